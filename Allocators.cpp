@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include "Allocators.h"
+
+
+// Counting replacements of the global allocation functions
+static std::atomic<long long> systemAllocationCount(0);
+
+long long GetSystemAllocationCount()
+{
+	return systemAllocationCount.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+	systemAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	systemAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+// Over-aligned types, e.g. alignas(16) SSE data, get memory from malloc rounded up to their
+// alignment, with malloc's own pointer kept just before the aligned one for delete
+static void* AlignedAllocate(size_t size, std::align_val_t align)
+{
+	size_t alignment = (size_t)align;
+	if (size > SIZE_MAX - alignment - sizeof(void*))
+		return NULL;
+	char* raw = (char*)malloc(size + alignment - 1 + sizeof(void*));
+	if (!raw)
+		return NULL;
+	void** memory = (void**)(((uintptr_t)raw + sizeof(void*) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	memory[-1] = raw;
+	return memory;
+}
+
+static void AlignedFree(void* memory)
+{
+	if (memory)
+		free(((void**)memory)[-1]);
+}
+
+void* operator new(size_t size, std::align_val_t align)
+{
+	systemAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* memory = AlignedAllocate(size ? size : 1, align);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t align)
+{
+	return operator new(size, align);
+}
+
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+	systemAllocationCount.fetch_add(1, std::memory_order_relaxed);
+	return AlignedAllocate(size ? size : 1, align);
+}
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+	return operator new(size, align, std::nothrow);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	AlignedFree(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	AlignedFree(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+	AlignedFree(memory);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept
+{
+	AlignedFree(memory);
+}
+
+
+FrameArena::FrameArena(size_t blockSize)
+{
+	this->blockSize = blockSize > 0 ? blockSize : 1;
+	currentBlock = -1;
+	offset = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+FrameArena::~FrameArena()
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+		::operator delete(blocks[i].memory);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	stats.allocations++;
+
+	// Move on through the kept blocks until one has room, then add a block if none has
+	while (true)
+	{
+		if (currentBlock >= 0)
+		{
+			Block& block = blocks[currentBlock];
+			size_t start = (size_t)(((uintptr_t)block.memory + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - (uintptr_t)block.memory;
+			if (start + size <= block.size)
+			{
+				stats.bytesInUse += start + size - offset;
+				if (stats.bytesInUse > stats.peakBytesInUse)
+					stats.peakBytesInUse = stats.bytesInUse;
+				offset = start + size;
+				return block.memory + start;
+			}
+		}
+
+		if (currentBlock + 1 < (int)blocks.size())
+		{
+			// the unused tail of the block counts as used until the reset
+			if (currentBlock >= 0)
+				stats.bytesInUse += blocks[currentBlock].size - offset;
+			currentBlock++;
+			offset = 0;
+			continue;
+		}
+
+		Block block;
+		block.size = size + alignment > blockSize ? size + alignment : blockSize;
+		block.memory = (char*)::operator new(block.size, std::nothrow);
+		if (!block.memory)
+			return NULL;
+		blocks.push_back(block);
+		stats.capacity += block.size;
+		stats.systemAllocations++;
+	}
+}
+
+void FrameArena::Reset()
+{
+	currentBlock = blocks.empty() ? -1 : 0;
+	offset = 0;
+	stats.bytesInUse = 0;
+}
+
+
+PoolAllocator::PoolAllocator(size_t blockSize, int blocksPerPage)
+{
+	// every free block holds the free list link
+	this->blockSize = blockSize < sizeof(void*) ? sizeof(void*) : (blockSize + 15) & ~(size_t)15;
+	this->blocksPerPage = blocksPerPage > 0 ? blocksPerPage : 1;
+	freeList = NULL;
+	memset(&stats, 0, sizeof(stats));
+}
+
+PoolAllocator::~PoolAllocator()
+{
+	for (size_t i = 0; i < pages.size(); i++)
+		::operator delete(pages[i]);
+}
+
+void* PoolAllocator::Allocate()
+{
+	if (!freeList)
+	{
+		char* page = (char*)::operator new(blockSize * blocksPerPage, std::nothrow);
+		if (!page)
+			return NULL;
+		pages.push_back(page);
+		stats.capacity += blockSize * blocksPerPage;
+		stats.systemAllocations++;
+
+		// thread the new blocks onto the free list, first block on top
+		for (int i = blocksPerPage - 1; i >= 0; i--)
+		{
+			void* block = page + i * blockSize;
+			*(void**)block = freeList;
+			freeList = block;
+		}
+	}
+
+	void* block = freeList;
+	freeList = *(void**)block;
+
+	stats.allocations++;
+	stats.bytesInUse += blockSize;
+	if (stats.bytesInUse > stats.peakBytesInUse)
+		stats.peakBytesInUse = stats.bytesInUse;
+	return block;
+}
+
+void PoolAllocator::Free(void* block)
+{
+	if (!block)
+		return;
+
+	*(void**)block = freeList;
+	freeList = block;
+	stats.bytesInUse -= blockSize;
+}
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Allocators.h
+//	Memory for per-frame scratch data and for mesh storage.
+//
+//	FrameArena hands out memory for data that only lives until the end of the frame (draw
+//	lists, matrices, culling results) by bumping an offset through blocks it keeps, and
+//	Reset() makes all of it free again at once. Once the blocks have grown to a frame's
+//	needs, frames allocate nothing from the system.
+//
+//	PoolAllocator hands out fixed size blocks from pages it keeps, freed blocks go on a
+//	free list and are reused first, so meshes of one size can come and go, e.g. terrain
+//	patches, without going back to the system.
+//
+//	Neither is thread safe. Objects are not constructed or destroyed, use them for plain
+//	data or construct in place.
+//
+//	Every global operator new is counted, over-aligned ones too, GetSystemAllocationCount()
+//	tells how many allocations the program has made so far.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ALLOCATORS_H
+#define ALLOCATORS_H
+
+#include <stddef.h>
+#include <vector>
+
+struct AllocationStats
+{
+	size_t bytesInUse;			// handed out and not yet freed or reset
+	size_t peakBytesInUse;
+	size_t capacity;			// bytes held from the system
+	long long allocations;		// calls to Allocate()
+	long long systemAllocations;// times the allocator went to the system for more memory
+};
+
+// Global operator new calls since the program started, from any thread
+long long GetSystemAllocationCount();
+
+class FrameArena
+{
+private:
+	struct Block
+	{
+		char* memory;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t blockSize;
+	int currentBlock;
+	size_t offset;			// in the current block
+	AllocationStats stats;
+
+public:
+	FrameArena(size_t blockSize = 1 << 20);
+	~FrameArena();
+
+	// alignment must be a power of two. Returns NULL only if the system is out of memory.
+	void* Allocate(size_t size, size_t alignment = 16);
+
+	template <class T>
+	T* AllocateArray(size_t count)
+	{
+		return (T*)Allocate(sizeof(T) * count, alignof(T));
+	}
+
+	// Frees everything allocated since the last reset, keeping the blocks
+	void Reset();
+
+	const AllocationStats& GetStats() const
+	{
+		return stats;
+	}
+};
+
+class PoolAllocator
+{
+private:
+	size_t blockSize;
+	int blocksPerPage;
+	std::vector<char*> pages;
+	void* freeList;
+	AllocationStats stats;
+
+public:
+	PoolAllocator(size_t blockSize, int blocksPerPage = 16);
+	~PoolAllocator();
+
+	// NULL only if the system is out of memory
+	void* Allocate();
+	void Free(void* block);
+
+	size_t GetBlockSize() const
+	{
+		return blockSize;
+	}
+
+	const AllocationStats& GetStats() const
+	{
+		return stats;
+	}
+};
+
+#endif	//ALLOCATORS_H
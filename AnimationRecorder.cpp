@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "AnimationRecorder.h"
+
+static const unsigned char logMagic[4] = { 'R', 'B', 'A', 'L' };
+static const unsigned char logVersion = 1;
+
+// Buffered bytes are written out once this many have accumulated
+static const size_t flushSize = 64 * 1024;
+
+static unsigned int FloatBits(float f)
+{
+	unsigned int bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+// Zigzag maps small signed deltas to small unsigned values so they varint-encode short
+static unsigned int ZigZag(unsigned int delta)
+{
+	int d = (int)delta;
+	return ((unsigned int)d << 1) ^ (unsigned int)(d >> 31);
+}
+
+static unsigned int UnZigZag(unsigned int value)
+{
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+static void WriteVarint(std::vector<unsigned char>& out, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((unsigned char)value);
+}
+
+
+AnimationRecorder::AnimationRecorder()
+{
+	file = NULL;
+	numChannels = 0;
+	writeFailed = false;
+	numRecords = 0;
+	totalRecordTime = 0.0;
+	maxRecordTime = 0.0;
+	memset(previous, 0, sizeof(previous));
+}
+
+bool AnimationRecorder::Open(const char* fileName, const float* const* channels, int numChannels)
+{
+	Close();
+
+	if (numChannels <= 0 || numChannels > MAX_RECORD_CHANNELS)
+		return false;
+
+	file = fopen(fileName, "wb");
+	if (!file)
+		return false;
+
+	this->numChannels = numChannels;
+	writeFailed = false;
+	numRecords = 0;
+	totalRecordTime = 0.0;
+	maxRecordTime = 0.0;
+	buffer.clear();
+	buffer.reserve(flushSize * 2);
+
+	// Header carries the starting state verbatim so deltas have a base
+	for (int i = 0; i < 4; i++)
+		buffer.push_back(logMagic[i]);
+	buffer.push_back(logVersion);
+	buffer.push_back((unsigned char)numChannels);
+	for (int i = 0; i < numChannels; i++)
+	{
+		previous[i] = FloatBits(*channels[i]);
+		for (int b = 0; b < 4; b++)
+			buffer.push_back((unsigned char)(previous[i] >> (8 * b)));
+	}
+
+	return true;
+}
+
+bool AnimationRecorder::Close()
+{
+	if (!file)
+		return !writeFailed;
+
+	Flush();
+	if (fclose(file) != 0)
+		writeFailed = true;
+	file = NULL;
+	return !writeFailed;
+}
+
+void AnimationRecorder::Flush()
+{
+	// A full disk or a lost file is reported once, the records after it are dropped
+	if (!buffer.empty() && !writeFailed && fwrite(&buffer[0], 1, buffer.size(), file) != buffer.size())
+	{
+		writeFailed = true;
+		fprintf(stderr, "record: could not write the log, it is truncated\n");
+	}
+	buffer.clear();
+}
+
+void AnimationRecorder::RecordTick(const float* const* channels)
+{
+	WriteRecord(RECORD_TICK, 0, channels);
+}
+
+void AnimationRecorder::RecordEvent(int type, int key, const float* const* channels)
+{
+	WriteRecord(type, key, channels);
+}
+
+void AnimationRecorder::WriteRecord(int type, int key, const float* const* channels)
+{
+	if (!file)
+		return;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	unsigned int mask = 0;
+	unsigned int deltas[MAX_RECORD_CHANNELS];
+	for (int i = 0; i < numChannels; i++)
+	{
+		unsigned int bits = FloatBits(*channels[i]);
+		if (bits != previous[i])
+		{
+			mask |= 1u << i;
+			deltas[i] = ZigZag(bits - previous[i]);
+			previous[i] = bits;
+		}
+	}
+
+	buffer.push_back((unsigned char)type);
+	if (type != RECORD_TICK)
+		WriteVarint(buffer, (unsigned int)key);
+	WriteVarint(buffer, mask);
+	for (int i = 0; i < numChannels; i++)
+	{
+		if (mask & (1u << i))
+			WriteVarint(buffer, deltas[i]);
+	}
+
+	if (buffer.size() >= flushSize)
+		Flush();
+
+	double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	numRecords++;
+	totalRecordTime += elapsed;
+	if (elapsed > maxRecordTime)
+		maxRecordTime = elapsed;
+}
+
+
+AnimationPlayer::AnimationPlayer()
+{
+	readPos = 0;
+	numChannels = 0;
+	memset(expected, 0, sizeof(expected));
+}
+
+bool AnimationPlayer::Open(const char* fileName, int numChannels)
+{
+	FILE* in = fopen(fileName, "rb");
+	if (!in)
+		return false;
+
+	data.clear();
+	unsigned char chunk[4096];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+		data.insert(data.end(), chunk, chunk + n);
+	fclose(in);
+
+	// Header must match this build's channel layout
+	size_t headerSize = 6 + 4 * (size_t)numChannels;
+	if (data.size() < headerSize || memcmp(&data[0], logMagic, 4) != 0 ||
+		data[4] != logVersion || data[5] != numChannels)
+	{
+		return false;
+	}
+
+	this->numChannels = numChannels;
+	for (int i = 0; i < numChannels; i++)
+	{
+		const unsigned char* p = &data[6 + 4 * i];
+		expected[i] = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+	}
+	readPos = headerSize;
+
+	return true;
+}
+
+bool AnimationPlayer::ReadVarint(unsigned int& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (readPos >= data.size())
+			return false;
+		unsigned char byte = data[readPos++];
+		value |= (unsigned int)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+AnimationReadStatus AnimationPlayer::NextRecord(int& type, int& key)
+{
+	if (readPos >= data.size())
+		return RECORD_END;
+
+	type = data[readPos++];
+	key = 0;
+	if (type > RECORD_SELECT_JOINT)
+		return RECORD_CORRUPT;
+	if (type != RECORD_TICK)
+	{
+		unsigned int k;
+		if (!ReadVarint(k))
+			return RECORD_CORRUPT;
+		key = (int)k;
+	}
+
+	// only the log's own channels can have changed
+	unsigned int mask;
+	if (!ReadVarint(mask))
+		return RECORD_CORRUPT;
+	if (numChannels < 32 && (mask >> numChannels) != 0)
+		return RECORD_CORRUPT;
+
+	for (int i = 0; i < numChannels; i++)
+	{
+		if (mask & (1u << i))
+		{
+			unsigned int delta;
+			if (!ReadVarint(delta))
+				return RECORD_CORRUPT;
+			expected[i] += UnZigZag(delta);
+		}
+	}
+
+	return RECORD_READ;
+}
+
+bool AnimationPlayer::Matches(const float* const* channels)
+{
+	for (int i = 0; i < numChannels; i++)
+	{
+		if (FloatBits(*channels[i]) != expected[i])
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	AnimationRecorder.h
+//	Records input events and per-tick joint angles to a compact binary log and plays
+//	the log back so a session can be reproduced exactly.
+//
+//	Log layout:
+//		header	"RBAL", version byte, channel count byte, initial channel values (raw floats)
+//		records	type byte [, key varint], changed channel mask varint, one varint per
+//				changed channel holding the zigzag delta of the float bit pattern
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ANIMATIONRECORDER_H
+#define ANIMATIONRECORDER_H
+
+#include <stdio.h>
+#include <vector>
+
+// Record types stored in the log
+enum AnimationRecordType
+{
+	RECORD_TICK = 0,		// one animation timer tick
+	RECORD_KEY = 1,			// keyboard() event
+	RECORD_SPECIAL_KEY = 2,	// functionKeys() event
+	RECORD_SELECT_JOINT = 3	// joint picked with the mouse, key is its channel plus one, 0 for none
+};
+
+const int MAX_RECORD_CHANNELS = 32;
+
+// What AnimationPlayer::NextRecord() found
+enum AnimationReadStatus
+{
+	RECORD_READ,		// a whole record was decoded
+	RECORD_END,			// the log ended cleanly after the last record
+	RECORD_CORRUPT		// the log ends inside a record or holds one this build cannot decode
+};
+
+class AnimationRecorder
+{
+private:
+	FILE* file;
+	int numChannels;
+	unsigned int previous[MAX_RECORD_CHANNELS];
+	std::vector<unsigned char> buffer;
+	bool writeFailed;		// some of the log could not be written, the file is truncated
+
+	// Overhead bookkeeping, in microseconds
+	int numRecords;
+	double totalRecordTime;
+	double maxRecordTime;
+
+private:
+	void WriteRecord(int type, int key, const float* const* channels);
+	void Flush();
+
+public:
+	AnimationRecorder();
+
+	~AnimationRecorder()
+	{
+		Close();
+	}
+
+	bool Open(const char* fileName, const float* const* channels, int numChannels);
+
+	// Writes out what is buffered, false when any of the log failed to reach the file
+	bool Close();
+
+	bool IsRecording()
+	{
+		return file != NULL;
+	}
+
+	void RecordTick(const float* const* channels);
+	void RecordEvent(int type, int key, const float* const* channels);
+
+	double GetAverageRecordTime()
+	{
+		return numRecords > 0 ? totalRecordTime / numRecords : 0.0;
+	}
+
+	double GetMaxRecordTime()
+	{
+		return maxRecordTime;
+	}
+
+	bool HasWriteFailed()
+	{
+		return writeFailed;
+	}
+};
+
+class AnimationPlayer
+{
+private:
+	std::vector<unsigned char> data;
+	size_t readPos;
+	int numChannels;
+	unsigned int expected[MAX_RECORD_CHANNELS];
+
+private:
+	bool ReadVarint(unsigned int& value);
+
+public:
+	AnimationPlayer();
+
+	bool Open(const char* fileName, int numChannels);
+
+	// Decodes the next record and its expected joint state, see AnimationReadStatus
+	AnimationReadStatus NextRecord(int& type, int& key);
+
+	// Bitwise comparison of the current joint state with the decoded one
+	bool Matches(const float* const* channels);
+};
+
+#endif	//ANIMATIONRECORDER_H
@@ -0,0 +1,2689 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <vector>
+#include "VECTOR3D.h"
+#include "QuadMesh.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "RobotFleet.h"
+#include "JobSystem.h"
+#include "FramePipeline.h"
+#include "Collision.h"
+#include "Heightfield.h"
+#include "Terrain.h"
+#include "MeshOptimizer.h"
+#include "VertexQuantizer.h"
+#include "Allocators.h"
+#include "Shadows.h"
+#include "RedrawScheduler.h"
+#include "Camera.h"
+#include "MultiView.h"
+#include "Skinning.h"
+#include "JointTrails.h"
+#include "Particles.h"
+#include "Picking.h"
+#include "JointRegistry.h"
+#include "RobotPhysics.h"
+#include "OcclusionCulling.h"
+#include "RobotVariants.h"
+#include "Telemetry.h"
+
+#include "Benchmarks.h"
+
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double MillisecondsSince(BenchClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+static bool SameFleetState(RobotFleet& a, RobotFleet& b)
+{
+	for (int i = 0; i < a.GetNumRobots(); i++)
+	{
+		RobotPose poseA = a.GetPose(i), poseB = b.GetPose(i);
+		if (memcmp(a.GetPartMatrices(i), b.GetPartMatrices(i), sizeof(MATRIX4X4) * NUM_ROBOT_PARTS) != 0 ||
+			memcmp(&a.GetBounds(i), &b.GetBounds(i), sizeof(BBox)) != 0 ||
+			memcmp(&poseA, &poseB, sizeof(RobotPose)) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Parallel fleet update must produce exactly the serial results
+static int FleetCheck()
+{
+	const int numRobots = 10000;
+	const int numTicks = 200;
+	RobotDimensions dims;
+
+	RobotFleet serial, parallel;
+	serial.Init(numRobots, 8.0f, dims);
+	parallel.Init(numRobots, 8.0f, dims);
+
+	JobSystem jobs(4);
+	for (int t = 0; t < numTicks; t++)
+	{
+		serial.Update(NULL);
+		parallel.Update(&jobs, NULL, 64);
+	}
+
+	bool same = SameFleetState(serial, parallel);
+	printf("fleet check: %d robots, %d ticks, %d threads: %s\n",
+		numRobots, numTicks, jobs.GetNumThreads(), same ? "identical" : "MISMATCH");
+	return same ? 0 : 1;
+}
+
+// Fleet update throughput for 10k to 1M robots on 1..N threads
+static int FleetBenchmark()
+{
+	const int sizes[] = { 10000, 100000, 1000000 };
+	const int frames[] = { 20, 5, 2 };
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+		maxThreads = 1;
+
+	RobotDimensions dims;
+	printf("%10s %8s %12s %14s %8s\n", "robots", "threads", "ms/frame", "robots/s", "speedup");
+	for (int s = 0; s < 3; s++)
+	{
+		RobotFleet fleet;
+		fleet.Init(sizes[s], 8.0f, dims);
+
+		double serialTime = 0.0;
+		for (int threads = 1; threads <= maxThreads; threads++)
+		{
+			JobSystem jobs(threads);
+			fleet.Update(&jobs);	// warm up
+
+			BenchClock::time_point start = BenchClock::now();
+			for (int f = 0; f < frames[s]; f++)
+				fleet.Update(&jobs);
+			double frameTime = MillisecondsSince(start) / frames[s];
+			if (threads == 1)
+				serialTime = frameTime;
+
+			printf("%10d %8d %12.3f %14.0f %8.2f\n", sizes[s], threads, frameTime,
+				sizes[s] / (frameTime * 0.001), serialTime / frameTime);
+		}
+	}
+	return 0;
+}
+
+// Stand-in for render submission: what GL does per part on glMultMatrixf
+static float SubmitFleetFrame(const FleetFrame& frame, const MATRIX4X4& view)
+{
+	float checksum = 0.0f;
+	for (size_t i = 0; i < frame.partMatrices.size(); i++)
+	{
+		MATRIX4X4 modelView = view * frame.partMatrices[i];
+		checksum += modelView.entries[12] + modelView.entries[13] + modelView.entries[14];
+	}
+	return checksum;
+}
+
+// Serial simulate-then-submit loop against the triple buffered pipeline
+static int PipelineBenchmark()
+{
+	const int numRobots = 100000;
+	const int numFrames = 30;
+	RobotDimensions dims;
+	MATRIX4X4 view;
+	view.Translate(0.0f, -6.0f, -22.0f);
+	float checksum = 0.0f;
+	int result = 0;
+
+	printf("%10s %12s %14s %14s %12s\n", "loop", "frames/s", "avg lat ms", "max lat ms", "simulated");
+
+	// serial: every frame simulates, then submits
+	{
+		RobotFleet fleet;
+		fleet.Init(numRobots, 8.0f, dims);
+		JobSystem jobs;
+
+		double totalLatency = 0.0, maxLatency = 0.0;
+		BenchClock::time_point start = BenchClock::now();
+		for (int f = 0; f < numFrames; f++)
+		{
+			BenchClock::time_point frameStart = BenchClock::now();
+			fleet.Update(&jobs);
+			checksum += SubmitFleetFrame(fleet.GetFrame(), view);
+			double latency = MillisecondsSince(frameStart);
+			totalLatency += latency;
+			if (latency > maxLatency)
+				maxLatency = latency;
+		}
+		double elapsed = MillisecondsSince(start);
+		printf("%10s %12.1f %14.3f %14.3f %12d\n", "serial", numFrames / (elapsed * 0.001),
+			totalLatency / numFrames, maxLatency, numFrames);
+	}
+
+	// pipelined: simulation thread runs ahead while the previous snapshot is submitted
+	{
+		RobotFleet fleet;
+		fleet.Init(numRobots, 8.0f, dims);
+		FramePipeline pipeline;
+
+		double totalLatency = 0.0, maxLatency = 0.0;
+		int numFramesDrawn = 0;
+		BenchClock::time_point start = BenchClock::now();
+		pipeline.Start(&fleet, 0, 0);
+		for (int f = 0; f < numFrames; f++)
+		{
+			const FrameSnapshot* snapshot = pipeline.WaitForNext();
+			if (!snapshot)
+			{
+				printf("pipeline: no frame after %d, the simulation thread stopped\n", f);
+				result = 1;
+				break;
+			}
+			numFramesDrawn++;
+			checksum += SubmitFleetFrame(snapshot->fleet, view);
+			double latency = MillisecondsSince(snapshot->simulationStart);
+			totalLatency += latency;
+			if (latency > maxLatency)
+				maxLatency = latency;
+		}
+		double elapsed = MillisecondsSince(start);
+		pipeline.Stop();
+		if (numFramesDrawn > 0)
+			printf("%10s %12.1f %14.3f %14.3f %12lld\n", "pipelined", numFramesDrawn / (elapsed * 0.001),
+				totalLatency / numFramesDrawn, maxLatency, pipeline.GetNumFramesSimulated());
+	}
+
+	// Latency counts from a snapshot's simulation start, so it includes the frame it waits
+	// while the previous one is drawn. The overlap needs a hardware thread for each stage.
+	unsigned int numHardwareThreads = std::thread::hardware_concurrency();
+	if (numHardwareThreads < 2)
+		printf("(one hardware thread: simulation and drawing cannot overlap, no speedup is expected)\n");
+	printf("(%d robots, checksum %g)\n", numRobots, checksum);
+	return result;
+}
+
+// Ground and part-vs-part contact queries for 10k robots standing on a 1024 x 1024 mesh
+static int ContactBenchmark()
+{
+	const int numRobots = 10000;
+	const int groundSize = 1024;
+	const float spacing = 8.0f;
+	const int numFrames = 10;
+	RobotDimensions dims;
+
+	RobotFleet fleet;
+	fleet.Init(numRobots, spacing, dims);
+	fleet.Update(NULL);
+
+	// Ground just above the lowest foot so the feet really touch it
+	float lowest = 1e30f;
+	for (int i = 0; i < numRobots; i++)
+		lowest = fleet.GetBounds(i).min.y < lowest ? fleet.GetBounds(i).min.y : lowest;
+
+	int side = (int)ceil(sqrt((double)numRobots));
+	float extent = side * spacing + spacing;
+	QuadMesh ground(groundSize, extent);
+	ground.InitMesh(groundSize, VECTOR3D(-0.5f * extent, 0.0f, 0.5f * extent), extent, extent,
+		VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f));
+	VECTOR3D groundOffset(0.0f, lowest + 0.25f, 0.0f);
+
+	CollisionWorld world;
+	std::vector<GroundContact> groundContacts;
+	std::vector<PartContact> partContacts;
+	double buildTime = 0.0, groundTime = 0.0, partTime = 0.0;
+
+	for (int f = 0; f < numFrames; f++)
+	{
+		fleet.Update(NULL);
+
+		BenchClock::time_point start = BenchClock::now();
+		world.Clear();
+		for (int i = 0; i < numRobots; i++)
+			world.AddRobot(i, fleet.GetPartMatrices(i));
+		buildTime += MillisecondsSince(start);
+
+		start = BenchClock::now();
+		world.FindGroundContacts(ground, groundOffset, groundContacts);
+		groundTime += MillisecondsSince(start);
+
+		start = BenchClock::now();
+		world.FindPartContacts(partContacts);
+		partTime += MillisecondsSince(start);
+	}
+
+	printf("contacts: %d robots, %d parts, %dx%d ground\n", numRobots, world.GetNumColliders(), groundSize, groundSize);
+	printf("  build colliders  %8.3f ms/frame\n", buildTime / numFrames);
+	printf("  ground contacts  %8.3f ms/frame  (%d contacts)\n", groundTime / numFrames, (int)groundContacts.size());
+	printf("  part contacts    %8.3f ms/frame  (%d contacts)\n", partTime / numFrames, (int)partContacts.size());
+	return 0;
+}
+
+// Heightfield ground generation for 1024 and 4096 grids, serial and on every thread
+static int TerrainBenchmark()
+{
+	const int sizes[] = { 1024, 4096 };
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+		maxThreads = 1;
+	int result = 0;
+
+	printf("%6s %8s %12s %12s %14s %14s %12s\n", "grid", "threads", "scalar ms", "noise ms", "heightfield ms", "flat ms", "max error");
+	for (int s = 0; s < 2; s++)
+	{
+		int size = sizes[s];
+		QuadMesh mesh(size, 1.0f);
+		VECTOR3D origin(-0.5f * size, 0.0f, 0.5f * size);
+		VECTOR3D dir1(1.0f, 0.0f, 0.0f), dir2(0.0f, 0.0f, -1.0f);
+
+		// the old path, flat grid with per-quad cross product normals
+		BenchClock::time_point start = BenchClock::now();
+		mesh.InitMesh(size, origin, size, size, dir1, dir2);
+		double flatTime = MillisecondsSince(start);
+
+		// the SSE kernel is checked against the scalar noise on one thread
+		Heightfield reference;
+		start = BenchClock::now();
+		reference.GenerateNoiseReference(size + 1, size + 1, 6, 8.0f, 20.0f, 7);
+		double scalarTime = MillisecondsSince(start);
+
+		for (int threads = 1; threads <= maxThreads; threads = threads < maxThreads ? maxThreads : threads + 1)
+		{
+			JobSystem jobs(threads);
+			Heightfield heights;
+
+			start = BenchClock::now();
+			heights.GenerateNoise(size + 1, size + 1, 6, 8.0f, 20.0f, 7, &jobs);
+			double noiseTime = MillisecondsSince(start);
+
+			float maxError = 0.0f;
+			for (int y = 0; y <= size; y++)
+			{
+				for (int x = 0; x <= size; x++)
+					maxError = fmax(maxError, fabs(heights.Get(x, y) - reference.Get(x, y)));
+			}
+			bool ok = maxError < 1e-4f;
+			if (!ok)
+				result = 1;
+
+			start = BenchClock::now();
+			mesh.InitMesh(size, origin, size, size, dir1, dir2, &heights, &jobs);
+			double meshTime = MillisecondsSince(start);
+
+			printf("%6d %8d %12.1f %12.1f %14.1f %14.1f %12g  %s\n", size, threads, scalarTime, noiseTime, meshTime, flatTime,
+				maxError, ok ? "ok" : "FAILED");
+		}
+	}
+	return result;
+}
+
+// Quadtree terrain selection for 4096 and 16384 grids seen from a camera near the ground,
+// looking around in eight directions. The terrain has the same features per unit length
+// at both sizes, only more of it.
+static int QuadtreeBenchmark()
+{
+	const int sizes[] = { 4096, 16384 };
+	const int patchSize = 32;
+	const int viewWidth = 1920, viewHeight = 1080;
+	const int repeats = 20;
+
+	JobSystem jobs;
+	MATRIX4X4 projection = MATRIX4X4::GetPerspective(60.0f, (float)viewWidth / viewHeight, 1.0f, 10000.0f);
+
+	printf("%6s %10s %10s %10s %8s %10s %12s %14s\n", "grid", "noise ms", "tree ms", "nodes", "patches", "triangles", "select ms", "full grid tris");
+	for (int s = 0; s < 2; s++)
+	{
+		int size = sizes[s];
+		Heightfield heights;
+		Terrain terrain;
+
+		BenchClock::time_point start = BenchClock::now();
+		heights.GenerateNoise(size + 1, size + 1, 4, size / 1024.0f, 60.0f, 11, &jobs);
+		double noiseTime = MillisecondsSince(start);
+
+		start = BenchClock::now();
+		VECTOR3D origin(-0.5f * size, 0.0f, 0.5f * size);
+		if (!terrain.Init(&heights, patchSize, 1.0f, origin, &jobs))
+		{
+			printf("%6d terrain init failed\n", size);
+			return 1;
+		}
+		double treeTime = MillisecondsSince(start);
+
+		VECTOR3D eye(0.0f, heights.Get(size / 2, size / 2) + 30.0f, 0.0f);
+		double selectTime = 0.0;
+		long long patches = 0, triangles = 0;
+		for (int d = 0; d < 8; d++)
+		{
+			float yaw = d * 3.14159265f / 4.0f;
+			VECTOR3D centre = eye + VECTOR3D((float)sin(yaw), -0.15f, -(float)cos(yaw));
+			TerrainView view;
+			view.Set(MATRIX4X4::GetLookAt(eye, centre, VECTOR3D(0.0f, 1.0f, 0.0f)), projection, viewHeight, 2.0f);
+
+			start = BenchClock::now();
+			for (int r = 0; r < repeats; r++)
+				terrain.Select(view);
+			selectTime += MillisecondsSince(start) / repeats;
+
+			patches += terrain.GetSelection().size();
+			triangles += terrain.GetSelectedTriangles();
+		}
+
+		printf("%6d %10.0f %10.0f %10d %8lld %10lld %12.3f %14.0f\n", size, noiseTime, treeTime, terrain.GetNumNodes(),
+			patches / 8, triangles / 8, selectTime / 8, 2.0 * size * size);
+	}
+	return 0;
+}
+
+// Optimises one mesh and prints its ACMR before and after, as lists and as strips
+static void OptimizeAndReport(const char* label, IndexedMesh& mesh, const int cacheSizes[2])
+{
+	float before[2], after[2], strips[2];
+	for (int c = 0; c < 2; c++)
+		before[c] = ComputeACMR(mesh, cacheSizes[c]);
+	size_t listIndices = mesh.indices.size();
+
+	BenchClock::time_point start = BenchClock::now();
+	OptimizeVertexCache(mesh);
+	double optimizeTime = MillisecondsSince(start);
+	for (int c = 0; c < 2; c++)
+		after[c] = ComputeACMR(mesh, cacheSizes[c]);
+
+	start = BenchClock::now();
+	BuildStrips(mesh);
+	double stripTime = MillisecondsSince(start);
+	for (int c = 0; c < 2; c++)
+		strips[c] = ComputeACMR(mesh, cacheSizes[c]);
+
+	printf("%-16s %9d %6.3f %6.3f %6.3f %6.3f %6.3f %6.3f %7.2f %10.1f %9.1f\n", label, mesh.GetNumTriangles(),
+		before[0], after[0], strips[0], before[1], after[1], strips[1],
+		(double)mesh.indices.size() / listIndices, optimizeTime, stripTime);
+}
+
+// Triangles of a mesh by the vertex numbers stored in position.x, each rotated to start at
+// its smallest, sorted
+static std::vector<unsigned long long> SortedTriangles(const IndexedMesh& mesh)
+{
+	std::vector<unsigned long long> triangles(mesh.indices.size() / 3);
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		unsigned int v[3];
+		for (int k = 0; k < 3; k++)
+			v[k] = (unsigned int)mesh.vertices[mesh.indices[3 * t + k]].position.x;
+		int first = v[0] <= v[1] && v[0] <= v[2] ? 0 : (v[1] <= v[2] ? 1 : 2);
+		triangles[t] = 0;
+		for (int k = 0; k < 3; k++)
+			triangles[t] = (triangles[t] << 21) | v[(first + k) % 3];
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Vertex cache optimisation of the robot primitives, then of million triangle meshes
+static int MeshOptimizerBenchmark()
+{
+	// the largest cache the optimiser models must still emit every triangle once
+	IndexedMesh largest;
+	BuildSphereMesh(64, 32, largest);
+	for (size_t v = 0; v < largest.vertices.size(); v++)
+		largest.vertices[v].position.x = (float)v;
+	std::vector<unsigned long long> original = SortedTriangles(largest);
+	OptimizeVertexCache(largest, 64);
+	bool same = SortedTriangles(largest) == original;
+	printf("64 entry cache keeps the sphere's triangles  %s\n", same ? "ok" : "FAILED");
+	if (!same)
+		return 1;
+
+	const int cacheSizes[2] = { 16, 32 };
+	printf("%-16s %9s %20s %20s %7s %10s %9s\n", "", "", "ACMR, 16 entries", "ACMR, 32 entries", "strip", "", "");
+	printf("%-16s %9s %6s %6s %6s %6s %6s %6s %7s %10s %9s\n", "mesh", "triangles",
+		"before", "after", "strips", "before", "after", "strips", "indices", "optimize ms", "strips ms");
+
+	IndexedMesh mesh;
+	BuildSphereMesh(100, 100, mesh);
+	OptimizeAndReport("sphere 100x100", mesh, cacheSizes);
+	BuildCylinderMesh(100, 100, mesh);
+	OptimizeAndReport("cylinder 100x100", mesh, cacheSizes);
+	BuildCylinderMesh(50, 50, mesh);
+	OptimizeAndReport("cylinder 50x50", mesh, cacheSizes);
+	BuildCubeMesh(mesh);
+	OptimizeAndReport("cube", mesh, cacheSizes);
+
+	// 708 x 708 quads is just over a million triangles
+	const int size = 708;
+	QuadMesh grid(size, 1.0f);
+	grid.InitMesh(size, VECTOR3D(0.0f, 0.0f, 0.0f), size, size, VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f));
+	BuildQuadMeshTriangles(grid, mesh);
+	OptimizeAndReport("quad mesh 708", mesh, cacheSizes);
+	BuildSphereMesh(size, size, mesh);
+	OptimizeAndReport("sphere 708x708", mesh, cacheSizes);
+	return 0;
+}
+
+// Encodes and decodes one vertex array in both compact formats, printing sizes, speed and errors
+static void QuantizeAndReport(const char* label, const MeshVertex* vertices, int count)
+{
+	const int stride = sizeof(MeshVertex);
+	std::vector<MeshVertex> decoded(count);
+
+	for (int bits = 8; bits <= 16; bits += 8)
+	{
+		CompactMesh compact;
+		BenchClock::time_point start = BenchClock::now();
+		compact.Encode(&vertices[0].position, &vertices[0].normal, stride, count, bits == 16);
+		double encodeTime = MillisecondsSince(start);
+
+		start = BenchClock::now();
+		compact.Decode(&decoded[0].position, &decoded[0].normal, stride);
+		double decodeTime = MillisecondsSince(start);
+
+		float positionError = 0.0f, normalError = 0.0f;
+		double normalErrorSum = 0.0;
+		for (int i = 0; i < count; i++)
+		{
+			VECTOR3D d = decoded[i].position - vertices[i].position;
+			if (fabs(d.x) > positionError) positionError = (float)fabs(d.x);
+			if (fabs(d.y) > positionError) positionError = (float)fabs(d.y);
+			if (fabs(d.z) > positionError) positionError = (float)fabs(d.z);
+
+			float cosine = decoded[i].normal.DotProduct(vertices[i].normal);
+			float angle = (float)(acos(cosine > 1.0f ? 1.0f : cosine) * 180.0 / 3.14159265358979);
+			normalErrorSum += angle;
+			if (angle > normalError)
+				normalError = angle;
+		}
+		VECTOR3D bound = compact.GetPositionErrorBound();
+		float positionBound = bound.x > bound.y ? (bound.x > bound.z ? bound.x : bound.z) : (bound.y > bound.z ? bound.y : bound.z);
+
+		printf("%-14s %9d %3d %8.1f %8.1f %6.2fx %9.1f %9.1f %10.2e %10.2e %9.4f %9.4f\n", label, count, bits,
+			count * sizeof(MeshVertex) / 1048576.0, compact.GetMemorySize() / 1048576.0,
+			(double)(count * sizeof(MeshVertex)) / compact.GetMemorySize(),
+			count / encodeTime / 1000.0, count / decodeTime / 1000.0,
+			positionError, positionBound, normalError, normalErrorSum / count);
+	}
+}
+
+// Compact vertex formats for terrain grids of 1024^2 and up and for the body sphere
+static int QuantizeBenchmark()
+{
+	printf("%-14s %9s %3s %8s %8s %7s %9s %9s %10s %10s %9s %9s\n", "mesh", "vertices", "nrm",
+		"float MB", "comp MB", "saving", "enc Mv/s", "dec Mv/s", "pos err", "pos bound", "max deg", "mean deg");
+
+	IndexedMesh sphere;
+	BuildSphereMesh(100, 100, sphere);
+	std::vector<MeshVertex> sphereVertices(sphere.vertices.size());
+	for (size_t i = 0; i < sphere.vertices.size(); i++)
+	{
+		sphereVertices[i].position = sphere.vertices[i].position;
+		sphereVertices[i].normal = sphere.vertices[i].normal;
+	}
+	QuantizeAndReport("sphere", &sphereVertices[0], (int)sphereVertices.size());
+
+	const int sizes[] = { 1024, 2048, 4096 };
+	for (int s = 0; s < 3; s++)
+	{
+		int size = sizes[s];
+		Heightfield heights;
+		heights.GenerateNoise(size + 1, size + 1, 4, 8.0f, 20.0f, 3);
+		QuadMesh grid(size, 1.0f);
+		grid.InitMesh(size, VECTOR3D(-0.5f * size, 0.0f, 0.5f * size), size, size,
+			VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f), &heights);
+
+		char label[32];
+		sprintf(label, "grid %d", size);
+		QuantizeAndReport(label, &grid.GetVertex(0, 0), (size + 1) * (size + 1));
+	}
+	return 0;
+}
+
+struct alignas(64) AlignedProbe
+{
+	float values[16];
+};
+
+// A steady state frame must not allocate: fleet update on the job system, culling and a
+// draw list in the frame arena, contact queries and terrain selection. Fails when any
+// global operator new happens after the warm-up frames.
+static int FrameAllocationCheck()
+{
+	const int numRobots = 1024;
+	const int warmupFrames = 30;
+	const int checkedFrames = 300;
+
+	// over-aligned types go through their own operator new, which must be counted as well
+	long long probeStart = GetSystemAllocationCount();
+	AlignedProbe* probe = new AlignedProbe;
+	AlignedProbe* probes = new AlignedProbe[3];
+	bool probesAligned = ((uintptr_t)probe % alignof(AlignedProbe)) == 0 && ((uintptr_t)probes % alignof(AlignedProbe)) == 0;
+	delete probe;
+	delete[] probes;
+	bool probesCounted = GetSystemAllocationCount() - probeStart == 2;
+	printf("over-aligned allocations counted and aligned: %s\n", probesCounted && probesAligned ? "ok" : "FAILED");
+	if (!probesCounted || !probesAligned)
+		return 1;
+
+	JobSystem jobs(4);
+	RobotDimensions dims;
+	RobotFleet fleet;
+	fleet.Init(numRobots, 8.0f, dims);
+
+	VECTOR3D origin(-16.0f, 0.0f, 16.0f);
+	QuadMesh ground(16, 32.0f);
+	ground.InitMesh(16, origin, 32.0, 32.0, VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f));
+	Heightfield heights;
+	heights.GenerateNoise(257, 257, 4, 3.0f, 2.0f, 1);
+	Terrain terrain;
+	terrain.Init(&heights, 16, 0.125f, origin);
+
+	CollisionWorld world;
+	std::vector<GroundContact> groundContacts;
+	std::vector<PartContact> partContacts;
+	FrameArena arena;
+	MATRIX4X4 projection = MATRIX4X4::GetPerspective(60.0f, 1.0f, 0.2f, 400.0f);
+	VECTOR3D groundOffset(0.0f, -2.5f * dims.robotBodySize, 0.0f);
+	int numDrawn = 0;
+
+	auto frame = [&](int f)
+	{
+		arena.Reset();
+		fleet.Update(&jobs, NULL, 64);
+
+		// camera circles the fleet
+		float angle = f * 0.01f;
+		VECTOR3D eye(150.0f * (float)sin(angle), 40.0f, 150.0f * (float)cos(angle));
+		MATRIX4X4 view = MATRIX4X4::GetLookAt(eye, VECTOR3D(0.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 1.0f, 0.0f));
+		Frustum frustum;
+		frustum.Extract(projection * view);
+
+		int* visible = arena.AllocateArray<int>(numRobots);
+		int numVisible = 0;
+		for (int i = 0; i < numRobots; i++)
+		{
+			const BBox& bounds = fleet.GetBounds(i);
+			if (frustum.ClassifyBox(bounds.min, bounds.max) != FRUSTUM_OUTSIDE)
+				visible[numVisible++] = i;
+		}
+
+		MATRIX4X4* drawList = arena.AllocateArray<MATRIX4X4>((size_t)numVisible * NUM_ROBOT_PARTS);
+		for (int i = 0; i < numVisible; i++)
+		{
+			const MATRIX4X4* parts = fleet.GetPartMatrices(visible[i]);
+			for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+				drawList[i * NUM_ROBOT_PARTS + p] = view * parts[p];
+		}
+		numDrawn += numVisible;
+
+		world.Clear();
+		for (int i = 0; i < numVisible && i < 64; i++)
+			world.AddRobot(visible[i], fleet.GetPartMatrices(visible[i]));
+		world.FindGroundContacts(ground, groundOffset, groundContacts);
+		world.FindPartContacts(partContacts, &arena);
+
+		TerrainView terrainView;
+		terrainView.Set(view, projection, 600, 1.0f);
+		terrain.Select(terrainView);
+	};
+
+	for (int f = 0; f < warmupFrames; f++)
+		frame(f);
+
+	long long before = GetSystemAllocationCount();
+	for (int f = warmupFrames; f < warmupFrames + checkedFrames; f++)
+		frame(f);
+	long long allocations = GetSystemAllocationCount() - before;
+
+	const AllocationStats& stats = arena.GetStats();
+	printf("frame allocations: %d robots, %d frames, %.0f robots drawn per frame\n",
+		numRobots, checkedFrames, (double)numDrawn / (warmupFrames + checkedFrames));
+	printf("frame arena: %zu bytes peak, %zu bytes capacity, %lld blocks allocated\n",
+		stats.peakBytesInUse, stats.capacity, stats.systemAllocations);
+	printf("system allocations in steady state frames: %lld: %s\n", allocations, allocations == 0 ? "ok" : "FAILED");
+	return allocations == 0 ? 0 : 1;
+}
+
+
+// Reference image for the shadow maps: ground mask texels covered by the map's shapes
+// flattened onto the plane from the light. The ground's vertices are offset by
+// groundOffset, the mask is laid out by the planes from GetShadowMaskPlanes().
+static void RasterizePlanarShadow(const ShadowMap& map, const ShadowCaster* casters, int numCasters,
+								  const VECTOR3D& light, const VECTOR3D& groundOffset, const float sPlane[4],
+								  const float tPlane[4], int maskSize, std::vector<unsigned char>& coverage)
+{
+	const float plane[] = { 0.0f, 1.0f, 0.0f, -groundOffset.y };
+	const float lightPosition[] = { light.x, light.y, light.z, 1.0f };
+	MATRIX4X4 shadow = MATRIX4X4::GetPlanarShadow(plane, lightPosition);
+	coverage.assign((size_t)maskSize * maskSize, 0);
+
+	std::vector<float> texels;
+	for (int c = 0; c < numCasters; c++)
+	{
+		for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+		{
+			MATRIX4X4 part = casters[c].partMatrices[p];
+			part.entries[12] += casters[c].offset.x;
+			part.entries[13] += casters[c].offset.y;
+			part.entries[14] += casters[c].offset.z;
+			MATRIX4X4 flatten = shadow * part;
+
+			const IndexedMesh& shape = map.GetShape(robotParts[p].shape);
+			texels.resize(shape.vertices.size() * 2);
+			for (size_t v = 0; v < shape.vertices.size(); v++)
+			{
+				const VECTOR3D& q = shape.vertices[v].position;
+				const float* m = flatten.entries;
+				float w = m[3] * q.x + m[7] * q.y + m[11] * q.z + m[15];
+				VECTOR3D onPlane = flatten.TransformPoint(q) / w - groundOffset;
+				texels[2 * v] = maskSize * (sPlane[0] * onPlane.x + sPlane[2] * onPlane.z + sPlane[3]);
+				texels[2 * v + 1] = maskSize * (tPlane[0] * onPlane.x + tPlane[2] * onPlane.z + tPlane[3]);
+			}
+
+			for (size_t t = 0; t + 2 < shape.indices.size(); t += 3)
+			{
+				const float* a = &texels[2 * shape.indices[t]];
+				const float* b = &texels[2 * shape.indices[t + 1]];
+				const float* c = &texels[2 * shape.indices[t + 2]];
+				float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+				if (area == 0.0f)
+					continue;
+
+				int minX = (int)floor(std::min(a[0], std::min(b[0], c[0])));
+				int maxX = (int)ceil(std::max(a[0], std::max(b[0], c[0])));
+				int minY = (int)floor(std::min(a[1], std::min(b[1], c[1])));
+				int maxY = (int)ceil(std::max(a[1], std::max(b[1], c[1])));
+				for (int y = std::max(minY, 0); y <= std::min(maxY, maskSize - 1); y++)
+				{
+					for (int x = std::max(minX, 0); x <= std::min(maxX, maskSize - 1); x++)
+					{
+						float px = x + 0.5f, py = y + 0.5f;
+						float wa = ((b[0] - px) * (c[1] - py) - (b[1] - py) * (c[0] - px)) / area;
+						float wb = ((c[0] - px) * (a[1] - py) - (c[1] - py) * (a[0] - px)) / area;
+						if (wa >= 0.0f && wb >= 0.0f && wa + wb <= 1.0f)
+							coverage[(size_t)y * maskSize + x] = 1;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Lights of the window, placed in eye coordinates, moved into the robot's frame for the
+// default camera
+static void GetDefaultShadowLights(VECTOR3D lights[2])
+{
+	MATRIX4X4 view = MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 6.0f, 22.0f), VECTOR3D(0.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 1.0f, 0.0f));
+	MATRIX4X4 eyeToWorld = view.GetRigidInverse();
+	lights[0] = eyeToWorld.TransformPoint(VECTOR3D(-4.0f, 8.0f, 8.0f));
+	lights[1] = eyeToWorld.TransformPoint(VECTOR3D(4.0f, 8.0f, 8.0f));
+}
+
+// Headless image tests of the shadow maps against planar projection, the render caching,
+// and the per frame cost of every shadow stage with the fleet in view
+static int ShadowBenchmark()
+{
+	const int maskSize = 256;
+	const float minOverlap = 0.9f;
+	int result = 0;
+
+	RobotDimensions dims;
+	VECTOR3D groundOffset(0.0f, -10.0f, 0.0f);
+	QuadMesh ground(16, 32.0f);
+	ground.InitMesh(16, VECTOR3D(-16.0f, 0.0f, 16.0f), 32.0, 32.0, VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f));
+	float sPlane[4], tPlane[4];
+	GetShadowMaskPlanes(ground, sPlane, tPlane);
+
+	VECTOR3D lights[2];
+	GetDefaultShadowLights(lights);
+	ShadowMap maps[2];
+	const ShadowMap* mapList[] = { &maps[0], &maps[1] };
+	std::vector<unsigned char> mask((size_t)maskSize * maskSize);
+	std::vector<unsigned char> coverage;
+
+	// Image tests: the standing robot and the robot turned mid-step, each light alone
+	RobotPose pose;
+	RobotAnimation animation;
+	MATRIX4X4 root;
+	MATRIX4X4 partMatrices[NUM_ROBOT_PARTS];
+	for (int scene = 0; scene < 2; scene++)
+	{
+		if (scene == 1)
+		{
+			StartStepAnimation(pose, animation);
+			for (int i = 0; i < 25; i++)
+				AnimateRobot(pose, animation);
+			pose.angles[JOINT_ROBOT_SPIN] = 30.0f;
+		}
+		ComputeRobotTransforms(dims, pose, root, partMatrices);
+		ShadowCaster caster = { partMatrices, VECTOR3D(0.0f, 0.0f, 0.0f) };
+
+		for (int l = 0; l < 2; l++)
+		{
+			maps[l].Render(lights[l], &caster, 1);
+			BuildShadowMask(&mapList[l], 1, ground, groundOffset, 0.0f, maskSize, &mask[0]);
+			RasterizePlanarShadow(maps[l], &caster, 1, lights[l], groundOffset, sPlane, tPlane, maskSize, coverage);
+
+			int mapped = 0, planar = 0, both = 0;
+			for (size_t i = 0; i < mask.size(); i++)
+			{
+				bool inMap = mask[i] < 128;
+				mapped += inMap;
+				planar += coverage[i];
+				both += inMap && coverage[i];
+			}
+			int either = mapped + planar - both;
+			float overlap = either > 0 ? (float)both / either : 0.0f;
+			bool ok = planar > 100 && overlap >= minOverlap;
+			printf("shadow image %s, light %d: %6d mapped texels, %6d planar, overlap %.3f: %s\n",
+				scene == 0 ? "standing" : "stepping", l, mapped, planar, overlap, ok ? "ok" : "FAILED");
+			if (!ok)
+				result = 1;
+		}
+	}
+
+	// Caching: a second update with nothing moved must not render, a moved part or light must
+	ShadowCaster caster = { partMatrices, VECTOR3D(0.0f, 0.0f, 0.0f) };
+	maps[0].Update(lights[0], &caster, 1);
+	bool cached = !maps[0].Update(lights[0], &caster, 1);
+	partMatrices[PART_CANNON].entries[12] += 0.01f;
+	bool partMoved = maps[0].Update(lights[0], &caster, 1);
+	bool lightMoved = maps[0].Update(lights[0] + VECTOR3D(0.1f, 0.0f, 0.0f), &caster, 1);
+	bool cacheOk = cached && partMoved && lightMoved;
+	printf("shadow cache: unchanged %s, part moved %s, light moved %s: %s\n", cached ? "skipped" : "rendered",
+		partMoved ? "rendered" : "skipped", lightMoved ? "rendered" : "skipped", cacheOk ? "ok" : "FAILED");
+	if (!cacheOk)
+		result = 1;
+
+	// Per frame costs with the animated robot and the culled fleet as casters
+	const int fleetSize = 64;
+	const int numFrames = 100;
+	JobSystem jobs;
+	RobotFleet fleet;
+	fleet.Init(fleetSize, 8.0f, dims);
+	FrameArena arena;
+	VECTOR3D fleetOffset(0.0f, -10.0f + 2.5f * dims.robotBodySize, -30.0f);
+	MATRIX4X4 view = MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 6.0f, 22.0f), VECTOR3D(0.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 1.0f, 0.0f));
+	MATRIX4X4 fleetView = view;
+	fleetView.Translate(fleetOffset.x, fleetOffset.y, fleetOffset.z);
+	Frustum frustum;
+	frustum.Extract(MATRIX4X4::GetPerspective(60.0f, 650.0f / 500.0f, 0.2f, 40.0f) * fleetView);
+
+	animation = RobotAnimation();
+	pose = RobotPose();
+	double castersTime = 0.0, mapTime[2] = { 0.0, 0.0 }, staticTime = 0.0, maskTime = 0.0;
+	long long mapTriangles = 0, planarTriangles = 0;
+	int totalCasters = 0;
+	for (int f = 0; f < numFrames; f++)
+	{
+		if (!animation.stepping)
+			StartStepAnimation(pose, animation);
+		AnimateRobot(pose, animation);
+		fleet.Update(&jobs);
+		arena.Reset();
+
+		BenchClock::time_point start = BenchClock::now();
+		ComputeRobotTransforms(dims, pose, root, partMatrices);
+		ShadowCaster* casters = arena.AllocateArray<ShadowCaster>(1 + fleetSize);
+		casters[0].partMatrices = partMatrices;
+		casters[0].offset = VECTOR3D(0.0f, 0.0f, 0.0f);
+		int numCasters = 1;
+		for (int i = 0; i < fleetSize; i++)
+		{
+			if (frustum.ClassifyBox(fleet.GetBounds(i).min, fleet.GetBounds(i).max) != FRUSTUM_OUTSIDE)
+			{
+				casters[numCasters].partMatrices = fleet.GetPartMatrices(i);
+				casters[numCasters].offset = fleetOffset;
+				numCasters++;
+			}
+		}
+		castersTime += MillisecondsSince(start);
+		totalCasters += numCasters;
+
+		for (int l = 0; l < 2; l++)
+		{
+			start = BenchClock::now();
+			maps[l].Update(lights[l], casters, numCasters);
+			mapTime[l] += MillisecondsSince(start);
+			mapTriangles += maps[l].GetNumTriangles();
+			for (int c = 0; c < numCasters; c++)
+			{
+				for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+					planarTriangles += maps[l].GetShape(robotParts[p].shape).GetNumTriangles();
+			}
+		}
+
+		start = BenchClock::now();
+		BuildShadowMask(mapList, 2, ground, groundOffset, 0.55f, maskSize, &mask[0], &jobs);
+		maskTime += MillisecondsSince(start);
+
+		// the same frame again, nothing moved
+		start = BenchClock::now();
+		for (int l = 0; l < 2; l++)
+			maps[l].Update(lights[l], casters, numCasters);
+		staticTime += MillisecondsSince(start);
+	}
+
+	printf("shadow frame costs: %.1f casters (robot and fleet in view), %dx%d maps, %dx%d mask\n",
+		(double)totalCasters / numFrames, maps[0].GetSize(), maps[0].GetSize(), maskSize, maskSize);
+	printf("  caster list       %8.3f ms/frame\n", castersTime / numFrames);
+	printf("  map, light 0      %8.3f ms/frame\n", mapTime[0] / numFrames);
+	printf("  map, light 1      %8.3f ms/frame  (%.0f triangles per map)\n", mapTime[1] / numFrames,
+		(double)mapTriangles / (2 * numFrames));
+	printf("  mask              %8.3f ms/frame\n", maskTime / numFrames);
+	printf("  maps, unchanged   %8.3f ms/frame\n", staticTime / numFrames);
+	printf("  planar            %8.0f triangles/frame submitted for both lights\n", (double)planarTriangles / numFrames);
+	return result;
+}
+
+
+// One scripted interaction for the redraw benchmark, periods in milliseconds, 0 when unused
+struct RedrawScenario
+{
+	const char* name;
+	int mousePeriod;		// mouse motion events
+	int keyPeriod;			// joint select keys, which change nothing that is drawn
+	bool stepping;			// the step animation, started again whenever it ends
+	bool cannon;
+	bool fleet;
+};
+
+// Frames each redisplay policy draws over the same event stream, counted in 1 ms loop
+// iterations of a simulated GLUT main loop. The old policy posted a redisplay from every
+// handler and GLUT drew once per iteration with a post pending. The new one posts through
+// RedrawScheduler at most once per 60 Hz refresh, and only when the drawn state changed.
+static int RedrawBenchmark()
+{
+	const int duration = 10000;
+	const int animationPeriod = 10;
+	const RedrawScenario scenarios[] =
+	{
+		{ "idle",                     0,   0, false, false, false },
+		{ "idle, mouse moving",       8,   0, false, false, false },
+		{ "joint select keys",        0, 250, false, false, false },
+		{ "stepping, mouse moving",   8,   0, true,  false, false },
+		{ "cannon and fleet",         0,   0, false, true,  true  },
+	};
+	const int numScenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+	int result = 0;
+
+	printf("redraw policy over %d s, frames per second: every post / scheduled\n", duration / 1000);
+	for (int s = 0; s < numScenarios; s++)
+	{
+		const RedrawScenario& scenario = scenarios[s];
+		RobotPose pose;
+		RobotAnimation animation;
+		long long fleetFrameNumber = 0;
+		bool showFleet = scenario.fleet;
+
+		RedrawScheduler scheduler;
+		scheduler.Track(pose);
+		scheduler.Track(fleetFrameNumber);
+		scheduler.Track(showFleet);
+
+		if (scenario.stepping)
+			StartStepAnimation(pose, animation);
+		if (scenario.cannon)
+			StartCannonAnimation(animation);
+		bool animating = scenario.stepping || scenario.cannon || scenario.fleet;
+
+		// both policies draw the first frame when the window is shown
+		long long oldFrames = 1;
+		scheduler.FrameDrawn(0.0);
+		int displayAt = -1;
+		bool missed = false;
+
+		for (int now = 1; now <= duration; now++)
+		{
+			bool posted = false;
+			bool requested = false;
+
+			if (scenario.mousePeriod && now % scenario.mousePeriod == 0)
+				posted = requested = true;
+			if (scenario.keyPeriod && now % scenario.keyPeriod == 0)
+				posted = requested = true;
+			if (animating && now % animationPeriod == 0)
+			{
+				if (!AnimateRobot(pose, animation) && scenario.stepping)
+					StartStepAnimation(pose, animation);
+				if (showFleet)
+					fleetFrameNumber++;
+				posted = requested = true;
+			}
+
+			if (posted)
+				oldFrames++;
+			if (requested)
+			{
+				double delay = scheduler.Request((double)now);
+				if (delay >= 0.0)
+					displayAt = now + (int)ceil(delay);
+			}
+
+			// every change must have a frame on its way
+			if (scheduler.HasChanged() && displayAt < 0)
+				missed = true;
+
+			if (displayAt >= 0 && now >= displayAt)
+			{
+				scheduler.FrameDrawn((double)now);
+				displayAt = -1;
+			}
+		}
+
+		double seconds = duration / 1000.0;
+		printf("  %-24s %7.1f / %5.1f fps  (%lld requests)\n", scenario.name, oldFrames / seconds,
+			scheduler.GetNumFrames() / seconds, scheduler.GetNumRequests());
+
+		if (missed || (scheduler.HasChanged() && displayAt < 0))
+		{
+			printf("  FAILED: %s left a change undrawn\n", scenario.name);
+			result = 1;
+		}
+		if (scheduler.GetNumFrames() > duration * 60 / 1000 + 1)
+		{
+			printf("  FAILED: %s drew more than one frame per refresh\n", scenario.name);
+			result = 1;
+		}
+	}
+	return result;
+}
+
+
+// Camera work of one frame as display() did it before the matrices were cached: the
+// viewing and projection matrices built from scratch, the fleet's frustum extracted from
+// their product, and the eye to world transform taken for the shadows' lights
+static float UncachedCameraFrame(const CameraParams& params, const VECTOR3D& eyeLight, Frustum& frustum)
+{
+	const float degreesToRadians = 3.14159265358979f / 180.0f;
+	float cosPitch = (float)cos(params.pitch * degreesToRadians);
+	VECTOR3D offset((float)sin(params.yaw * degreesToRadians) * cosPitch, (float)sin(params.pitch * degreesToRadians),
+					(float)cos(params.yaw * degreesToRadians) * cosPitch);
+	VECTOR3D eye = params.target + offset * params.distance;
+	MATRIX4X4 view = MATRIX4X4::GetLookAt(eye, params.target, VECTOR3D(0.0f, 1.0f, 0.0f));
+	MATRIX4X4 projection = MATRIX4X4::GetPerspective(params.fovy, params.aspect, params.zNear, params.zFar);
+
+	frustum.Extract(projection * view);
+	VECTOR3D light = view.GetRigidInverse().TransformPoint(eyeLight);
+	return light.x + light.y + light.z;
+}
+
+// The same frame from the camera's cached matrices
+static float CachedCameraFrame(Camera& camera, const VECTOR3D& worldLight, Frustum& frustum)
+{
+	const MATRIX4X4& view = camera.GetView();
+	const MATRIX4X4& projection = camera.GetProjection();
+	frustum = camera.GetFrustum();
+	VECTOR3D light = view.TransformPoint(worldLight);
+	return light.x + light.y + light.z + projection.entries[0];
+}
+
+// Per frame camera cost with the matrices computed every frame against only after the
+// camera moved, for a still camera, one dragged every fourth frame and one moving every frame
+static int CameraBenchmark()
+{
+	const int numFrames = 1000000;
+	const int movePeriods[] = { 0, 4, 1 };
+	const char* labels[] = { "still", "moved every 4th frame", "moved every frame" };
+	int result = 0;
+
+	VECTOR3D eyeLight(-4.0f, 8.0f, 8.0f);
+	Camera initial;
+	VECTOR3D worldLight = initial.GetView().GetRigidInverse().TransformPoint(eyeLight);
+
+	// both paths give the same frustum
+	Camera check;
+	check.SetViewport(650, 500);
+	check.Orbit(37.0f, 12.0f);
+	Frustum checkFrustum, uncachedFrustum;
+	CachedCameraFrame(check, worldLight, checkFrustum);
+	UncachedCameraFrame(check.GetParams(), eyeLight, uncachedFrustum);
+	for (int i = 0; i < 6; i++)
+	{
+		if (fabs(checkFrustum.distances[i] - uncachedFrustum.distances[i]) > 1e-4f ||
+			(checkFrustum.normals[i] - uncachedFrustum.normals[i]).GetLength() > 1e-4f)
+		{
+			printf("camera: cached frustum differs from the recomputed one: FAILED\n");
+			result = 1;
+			break;
+		}
+	}
+
+	printf("camera cost over %d frames, ns/frame: recomputed / cached\n", numFrames);
+	for (int m = 0; m < 3; m++)
+	{
+		Camera camera;
+		camera.SetViewport(650, 500);
+		Frustum frustum;
+		float checksum = 0.0f;
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			if (movePeriods[m] && frame % movePeriods[m] == 0)
+				camera.Orbit(0.5f, 0.0f);
+			checksum += UncachedCameraFrame(camera.GetParams(), eyeLight, frustum);
+		}
+		double uncachedTime = MillisecondsSince(start);
+
+		Camera cached;
+		cached.SetViewport(650, 500);
+		long long updatesBefore = cached.GetNumUpdates();
+		start = BenchClock::now();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			if (movePeriods[m] && frame % movePeriods[m] == 0)
+				cached.Orbit(0.5f, 0.0f);
+			checksum += CachedCameraFrame(cached, worldLight, frustum);
+		}
+		double cachedTime = MillisecondsSince(start);
+
+		printf("  %-22s %8.1f / %6.1f ns  (%lld matrix updates, checksum %g)\n", labels[m], uncachedTime * 1e6 / numFrames,
+			cachedTime * 1e6 / numFrames, cached.GetNumUpdates() - updatesBefore, checksum);
+	}
+	return result;
+}
+
+// Stand-in for submitting one robot's parts to GL, as SubmitFleetFrame() does for a frame
+static float SubmitRobot(const MATRIX4X4& view, const MATRIX4X4* partMatrices)
+{
+	float checksum = 0.0f;
+	for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+	{
+		MATRIX4X4 modelView = view * partMatrices[p];
+		checksum += modelView.entries[12] + modelView.entries[13] + modelView.entries[14];
+	}
+	return checksum;
+}
+
+// The views of each multi-view test: one camera, split-screen and cube faces over a fleet
+static int GetBenchmarkViews(int test, View* views)
+{
+	const float zFar = 400.0f;
+	MATRIX4X4 projection = MATRIX4X4::GetPerspective(60.0f, 1.3f, 0.2f, zFar);
+	VECTOR3D centre(0.0f, 0.0f, 0.0f);
+	VECTOR3D up(0.0f, 1.0f, 0.0f);
+	switch (test)
+	{
+	case 0:
+		views[0].Set(MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 60.0f, 300.0f), centre, up), projection, 0, 0, 650, 500);
+		return 1;
+	case 1:
+		views[0].Set(MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 60.0f, 300.0f), centre, up), projection, 0, 250, 325, 250);
+		views[1].Set(MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 20.0f, 150.0f), centre, up), projection, 325, 250, 325, 250);
+		views[2].Set(MATRIX4X4::GetLookAt(VECTOR3D(200.0f, 20.0f, 0.0f), centre, up), projection, 0, 0, 325, 250);
+		views[3].Set(MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 300.0f, 0.0f), centre, VECTOR3D(0.0f, 0.0f, -1.0f)),
+			projection, 325, 0, 325, 250);
+		return 4;
+	default:
+		GetCubeFaceViews(VECTOR3D(0.0f, 2.0f, 0.0f), 0.2f, zFar, 0, 0, 160, views);
+		return 6;
+	}
+}
+
+// CPU time of drawing N views in one pass (one scene walk, one culling pass over the
+// boxes, a draw list per view) against N independent display() passes that each walk,
+// cull and submit the whole scene for their own view
+static int MultiViewBenchmark()
+{
+	const int numRobots = 10000;
+	const int numFrames = 50;
+	const char* labels[] = { "1 view", "4 split views", "6 cube faces" };
+	RobotDimensions dims;
+	RobotFleet fleet;
+	fleet.Init(numRobots, 8.0f, dims);
+	JobSystem jobs;
+	fleet.Update(&jobs);
+	const FleetFrame& frame = fleet.GetFrame();
+	VECTOR3D fleetOffset(0.0f, 0.0f, 0.0f);
+
+	RobotPose pose;
+	MATRIX4X4 root;
+	MATRIX4X4 robotMatrices[NUM_ROBOT_PARTS];
+	FrameArena arena;
+	int result = 0;
+	float checksum = 0.0f;
+
+	printf("multi-view CPU cost, %d robots, per frame: independent passes / one pass\n", numRobots);
+	for (int test = 0; test < 3; test++)
+	{
+		View views[MAX_VIEWS];
+		int numViews = GetBenchmarkViews(test, views);
+		long long independentDrawn = 0, sharedDrawn = 0;
+		double independentSubmit = 0.0, sharedSubmit = 0.0;
+
+		// independent: the scene walked, culled and submitted once per view
+		BenchClock::time_point start = BenchClock::now();
+		for (int f = 0; f < numFrames; f++)
+		{
+			for (int v = 0; v < numViews; v++)
+			{
+				arena.Reset();
+				ComputeRobotTransforms(dims, pose, root, robotMatrices);
+				checksum += SubmitRobot(views[v].view, robotMatrices);
+
+				ShadowCaster* casters = arena.AllocateArray<ShadowCaster>(frame.numRobots + 1);
+				int* visible = arena.AllocateArray<int>(frame.numRobots);
+				int numVisible = 0;
+				for (int i = 0; i < frame.numRobots; i++)
+				{
+					if (views[v].frustum.ClassifyBox(frame.bounds[i].min + fleetOffset, frame.bounds[i].max + fleetOffset) != FRUSTUM_OUTSIDE)
+						visible[numVisible++] = i;
+				}
+				for (int i = 0; i < numVisible; i++)
+				{
+					casters[i].partMatrices = frame.GetPartMatrices(visible[i]);
+					casters[i].offset = fleetOffset;
+				}
+				independentDrawn += numVisible;
+
+				BenchClock::time_point submitStart = BenchClock::now();
+				for (int i = 0; i < numVisible; i++)
+					checksum += SubmitRobot(views[v].view, frame.GetPartMatrices(visible[i]));
+				independentSubmit += MillisecondsSince(submitStart);
+			}
+		}
+		double independentTime = MillisecondsSince(start);
+
+		// one pass: walked and culled once, each view submits its own list
+		start = BenchClock::now();
+		for (int f = 0; f < numFrames; f++)
+		{
+			arena.Reset();
+			ComputeRobotTransforms(dims, pose, root, robotMatrices);
+
+			int numBoxes = frame.numRobots + 1;
+			BBox* boxes = arena.AllocateArray<BBox>(numBoxes);
+			boxes[0] = ComputeRobotBounds(robotMatrices);
+			for (int i = 0; i < frame.numRobots; i++)
+			{
+				boxes[1 + i].min = frame.bounds[i].min + fleetOffset;
+				boxes[1 + i].max = frame.bounds[i].max + fleetOffset;
+			}
+
+			int* lists[MAX_VIEWS];
+			int counts[MAX_VIEWS];
+			for (int v = 0; v < numViews; v++)
+				lists[v] = arena.AllocateArray<int>(numBoxes);
+			int* visible = arena.AllocateArray<int>(numBoxes);
+			int numVisible = CullViews(views, numViews, boxes, numBoxes, lists, counts, visible);
+
+			ShadowCaster* casters = arena.AllocateArray<ShadowCaster>(numBoxes);
+			for (int i = 0; i < numVisible; i++)
+			{
+				casters[i].partMatrices = visible[i] == 0 ? robotMatrices : frame.GetPartMatrices(visible[i] - 1);
+				casters[i].offset = fleetOffset;
+			}
+
+			BenchClock::time_point submitStart = BenchClock::now();
+			for (int v = 0; v < numViews; v++)
+			{
+				checksum += SubmitRobot(views[v].view, robotMatrices);
+				for (int i = 0; i < counts[v]; i++)
+				{
+					if (lists[v][i] != 0)
+						checksum += SubmitRobot(views[v].view, frame.GetPartMatrices(lists[v][i] - 1));
+				}
+				sharedDrawn += counts[v] - (counts[v] > 0 && lists[v][0] == 0 ? 1 : 0);
+			}
+			sharedSubmit += MillisecondsSince(submitStart);
+		}
+		double sharedTime = MillisecondsSince(start);
+
+		bool same = independentDrawn == sharedDrawn;
+		printf("  %-14s %8.3f / %8.3f ms, walk and cull %7.3f / %7.3f ms  (%.0f fleet robots drawn)  %s\n",
+			labels[test], independentTime / numFrames, sharedTime / numFrames,
+			(independentTime - independentSubmit) / numFrames, (sharedTime - sharedSubmit) / numFrames,
+			(double)sharedDrawn / numFrames, same ? "ok" : "FAILED: the draw lists differ");
+		if (!same)
+			result = 1;
+	}
+	printf("(checksum %g)\n", checksum);
+	return result;
+}
+
+// Largest position or normal difference between two skinned vertex arrays
+static float MaxSkinError(const IndexedMesh::Vertex* a, const IndexedMesh::Vertex* b, int count)
+{
+	float maxError = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		VECTOR3D dp = a[i].position - b[i].position;
+		VECTOR3D dn = a[i].normal - b[i].normal;
+		maxError = std::max(maxError, std::max(fabs(dp.x), std::max(fabs(dp.y), fabs(dp.z))));
+		maxError = std::max(maxError, std::max(fabs(dn.x), std::max(fabs(dn.y), fabs(dn.z))));
+	}
+	return maxError;
+}
+
+static int SkinningBenchmark()
+{
+	const int numFrames = 10;
+	const char* labels[] = { "linear blend", "dual quaternion" };
+	RobotDimensions dims;
+	int result = 0;
+
+	// check the SSE kernel against the scalar version over a range of knee bends
+	SkinMesh checkMesh;
+	BuildLegSkin(dims, 24, 64, checkMesh);
+	std::vector<IndexedMesh::Vertex> simd(checkMesh.numVertices), reference(checkMesh.numVertices);
+	JobSystem jobs;
+	printf("skinning, SSE against scalar reference, %d vertices\n", checkMesh.numVertices);
+	for (int method = 0; method < 2; method++)
+	{
+		float maxError = 0.0f;
+		for (int knee = -90; knee <= 90; knee += 15)
+		{
+			RobotPose pose;
+			pose.angles[JOINT_LEFT_HIP] = 0.5f * knee;
+			pose.angles[JOINT_LEFT_KNEE] = (float)knee;
+			pose.angles[JOINT_RIGHT_HIP] = -0.5f * knee;
+			pose.angles[JOINT_RIGHT_KNEE] = -(float)knee;
+			MATRIX4X4 root;
+			MATRIX4X4 partMatrices[NUM_ROBOT_PARTS];
+			ComputeRobotTransforms(dims, pose, root, partMatrices);
+
+			SkinBones bones;
+			bones.Set(checkMesh, partMatrices);
+			SkinVertices(checkMesh, bones, (SkinningMethod)method, &simd[0], &jobs, 64);
+			SkinVerticesReference(checkMesh, bones, (SkinningMethod)method, &reference[0]);
+			maxError = std::max(maxError, MaxSkinError(&simd[0], &reference[0], checkMesh.numVertices));
+		}
+		bool ok = maxError < 1e-4f;
+		printf("  %-16s max error %g  %s\n", labels[method], maxError, ok ? "ok" : "FAILED");
+		if (!ok)
+			result = 1;
+	}
+
+	// the bind pose must give back the bind pose
+	{
+		RobotPose pose;
+		MATRIX4X4 root;
+		MATRIX4X4 partMatrices[NUM_ROBOT_PARTS];
+		ComputeRobotTransforms(dims, pose, root, partMatrices);
+		SkinBones bones;
+		bones.Set(checkMesh, partMatrices);
+		for (int method = 0; method < 2; method++)
+		{
+			SkinVertices(checkMesh, bones, (SkinningMethod)method, &simd[0]);
+			float maxError = 0.0f;
+			for (int v = 0; v < checkMesh.numVertices; v++)
+			{
+				maxError = std::max(maxError, (float)fabs(simd[v].position.x - checkMesh.positions[0][v]));
+				maxError = std::max(maxError, (float)fabs(simd[v].position.y - checkMesh.positions[1][v]));
+				maxError = std::max(maxError, (float)fabs(simd[v].position.z - checkMesh.positions[2][v]));
+			}
+			bool ok = maxError < 1e-4f;
+			printf("  %-16s bind pose error %g  %s\n", labels[method], maxError, ok ? "ok" : "FAILED");
+			if (!ok)
+				result = 1;
+		}
+	}
+
+	// throughput on a mesh far larger than the robot's
+	SkinMesh mesh;
+	BuildLegSkin(dims, 128, 2048, mesh);
+	std::vector<IndexedMesh::Vertex> vertices(mesh.numVertices);
+	RobotPose pose;
+	pose.angles[JOINT_LEFT_KNEE] = 60.0f;
+	pose.angles[JOINT_RIGHT_KNEE] = -45.0f;
+	MATRIX4X4 root;
+	MATRIX4X4 partMatrices[NUM_ROBOT_PARTS];
+	ComputeRobotTransforms(dims, pose, root, partMatrices);
+	SkinBones bones;
+	bones.Set(mesh, partMatrices);
+	int numThreads = jobs.GetNumThreads();
+
+	printf("skinning throughput, %d vertices, million vertices/s\n", mesh.numVertices);
+	printf("  %-16s %10s %10s %14s %14s\n", "", "scalar", "SSE", "SSE x threads", "per core");
+	for (int method = 0; method < 2; method++)
+	{
+		double times[3];
+		for (int mode = 0; mode < 3; mode++)
+		{
+			BenchClock::time_point start = BenchClock::now();
+			for (int f = 0; f < numFrames; f++)
+			{
+				if (mode == 0)
+					SkinVerticesReference(mesh, bones, (SkinningMethod)method, &vertices[0]);
+				else
+					SkinVertices(mesh, bones, (SkinningMethod)method, &vertices[0], mode == 2 ? &jobs : NULL);
+			}
+			times[mode] = MillisecondsSince(start) / numFrames;
+		}
+
+		double rates[3];
+		for (int mode = 0; mode < 3; mode++)
+			rates[mode] = mesh.numVertices / (times[mode] * 1000.0);
+		printf("  %-16s %10.1f %10.1f %10.1f (%2d) %14.1f\n", labels[method], rates[0], rates[1], rates[2], numThreads,
+			rates[2] / numThreads);
+	}
+	printf("(checksum %g)\n", vertices[mesh.numVertices / 2].position.y);
+	return result;
+}
+
+// Part matrices whose tracked points all sit at x = frame, for checking what readers see
+static void SetTrailCheckFrame(std::vector<MATRIX4X4>& partMatrices, int numRobots, int frame)
+{
+	for (int r = 0; r < numRobots; r++)
+	{
+		for (int j = 0; j < TRAIL_JOINTS; j++)
+		{
+			MATRIX4X4& m = partMatrices[(size_t)r * NUM_ROBOT_PARTS + trailJointParts[j]];
+			m.LoadIdentity();
+			m.Translate((float)frame, (float)r, (float)j);
+			m.Scale(1.0f, 1.0f, 0.0f);		// flattens the gun tips onto the part origin
+		}
+	}
+}
+
+static int TrailsBenchmark()
+{
+	const int numRobots = 10000;
+	const int capacity = 64;
+	const int numFrames = 200;
+	int result = 0;
+
+	RobotDimensions dims;
+	RobotFleet fleet;
+	fleet.Init(numRobots, 8.0f, dims);
+	JobSystem jobs;
+	JointTrails trails;
+	trails.Init(numRobots, capacity);
+	printf("joint trails, %d robots, %d samples per trail, %.1f MB\n", numRobots, trails.GetCapacity(),
+		trails.GetMemoryUsed() / (1024.0 * 1024.0));
+
+	// push cost on its own, from fleet frames updated beforehand
+	const int numFleetFrames = 8;
+	std::vector<FleetFrame> frames(numFleetFrames);
+	for (int f = 0; f < numFleetFrames; f++)
+		fleet.Update(&jobs, &frames[f]);
+
+	for (int threaded = 0; threaded < 2; threaded++)
+	{
+		BenchClock::time_point start = BenchClock::now();
+		for (int f = 0; f < numFrames; f++)
+			trails.Push(&frames[f % numFleetFrames].partMatrices[0], f * 0.01f, threaded ? &jobs : NULL);
+		double frameTime = MillisecondsSince(start) / numFrames;
+		printf("  push %-10s %8.3f ms/frame %10.1f million samples/s\n", threaded ? "jobs" : "serial", frameTime,
+			numRobots * TRAIL_JOINTS / (frameTime * 1000.0));
+	}
+
+	// reading every full trail back
+	std::vector<VECTOR3D> points(trails.GetCapacity());
+	std::vector<float> times(trails.GetCapacity());
+	long long numRead = 0;
+	BenchClock::time_point start = BenchClock::now();
+	for (int r = 0; r < numRobots; r++)
+	{
+		for (int j = 0; j < TRAIL_JOINTS; j++)
+			numRead += trails.GetTrail(r, j, &points[0], &times[0]);
+	}
+	double readTime = MillisecondsSince(start);
+	printf("  read all       %8.3f ms      %10.1f million samples/s\n", readTime, numRead / (readTime * 1000.0));
+
+	start = BenchClock::now();
+	float longest = 0.0f, fastest = 0.0f;
+	for (int r = 0; r < numRobots; r++)
+	{
+		longest = std::max(longest, trails.GetPathLength(r, TRAIL_LEFT_FOOT));
+		fastest = std::max(fastest, trails.GetMaxSpeed(r, TRAIL_LEFT_FOOT));
+	}
+	double queryTime = MillisecondsSince(start);
+	printf("  path length and max speed of %d trails %.3f ms (longest foot path %.2f, fastest foot %.2f/s)\n",
+		2 * numRobots, queryTime, longest, fastest);
+
+	// a reader racing the writer must only ever see consecutive, whole samples
+	const int checkRobots = 1000;
+	const int checkFrames = 20000;
+	JointTrails checkTrails;
+	checkTrails.Init(checkRobots, 16);
+	std::vector<MATRIX4X4> checkMatrices((size_t)checkRobots * NUM_ROBOT_PARTS);
+	std::atomic<bool> writing(true);
+	std::thread writer([&]()
+	{
+		for (int f = 0; f < checkFrames; f++)
+		{
+			SetTrailCheckFrame(checkMatrices, checkRobots, f);
+			checkTrails.Push(&checkMatrices[0], (float)f);
+		}
+		writing = false;
+	});
+
+	long long numChecked = 0, numBad = 0, numDropped = 0;
+	std::vector<VECTOR3D> checkPoints(checkTrails.GetCapacity());
+	std::vector<float> checkTimes(checkTrails.GetCapacity());
+	while (writing.load())
+	{
+		int robot = (int)(numChecked % checkRobots);
+		int joint = (int)(numChecked % TRAIL_JOINTS);
+		long long before = checkTrails.GetNumSamples();
+		int count = checkTrails.GetTrail(robot, joint, &checkPoints[0], &checkTimes[0]);
+		if (before >= checkTrails.GetCapacity() && count < checkTrails.GetCapacity())
+			numDropped++;
+		for (int i = 0; i < count; i++)
+		{
+			bool whole = checkPoints[i].x == checkTimes[i] && checkPoints[i].y == (float)robot &&
+				checkPoints[i].z == (float)joint;
+			bool consecutive = i == 0 || checkTimes[i] == checkTimes[i - 1] + 1.0f;
+			if (!whole || !consecutive)
+			{
+				numBad++;
+				break;
+			}
+		}
+		numChecked++;
+	}
+	writer.join();
+	bool ok = numBad == 0;
+	printf("  %lld reads racing %d pushes, %lld shortened, %lld inconsistent  %s\n", numChecked, checkFrames,
+		numDropped, numBad, ok ? "ok" : "FAILED");
+	if (!ok)
+		result = 1;
+	return result;
+}
+
+// Spray of particles over the middle of the ground, rising from a little above it
+static void EmitBenchmarkParticles(ParticleSystem& particles, int count, float lifetime)
+{
+	for (int emitted = 0; emitted < count; emitted += 1000)
+	{
+		float angle = 0.001f * emitted;
+		VECTOR3D origin(8.0f * (float)cos(angle), -6.0f, 8.0f * (float)sin(angle));
+		particles.Emit(origin, VECTOR3D(0.0f, 1.0f, 0.0f), 1.2f, 6.0f, lifetime, std::min(1000, count - emitted));
+	}
+}
+
+static int ParticleBenchmark()
+{
+	const int numParticles = 1000000;
+	const int numFrames = 20;
+	const float dt = 0.01f;
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+		maxThreads = 1;
+	int result = 0;
+
+	// rolling ground as bot2 lays it out, 10 below the robot
+	Heightfield heights;
+	heights.GenerateNoise(65, 65, 4, 3.0f, 2.0f, 1);
+	QuadMesh mesh(64, 32.0f);
+	mesh.InitMesh(64, VECTOR3D(-16.0f, 0.0f, 16.0f), 32.0, 32.0, VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f),
+		&heights);
+	ParticleGround ground;
+	ground.Set(mesh, VECTOR3D(0.0f, -10.0f, 0.0f));
+	ParticleParams params;
+
+	// SSE kernel against the scalar version over a few seconds of bouncing and dying
+	{
+		ParticleSystem simd, reference;
+		simd.Init(20000, 5);
+		reference.Init(20000, 5);
+		EmitBenchmarkParticles(simd, 20000, 2.0f);
+		EmitBenchmarkParticles(reference, 20000, 2.0f);
+		JobSystem jobs;
+		float maxError = 0.0f, groundError = 0.0f;
+		bool sameCount = true;
+		for (int f = 0; f < 200 && sameCount; f++)
+		{
+			simd.Update(dt, params, &ground, &jobs, 1024);
+			reference.UpdateReference(dt, params, &ground);
+			sameCount = simd.GetNumParticles() == reference.GetNumParticles();
+			for (int i = 0; i < simd.GetNumParticles() && sameCount; i++)
+			{
+				VECTOR3D p = simd.GetPosition(i);
+				maxError = std::max(maxError, (p - reference.GetPosition(i)).GetLength());
+				float height;
+				if (ground.GetHeight(p.x, p.z, height))
+					groundError = std::max(groundError, height - p.y);
+			}
+		}
+
+		bool ok = sameCount && maxError < 1e-3f && groundError < 1e-4f;
+		printf("particles, SSE against scalar: %d left, max error %g, deepest below ground %g  %s\n",
+			simd.GetNumParticles(), maxError, groundError, ok ? "ok" : "FAILED");
+		if (!ok)
+			result = 1;
+	}
+
+	// update throughput, nothing dies during the run
+	ParticleSystem particles;
+	particles.Init(numParticles, 9);
+	EmitBenchmarkParticles(particles, numParticles, 1000.0f);
+
+	BenchClock::time_point start = BenchClock::now();
+	for (int f = 0; f < numFrames; f++)
+		particles.UpdateReference(dt, params, &ground);
+	double scalarTime = MillisecondsSince(start) / numFrames;
+
+	printf("%d particles, update with ground collisions\n", particles.GetNumParticles());
+	printf("%10s %12s %14s %8s\n", "threads", "ms/frame", "M particles/s", "speedup");
+	printf("%10s %12.3f %14.1f %8.2f\n", "scalar", scalarTime, numParticles / (scalarTime * 1000.0), 1.0);
+	for (int threads = 1; threads <= maxThreads; threads++)
+	{
+		JobSystem jobs(threads);
+		particles.Update(dt, params, &ground, &jobs);	// warm up
+
+		start = BenchClock::now();
+		for (int f = 0; f < numFrames; f++)
+			particles.Update(dt, params, &ground, &jobs);
+		double frameTime = MillisecondsSince(start) / numFrames;
+		printf("%10d %12.3f %14.1f %8.2f\n", threads, frameTime, numParticles / (frameTime * 1000.0),
+			scalarTime / frameTime);
+	}
+
+	// back to front order for blending
+	MATRIX4X4 view = MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 6.0f, 22.0f), VECTOR3D(0.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 1.0f, 0.0f));
+	JobSystem jobs;
+	start = BenchClock::now();
+	const std::vector<int>& order = particles.SortBackToFront(view, &jobs);
+	double sortTime = MillisecondsSince(start);
+
+	bool sorted = (int)order.size() == particles.GetNumParticles();
+	float previous = -1e30f;
+	for (size_t i = 0; i < order.size() && sorted; i++)
+	{
+		float z = view.TransformPoint(particles.GetPosition(order[i])).z;
+		sorted = z >= previous;
+		previous = z;
+	}
+	printf("back to front sort %.3f ms  %s\n", sortTime, sorted ? "ok" : "FAILED: out of order");
+	if (!sorted)
+		result = 1;
+	return result;
+}
+
+// Rays through a width x height grid of pixels of a 60 degree camera
+static void MakeBenchmarkRays(const MATRIX4X4& view, int width, int height, std::vector<Ray>& rays)
+{
+	MATRIX4X4 projection = MATRIX4X4::GetPerspective(60.0f, (float)width / height, 0.1f, 2000.0f);
+	int viewport[4] = { 0, 0, width, height };
+	rays.resize((size_t)width * height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+			rays[y * width + x] = GetPickRay(view, projection, viewport, x + 0.5f, y + 0.5f);
+	}
+}
+
+static bool SamePickHit(bool foundA, const PickHit& a, bool foundB, const PickHit& b)
+{
+	if (foundA != foundB)
+		return false;
+	return !foundA || (a.robot == b.robot && a.part == b.part && fabsf(a.t - b.t) <= 1e-3f * (1.0f + a.t));
+}
+
+// Picking rays cast over a 10000 robot fleet standing on a 1024 grid of rolling ground, the
+// hierarchy and ground quadtree against testing every robot and every ground cell
+static int PickingBenchmark()
+{
+	const int numRobots = 10000;
+	const int groundSize = 1024;
+	const float spacing = 8.0f;
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+		maxThreads = 1;
+	int result = 0;
+
+	RobotDimensions dims;
+	RobotFleet fleet;
+	fleet.Init(numRobots, spacing, dims);
+	fleet.Update(NULL);
+
+	// ground just under the lowest foot, over the whole fleet
+	float lowest = 1e30f;
+	for (int i = 0; i < numRobots; i++)
+		lowest = std::min(lowest, fleet.GetBounds(i).min.y);
+	float extent = ceilf(sqrtf((float)numRobots)) * spacing;
+	Heightfield heights;
+	heights.GenerateNoise(groundSize + 1, groundSize + 1, 6, 2.0f, 40.0f, 3);
+	QuadMesh mesh(groundSize, extent);
+	mesh.InitMesh(groundSize, VECTOR3D(-0.5f * extent, 0.0f, 0.5f * extent), extent, extent, VECTOR3D(1.0f, 0.0f, 0.0f),
+		VECTOR3D(0.0f, 0.0f, -1.0f), &heights);
+	PickGround ground;
+	ground.Set(mesh, VECTOR3D(0.0f, lowest - 2.0f, 0.0f));
+
+	BenchClock::time_point start = BenchClock::now();
+	PickScene scene;
+	for (int i = 0; i < numRobots; i++)
+		scene.AddRobot(i, fleet.GetPartMatrices(i), VECTOR3D(0.0f, 0.0f, 0.0f));
+	scene.Build();
+	double buildTime = MillisecondsSince(start);
+	printf("picking, %d robots on a %d grid, hierarchy built in %.2f ms\n", numRobots, groundSize, buildTime);
+
+	// looking across the fleet from one edge, so rays pass over many robots before landing
+	MATRIX4X4 view = MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 25.0f, 0.5f * extent + 20.0f), VECTOR3D(0.0f, lowest, 0.0f),
+		VECTOR3D(0.0f, 1.0f, 0.0f));
+
+	// against every robot's bounds in turn, on a coarser grid of rays
+	{
+		std::vector<Ray> rays;
+		MakeBenchmarkRays(view, 64, 48, rays);
+		std::vector<PickHit> hits(rays.size());
+		std::vector<char> found(rays.size());
+		start = BenchClock::now();
+		for (size_t i = 0; i < rays.size(); i++)
+			found[i] = scene.IntersectBruteForce(rays[i], hits[i], &ground);
+		double bruteTime = MillisecondsSince(start);
+
+		int mismatches = 0, robotHits = 0;
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			PickHit check;
+			bool foundCheck = scene.Intersect(rays[i], check, &ground);
+			if (!SamePickHit(found[i] != 0, hits[i], foundCheck, check))
+				mismatches++;
+			if (found[i] && hits[i].robot >= 0)
+				robotHits++;
+		}
+		bool ok = mismatches == 0 && robotHits > 0;
+		printf("  every robot: %.3f M rays/s, %d rays, %d on robots, hierarchy mismatched %d  %s\n",
+			rays.size() / (bruteTime * 1000.0), (int)rays.size(), robotHits, mismatches, ok ? "ok" : "FAILED");
+		if (!ok)
+			result = 1;
+	}
+
+	// ground quadtree against every cell, on a smaller grid
+	{
+		QuadMesh smallMesh(64, 64.0f);
+		Heightfield smallHeights;
+		smallHeights.GenerateNoise(65, 65, 4, 6.0f, 8.0f, 5);
+		smallMesh.InitMesh(64, VECTOR3D(-32.0f, 0.0f, 32.0f), 64.0, 64.0, VECTOR3D(1.0f, 0.0f, 0.0f),
+			VECTOR3D(0.0f, 0.0f, -1.0f), &smallHeights);
+		PickGround smallGround;
+		smallGround.Set(smallMesh, VECTOR3D(0.0f, 0.0f, 0.0f));
+
+		std::vector<Ray> rays;
+		MakeBenchmarkRays(MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 12.0f, 40.0f), VECTOR3D(0.0f, 0.0f, 0.0f),
+			VECTOR3D(0.0f, 1.0f, 0.0f)), 64, 48, rays);
+		int mismatches = 0, hits = 0;
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			PickHit hit, check;
+			hit.t = check.t = 1e30f;
+			bool found = smallGround.IntersectBruteForce(rays[i], hit);
+			bool foundCheck = smallGround.Intersect(rays[i], check);
+			if (!SamePickHit(found, hit, foundCheck, check))
+				mismatches++;
+			if (found)
+				hits++;
+		}
+		bool ok = mismatches == 0 && hits > 0;
+		printf("  ground quadtree against every cell: %d rays, %d hits, %d mismatched  %s\n", (int)rays.size(), hits,
+			mismatches, ok ? "ok" : "FAILED");
+		if (!ok)
+			result = 1;
+	}
+
+	// throughput, a full window of rays
+	std::vector<Ray> rays;
+	MakeBenchmarkRays(view, 640, 480, rays);
+	int numRays = (int)rays.size();
+	std::vector<PickHit> hits(numRays);
+	printf("%10s %12s %14s\n", "threads", "ms", "M rays/s");
+	for (int threads = 0; threads <= maxThreads; threads++)
+	{
+		JobSystem jobs(std::max(threads, 1));
+		auto castRange = [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+				scene.Intersect(rays[i], hits[i], &ground);
+		};
+
+		start = BenchClock::now();
+		if (threads == 0)
+			castRange(0, numRays);
+		else
+			jobs.ParallelFor(numRays, 1024, castRange);
+		double castTime = MillisecondsSince(start);
+		if (threads == 0)
+			printf("%10s %12.2f %14.2f\n", "serial", castTime, numRays / (castTime * 1000.0));
+		else
+			printf("%10d %12.2f %14.2f\n", threads, castTime, numRays / (castTime * 1000.0));
+	}
+
+	int robotHits = 0, groundHits = 0;
+	for (int i = 0; i < numRays; i++)
+	{
+		if (hits[i].robot >= 0)
+			robotHits++;
+		else if (hits[i].t < 1e30f)
+			groundHits++;
+	}
+	printf("  %d rays: %d on robots, %d on the ground\n", numRays, robotHits, groundHits);
+	return result;
+}
+
+// Velocities between -720 and 720 degrees per second for every joint, from a fixed sequence
+static void KickJoints(JointRegistry& joints, unsigned int seed)
+{
+	unsigned int state = seed;
+	for (int r = 0; r < joints.GetNumRobots(); r++)
+	{
+		for (int j = 0; j < NUM_JOINTS; j++)
+		{
+			state = state * 1664525u + 1013904223u;
+			joints.SetVelocity(r, j, ((state >> 8) * (1.0f / 16777216.0f) - 0.5f) * 1440.0f);
+		}
+	}
+}
+
+static bool PoseWithinLimits(const RobotPose& pose)
+{
+	RobotPose limited = pose;
+	LimitPose(limited);
+	return memcmp(&limited, &pose, sizeof(pose)) == 0;
+}
+
+// Joint limits kept by input steps, the scripted animations and bulk updates, then bulk
+// update and clamp throughput over a million joints
+static int JointsBenchmark()
+{
+	const int numRobots = 1000000 / NUM_JOINTS;
+	const int numFrames = 50;
+	const float dt = 0.01f;
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+		maxThreads = 1;
+	int result = 0;
+
+	// turning every joint far past its limits a step at a time, as the arrow keys do
+	{
+		JointRegistry joints(1);
+		int outside = 0;
+		for (int j = 0; j < NUM_JOINTS; j++)
+		{
+			for (int step = 0; step < 1000; step++)
+			{
+				float degrees = step < 500 ? 2.0f : -2.0f;
+				joints.SetAngle(0, j, joints.GetAngle(0, j) + degrees);
+				RobotPose pose;
+				joints.GetPose(0, pose);
+				if (!PoseWithinLimits(pose))
+					outside++;
+			}
+		}
+		printf("joints, stepped past their limits: %d outside  %s\n", outside, outside == 0 ? "ok" : "FAILED");
+		if (outside != 0)
+			result = 1;
+	}
+
+	// wrapping the floats closest to odd multiples of 180, where the number of turns rounds
+	{
+		int outside = 0;
+		for (int k = -9; k <= 9; k += 2)
+		{
+			float angle = 180.0f * k;
+			for (int i = 0; i < 64; i++)
+				angle = nextafterf(angle, -1e9f);
+			for (int i = 0; i < 128; i++)
+			{
+				float wrapped = WrapAngle(angle);
+				if (!(wrapped >= -180.0f && wrapped < 180.0f))
+					outside++;
+				angle = nextafterf(angle, 1e9f);
+			}
+		}
+		printf("joints, wrapped near odd multiples of 180: %d outside  %s\n", outside, outside == 0 ? "ok" : "FAILED");
+		if (outside != 0)
+			result = 1;
+	}
+
+	// the scripted animations over a few thousand ticks, restarted as they finish
+	{
+		RobotDimensions dims;
+		RobotFleet fleet;
+		fleet.Init(256, 8.0f, dims);
+		int outside = 0;
+		for (int t = 0; t < 3000; t++)
+		{
+			fleet.Update(NULL);
+			for (int i = 0; i < fleet.GetNumRobots(); i++)
+			{
+				if (!PoseWithinLimits(fleet.GetPose(i)))
+					outside++;
+			}
+		}
+		printf("joints, %d animated robots over 3000 ticks: %d poses outside  %s\n", fleet.GetNumRobots(), outside,
+			outside == 0 ? "ok" : "FAILED");
+		if (outside != 0)
+			result = 1;
+	}
+
+	// SSE against scalar, kicked every ten frames so joints keep hitting their limits
+	{
+		JointRegistry simd, reference;
+		simd.Init(10000);
+		reference.Init(10000);
+		JobSystem jobs;
+		int mismatches = 0, outside = 0;
+		for (int f = 0; f < 200; f++)
+		{
+			if (f % 10 == 0)
+			{
+				KickJoints(simd, f + 1);
+				KickJoints(reference, f + 1);
+			}
+			simd.Update(dt, &jobs, 4096);
+			reference.UpdateReference(dt);
+			outside += simd.CountOutsideLimits();
+		}
+		for (int r = 0; r < simd.GetNumRobots(); r++)
+		{
+			for (int j = 0; j < NUM_JOINTS; j++)
+			{
+				if (simd.GetAngle(r, j) != reference.GetAngle(r, j) || simd.GetVelocity(r, j) != reference.GetVelocity(r, j))
+					mismatches++;
+			}
+		}
+		bool ok = mismatches == 0 && outside == 0;
+		printf("joints, SSE against scalar: %d mismatched, %d outside limits  %s\n", mismatches, outside, ok ? "ok" : "FAILED");
+		if (!ok)
+			result = 1;
+	}
+
+	JointRegistry joints;
+	joints.Init(numRobots);
+	KickJoints(joints, 7);
+
+	BenchClock::time_point start = BenchClock::now();
+	for (int f = 0; f < numFrames; f++)
+		joints.UpdateReference(dt);
+	double scalarTime = MillisecondsSince(start) / numFrames;
+
+	printf("%d joints, integrate and limit\n", joints.GetNumJoints());
+	printf("%10s %12s %12s %8s\n", "threads", "ms/update", "M joints/s", "speedup");
+	printf("%10s %12.3f %12.1f %8.2f\n", "scalar", scalarTime, joints.GetNumJoints() / (scalarTime * 1000.0), 1.0);
+
+	start = BenchClock::now();
+	for (int f = 0; f < numFrames; f++)
+		joints.Update(dt);
+	double frameTime = MillisecondsSince(start) / numFrames;
+	printf("%10s %12.3f %12.1f %8.2f\n", "SSE", frameTime, joints.GetNumJoints() / (frameTime * 1000.0),
+		scalarTime / frameTime);
+
+	for (int threads = 1; threads <= maxThreads; threads++)
+	{
+		JobSystem jobs(threads);
+		joints.Update(dt, &jobs);	// warm up
+
+		start = BenchClock::now();
+		for (int f = 0; f < numFrames; f++)
+			joints.Update(dt, &jobs);
+		frameTime = MillisecondsSince(start) / numFrames;
+		printf("%10d %12.3f %12.1f %8.2f\n", threads, frameTime, joints.GetNumJoints() / (frameTime * 1000.0),
+			scalarTime / frameTime);
+	}
+
+	int outside = joints.CountOutsideLimits();
+	printf("%d outside limits after the runs  %s\n", outside, outside == 0 ? "ok" : "FAILED");
+	if (outside != 0)
+		result = 1;
+	return result;
+}
+
+// Robots on a grid spacing apart, the root high enough that the feet clear the ground below
+static void PlacePhysicsRobots(RobotPhysics& physics, const RobotDimensions& dims, int side, float spacing,
+							   const ParticleGround* ground, float groundHeight)
+{
+	int numRobots = side * side;
+	std::vector<VECTOR3D> positions(numRobots);
+	std::vector<float> headings(numRobots);
+	physics.Init(dims, 1, &positions[0], &headings[0]);
+	float standing = physics.GetStandingHeight();
+	float reach = 2.0f * dims.robotBodySize;
+
+	for (int i = 0; i < numRobots; i++)
+	{
+		float x = ((i % side) - 0.5f * (side - 1)) * spacing;
+		float z = ((i / side) - 0.5f * (side - 1)) * spacing;
+		float top = groundHeight, height;
+		for (int k = 0; k < 9 && ground; k++)
+		{
+			if (ground->GetHeight(x + (k % 3 - 1) * reach, z + (k / 3 - 1) * reach, height))
+				top = std::max(top, height);
+		}
+		positions[i].Set(x, top + standing + 0.05f, z);
+		headings[i] = (float)((i * 37) % 360);
+	}
+	physics.Init(dims, numRobots, &positions[0], &headings[0]);
+}
+
+static void SetWalkTargets(RobotPhysics& physics, float time, float frequency)
+{
+	for (int i = 0; i < physics.GetNumRobots(); i++)
+	{
+		RobotPose pose;
+		GetWalkTargets(2.0f * 3.14159265f * frequency * time + i * 0.7f, pose);
+		physics.SetTargets(i, pose);
+	}
+}
+
+static int PhysicsBenchmark()
+{
+	const int side = 16;
+	const float frameTime = 1.0f / 60.0f;
+	const float walkTime = 10.0f;
+	const float stepFrequency = 1.0f;
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+		maxThreads = 1;
+	int result = 0;
+	RobotDimensions dims;
+
+	// stability: robots dropped onto rolling ground stand still within a few seconds and stay
+	// standing, with their hinges together
+	{
+		Heightfield heights;
+		heights.GenerateNoise(65, 65, 4, 2.0f, 0.3f, 3);
+		QuadMesh mesh(64, 64.0f);
+		mesh.InitMesh(64, VECTOR3D(-32.0f, 0.0f, 32.0f), 64.0, 64.0, VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f),
+			&heights);
+		ParticleGround ground;
+		ground.Set(mesh, VECTOR3D(0.0f, -10.0f, 0.0f));
+
+		RobotPhysics physics;
+		physics.SetGround(&ground);
+		PlacePhysicsRobots(physics, dims, 6, 9.0f, &ground, -10.0f);
+
+		float maxError = 0.0f;
+		bool finite = true;
+		for (int f = 0; f < 600 && finite; f++)
+		{
+			physics.Step(frameTime);
+			maxError = std::max(maxError, physics.GetMaxHingeError());
+			finite = physics.IsFinite();
+		}
+		float upright = 1.0f;
+		for (int i = 0; i < physics.GetNumRobots(); i++)
+			upright = std::min(upright, physics.GetUprightness(i));
+		float speed = physics.GetMaxSpeed();
+
+		bool ok = finite && maxError < 0.05f * dims.robotBodySize && upright > 0.95f && speed < 0.1f;
+		printf("physics, %d robots standing for 10 s: largest hinge gap %.4f, least upright %.3f, fastest body %.4f  %s\n",
+			physics.GetNumRobots(), maxError, upright, speed, ok ? "ok" : "FAILED");
+		if (!ok)
+			result = 1;
+	}
+
+	// walking on flat ground, the same result on any number of threads since robots are islands
+	RobotPhysics physics;
+	PlacePhysicsRobots(physics, dims, side, 10.0f, NULL, -10.0f);
+	std::vector<VECTOR3D> starts(physics.GetNumRobots()), ends;
+	for (int i = 0; i < physics.GetNumRobots(); i++)
+		starts[i] = physics.GetTorsoPosition(i);
+	RobotPhysics initial = physics;
+
+	int numFrames = (int)(walkTime / frameTime + 0.5f);
+	printf("%d robots walking at %.1f steps/s, %d bodies, %d solver steps per simulated second\n", physics.GetNumRobots(),
+		stepFrequency, physics.GetNumRobots() * NUM_ROBOT_BODIES, (int)(1.0f / PhysicsParams().timeStep + 0.5f));
+	printf("%10s %12s %12s\n", "threads", "ms/sim s", "x realtime");
+	bool deterministic = true;
+	for (int threads = 1; threads <= maxThreads; threads++)
+	{
+		physics = initial;
+		JobSystem jobs(threads);
+
+		BenchClock::time_point start = BenchClock::now();
+		for (int f = 0; f < numFrames; f++)
+		{
+			SetWalkTargets(physics, f * frameTime, stepFrequency);
+			physics.Step(frameTime, &jobs);
+		}
+		double runTime = MillisecondsSince(start) / walkTime;
+		printf("%10d %12.1f %12.2f\n", threads, runTime, 1000.0 / runTime);
+
+		if (threads == 1)
+		{
+			for (int i = 0; i < physics.GetNumRobots(); i++)
+				ends.push_back(physics.GetTorsoPosition(i));
+		}
+		for (int i = 0; i < physics.GetNumRobots(); i++)
+			deterministic = deterministic && (physics.GetTorsoPosition(i) - ends[i]).GetLength() == 0.0f;
+	}
+
+	int fallen = 0;
+	float walked = 0.0f;
+	for (int i = 0; i < physics.GetNumRobots(); i++)
+	{
+		if (physics.GetUprightness(i) < 0.9f)
+			fallen++;
+		float heading = (float)((i * 37) % 360) * 3.14159265f / 180.0f;
+		walked += (ends[i] - starts[i]).DotProduct(VECTOR3D(sinf(heading), 0.0f, cosf(heading)));
+	}
+	walked /= physics.GetNumRobots();
+
+	bool ok = physics.IsFinite() && fallen == 0 && walked > dims.robotBodySize && deterministic;
+	printf("walked %.2f forward on average, %d fallen, %s on every thread count  %s\n", walked, fallen,
+		deterministic ? "identical" : "different", ok ? "ok" : "FAILED");
+	if (!ok)
+		result = 1;
+	return result;
+}
+
+// Whether the segment from eye to point passes through the sphere before reaching point
+static bool SegmentHitsSphere(const VECTOR3D& eye, const VECTOR3D& point, const VECTOR3D& centre, float radius)
+{
+	VECTOR3D d = point - eye;
+	VECTOR3D m = eye - centre;
+	float a = d.DotProduct(d);
+	float b = m.DotProduct(d);
+	float c = m.DotProduct(m) - radius * radius;
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f)
+		return false;
+	float t = (-b - sqrtf(discriminant)) / a;
+	return t > 0.0f && t < 1.0f;
+}
+
+// Fraction of the robots and parts left by the frustum that occlusion culling removes, and
+// its CPU cost, for crowds seen at eye level and from above. On the smallest crowd every
+// culled part is checked to be hidden: its box's corners and centre must all be out of
+// the view or have their lines of sight pass through a body sphere or the ground.
+static int OcclusionBenchmark()
+{
+	const int crowdSizes[] = { 1000, 10000, 100000 };
+	const int numFrames = 10;
+	const float spacing = 8.0f;
+	const char* labels[] = { "eye level", "from above" };
+	MATRIX4X4 projection = MATRIX4X4::GetPerspective(60.0f, 1.3f, 0.2f, 2000.0f);
+	RobotDimensions dims;
+	JobSystem jobs;
+	OcclusionBuffer buffer;
+	buffer.Init(320, 240);
+	int result = 0;
+
+	printf("occlusion culling into a %dx%d depth buffer, per frame\n", buffer.GetWidth(), buffer.GetHeight());
+	printf("%8s %-11s %9s %9s %9s %10s %9s %9s %9s\n", "robots", "view", "frustum", "occluded", "parts",
+		"submitted", "culled", "draw ms", "test ms");
+	for (int crowd = 0; crowd < 3; crowd++)
+	{
+		RobotFleet fleet;
+		fleet.Init(crowdSizes[crowd], spacing, dims);
+		fleet.Update(&jobs);
+		const FleetFrame& frame = fleet.GetFrame();
+		int side = (int)ceil(sqrt((double)frame.numRobots));
+		float half = 0.5f * (side - 1) * spacing + spacing;
+
+		// the ground under the lowest foot, as far as the crowd goes
+		float groundY = 0.0f;
+		for (int i = 0; i < frame.numRobots; i++)
+			groundY = std::min(groundY, frame.bounds[i].min.y);
+		VECTOR3D ground[4] = { VECTOR3D(-half, groundY, -half), VECTOR3D(half, groundY, -half),
+			VECTOR3D(half, groundY, half), VECTOR3D(-half, groundY, half) };
+
+		for (int test = 0; test < 2; test++)
+		{
+			VECTOR3D eye = test == 0 ? VECTOR3D(0.3f * half, 1.0f, half + 4.0f) : VECTOR3D(0.0f, 40.0f, half + 30.0f);
+			VECTOR3D target = test == 0 ? VECTOR3D(0.0f, 1.0f, 0.0f) : VECTOR3D(0.0f, 0.0f, 0.0f);
+			MATRIX4X4 view = MATRIX4X4::GetLookAt(eye, target, VECTOR3D(0.0f, 1.0f, 0.0f));
+			Frustum frustum;
+			frustum.Extract(projection * view);
+
+			std::vector<int> visible;
+			for (int i = 0; i < frame.numRobots; i++)
+			{
+				if (frustum.ClassifyBox(frame.bounds[i].min, frame.bounds[i].max) != FRUSTUM_OUTSIDE)
+					visible.push_back(i);
+			}
+
+			std::vector<unsigned int> masks(visible.size());
+			VECTOR3D offset(0.0f, 0.0f, 0.0f);
+			double drawTime = 0.0, testTime = 0.0;
+			for (int f = 0; f < numFrames; f++)
+			{
+				BenchClock::time_point start = BenchClock::now();
+				buffer.Begin(view, projection);
+				buffer.DrawTriangle(ground[0], ground[1], ground[2]);
+				buffer.DrawTriangle(ground[0], ground[2], ground[3]);
+				for (size_t i = 0; i < visible.size(); i++)
+					DrawRobotOccluders(buffer, frame.GetPartMatrices(visible[i]), offset);
+				buffer.End();
+				drawTime += MillisecondsSince(start);
+
+				start = BenchClock::now();
+				for (size_t i = 0; i < visible.size(); i++)
+					masks[i] = GetVisibleRobotParts(buffer, frame.bounds[visible[i]], frame.GetPartMatrices(visible[i]), offset);
+				testTime += MillisecondsSince(start);
+			}
+
+			int occluded = 0, submitted = 0;
+			for (size_t i = 0; i < visible.size(); i++)
+			{
+				if (masks[i] == 0)
+					occluded++;
+				for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+					submitted += (masks[i] >> p) & 1;
+			}
+			int parts = (int)visible.size() * NUM_ROBOT_PARTS;
+
+			// every corner and the centre of a culled part's box must be out of sight
+			int unsound = 0;
+			if (crowd == 0)
+			{
+				for (size_t i = 0; i < visible.size(); i++)
+				{
+					const MATRIX4X4* partMatrices = frame.GetPartMatrices(visible[i]);
+					for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+					{
+						if ((masks[i] >> p) & 1)
+							continue;
+						BBox box = ComputePartBounds(robotParts[p].shape, partMatrices[p]);
+						for (int k = 0; k < 9; k++)
+						{
+							VECTOR3D point = k == 8 ? (box.min + box.max) * 0.5f :
+								VECTOR3D((k & 1) ? box.max.x : box.min.x, (k & 2) ? box.max.y : box.min.y, (k & 4) ? box.max.z : box.min.z);
+							bool hidden = point.y < groundY || frustum.ClassifyBox(point, point) == FRUSTUM_OUTSIDE;
+							for (size_t j = 0; j < visible.size() && !hidden; j++)
+							{
+								const MATRIX4X4& body = frame.GetPartMatrices(visible[j])[PART_BODY];
+								hidden = SegmentHitsSphere(eye, point, body.GetColumn(3), body.GetColumn(0).GetLength());
+							}
+							if (!hidden)
+							{
+								unsound++;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			printf("%8d %-11s %9d %8.1f%% %9d %10d %8.1f%% %9.3f %9.3f", frame.numRobots, labels[test], (int)visible.size(),
+				100.0 * occluded / std::max((int)visible.size(), 1), parts, submitted,
+				100.0 * (parts - submitted) / std::max(parts, 1), drawTime / numFrames, testTime / numFrames);
+			if (crowd == 0)
+			{
+				bool ok = unsound == 0 && submitted < parts;
+				printf("  %d culled parts in sight  %s", unsound, ok ? "ok" : "FAILED");
+				if (!ok)
+					result = 1;
+			}
+			printf("\n");
+		}
+	}
+	return result;
+}
+
+// Bytes of a robot's part meshes if every robot had its own, tessellated as drawn
+static size_t GetRobotMeshBytes()
+{
+	size_t bytes = 0;
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		IndexedMesh mesh;
+		const RobotPartInfo& part = robotParts[i];
+		if (part.shape == SHAPE_SPHERE)
+			BuildSphereMesh(part.slices, part.stacks, mesh);
+		else if (part.shape == SHAPE_CYLINDER)
+			BuildCylinderMesh(part.slices, part.stacks, mesh);
+		else
+			BuildCubeMesh(mesh);
+		bytes += mesh.vertices.size() * sizeof(IndexedMesh::Vertex) + mesh.indices.size() * sizeof(unsigned int);
+	}
+	return bytes;
+}
+
+// Stands in for drawing a robot with its materials: the material of every part that
+// changes it, then the part's modelview
+static float SubmitVariantRobot(const MATRIX4X4& view, const MATRIX4X4* partMatrices, const RobotVariant* variant,
+								const VariantPalette& palette)
+{
+	float checksum = 0.0f;
+	for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+	{
+		if (variant && (p == 0 || robotParts[p].bodyMaterial != robotParts[p - 1].bodyMaterial))
+		{
+			const VariantMaterial& material = robotParts[p].bodyMaterial ? palette.body[variant->bodyMaterial] :
+				palette.legs[variant->legMaterial];
+			checksum += material.diffuse[0] + material.shininess;
+		}
+		MATRIX4X4 modelView = view * partMatrices[p];
+		checksum += modelView.entries[12] + modelView.entries[13] + modelView.entries[14];
+	}
+	return checksum;
+}
+
+// Memory per robot and frame cost of a fleet of unique variants against the same fleet
+// of identical robots. Checks that the variants are unique and that every robot of any
+// size still stands on the same ground.
+static int VariantsBenchmark()
+{
+	const int numRobots = 100000;
+	const int numFrames = 5;
+	RobotDimensions dims;
+	JobSystem jobs;
+	VariantPalette palette;
+	GenerateVariantPalette(1, palette);
+
+	BenchClock::time_point start = BenchClock::now();
+	std::vector<RobotVariant> variants(numRobots);
+	for (int i = 0; i < numRobots; i++)
+		variants[i] = MakeRobotVariant(1, i, dims.robotBodySize);
+	double generateTime = MillisecondsSince(start);
+
+	// unique by their bytes, padding aside
+	std::vector<std::vector<unsigned char> > keys(numRobots);
+	for (int i = 0; i < numRobots; i++)
+	{
+		const unsigned char* bytes = (const unsigned char*)&variants[i];
+		keys[i].assign(bytes, bytes + sizeof(float) + NUM_VARIANT_PROPORTIONS + 2);
+	}
+	std::sort(keys.begin(), keys.end());
+	int unique = (int)(std::unique(keys.begin(), keys.end()) - keys.begin());
+
+	size_t stateBytes = sizeof(VECTOR3D) + sizeof(RobotPose) + sizeof(RobotAnimation);
+	size_t frameBytes = NUM_ROBOT_PARTS * sizeof(MATRIX4X4) + sizeof(BBox);
+	printf("variants: %d robots, %d unique, generated in %.2f ms\n", numRobots, unique, generateTime);
+	printf("  per robot: %d bytes of variant record, against %d for its own RobotDimensions and %d KB for its own meshes\n",
+		(int)sizeof(RobotVariant), (int)sizeof(RobotDimensions), (int)(GetRobotMeshBytes() / 1024));
+	printf("  fleet per robot: %d bytes of state, %d with the variant, %d of part matrices and bounds per frame\n",
+		(int)stateBytes, (int)(stateBytes + sizeof(RobotVariant)), (int)frameBytes);
+
+	MATRIX4X4 view = MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 60.0f, 300.0f), VECTOR3D(0.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 1.0f, 0.0f));
+	float restHeight = GetRestHeight(dims);
+	float checksum = 0.0f;
+	int result = 0;
+	printf("  %-10s %12s %12s\n", "robots", "update ms", "submit ms");
+	for (int test = 0; test < 2; test++)
+	{
+		RobotFleet fleet;
+		fleet.Init(numRobots, 8.0f, dims);
+		if (test == 1)
+			fleet.SetVariants(&variants[0]);
+
+		double updateTime = 0.0, submitTime = 0.0;
+		for (int f = 0; f < numFrames; f++)
+		{
+			start = BenchClock::now();
+			fleet.Update(&jobs);
+			updateTime += MillisecondsSince(start);
+
+			start = BenchClock::now();
+			const FleetFrame& frame = fleet.GetFrame();
+			for (int i = 0; i < frame.numRobots; i++)
+				checksum += SubmitVariantRobot(view, frame.GetPartMatrices(i), fleet.HasVariants() ? &fleet.GetVariant(i) : NULL, palette);
+			submitTime += MillisecondsSince(start);
+		}
+
+		// the right leg does not step, so its foot stays on the ground
+		float worst = 0.0f;
+		const FleetFrame& frame = fleet.GetFrame();
+		for (int i = 0; i < frame.numRobots; i++)
+			worst = std::max(worst, (float)fabs(frame.bounds[i].min.y + restHeight));
+		printf("  %-10s %12.2f %12.2f  feet within %.5f of the ground\n", test == 0 ? "identical" : "variants",
+			updateTime / numFrames, submitTime / numFrames, worst);
+		if (worst > 1e-3f * restHeight)
+			result = 1;
+	}
+
+	bool ok = result == 0 && unique > numRobots - numRobots / 1000;
+	printf("(checksum %g)  %s\n", checksum, ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
+
+// Hash of every word of the robots, in order, so a frame torn between two publishes
+// does not match either of them
+static unsigned long long TelemetryChecksum(const TelemetryRobot* robots, int numRobots)
+{
+	const unsigned int* words = (const unsigned int*)robots;
+	size_t count = (size_t)numRobots * sizeof(TelemetryRobot) / sizeof(unsigned int);
+	unsigned long long hash = 0;
+	for (size_t i = 0; i < count; i++)
+		hash = hash * 31 + words[i];
+	return hash;
+}
+
+static void PublishTelemetryFrame(TelemetryPublisher& publisher, const FleetFrame& frame, long long frameNumber,
+								  JobSystem* jobs)
+{
+	publisher.BeginFrame(frameNumber, frameNumber * 0.01, 10.0f, frame.numRobots);
+	publisher.WriteRobots(0, frame.numRobots, &frame.poses[0], &frame.partMatrices[0], VECTOR3D(0.0f, 0.0f, 0.0f), jobs);
+	publisher.EndFrame();
+}
+
+// What one reader thread saw of a run
+struct TelemetryReadStats
+{
+	int numRead = 0;
+	int numFailed = 0;
+	int numTorn = 0;
+	int retries = 0;
+	long long numSkipped = 0;
+	std::vector<double> latencies;	// milliseconds from EndFrame() to a complete copy
+};
+
+static int TelemetryBenchmark()
+{
+	const int numRobots = 10000;
+	const int numFleetFrames = 8;
+	const int numFrames = 200;
+	const int numReaders = 2;
+	const char* name = "Local\\RobotTelemetryBench";
+	int result = 0;
+
+	RobotDimensions dims;
+	RobotFleet fleet;
+	fleet.Init(numRobots, 8.0f, dims);
+	JobSystem jobs;
+	std::vector<FleetFrame> frames(numFleetFrames);
+	BenchClock::time_point start = BenchClock::now();
+	for (int f = 0; f < numFleetFrames; f++)
+		fleet.Update(&jobs, &frames[f]);
+	double updateTime = MillisecondsSince(start) / numFleetFrames;
+
+	// a ring of one slot, or slots larger than the header can describe, are refused
+	TelemetryPublisher publisher;
+	bool refused = !publisher.Open(name, numRobots, 1) && !publisher.Open(name, INT_MAX / (int)sizeof(TelemetryRobot) + 1);
+	printf("telemetry: one slot and oversized slots refused  %s\n", refused ? "ok" : "FAILED");
+	if (!refused)
+		return 1;
+
+	if (!publisher.Open(name, numRobots))
+	{
+		printf("telemetry: could not create shared memory %s  FAILED\n", name);
+		return 1;
+	}
+	double frameSize = numRobots * sizeof(TelemetryRobot) / (1024.0 * 1024.0);
+	printf("telemetry, %d robots, %.2f MB per frame, %.1f MB shared\n", numRobots, frameSize,
+		publisher.GetSharedSize() / (1024.0 * 1024.0));
+
+	// publisher cost on its own, against the fleet update that makes the frame
+	for (int threaded = 0; threaded < 2; threaded++)
+	{
+		start = BenchClock::now();
+		for (int f = 0; f < numFrames; f++)
+			PublishTelemetryFrame(publisher, frames[f % numFleetFrames], f, threaded ? &jobs : NULL);
+		double frameTime = MillisecondsSince(start) / numFrames;
+		printf("  publish %-7s %8.3f ms/frame %8.2f GB/s  (fleet update %.3f ms/frame)\n", threaded ? "jobs" : "serial",
+			frameTime, frameSize / 1024.0 / (frameTime * 0.001), updateTime);
+	}
+
+	// what a reader copies of each fleet frame, checked against the frame itself
+	TelemetryReader reader;
+	if (!reader.Open(name))
+	{
+		printf("  could not open shared memory %s  FAILED\n", name);
+		return 1;
+	}
+	unsigned long long expected[numFleetFrames];
+	TelemetrySnapshot snapshot;
+	bool same = true;
+	for (int f = 0; f < numFleetFrames; f++)
+	{
+		PublishTelemetryFrame(publisher, frames[f], f, NULL);
+		if (!reader.ReadLatest(snapshot) || snapshot.frameNumber != f || snapshot.numRobots != numRobots)
+		{
+			same = false;
+			break;
+		}
+		expected[f] = TelemetryChecksum(&snapshot.robots[0], numRobots);
+		for (int r = 0; r < numRobots; r += 97)
+		{
+			const MATRIX4X4& body = frames[f].GetPartMatrices(r)[PART_BODY];
+			const float* t = snapshot.robots[r].transforms[PART_BODY];
+			same = same && memcmp(snapshot.robots[r].angles, frames[f].poses[r].angles, sizeof(RobotPose)) == 0 &&
+				t[0] == body.entries[0] && t[1] == body.entries[4] && t[3] == body.entries[12] &&
+				t[7] == body.entries[13] && t[11] == body.entries[14];
+		}
+	}
+	printf("  snapshots match the fleet frames  %s\n", same ? "ok" : "FAILED");
+	if (!same)
+		return 1;
+	reader.Close();
+
+	// readers racing the publisher, at 60 frames a second and flat out, and with only two
+	// slots so the readers' copies are overwritten
+	struct TelemetryRun
+	{
+		const char* label;
+		int numSlots;
+		int numFrames;
+		bool paced;
+	};
+	const TelemetryRun runs[] =
+	{
+		{ "60 frames/s, 4 slots", 4, 120, true },
+		{ "flat out, 4 slots", 4, 400, false },
+		{ "flat out, 2 slots", 2, 400, false }
+	};
+	long long frameNumber = numFleetFrames;
+	for (const TelemetryRun& run : runs)
+	{
+		if (!publisher.Open(name, numRobots, run.numSlots))
+		{
+			printf("  could not create shared memory %s  FAILED\n", name);
+			return 1;
+		}
+		std::atomic<bool> publishing(true);
+		std::vector<TelemetryReadStats> stats(numReaders);
+		std::vector<std::thread> readers;
+		for (int i = 0; i < numReaders; i++)
+		{
+			readers.push_back(std::thread([&, i]()
+			{
+				TelemetryReader threadReader;
+				threadReader.Open(name);
+				TelemetrySnapshot copy;
+				TelemetryReadStats& stat = stats[i];
+				long long lastFrame = -1;
+				long long seen = threadReader.GetNumPublished();
+				while (publishing.load())
+				{
+					long long published = threadReader.GetNumPublished();
+					if (published == seen)
+					{
+						std::this_thread::yield();
+						continue;
+					}
+					seen = published;
+					if (!threadReader.ReadLatest(copy, 100, &stat.retries))
+					{
+						stat.numFailed++;
+						continue;
+					}
+					long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+						BenchClock::now().time_since_epoch()).count();
+					stat.latencies.push_back((now - copy.publishTime) * 1e-6);
+					if (lastFrame >= 0 && copy.frameNumber > lastFrame + 1)
+						stat.numSkipped += copy.frameNumber - lastFrame - 1;
+					lastFrame = copy.frameNumber;
+					if (TelemetryChecksum(&copy.robots[0], copy.numRobots) != expected[copy.frameNumber % numFleetFrames])
+						stat.numTorn++;
+					stat.numRead++;
+				}
+			}));
+		}
+
+		double publishTime = 0.0, maxPublishTime = 0.0;
+		start = BenchClock::now();
+		for (int f = 0; f < run.numFrames; f++, frameNumber++)
+		{
+			if (run.paced)
+				std::this_thread::sleep_until(start + std::chrono::microseconds(16667 * f));
+			BenchClock::time_point publishStart = BenchClock::now();
+			PublishTelemetryFrame(publisher, frames[frameNumber % numFleetFrames], frameNumber, &jobs);
+			double frameTime = MillisecondsSince(publishStart);
+			publishTime += frameTime;
+			maxPublishTime = std::max(maxPublishTime, frameTime);
+		}
+		double runTime = MillisecondsSince(start);
+		// leave the readers time for the last frame
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		publishing = false;
+		for (size_t i = 0; i < readers.size(); i++)
+			readers[i].join();
+
+		printf("  %s, %d frames in %.0f ms, publish %.3f ms/frame (max %.3f) with %d readers\n", run.label,
+			run.numFrames, runTime, publishTime / run.numFrames, maxPublishTime, numReaders);
+		printf("    reader   read skipped retries failed   latency avg    p99      max  torn\n");
+		for (int i = 0; i < numReaders; i++)
+		{
+			TelemetryReadStats& stat = stats[i];
+			std::vector<double>& latencies = stat.latencies;
+			std::sort(latencies.begin(), latencies.end());
+			double average = 0.0;
+			for (size_t l = 0; l < latencies.size(); l++)
+				average += latencies[l];
+			average = latencies.empty() ? 0.0 : average / latencies.size();
+			double p99 = latencies.empty() ? 0.0 : latencies[latencies.size() * 99 / 100];
+			double worst = latencies.empty() ? 0.0 : latencies.back();
+			printf("    %6d %6d %7lld %7d %6d %10.3f %8.3f %8.3f %5d\n", i, stat.numRead, stat.numSkipped, stat.retries,
+				stat.numFailed, average, p99, worst, stat.numTorn);
+			if (stat.numTorn > 0 || stat.numRead == 0)
+				result = 1;
+		}
+	}
+
+	printf("  no reader saw a torn frame  %s\n", result == 0 ? "ok" : "FAILED");
+	return result;
+}
+
+int RunBenchmark(const char* name)
+{
+	bool all = strcmp(name, "all") == 0;
+	bool found = false;
+	int result = 0;
+
+	if (all || strcmp(name, "fleetcheck") == 0)
+	{
+		found = true;
+		result |= FleetCheck();
+	}
+	if (all || strcmp(name, "fleet") == 0)
+	{
+		found = true;
+		result |= FleetBenchmark();
+	}
+
+	if (all || strcmp(name, "pipeline") == 0)
+	{
+		found = true;
+		result |= PipelineBenchmark();
+	}
+
+	if (all || strcmp(name, "contacts") == 0)
+	{
+		found = true;
+		result |= ContactBenchmark();
+	}
+
+	if (all || strcmp(name, "terrain") == 0)
+	{
+		found = true;
+		result |= TerrainBenchmark();
+	}
+
+	if (all || strcmp(name, "quadtree") == 0)
+	{
+		found = true;
+		result |= QuadtreeBenchmark();
+	}
+
+	if (all || strcmp(name, "meshopt") == 0)
+	{
+		found = true;
+		result |= MeshOptimizerBenchmark();
+	}
+
+	if (all || strcmp(name, "quantize") == 0)
+	{
+		found = true;
+		result |= QuantizeBenchmark();
+	}
+
+	if (all || strcmp(name, "frameallocs") == 0)
+	{
+		found = true;
+		result |= FrameAllocationCheck();
+	}
+
+	if (all || strcmp(name, "shadows") == 0)
+	{
+		found = true;
+		result |= ShadowBenchmark();
+	}
+
+	if (all || strcmp(name, "redraw") == 0)
+	{
+		found = true;
+		result |= RedrawBenchmark();
+	}
+
+	if (all || strcmp(name, "camera") == 0)
+	{
+		found = true;
+		result |= CameraBenchmark();
+	}
+
+	if (all || strcmp(name, "multiview") == 0)
+	{
+		found = true;
+		result |= MultiViewBenchmark();
+	}
+
+	if (all || strcmp(name, "skinning") == 0)
+	{
+		found = true;
+		result |= SkinningBenchmark();
+	}
+
+	if (all || strcmp(name, "trails") == 0)
+	{
+		found = true;
+		result |= TrailsBenchmark();
+	}
+
+	if (all || strcmp(name, "particles") == 0)
+	{
+		found = true;
+		result |= ParticleBenchmark();
+	}
+
+	if (all || strcmp(name, "picking") == 0)
+	{
+		found = true;
+		result |= PickingBenchmark();
+	}
+
+	if (all || strcmp(name, "joints") == 0)
+	{
+		found = true;
+		result |= JointsBenchmark();
+	}
+
+	if (all || strcmp(name, "physics") == 0)
+	{
+		found = true;
+		result |= PhysicsBenchmark();
+	}
+	if (all || strcmp(name, "occlusion") == 0)
+	{
+		found = true;
+		result |= OcclusionBenchmark();
+	}
+	if (all || strcmp(name, "variants") == 0)
+	{
+		found = true;
+		result |= VariantsBenchmark();
+	}
+	if (all || strcmp(name, "telemetry") == 0)
+	{
+		found = true;
+		result |= TelemetryBenchmark();
+	}
+
+	if (!found)
+	{
+		fprintf(stderr, "unknown benchmark %s\n", name);
+		return 1;
+	}
+	return result;
+}
@@ -0,0 +1,13 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Benchmarks.h
+//	Headless benchmarks and self checks, run with -bench <name> instead of opening
+//	a window. None of them make GL calls.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+// Runs the named benchmark ("all" runs every one), returns a process exit code
+int RunBenchmark(const char* name);
+
+#endif	//BENCHMARKS_H
@@ -0,0 +1,145 @@
+#include <math.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+
+#include "Camera.h"
+
+
+const float Camera::minPitch = -5.0f;
+const float Camera::maxPitch = 85.0f;
+const float Camera::minDistance = 5.0f;
+const float Camera::maxDistance = 30.0f;
+
+static const float degreesToRadians = 3.14159265358979f / 180.0f;
+
+
+Camera::Camera()
+{
+	params.mode = CAMERA_ORBIT;
+	params.target = VECTOR3D(0.0f, 0.0f, 0.0f);
+	params.distance = (float)sqrt(6.0 * 6.0 + 22.0 * 22.0);
+	params.yaw = 0.0f;
+	params.pitch = (float)atan2(6.0, 22.0) / degreesToRadians;
+	params.heading = 0.0f;
+	params.fovy = 60.0f;
+	params.aspect = 1.0f;
+	params.zNear = 0.2f;
+	params.zFar = 40.0f;
+	params.viewportHeight = 1;
+
+	viewDirty = true;
+	projectionDirty = true;
+	numUpdates = 0;
+}
+
+void Camera::SetViewport(int width, int height)
+{
+	if (height < 1)
+		height = 1;
+	float aspect = (float)width / height;
+	if (aspect != params.aspect || height != params.viewportHeight)
+	{
+		params.aspect = aspect;
+		params.viewportHeight = height;
+		projectionDirty = true;
+	}
+}
+
+void Camera::SetPerspective(float fovy, float zNear, float zFar)
+{
+	if (fovy != params.fovy || zNear != params.zNear || zFar != params.zFar)
+	{
+		params.fovy = fovy;
+		params.zNear = zNear;
+		params.zFar = zFar;
+		projectionDirty = true;
+	}
+}
+
+void Camera::SetMode(CameraMode mode)
+{
+	if (mode == params.mode)
+		return;
+
+	// keep the camera where it is, follow mode measures yaw from the heading
+	if (mode == CAMERA_FOLLOW)
+		params.yaw -= params.heading;
+	else
+		params.yaw += params.heading;
+	params.mode = mode;
+}
+
+void Camera::Orbit(float yawDegrees, float pitchDegrees)
+{
+	if (yawDegrees == 0.0f && pitchDegrees == 0.0f)
+		return;
+
+	params.yaw = (float)fmod(params.yaw + yawDegrees, 360.0f);
+	params.pitch += pitchDegrees;
+	if (params.pitch < minPitch)
+		params.pitch = minPitch;
+	if (params.pitch > maxPitch)
+		params.pitch = maxPitch;
+	viewDirty = true;
+}
+
+void Camera::Zoom(float factor)
+{
+	float distance = params.distance * factor;
+	if (distance < minDistance)
+		distance = minDistance;
+	if (distance > maxDistance)
+		distance = maxDistance;
+	if (distance != params.distance)
+	{
+		params.distance = distance;
+		viewDirty = true;
+	}
+}
+
+void Camera::SetTarget(const VECTOR3D& target)
+{
+	if (target.x != params.target.x || target.y != params.target.y || target.z != params.target.z)
+	{
+		params.target = target;
+		viewDirty = true;
+	}
+}
+
+void Camera::Follow(const VECTOR3D& target, float heading)
+{
+	SetTarget(target);
+	if (heading != params.heading)
+	{
+		params.heading = heading;
+		if (params.mode == CAMERA_FOLLOW)
+			viewDirty = true;
+	}
+}
+
+void Camera::Update()
+{
+	if (!viewDirty && !projectionDirty)
+		return;
+
+	if (viewDirty)
+	{
+		float yaw = params.yaw;
+		if (params.mode == CAMERA_FOLLOW)
+			yaw += params.heading;
+		float cosPitch = (float)cos(params.pitch * degreesToRadians);
+		VECTOR3D offset((float)sin(yaw * degreesToRadians) * cosPitch, (float)sin(params.pitch * degreesToRadians),
+						(float)cos(yaw * degreesToRadians) * cosPitch);
+		eye = params.target + offset * params.distance;
+		view = MATRIX4X4::GetLookAt(eye, params.target, VECTOR3D(0.0f, 1.0f, 0.0f));
+	}
+	if (projectionDirty)
+		projection = MATRIX4X4::GetPerspective(params.fovy, params.aspect, params.zNear, params.zFar);
+
+	viewProjection = projection * view;
+	frustum.Extract(viewProjection);
+	viewDirty = false;
+	projectionDirty = false;
+	numUpdates++;
+}
@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Camera.h
+//	Perspective camera orbiting a target point, dragged around with the mouse. In follow
+//	mode the orbit turns with the target's heading, so the camera keeps its place relative
+//	to a spinning or walking robot.
+//
+//	The view, projection and view-projection matrices and the frustum are kept, and only
+//	computed again by the first Get...() after a setting changed, so every user in a
+//	frame shares them without reading matrices back from GL. The settings live in one
+//	struct, CameraParams, which is all a frame depends on.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+
+enum CameraMode
+{
+	CAMERA_ORBIT,
+	CAMERA_FOLLOW
+};
+
+struct CameraParams
+{
+	int mode;
+	VECTOR3D target;
+	float distance;
+	float yaw, pitch;		// degrees, yaw about +y from +z, pitch up from the ground plane
+	float heading;			// target's heading in follow mode, degrees about +y
+	float fovy, aspect, zNear, zFar;
+	int viewportHeight;
+};
+
+class Camera
+{
+private:
+	CameraParams params;
+
+	// Derived from params, valid unless dirty
+	bool viewDirty, projectionDirty;
+	VECTOR3D eye;
+	MATRIX4X4 view;
+	MATRIX4X4 projection;
+	MATRIX4X4 viewProjection;
+	Frustum frustum;
+
+	long long numUpdates;
+
+	void Update();
+
+public:
+	// Looking at the origin from (0, 6, 22), 60 degrees vertical field of view
+	Camera();
+
+	void SetViewport(int width, int height);
+	void SetPerspective(float fovy, float zNear, float zFar);
+	void SetMode(CameraMode mode);
+
+	// Orbit around the target by degrees of yaw and pitch, pitch is kept within
+	// [minPitch, maxPitch] so the camera stays above the ground and never flips
+	void Orbit(float yawDegrees, float pitchDegrees);
+
+	// Distance to the target times factor, within [minDistance, maxDistance]
+	void Zoom(float factor);
+
+	void SetTarget(const VECTOR3D& target);
+
+	// Target position and heading in follow mode, orbit mode ignores the heading
+	void Follow(const VECTOR3D& target, float heading);
+
+	const CameraParams& GetParams() const
+	{
+		return params;
+	}
+
+	const VECTOR3D& GetEye()
+	{
+		Update();
+		return eye;
+	}
+
+	const MATRIX4X4& GetView()
+	{
+		Update();
+		return view;
+	}
+
+	const MATRIX4X4& GetProjection()
+	{
+		Update();
+		return projection;
+	}
+
+	const MATRIX4X4& GetViewProjection()
+	{
+		Update();
+		return viewProjection;
+	}
+
+	// Planes in world coordinates
+	const Frustum& GetFrustum()
+	{
+		Update();
+		return frustum;
+	}
+
+	// Times the matrices were computed, for benchmarks
+	long long GetNumUpdates() const
+	{
+		return numUpdates;
+	}
+
+	static const float minPitch, maxPitch;
+	static const float minDistance, maxDistance;
+};
+
+#endif	//CAMERA_H
@@ -0,0 +1,481 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "QuadMesh.h"
+#include "Allocators.h"
+
+#include "Collision.h"
+
+
+// Parts joined at a joint within one robot, these always touch
+static const int jointedParts[][2] =
+{
+	{ PART_BODY, PART_CANNON }, { PART_CANNON, PART_NOTCH },
+	{ PART_BODY, PART_LEFT_HIP }, { PART_LEFT_HIP, PART_LEFT_UPPER_LEG },
+	{ PART_LEFT_UPPER_LEG, PART_LEFT_LOWER_LEG }, { PART_LEFT_LOWER_LEG, PART_LEFT_FOOT },
+	{ PART_BODY, PART_RIGHT_HIP }, { PART_RIGHT_HIP, PART_RIGHT_UPPER_LEG },
+	{ PART_RIGHT_UPPER_LEG, PART_RIGHT_LOWER_LEG }, { PART_RIGHT_LOWER_LEG, PART_RIGHT_FOOT },
+	{ PART_BODY, PART_LEFT_SHOULDER }, { PART_LEFT_SHOULDER, PART_LEFT_UPPER_ARM },
+	{ PART_LEFT_UPPER_ARM, PART_LEFT_ARM_GUN },
+	{ PART_BODY, PART_RIGHT_SHOULDER }, { PART_RIGHT_SHOULDER, PART_RIGHT_UPPER_ARM },
+	{ PART_RIGHT_UPPER_ARM, PART_RIGHT_ARM_GUN },
+};
+
+// Jointed pairs looked up both ways round, filled in before main() so that contact
+// queries on any thread only read it
+struct JointedPartTable
+{
+	bool jointed[NUM_ROBOT_PARTS][NUM_ROBOT_PARTS];
+
+	JointedPartTable()
+	{
+		memset(jointed, 0, sizeof(jointed));
+		for (size_t i = 0; i < sizeof(jointedParts) / sizeof(jointedParts[0]); i++)
+		{
+			jointed[jointedParts[i][0]][jointedParts[i][1]] = true;
+			jointed[jointedParts[i][1]][jointedParts[i][0]] = true;
+		}
+	}
+};
+
+static const JointedPartTable jointedPartTable;
+
+static bool PartsJointed(int a, int b)
+{
+	return jointedPartTable.jointed[a][b];
+}
+
+
+void MakePartCollider(PartShape shape, const MATRIX4X4& M, Collider& collider)
+{
+	VECTOR3D col0 = M.GetColumn(0), col1 = M.GetColumn(1), col2 = M.GetColumn(2);
+
+	switch (shape)
+	{
+	case SHAPE_SPHERE:
+		collider.type = COLLIDER_SPHERE;
+		collider.centre = M.GetColumn(3);
+		collider.radius = col0.GetLength();
+		break;
+
+	case SHAPE_CYLINDER:
+		// unit cylinder along +z, x and y are always scaled alike
+		collider.type = COLLIDER_CAPSULE;
+		collider.p0 = M.GetColumn(3);
+		collider.p1 = collider.p0 + col2;
+		collider.centre = collider.p0.lerp(collider.p1, 0.5f);
+		collider.radius = col0.GetLength();
+		break;
+
+	case SHAPE_CUBE:
+		collider.type = COLLIDER_BOX;
+		collider.centre = M.GetColumn(3);
+		collider.halfExtents.Set(0.5f * col0.GetLength(), 0.5f * col1.GetLength(), 0.5f * col2.GetLength());
+		collider.axes[0] = col0;
+		collider.axes[1] = col1;
+		collider.axes[2] = col2;
+		collider.axes[0].Normalize();
+		collider.axes[1].Normalize();
+		collider.axes[2].Normalize();
+		break;
+	}
+
+	collider.bounds = ComputePartBounds(shape, M);
+}
+
+VECTOR3D ColliderSupport(const Collider& c, const VECTOR3D& d)
+{
+	switch (c.type)
+	{
+	case COLLIDER_SPHERE:
+	{
+		VECTOR3D n = d;
+		n.Normalize();
+		return c.centre + n * c.radius;
+	}
+	case COLLIDER_CAPSULE:
+	{
+		VECTOR3D n = d;
+		n.Normalize();
+		return ((c.p1 - c.p0).DotProduct(d) > 0.0f ? c.p1 : c.p0) + n * c.radius;
+	}
+	case COLLIDER_BOX:
+	default:
+	{
+		VECTOR3D p = c.centre;
+		for (int i = 0; i < 3; i++)
+		{
+			float h = (i == 0) ? c.halfExtents.x : (i == 1) ? c.halfExtents.y : c.halfExtents.z;
+			p += c.axes[i] * (c.axes[i].DotProduct(d) >= 0.0f ? h : -h);
+		}
+		return p;
+	}
+	}
+}
+
+
+// GJK on the Minkowski difference a - b, simplex[0] is always the newest point
+static VECTOR3D MinkowskiSupport(const Collider& a, const Collider& b, const VECTOR3D& d)
+{
+	return ColliderSupport(a, d) - ColliderSupport(b, -d);
+}
+
+static bool SameDirection(const VECTOR3D& a, const VECTOR3D& b)
+{
+	return a.DotProduct(b) > 0.0f;
+}
+
+static VECTOR3D TripleCross(const VECTOR3D& a, const VECTOR3D& b, const VECTOR3D& c)
+{
+	return a.CrossProduct(b).CrossProduct(c);
+}
+
+static bool LineCase(VECTOR3D* s, int& n, VECTOR3D& d)
+{
+	VECTOR3D ab = s[1] - s[0], ao = -s[0];
+	if (SameDirection(ab, ao))
+	{
+		d = TripleCross(ab, ao, ab);
+	}
+	else
+	{
+		n = 1;
+		d = ao;
+	}
+	return false;
+}
+
+static bool TriangleCase(VECTOR3D* s, int& n, VECTOR3D& d)
+{
+	VECTOR3D a = s[0], b = s[1], c = s[2];
+	VECTOR3D ab = b - a, ac = c - a, ao = -a;
+	VECTOR3D abc = ab.CrossProduct(ac);
+
+	if (SameDirection(abc.CrossProduct(ac), ao))
+	{
+		if (SameDirection(ac, ao))
+		{
+			s[1] = c;
+			n = 2;
+			d = TripleCross(ac, ao, ac);
+			return false;
+		}
+		n = 2;
+		return LineCase(s, n, d);
+	}
+
+	if (SameDirection(ab.CrossProduct(abc), ao))
+	{
+		n = 2;
+		return LineCase(s, n, d);
+	}
+
+	if (SameDirection(abc, ao))
+	{
+		d = abc;
+	}
+	else
+	{
+		s[1] = c;
+		s[2] = b;
+		d = -abc;
+	}
+	return false;
+}
+
+static bool TetrahedronCase(VECTOR3D* s, int& n, VECTOR3D& d)
+{
+	VECTOR3D a = s[0], b = s[1], c = s[2], e = s[3];
+	VECTOR3D ab = b - a, ac = c - a, ae = e - a, ao = -a;
+
+	if (SameDirection(ab.CrossProduct(ac), ao))
+	{
+		n = 3;
+		return TriangleCase(s, n, d);
+	}
+	if (SameDirection(ac.CrossProduct(ae), ao))
+	{
+		s[1] = c;
+		s[2] = e;
+		n = 3;
+		return TriangleCase(s, n, d);
+	}
+	if (SameDirection(ae.CrossProduct(ab), ao))
+	{
+		s[1] = e;
+		s[2] = b;
+		n = 3;
+		return TriangleCase(s, n, d);
+	}
+	return true;
+}
+
+bool CollidersIntersect(const Collider& a, const Collider& b)
+{
+	VECTOR3D d = b.centre - a.centre;
+	if (d.GetQuaddLength() < 1e-12f)
+		d.Set(1.0f, 0.0f, 0.0f);
+
+	VECTOR3D simplex[4];
+	simplex[0] = MinkowskiSupport(a, b, d);
+	int n = 1;
+	d = -simplex[0];
+
+	for (int iteration = 0; iteration < 64; iteration++)
+	{
+		// origin lies on the current simplex
+		if (d.GetQuaddLength() < 1e-12f)
+			return true;
+
+		VECTOR3D p = MinkowskiSupport(a, b, d);
+		if (p.DotProduct(d) < 0.0f)
+			return false;
+
+		for (int i = n; i > 0; i--)
+			simplex[i] = simplex[i - 1];
+		simplex[0] = p;
+		n++;
+
+		bool enclosed = false;
+		switch (n)
+		{
+		case 2: enclosed = LineCase(simplex, n, d); break;
+		case 3: enclosed = TriangleCase(simplex, n, d); break;
+		case 4: enclosed = TetrahedronCase(simplex, n, d); break;
+		}
+		if (enclosed)
+			return true;
+	}
+
+	// did not converge, treat as touching
+	return true;
+}
+
+
+void CollisionWorld::Clear()
+{
+	colliders.clear();
+}
+
+void CollisionWorld::AddRobot(int robot, const MATRIX4X4 partMatrices[NUM_ROBOT_PARTS])
+{
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		Collider collider;
+		MakePartCollider(robotParts[i].shape, partMatrices[i], collider);
+		collider.robot = robot;
+		collider.part = i;
+		colliders.push_back(collider);
+	}
+}
+
+void CollisionWorld::FindGroundContacts(const QuadMesh& ground, const VECTOR3D& groundOffset, std::vector<GroundContact>& contacts)
+{
+	contacts.clear();
+
+	for (size_t i = 0; i < colliders.size(); i++)
+	{
+		const Collider& c = colliders[i];
+		int row0, row1, col0, col1;
+		if (!ground.GetQuadRange(c.bounds.min - groundOffset, c.bounds.max - groundOffset, row0, row1, col0, col1))
+			continue;
+
+		GroundContact deepest;
+		deepest.depth = 0.0f;
+
+		for (int row = row0; row <= row1; row++)
+		{
+			for (int col = col0; col <= col1; col++)
+			{
+				// Counterclockwise quad split into two triangles
+				VECTOR3D q0 = ground.GetVertex(row, col).position + groundOffset;
+				VECTOR3D q1 = ground.GetVertex(row, col + 1).position + groundOffset;
+				VECTOR3D q2 = ground.GetVertex(row + 1, col + 1).position + groundOffset;
+				VECTOR3D q3 = ground.GetVertex(row + 1, col).position + groundOffset;
+				const VECTOR3D* triangles[2][3] = { { &q0, &q1, &q2 }, { &q0, &q2, &q3 } };
+
+				for (int t = 0; t < 2; t++)
+				{
+					const VECTOR3D& a = *triangles[t][0];
+					const VECTOR3D& b = *triangles[t][1];
+					const VECTOR3D& e = *triangles[t][2];
+					VECTOR3D normal = (b - a).CrossProduct(e - a);
+					normal.Normalize();
+
+					// lowest point of the part relative to the triangle plane
+					VECTOR3D s = ColliderSupport(c, -normal);
+					float depth = (a - s).DotProduct(normal);
+					if (depth <= deepest.depth)
+						continue;
+
+					// only counts when that point lies over this triangle
+					VECTOR3D p = s + normal * depth;
+					if ((b - a).CrossProduct(p - a).DotProduct(normal) < 0.0f ||
+						(e - b).CrossProduct(p - b).DotProduct(normal) < 0.0f ||
+						(a - e).CrossProduct(p - e).DotProduct(normal) < 0.0f)
+					{
+						continue;
+					}
+
+					deepest.depth = depth;
+					deepest.point = p;
+					deepest.normal = normal;
+				}
+			}
+		}
+
+		if (deepest.depth > 0.0f)
+		{
+			deepest.robot = c.robot;
+			deepest.part = c.part;
+			contacts.push_back(deepest);
+		}
+	}
+}
+
+// count elements from the frame arena when there is one, else from the kept vector
+template <class T>
+static T* ScratchArray(FrameArena* arena, std::vector<T>& kept, size_t count)
+{
+	if (arena)
+		return arena->AllocateArray<T>(count);
+	kept.resize(count);
+	return count ? &kept[0] : NULL;
+}
+
+void CollisionWorld::FindPartContacts(std::vector<PartContact>& contacts, FrameArena* scratch)
+{
+	contacts.clear();
+
+	// Reuse last frame's order, it is nearly sorted already so insertion sort is close to linear
+	if (sweepOrder.size() != colliders.size())
+	{
+		sweepOrder.resize(colliders.size());
+		for (size_t i = 0; i < sweepOrder.size(); i++)
+			sweepOrder[i] = (int)i;
+		std::sort(sweepOrder.begin(), sweepOrder.end(),
+			[this](int a, int b) { return colliders[a].bounds.min.x < colliders[b].bounds.min.x; });
+	}
+
+	for (size_t i = 1; i < sweepOrder.size(); i++)
+	{
+		int index = sweepOrder[i];
+		float key = colliders[index].bounds.min.x;
+		size_t j = i;
+		while (j > 0 && colliders[sweepOrder[j - 1]].bounds.min.x > key)
+		{
+			sweepOrder[j] = sweepOrder[j - 1];
+			j--;
+		}
+		sweepOrder[j] = index;
+	}
+
+	if (colliders.empty())
+		return;
+
+	// A single sweep along x degenerates when many parts share an x range (a grid of
+	// robots), so the sweep runs separately in strips along z. Distributing the x-sorted
+	// order keeps every strip sorted.
+	float zMin = 1e30f, zMax = -1e30f, averageDepth = 0.0f;
+	for (size_t i = 0; i < colliders.size(); i++)
+	{
+		zMin = fmin(zMin, colliders[i].bounds.min.z);
+		zMax = fmax(zMax, colliders[i].bounds.max.z);
+		averageDepth += colliders[i].bounds.max.z - colliders[i].bounds.min.z;
+	}
+	averageDepth /= colliders.size();
+
+	int numStrips = (int)sqrt(colliders.size() / 64.0);
+	if (numStrips < 1)
+		numStrips = 1;
+	float stripWidth = (zMax - zMin) / numStrips;
+	if (stripWidth < 4.0f * averageDepth || stripWidth <= 0.0f)
+	{
+		stripWidth = 4.0f * averageDepth > 0.0f ? 4.0f * averageDepth : 1.0f;
+		numStrips = (int)((zMax - zMin) / stripWidth) + 1;
+	}
+
+	// Strip s holds z from zMin + s * stripWidth up to the next strip, the last one up to
+	// and including zMax
+	auto stripOf = [&](float z) -> int
+	{
+		int s = (int)((z - zMin) / stripWidth);
+		return s < numStrips ? s : numStrips - 1;
+	};
+
+	// Strips are laid out one after another in stripEntries, stripStart[s] is the first of
+	// strip s: count the entries per strip, then fill them in sweep order
+	int* stripStart = ScratchArray(scratch, stripStarts, numStrips + 1);
+	for (int s = 0; s <= numStrips; s++)
+		stripStart[s] = 0;
+	for (size_t i = 0; i < colliders.size(); i++)
+	{
+		int last = stripOf(colliders[i].bounds.max.z);
+		for (int s = stripOf(colliders[i].bounds.min.z); s <= last; s++)
+			stripStart[s + 1]++;
+	}
+	for (int s = 0; s < numStrips; s++)
+		stripStart[s + 1] += stripStart[s];
+
+	int* stripEntry = ScratchArray(scratch, stripEntries, stripStart[numStrips]);
+	int* fill = ScratchArray(scratch, stripFill, numStrips);
+	for (int s = 0; s < numStrips; s++)
+		fill[s] = stripStart[s];
+	for (size_t i = 0; i < sweepOrder.size(); i++)
+	{
+		const Collider& c = colliders[sweepOrder[i]];
+		int last = stripOf(c.bounds.max.z);
+		for (int s = stripOf(c.bounds.min.z); s <= last; s++)
+			stripEntry[fill[s]++] = sweepOrder[i];
+	}
+
+	for (int s = 0; s < numStrips; s++)
+	{
+		const int* strip = stripEntry + stripStart[s];
+		const int stripSize = stripStart[s + 1] - stripStart[s];
+		for (int i = 0; i < stripSize; i++)
+		{
+			const Collider& a = colliders[strip[i]];
+
+			for (int j = i + 1; j < stripSize; j++)
+			{
+				const Collider& b = colliders[strip[j]];
+				if (b.bounds.min.x > a.bounds.max.x)
+					break;
+
+				if (a.bounds.max.y < b.bounds.min.y || b.bounds.max.y < a.bounds.min.y ||
+					a.bounds.max.z < b.bounds.min.z || b.bounds.max.z < a.bounds.min.z)
+				{
+					continue;
+				}
+
+				// pairs sharing several strips are reported only by the strip holding their overlap's start
+				if (stripOf(fmax(a.bounds.min.z, b.bounds.min.z)) != s)
+					continue;
+
+				if (a.robot == b.robot && (a.part == b.part || PartsJointed(a.part, b.part)))
+					continue;
+
+				if (!CollidersIntersect(a, b))
+					continue;
+
+				PartContact contact;
+				contact.robotA = a.robot;
+				contact.partA = a.part;
+				contact.robotB = b.robot;
+				contact.partB = b.part;
+				contact.point.Set(0.5f * (fmax(a.bounds.min.x, b.bounds.min.x) + fmin(a.bounds.max.x, b.bounds.max.x)),
+								  0.5f * (fmax(a.bounds.min.y, b.bounds.min.y) + fmin(a.bounds.max.y, b.bounds.max.y)),
+								  0.5f * (fmax(a.bounds.min.z, b.bounds.min.z) + fmin(a.bounds.max.z, b.bounds.max.z)));
+				contacts.push_back(contact);
+			}
+		}
+	}
+}
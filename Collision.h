@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Collision.h
+//	Contact detection for robot parts. The body is a sphere, the cylinder parts
+//	(hips, shoulders, cannon, arm guns) are capsules and the cube parts are oriented
+//	boxes, all built from the part matrices produced by ComputeRobotTransforms().
+//
+//	CollisionWorld keeps one collider per part. A sweep-and-prune pass over the x extents
+//	of their bounding boxes, run in strips along z, finds candidate pairs, so the narrow
+//	phase (GJK on the shapes' support functions) only runs on parts that are actually
+//	close. Ground contacts test each part against the QuadMesh triangles under its
+//	bounding box.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+
+class QuadMesh;
+class FrameArena;
+
+enum ColliderType
+{
+	COLLIDER_SPHERE,	// centre, radius
+	COLLIDER_CAPSULE,	// segment p0-p1, radius
+	COLLIDER_BOX		// centre, unit axes, half extents
+};
+
+struct Collider
+{
+	ColliderType type;
+	VECTOR3D centre;
+	VECTOR3D p0, p1;
+	float radius;
+	VECTOR3D axes[3];
+	VECTOR3D halfExtents;
+	BBox bounds;
+
+	int robot;
+	int part;
+};
+
+struct GroundContact
+{
+	int robot, part;
+	VECTOR3D point;		// deepest point of the part, on the ground surface
+	VECTOR3D normal;	// ground normal
+	float depth;		// penetration along the normal
+};
+
+struct PartContact
+{
+	int robotA, partA;
+	int robotB, partB;
+	VECTOR3D point;		// centre of the overlap of the two bounding boxes
+};
+
+// Collider for one part's unit primitive under its part matrix
+void MakePartCollider(PartShape shape, const MATRIX4X4& partMatrix, Collider& collider);
+
+// Farthest point of the collider in direction d
+VECTOR3D ColliderSupport(const Collider& collider, const VECTOR3D& d);
+
+// Exact overlap test of two convex colliders (GJK)
+bool CollidersIntersect(const Collider& a, const Collider& b);
+
+class CollisionWorld
+{
+private:
+	std::vector<Collider> colliders;
+
+	// Sweep-and-prune order by bounds.min.x, kept between frames so re-sorting is cheap
+	std::vector<int> sweepOrder;
+
+	// z strips, used when no frame arena is given
+	std::vector<int> stripStarts;
+	std::vector<int> stripEntries;
+	std::vector<int> stripFill;
+
+public:
+	// Starts a new frame, the previous sweep order is reused when the part count is unchanged
+	void Clear();
+
+	void AddRobot(int robot, const MATRIX4X4 partMatrices[NUM_ROBOT_PARTS]);
+
+	int GetNumColliders()
+	{
+		return (int)colliders.size();
+	}
+
+	// Parts penetrating the ground mesh, whose vertices are offset by groundOffset in the world
+	void FindGroundContacts(const QuadMesh& ground, const VECTOR3D& groundOffset, std::vector<GroundContact>& contacts);
+
+	// Overlapping parts, of the same or of different robots. Parts joined to each other
+	// within one robot always touch and are skipped. The sweep's scratch arrays come from
+	// scratch when given.
+	void FindPartContacts(std::vector<PartContact>& contacts, FrameArena* scratch = NULL);
+};
+
+#endif	//COLLISION_H
@@ -0,0 +1,115 @@
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "RobotFleet.h"
+#include "JobSystem.h"
+#include "JointTrails.h"
+
+#include "FramePipeline.h"
+
+
+FramePipeline::FramePipeline()
+{
+	pending = 1;
+	back = 0;
+	front = 2;
+	fleet = NULL;
+	trails = NULL;
+	numThreads = 1;
+	tickInterval = 0;
+	numFramesSimulated = 0;
+	running = false;
+}
+
+void FramePipeline::Start(RobotFleet* fleet, int numThreads, int tickInterval, JointTrails* trails)
+{
+	Stop();
+
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency() - 1;
+	if (numThreads < 1)
+		numThreads = 1;
+
+	this->fleet = fleet;
+	this->trails = trails;
+	this->numThreads = numThreads;
+	this->tickInterval = tickInterval;
+
+	// Fresh rotation, no snapshot is visible to the renderer until the first frame lands
+	for (int i = 0; i < 3; i++)
+	{
+		snapshots[i].frameNumber = -1;
+		snapshots[i].fleet.Resize(fleet->GetNumRobots());
+	}
+	back = 0;
+	pending = 1;
+	front = 2;
+	numFramesSimulated = 0;
+
+	running = true;
+	simulationThread = std::thread(&FramePipeline::SimulationLoop, this);
+}
+
+void FramePipeline::Stop()
+{
+	if (!running.load())
+		return;
+
+	running = false;
+	simulationThread.join();
+
+	for (int i = 0; i < 3; i++)
+		snapshots[i].frameNumber = -1;
+	pending.store(pending.load() & ~FRESH_BIT);
+}
+
+void FramePipeline::SimulationLoop()
+{
+	// The job system is driven from this thread so it is created here
+	JobSystem jobs(numThreads);
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point nextTick = startTime;
+	while (running.load())
+	{
+		FrameSnapshot& snapshot = snapshots[back];
+		snapshot.simulationStart = std::chrono::steady_clock::now();
+		fleet->Update(&jobs, &snapshot.fleet);
+		if (trails)
+		{
+			float time = std::chrono::duration<float>(snapshot.simulationStart - startTime).count();
+			trails->Push(&snapshot.fleet.partMatrices[0], time, &jobs);
+		}
+		snapshot.frameNumber = numFramesSimulated.load();
+		numFramesSimulated++;
+
+		// Publish: the old pending snapshot, taken or not, becomes the next back buffer
+		back = pending.exchange(back | FRESH_BIT, std::memory_order_acq_rel) & ~FRESH_BIT;
+
+		if (tickInterval > 0)
+		{
+			nextTick += std::chrono::milliseconds(tickInterval);
+			std::this_thread::sleep_until(nextTick);
+		}
+	}
+}
+
+const FrameSnapshot* FramePipeline::AcquireLatest()
+{
+	if (pending.load(std::memory_order_acquire) & FRESH_BIT)
+		front = pending.exchange(front, std::memory_order_acq_rel) & ~FRESH_BIT;
+
+	return snapshots[front].frameNumber >= 0 ? &snapshots[front] : NULL;
+}
+
+const FrameSnapshot* FramePipeline::WaitForNext()
+{
+	while (!(pending.load(std::memory_order_acquire) & FRESH_BIT))
+	{
+		if (!running.load())
+			return NULL;
+		std::this_thread::yield();
+	}
+	return AcquireLatest();
+}
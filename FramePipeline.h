@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	FramePipeline.h
+//	Runs the fleet simulation on its own thread so frame N+1 is simulated while frame N
+//	is being drawn.
+//
+//	Three snapshots rotate between the simulation thread and the render thread without
+//	any locks: the simulation fills its back snapshot and swaps it into the pending slot,
+//	and the renderer swaps the pending slot for its front snapshot whenever it is fresh.
+//	A snapshot the renderer holds is never written to, so drawing reads it directly.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "RobotFleet.h"
+
+class JointTrails;
+
+struct FrameSnapshot
+{
+	long long frameNumber = -1;
+	FleetFrame fleet;
+
+	// when simulation of this frame started, for latency measurements
+	std::chrono::steady_clock::time_point simulationStart;
+};
+
+class FramePipeline
+{
+private:
+	// pending slot holds a snapshot index, FRESH_BIT is set until the renderer takes it
+	static const int FRESH_BIT = 4;
+
+	FrameSnapshot snapshots[3];
+	std::atomic<int> pending;
+	int back;		// owned by the simulation thread
+	int front;		// owned by the render thread
+
+	RobotFleet* fleet;
+	JointTrails* trails;	// pushed from every simulated frame when given
+	int numThreads;
+	int tickInterval;		// milliseconds between ticks, 0 runs flat out
+	std::atomic<long long> numFramesSimulated;
+
+	std::thread simulationThread;
+	std::atomic<bool> running;
+
+private:
+	void SimulationLoop();
+
+public:
+	FramePipeline();
+
+	~FramePipeline()
+	{
+		Stop();
+	}
+
+	// The fleet belongs to the simulation thread until Stop() returns, and so does pushing
+	// to trails, which are timed in seconds since Start(). numThreads 0 leaves one hardware
+	// thread to the renderer and gives the simulation the rest, so the two overlap.
+	void Start(RobotFleet* fleet, int numThreads, int tickInterval, JointTrails* trails = NULL);
+	// Joins the simulation thread and drops every snapshot, AcquireLatest() returns NULL
+	// until the pipeline is started again
+	void Stop();
+
+	bool IsRunning()
+	{
+		return running.load();
+	}
+
+	// Latest complete snapshot, NULL before the first frame. Valid until the next call.
+	const FrameSnapshot* AcquireLatest();
+
+	// Blocks until a snapshot newer than the one last acquired is available
+	const FrameSnapshot* WaitForNext();
+
+	long long GetNumFramesSimulated()
+	{
+		return numFramesSimulated.load();
+	}
+};
+
+#endif	//FRAMEPIPELINE_H
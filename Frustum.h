@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Frustum.h
+//	View frustum as six inward facing planes, extracted from a projection * modelview
+//	matrix (Gribb/Hartmann), so the planes are in the coordinate frame that matrix maps
+//	from. Used to cull bounding boxes before drawing.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <math.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+
+enum FrustumResult
+{
+	FRUSTUM_OUTSIDE,
+	FRUSTUM_INTERSECT,
+	FRUSTUM_INSIDE
+};
+
+class Frustum
+{
+public:
+	// left, right, bottom, top, near, far; a point p is inside when
+	// normals[i].DotProduct(p) + distances[i] >= 0 for every plane
+	VECTOR3D normals[6];
+	float distances[6];
+
+	Frustum()
+	{
+		for (int i = 0; i < 6; i++)
+			distances[i] = 0.0f;
+	}
+
+	void Extract(const MATRIX4X4& clip)
+	{
+		const float* m = clip.entries;
+		for (int i = 0; i < 6; i++)
+		{
+			// row 3 plus or minus row 0, 1 or 2 of the column major matrix
+			int row = i / 2;
+			float sign = (i & 1) ? -1.0f : 1.0f;
+			VECTOR3D n(m[3] + sign * m[row], m[7] + sign * m[4 + row], m[11] + sign * m[8 + row]);
+			float d = m[15] + sign * m[12 + row];
+
+			float length = n.GetLength();
+			if (length > 0.0f)
+			{
+				n = n / length;
+				d /= length;
+			}
+			normals[i] = n;
+			distances[i] = d;
+		}
+	}
+
+	FrustumResult ClassifyBox(const VECTOR3D& boxMin, const VECTOR3D& boxMax) const
+	{
+		FrustumResult result = FRUSTUM_INSIDE;
+		for (int i = 0; i < 6; i++)
+		{
+			const VECTOR3D& n = normals[i];
+
+			// corner farthest along the plane normal, then the one farthest against it
+			VECTOR3D p(n.x >= 0.0f ? boxMax.x : boxMin.x, n.y >= 0.0f ? boxMax.y : boxMin.y, n.z >= 0.0f ? boxMax.z : boxMin.z);
+			if (n.DotProduct(p) + distances[i] < 0.0f)
+				return FRUSTUM_OUTSIDE;
+
+			VECTOR3D q(n.x >= 0.0f ? boxMin.x : boxMax.x, n.y >= 0.0f ? boxMin.y : boxMax.y, n.z >= 0.0f ? boxMin.z : boxMax.z);
+			if (n.DotProduct(q) + distances[i] < 0.0f)
+				result = FRUSTUM_INTERSECT;
+		}
+		return result;
+	}
+};
+
+#endif	//FRUSTUM_H
@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <emmintrin.h>
+#include <vector>
+#include "JobSystem.h"
+
+#include "Heightfield.h"
+
+
+// Permutation and unit gradients for 2D gradient noise, period 256
+struct NoiseTable
+{
+	int perm[512];
+	float gradX[256];
+	float gradY[256];
+};
+
+static void BuildNoiseTable(NoiseTable& table, unsigned int seed)
+{
+	unsigned int state = seed * 747796405u + 2891336453u;
+	for (int i = 0; i < 256; i++)
+	{
+		table.perm[i] = i;
+		float angle = 2.0f * 3.14159265f * i / 256.0f;
+		table.gradX[i] = (float)cos(angle);
+		table.gradY[i] = (float)sin(angle);
+	}
+
+	// Fisher-Yates shuffle driven by a small LCG so a seed always gives the same terrain
+	for (int i = 255; i > 0; i--)
+	{
+		state = state * 1664525u + 1013904223u;
+		int j = (int)((state >> 8) % (unsigned int)(i + 1));
+		int t = table.perm[i];
+		table.perm[i] = table.perm[j];
+		table.perm[j] = t;
+	}
+	for (int i = 0; i < 256; i++)
+		table.perm[256 + i] = table.perm[i];
+}
+
+static float Fade(float t)
+{
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static float GradientNoise(const NoiseTable& table, float x, float y)
+{
+	float fx = floorf(x), fy = floorf(y);
+	int X = (int)fx & 255, Y = (int)fy & 255;
+	float dx = x - fx, dy = y - fy;
+
+	int h00 = table.perm[table.perm[X] + Y];
+	int h10 = table.perm[table.perm[X + 1] + Y];
+	int h01 = table.perm[table.perm[X] + Y + 1];
+	int h11 = table.perm[table.perm[X + 1] + Y + 1];
+
+	float n00 = table.gradX[h00] * dx + table.gradY[h00] * dy;
+	float n10 = table.gradX[h10] * (dx - 1.0f) + table.gradY[h10] * dy;
+	float n01 = table.gradX[h01] * dx + table.gradY[h01] * (dy - 1.0f);
+	float n11 = table.gradX[h11] * (dx - 1.0f) + table.gradY[h11] * (dy - 1.0f);
+
+	float u = Fade(dx), v = Fade(dy);
+	float nx0 = n00 + u * (n10 - n00);
+	float nx1 = n01 + u * (n11 - n01);
+	return nx0 + v * (nx1 - nx0);
+}
+
+
+// Fade() in the four lanes, the same operations in the same order
+static __m128 Fade4(__m128 t)
+{
+	__m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+	__m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+	return _mm_mul_ps(t3, inner);
+}
+
+// floorf() in the four lanes, SSE2 only truncates
+static __m128 Floor4(__m128 x)
+{
+	__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+// GradientNoise() at four points, the permutation lookups are done lane by lane
+static __m128 GradientNoise4(const NoiseTable& table, __m128 x, __m128 y)
+{
+	__m128 fx = Floor4(x), fy = Floor4(y);
+	__m128i mask = _mm_set1_epi32(255);
+	int X[4], Y[4];
+	_mm_storeu_si128((__m128i*)X, _mm_and_si128(_mm_cvttps_epi32(fx), mask));
+	_mm_storeu_si128((__m128i*)Y, _mm_and_si128(_mm_cvttps_epi32(fy), mask));
+	__m128 dx = _mm_sub_ps(x, fx), dy = _mm_sub_ps(y, fy);
+
+	float g[8][4];
+	for (int i = 0; i < 4; i++)
+	{
+		int h00 = table.perm[table.perm[X[i]] + Y[i]];
+		int h10 = table.perm[table.perm[X[i] + 1] + Y[i]];
+		int h01 = table.perm[table.perm[X[i]] + Y[i] + 1];
+		int h11 = table.perm[table.perm[X[i] + 1] + Y[i] + 1];
+		g[0][i] = table.gradX[h00];	g[1][i] = table.gradY[h00];
+		g[2][i] = table.gradX[h10];	g[3][i] = table.gradY[h10];
+		g[4][i] = table.gradX[h01];	g[5][i] = table.gradY[h01];
+		g[6][i] = table.gradX[h11];	g[7][i] = table.gradY[h11];
+	}
+
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 dx1 = _mm_sub_ps(dx, one), dy1 = _mm_sub_ps(dy, one);
+	__m128 n00 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(g[0]), dx), _mm_mul_ps(_mm_loadu_ps(g[1]), dy));
+	__m128 n10 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(g[2]), dx1), _mm_mul_ps(_mm_loadu_ps(g[3]), dy));
+	__m128 n01 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(g[4]), dx), _mm_mul_ps(_mm_loadu_ps(g[5]), dy1));
+	__m128 n11 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(g[6]), dx1), _mm_mul_ps(_mm_loadu_ps(g[7]), dy1));
+
+	__m128 u = Fade4(dx), v = Fade4(dy);
+	__m128 nx0 = _mm_add_ps(n00, _mm_mul_ps(u, _mm_sub_ps(n10, n00)));
+	__m128 nx1 = _mm_add_ps(n01, _mm_mul_ps(u, _mm_sub_ps(n11, n01)));
+	return _mm_add_ps(nx0, _mm_mul_ps(v, _mm_sub_ps(nx1, nx0)));
+}
+
+
+Heightfield::Heightfield()
+{
+	width = 0;
+	height = 0;
+}
+
+void Heightfield::GenerateNoise(int width, int height, int octaves, float frequency, float amplitude,
+								unsigned int seed, JobSystem* jobs)
+{
+	this->width = width < 2 ? 2 : width;
+	this->height = height < 2 ? 2 : height;
+	heights.assign((size_t)this->width * this->height, 0.0f);
+
+	NoiseTable table;
+	BuildNoiseTable(table, seed);
+
+	auto generateRows = [&](int begin, int end)
+	{
+		float scaleX = frequency / (this->width - 1);
+		float scaleY = frequency / (this->height - 1);
+		int numGroups = this->width / 4;
+		for (int y = begin; y < end; y++)
+		{
+			float* row = &heights[(size_t)y * this->width];
+			float octaveScale = 1.0f, octaveAmplitude = amplitude;
+			for (int o = 0; o < octaves; o++)
+			{
+				// each octave is shifted so their lattices do not line up
+				float offset = 17.31f * o;
+				float ny = y * scaleY * octaveScale + offset;
+
+				// four samples of the row at a time, the last few one by one
+				__m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+				__m128 vy = _mm_set1_ps(ny);
+				__m128 vAmplitude = _mm_set1_ps(octaveAmplitude);
+				for (int g = 0; g < numGroups; g++)
+				{
+					__m128 vx = _mm_add_ps(_mm_set1_ps((float)(4 * g)), lanes);
+					vx = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(vx, _mm_set1_ps(scaleX)), _mm_set1_ps(octaveScale)), _mm_set1_ps(offset));
+					__m128 noise = GradientNoise4(table, vx, vy);
+					_mm_storeu_ps(row + 4 * g, _mm_add_ps(_mm_loadu_ps(row + 4 * g), _mm_mul_ps(vAmplitude, noise)));
+				}
+				for (int x = 4 * numGroups; x < this->width; x++)
+					row[x] += octaveAmplitude * GradientNoise(table, x * scaleX * octaveScale + offset, ny);
+
+				octaveScale *= 2.0f;
+				octaveAmplitude *= 0.5f;
+			}
+		}
+	};
+
+	if (jobs)
+		jobs->ParallelFor(this->height, 16, generateRows);
+	else
+		generateRows(0, this->height);
+}
+
+void Heightfield::GenerateNoiseReference(int width, int height, int octaves, float frequency, float amplitude,
+										 unsigned int seed)
+{
+	this->width = width < 2 ? 2 : width;
+	this->height = height < 2 ? 2 : height;
+	heights.assign((size_t)this->width * this->height, 0.0f);
+
+	NoiseTable table;
+	BuildNoiseTable(table, seed);
+
+	float scaleX = frequency / (this->width - 1);
+	float scaleY = frequency / (this->height - 1);
+	for (int y = 0; y < this->height; y++)
+	{
+		float* row = &heights[(size_t)y * this->width];
+		float octaveScale = 1.0f, octaveAmplitude = amplitude;
+		for (int o = 0; o < octaves; o++)
+		{
+			float offset = 17.31f * o;
+			float ny = y * scaleY * octaveScale + offset;
+			for (int x = 0; x < this->width; x++)
+				row[x] += octaveAmplitude * GradientNoise(table, x * scaleX * octaveScale + offset, ny);
+			octaveScale *= 2.0f;
+			octaveAmplitude *= 0.5f;
+		}
+	}
+}
+
+// Reads one decimal header value, false when there is none or it is above maxValue
+static bool ReadHeaderValue(FILE* file, int& value, int maxValue)
+{
+	int c = fgetc(file);
+	while (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#')
+	{
+		if (c == '#')
+		{
+			while (c != '\n' && c != EOF)
+				c = fgetc(file);
+		}
+		c = fgetc(file);
+	}
+	if (c < '0' || c > '9')
+		return false;
+
+	value = 0;
+	while (c >= '0' && c <= '9')
+	{
+		if (value > (maxValue - (c - '0')) / 10)
+			return false;
+		value = value * 10 + (c - '0');
+		c = fgetc(file);
+	}
+	// c is the single whitespace character ending the value
+	return true;
+}
+
+bool Heightfield::LoadHeightmap(const char* fileName, float amplitude)
+{
+	FILE* file = fopen(fileName, "rb");
+	if (!file)
+		return false;
+
+	int w, h, maxValue;
+	char magic[2];
+	if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || magic[1] != '5' ||
+		!ReadHeaderValue(file, w, MAX_HEIGHTMAP_SIZE) || !ReadHeaderValue(file, h, MAX_HEIGHTMAP_SIZE) ||
+		!ReadHeaderValue(file, maxValue, 65535) || w < 2 || h < 2 || maxValue <= 0)
+	{
+		fclose(file);
+		return false;
+	}
+
+	// the samples must all be in the file before anything is allocated for them
+	int bytesPerSample = maxValue > 255 ? 2 : 1;
+	long start = ftell(file);
+	long end = -1;
+	if (start >= 0 && fseek(file, 0, SEEK_END) == 0)
+		end = ftell(file);
+	if (end < 0 || fseek(file, start, SEEK_SET) != 0 || (size_t)w * h > SIZE_MAX / bytesPerSample ||
+		end < start || (size_t)(end - start) < (size_t)w * h * bytesPerSample)
+	{
+		fclose(file);
+		return false;
+	}
+
+	std::vector<unsigned char> data((size_t)w * h * bytesPerSample);
+	size_t read = fread(&data[0], 1, data.size(), file);
+	fclose(file);
+	if (read != data.size())
+		return false;
+
+	width = w;
+	height = h;
+	heights.resize((size_t)w * h);
+	float scale = amplitude / maxValue;
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		// 16-bit samples are big endian
+		int sample = bytesPerSample == 2 ? (data[2 * i] << 8) | data[2 * i + 1] : data[i];
+		heights[i] = sample * scale;
+	}
+	return true;
+}
+
+float Heightfield::Sample(float u, float v) const
+{
+	float x = u * (width - 1);
+	float y = v * (height - 1);
+	if (x < 0.0f) x = 0.0f;
+	if (y < 0.0f) y = 0.0f;
+	if (x > width - 1) x = (float)(width - 1);
+	if (y > height - 1) y = (float)(height - 1);
+
+	int x0 = (int)x, y0 = (int)y;
+	int x1 = x0 + 1 < width ? x0 + 1 : x0;
+	int y1 = y0 + 1 < height ? y0 + 1 : y0;
+	float fx = x - x0, fy = y - y0;
+
+	float h0 = Get(x0, y0) + fx * (Get(x1, y0) - Get(x0, y0));
+	float h1 = Get(x0, y1) + fx * (Get(x1, y1) - Get(x0, y1));
+	return h0 + fy * (h1 - h0);
+}
@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Heightfield.h
+//	Regular grid of heights, generated from multi-octave gradient noise or loaded from a
+//	16-bit greyscale heightmap (binary PGM, "P5" with maxval up to 65535).
+//	QuadMesh::InitMesh() samples it to displace the ground.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include <vector>
+
+class JobSystem;
+
+// Largest heightmap LoadHeightmap() accepts, grid points per side
+const int MAX_HEIGHTMAP_SIZE = 16385;
+
+class Heightfield
+{
+private:
+	int width;
+	int height;
+	std::vector<float> heights;		// row major, width * height
+
+public:
+	Heightfield();
+
+	// Fractal sum of gradient noise. frequency is in cycles across the whole field, each
+	// octave doubles it and halves the amplitude. The SSE kernel generates four samples of
+	// a row at a time, and rows are generated in parallel when jobs is given.
+	void GenerateNoise(int width, int height, int octaves, float frequency, float amplitude,
+					   unsigned int seed, JobSystem* jobs = NULL);
+
+	// Plain scalar version of GenerateNoise(), one sample at a time
+	void GenerateNoiseReference(int width, int height, int octaves, float frequency, float amplitude,
+								unsigned int seed);
+
+	// Heights scaled to [0, amplitude] from a binary PGM of at most MAX_HEIGHTMAP_SIZE grid
+	// points per side. False when the file is not one or holds fewer samples than its header.
+	bool LoadHeightmap(const char* fileName, float amplitude);
+
+	int GetWidth() const
+	{
+		return width;
+	}
+
+	int GetHeight() const
+	{
+		return height;
+	}
+
+	float Get(int x, int y) const
+	{
+		return heights[(size_t)y * width + x];
+	}
+
+	// Bilinear lookup, u and v in [0, 1] across the field
+	float Sample(float u, float v) const;
+};
+
+#endif	//HEIGHTFIELD_H
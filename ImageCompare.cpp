@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+
+#include "ImageCompare.h"
+
+
+// Reads one decimal header value, false when there is none or it is above maxValue
+static bool ReadHeaderValue(FILE* file, int& value, int maxValue)
+{
+	int c = fgetc(file);
+	while (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#')
+	{
+		if (c == '#')
+		{
+			while (c != '\n' && c != EOF)
+				c = fgetc(file);
+		}
+		c = fgetc(file);
+	}
+	if (c < '0' || c > '9')
+		return false;
+
+	value = 0;
+	while (c >= '0' && c <= '9')
+	{
+		if (value > (maxValue - (c - '0')) / 10)
+			return false;
+		value = value * 10 + (c - '0');
+		c = fgetc(file);
+	}
+	// c is the single whitespace character ending the value
+	return true;
+}
+
+bool ReadPPM(const char* fileName, RGBImage& image)
+{
+	FILE* file = fopen(fileName, "rb");
+	if (!file)
+		return false;
+
+	int w, h, maxValue;
+	char magic[2];
+	if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || magic[1] != '6' ||
+		!ReadHeaderValue(file, w, MAX_IMAGE_SIZE) || !ReadHeaderValue(file, h, MAX_IMAGE_SIZE) ||
+		!ReadHeaderValue(file, maxValue, 255) || w < 1 || h < 1 || maxValue != 255)
+	{
+		fclose(file);
+		return false;
+	}
+
+	// the pixels must all be in the file before anything is allocated for them
+	long start = ftell(file);
+	long end = -1;
+	if (start >= 0 && fseek(file, 0, SEEK_END) == 0)
+		end = ftell(file);
+	if (end < 0 || fseek(file, start, SEEK_SET) != 0 || (size_t)w * h > SIZE_MAX / 3 ||
+		end < start || (size_t)(end - start) < (size_t)w * h * 3)
+	{
+		fclose(file);
+		return false;
+	}
+
+	image.Resize(w, h);
+	size_t read = fread(&image.pixels[0], 1, image.pixels.size(), file);
+	fclose(file);
+	return read == image.pixels.size();
+}
+
+bool WritePPM(const char* fileName, const RGBImage& image)
+{
+	if (image.width < 1 || image.height < 1 || image.pixels.size() != (size_t)image.width * image.height * 3)
+		return false;
+
+	FILE* file = fopen(fileName, "wb");
+	if (!file)
+		return false;
+
+	fprintf(file, "P6\n%d %d\n255\n", image.width, image.height);
+	size_t written = fwrite(&image.pixels[0], 1, image.pixels.size(), file);
+	return fclose(file) == 0 && written == image.pixels.size();
+}
+
+float PixelDelta(const unsigned char* a, const unsigned char* b)
+{
+	float r = (float)(a[0] - b[0]);
+	float g = (float)(a[1] - b[1]);
+	float bl = (float)(a[2] - b[2]);
+
+	// YIQ, weighted as in Kotsarenko and Ramos, "Measuring perceived color difference
+	// using YIQ NTSC transmission color space in mobile applications"
+	float y = r * 0.29889531f + g * 0.58662247f + bl * 0.11448223f;
+	float i = r * 0.59597799f - g * 0.27417610f - bl * 0.32180189f;
+	float q = r * 0.21147017f - g * 0.52261711f + bl * 0.31114694f;
+	float delta = 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+
+	// 35215 is the delta from black to white
+	return sqrtf(delta * (1.0f / 35215.0f));
+}
+
+// Whether a pixel next to (x, y) in neighbours is within threshold of pixel
+static bool HasMatchingNeighbour(const RGBImage& neighbours, int x, int y, const unsigned char* pixel, float threshold)
+{
+	for (int ny = y - 1; ny <= y + 1; ny++)
+	{
+		for (int nx = x - 1; nx <= x + 1; nx++)
+		{
+			if (nx < 0 || ny < 0 || nx >= neighbours.width || ny >= neighbours.height || (nx == x && ny == y))
+				continue;
+			if (PixelDelta(&neighbours.pixels[((size_t)ny * neighbours.width + nx) * 3], pixel) <= threshold)
+				return true;
+		}
+	}
+	return false;
+}
+
+void CompareImages(const RGBImage& reference, const RGBImage& image, float threshold,
+				   ImageDifference& result, RGBImage* diff)
+{
+	result.meanDelta = 0.0;
+	result.maxDelta = 0.0f;
+	result.differentPixels = 0;
+	result.shiftedPixels = 0;
+	result.differentFraction = 0.0;
+	if (diff)
+		diff->Resize(reference.width, reference.height);
+
+	double total = 0.0;
+	for (int y = 0; y < reference.height; y++)
+	{
+		for (int x = 0; x < reference.width; x++)
+		{
+			size_t index = ((size_t)y * reference.width + x) * 3;
+			const unsigned char* a = &reference.pixels[index];
+			const unsigned char* b = &image.pixels[index];
+			float delta = PixelDelta(a, b);
+			total += delta;
+
+			unsigned char colour[3];
+			unsigned char grey = (unsigned char)(160 + (a[0] * 77 + a[1] * 150 + a[2] * 29) / (256 * 3));
+			colour[0] = colour[1] = colour[2] = grey;
+			if (delta > threshold)
+			{
+				// each image must have the other's pixel next to it, or it is not just a shift
+				if (HasMatchingNeighbour(reference, x, y, b, threshold) && HasMatchingNeighbour(image, x, y, a, threshold))
+				{
+					result.shiftedPixels++;
+					colour[0] = colour[1] = 255;
+					colour[2] = 0;
+				}
+				else
+				{
+					result.differentPixels++;
+					result.maxDelta = delta > result.maxDelta ? delta : result.maxDelta;
+					colour[0] = 255;
+					colour[1] = colour[2] = 0;
+				}
+			}
+			if (diff)
+			{
+				for (int c = 0; c < 3; c++)
+					diff->pixels[index + c] = colour[c];
+			}
+		}
+	}
+
+	size_t numPixels = (size_t)reference.width * reference.height;
+	if (numPixels > 0)
+	{
+		result.meanDelta = total / numPixels;
+		result.differentFraction = (double)result.differentPixels / numPixels;
+	}
+}
@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	ImageCompare.h
+//	RGB images read from and written to binary PPM files ("P6", maxval 255), and a
+//	perceptual comparison between two of them for the reference image test.
+//
+//	Pixels are compared by their distance in YIQ, weighted the way the eye weighs brightness
+//	against hue, rather than per channel. A pixel over the threshold only counts as different
+//	when no pixel next to it in the other image is within it, so edges rasterized a pixel
+//	over by another driver are tolerated and counted apart.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef IMAGECOMPARE_H
+#define IMAGECOMPARE_H
+
+#include <vector>
+
+struct RGBImage
+{
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> pixels;	// rows from the top, 3 bytes per pixel
+
+	void Resize(int width, int height)
+	{
+		this->width = width;
+		this->height = height;
+		pixels.resize((size_t)width * height * 3);
+	}
+};
+
+// Largest image ReadPPM() accepts, pixels per side
+const int MAX_IMAGE_SIZE = 16384;
+
+// False when the file is not a P6 of at most MAX_IMAGE_SIZE per side holding every pixel
+bool ReadPPM(const char* fileName, RGBImage& image);
+// False for an empty image or one whose pixels do not match its size
+bool WritePPM(const char* fileName, const RGBImage& image);
+
+struct ImageDifference
+{
+	double meanDelta;		// perceptual difference averaged over every pixel, 0 to 1
+	float maxDelta;			// of the pixels counted as different
+	int differentPixels;	// over the threshold with no matching neighbour
+	int shiftedPixels;		// over the threshold but matched by a neighbour
+	double differentFraction;
+};
+
+// Perceptual difference of two pixels, 0 for the same colour and 1 from black to white
+float PixelDelta(const unsigned char* a, const unsigned char* b);
+
+// Compares image against reference, which must be the same size. When diff is given it
+// gets the reference faded to grey with the different pixels in red and the shifted ones
+// in yellow.
+void CompareImages(const RGBImage& reference, const RGBImage& image, float threshold,
+				   ImageDifference& result, RGBImage* diff = NULL);
+
+#endif	//IMAGECOMPARE_H
@@ -0,0 +1,167 @@
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+
+
+JobSystem::JobSystem(int numThreads)
+{
+	if (numThreads <= 0)
+		numThreads = (int)std::thread::hardware_concurrency();
+	if (numThreads <= 0)
+		numThreads = 1;
+
+	queuedJobs = 0;
+	unfinishedJobs = 0;
+	shutdown = false;
+
+	for (int i = 0; i < numThreads; i++)
+		queues.push_back(new WorkQueue);
+
+	for (int i = 1; i < numThreads; i++)
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> guard(wakeLock);
+		shutdown = true;
+	}
+	wakeCondition.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	for (size_t i = 0; i < queues.size(); i++)
+		delete queues[i];
+}
+
+void JobSystem::WorkQueue::PushBack(const Job& job)
+{
+	if (count == (int)ring.size())
+	{
+		// unroll the ring into a buffer twice the size
+		std::vector<Job> grown(ring.empty() ? 64 : ring.size() * 2);
+		for (int i = 0; i < count; i++)
+			grown[i] = ring[(head + i) % ring.size()];
+		ring.swap(grown);
+		head = 0;
+	}
+
+	ring[(head + count) % ring.size()] = job;
+	count++;
+}
+
+void JobSystem::ParallelFor(int count, int chunkSize, const RangeFunction& function)
+{
+	if (count <= 0)
+		return;
+	if (chunkSize <= 0)
+		chunkSize = 1;
+
+	// Nothing to share, skip the queues entirely
+	if (queues.size() == 1 || count <= chunkSize)
+	{
+		function(0, count);
+		return;
+	}
+
+	// Deal contiguous runs of chunks to each queue so owners walk memory in order
+	int numChunks = (count + chunkSize - 1) / chunkSize;
+	int numQueues = (int)queues.size();
+	unfinishedJobs += numChunks;
+	queuedJobs += numChunks;
+
+	for (int q = 0; q < numQueues; q++)
+	{
+		int firstChunk = (int)((long long)numChunks * q / numQueues);
+		int lastChunk = (int)((long long)numChunks * (q + 1) / numQueues);
+
+		std::lock_guard<std::mutex> guard(queues[q]->lock);
+		// pushed in reverse so the owner pops them front to back from the back of its deque
+		for (int c = lastChunk - 1; c >= firstChunk; c--)
+		{
+			Job job;
+			job.function = &function;
+			job.begin = c * chunkSize;
+			job.end = (c + 1) * chunkSize < count ? (c + 1) * chunkSize : count;
+			queues[q]->PushBack(job);
+		}
+	}
+
+	// Passing through the lock orders the count update against a worker about to sleep
+	{
+		std::lock_guard<std::mutex> guard(wakeLock);
+	}
+	wakeCondition.notify_all();
+
+	// The caller works too, then waits for chunks other threads are still running
+	Job job;
+	while (unfinishedJobs.load() > 0)
+	{
+		if (TakeJob(0, job))
+			RunJob(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::TakeJob(int index, Job& job)
+{
+	// own deque first, newest end
+	{
+		WorkQueue* own = queues[index];
+		std::lock_guard<std::mutex> guard(own->lock);
+		if (!own->Empty())
+		{
+			job = own->PopBack();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	// then steal the oldest job of another thread
+	int numQueues = (int)queues.size();
+	for (int i = 1; i < numQueues; i++)
+	{
+		WorkQueue* victim = queues[(index + i) % numQueues];
+		std::lock_guard<std::mutex> guard(victim->lock);
+		if (!victim->Empty())
+		{
+			job = victim->PopFront();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::RunJob(const Job& job)
+{
+	(*job.function)(job.begin, job.end);
+	unfinishedJobs--;
+}
+
+void JobSystem::WorkerLoop(int index)
+{
+	Job job;
+	while (true)
+	{
+		if (TakeJob(index, job))
+		{
+			RunJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(wakeLock);
+		wakeCondition.wait(guard, [this] { return shutdown || queuedJobs.load() > 0; });
+		if (shutdown)
+			return;
+	}
+}
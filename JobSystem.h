@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	JobSystem.h
+//	Fixed pool of worker threads with one work-stealing deque per thread.
+//
+//	ParallelFor() splits a range into chunks, deals them out across the deques and
+//	blocks until all chunks are done. The calling thread takes part as worker 0. Each
+//	thread pops chunks from the back of its own deque and steals from the front of the
+//	others' deques once it runs dry.
+//
+//	The deques are ring buffers that only grow, so once they have held a frame's chunks
+//	ParallelFor() makes no allocations.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem
+{
+public:
+	typedef std::function<void(int begin, int end)> RangeFunction;
+
+private:
+	struct Job
+	{
+		const RangeFunction* function;
+		int begin, end;
+	};
+
+	// Deque of jobs in a ring buffer, doubled when full
+	struct WorkQueue
+	{
+		std::mutex lock;
+		std::vector<Job> ring;
+		int head = 0;
+		int count = 0;
+
+		bool Empty() const
+		{
+			return count == 0;
+		}
+
+		void PushBack(const Job& job);
+
+		Job PopBack()
+		{
+			count--;
+			return ring[(head + count) % ring.size()];
+		}
+
+		Job PopFront()
+		{
+			Job job = ring[head];
+			head = (head + 1) % (int)ring.size();
+			count--;
+			return job;
+		}
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<WorkQueue*> queues;		// queues[0] belongs to the calling thread
+
+	std::mutex wakeLock;
+	std::condition_variable wakeCondition;
+	std::atomic<int> queuedJobs;
+	std::atomic<int> unfinishedJobs;
+	bool shutdown;
+
+private:
+	void WorkerLoop(int index);
+	bool TakeJob(int index, Job& job);
+	void RunJob(const Job& job);
+
+public:
+	// numThreads includes the calling thread, 0 uses every hardware thread
+	JobSystem(int numThreads = 0);
+	~JobSystem();
+
+	int GetNumThreads()
+	{
+		return (int)queues.size();
+	}
+
+	// Calls function(begin, end) over [0, count) in chunks of at most chunkSize.
+	// Only the thread that created the job system may call this.
+	void ParallelFor(int count, int chunkSize, const RangeFunction& function);
+};
+
+#endif	//JOBSYSTEM_H
@@ -0,0 +1,157 @@
+#include <math.h>
+#include <vector>
+#include <emmintrin.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "JobSystem.h"
+
+#include "JointRegistry.h"
+
+
+JointRegistry::JointRegistry(int numRobots)
+{
+	Init(numRobots);
+}
+
+void JointRegistry::Init(int numRobots)
+{
+	this->numRobots = numRobots < 0 ? 0 : numRobots;
+	numSlots = (this->numRobots * NUM_JOINTS + 3) & ~3;
+
+	// padding slots are limited joints pinned at 0
+	angles.assign(numSlots, 0.0f);
+	velocities.assign(numSlots, 0.0f);
+	minAngles.assign(numSlots, 0.0f);
+	maxAngles.assign(numSlots, 0.0f);
+	restAngles.assign(numSlots, 0.0f);
+	continuous.assign(numSlots, 0);
+
+	for (int i = 0; i < this->numRobots * NUM_JOINTS; i++)
+	{
+		const JointInfo& info = robotJoints[i % NUM_JOINTS];
+		minAngles[i] = info.minAngle;
+		maxAngles[i] = info.maxAngle;
+		restAngles[i] = info.restAngle;
+		continuous[i] = info.continuous ? 0xFFFFFFFFu : 0;
+		angles[i] = info.restAngle;
+	}
+}
+
+float JointRegistry::Limit(int slot, float angle) const
+{
+	if (continuous[slot])
+		return WrapAngle(angle);
+	if (angle < minAngles[slot])
+		return minAngles[slot];
+	if (angle > maxAngles[slot])
+		return maxAngles[slot];
+	return angle;
+}
+
+void JointRegistry::SetLimits(int robot, int joint, float minAngle, float maxAngle)
+{
+	int slot = robot * NUM_JOINTS + joint;
+	minAngles[slot] = minAngle;
+	maxAngles[slot] = maxAngle;
+	angles[slot] = Limit(slot, angles[slot]);
+}
+
+void JointRegistry::Reset()
+{
+	angles = restAngles;
+	velocities.assign(numSlots, 0.0f);
+}
+
+void JointRegistry::SetAngle(int robot, int joint, float angle)
+{
+	int slot = robot * NUM_JOINTS + joint;
+	angles[slot] = Limit(slot, angle);
+}
+
+void JointRegistry::SetVelocity(int robot, int joint, float velocity)
+{
+	velocities[robot * NUM_JOINTS + joint] = velocity;
+}
+
+void JointRegistry::SetPose(int robot, const RobotPose& pose)
+{
+	for (int j = 0; j < NUM_JOINTS; j++)
+		SetAngle(robot, j, pose.angles[j]);
+}
+
+void JointRegistry::GetPose(int robot, RobotPose& pose) const
+{
+	for (int j = 0; j < NUM_JOINTS; j++)
+		pose.angles[j] = angles[robot * NUM_JOINTS + j];
+}
+
+void JointRegistry::UpdateGroups(float dt, int beginGroup, int endGroup)
+{
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 half = _mm_set1_ps(180.0f);
+	const __m128 turn = _mm_set1_ps(360.0f);
+	const __m128 perTurn = _mm_set1_ps(1.0f / 360.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (int g = beginGroup; g < endGroup; g++)
+	{
+		int i = g * 4;
+		__m128 velocity = _mm_loadu_ps(&velocities[i]);
+		__m128 angle = _mm_add_ps(_mm_loadu_ps(&angles[i]), _mm_mul_ps(velocity, step));
+
+		// limited joints clamp, and stop when they do
+		__m128 clamped = _mm_min_ps(_mm_max_ps(angle, _mm_loadu_ps(&minAngles[i])), _mm_loadu_ps(&maxAngles[i]));
+		__m128 free = _mm_cmpeq_ps(clamped, angle);
+
+		// continuous joints wrap as WrapAngle() does, floor as truncation corrected for negative values
+		__m128 turns = _mm_mul_ps(_mm_add_ps(angle, half), perTurn);
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(turns));
+		__m128 floored = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, turns), one));
+		__m128 wrapped = _mm_sub_ps(angle, _mm_mul_ps(turn, floored));
+		wrapped = _mm_add_ps(wrapped, _mm_and_ps(_mm_cmplt_ps(wrapped, _mm_sub_ps(_mm_setzero_ps(), half)), turn));
+		wrapped = _mm_sub_ps(wrapped, _mm_and_ps(_mm_cmpge_ps(wrapped, half), turn));
+
+		__m128 wraps = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&continuous[i]));
+		_mm_storeu_ps(&angles[i], _mm_or_ps(_mm_and_ps(wraps, wrapped), _mm_andnot_ps(wraps, clamped)));
+		_mm_storeu_ps(&velocities[i], _mm_and_ps(velocity, _mm_or_ps(wraps, free)));
+	}
+}
+
+void JointRegistry::Update(float dt, JobSystem* jobs, int chunkSize)
+{
+	int numGroups = numSlots / 4;
+	auto updateRange = [&](int begin, int end)
+	{
+		UpdateGroups(dt, begin, end);
+	};
+
+	if (jobs)
+		jobs->ParallelFor(numGroups, (chunkSize + 3) / 4, updateRange);
+	else
+		updateRange(0, numGroups);
+}
+
+void JointRegistry::UpdateReference(float dt)
+{
+	for (int i = 0; i < numSlots; i++)
+	{
+		float angle = angles[i] + velocities[i] * dt;
+		angles[i] = Limit(i, angle);
+		if (!continuous[i] && angles[i] != angle)
+			velocities[i] = 0.0f;
+	}
+}
+
+int JointRegistry::CountOutsideLimits() const
+{
+	int count = 0;
+	for (int i = 0; i < numRobots * NUM_JOINTS; i++)
+	{
+		bool inside = continuous[i] ? angles[i] >= -180.0f && angles[i] < 180.0f
+									: angles[i] >= minAngles[i] && angles[i] <= maxAngles[i];
+		if (!inside)
+			count++;
+	}
+	return count;
+}
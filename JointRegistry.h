@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	JointRegistry.h
+//	Joint state of many robots for bulk updates: every joint's angle, velocity, limits and
+//	rest angle, each field in one contiguous array where joint j of robot r is entry
+//	r * NUM_JOINTS + j. The fleet keeps its robots' joints in one, and the main robot its
+//	own; input and the scripted animations set angles through it, so they always stay
+//	within the limits, and drawing reads the poses back from it.
+//
+//	Limits start out as robotJoints[] gives them and can be set per robot. Update()
+//	integrates the velocities and limits the angles four joints at a time in SSE lanes,
+//	clamping limited joints, which also stops them, and wrapping continuous joints into
+//	[-180, 180) so their angles never grow without bound.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef JOINTREGISTRY_H
+#define JOINTREGISTRY_H
+
+#include <vector>
+#include "RobotModel.h"
+
+class JobSystem;
+
+class JointRegistry
+{
+private:
+	int numRobots;
+	int numSlots;		// numRobots * NUM_JOINTS rounded up to a multiple of 4
+
+	std::vector<float> angles;
+	std::vector<float> velocities;		// degrees per second
+	std::vector<float> minAngles, maxAngles;
+	std::vector<float> restAngles;
+	std::vector<unsigned int> continuous;	// all bits set for continuous joints
+
+private:
+	void UpdateGroups(float dt, int beginGroup, int endGroup);
+	float Limit(int slot, float angle) const;
+
+public:
+	explicit JointRegistry(int numRobots = 0);
+
+	// Every robot at rest with robotJoints[]'s limits
+	void Init(int numRobots);
+
+	// Limits of one robot's joint, its angle is moved within them
+	void SetLimits(int robot, int joint, float minAngle, float maxAngle);
+
+	// Every joint back at its rest angle and still
+	void Reset();
+
+	// Angles are limited as they are set
+	void SetAngle(int robot, int joint, float angle);
+	void SetVelocity(int robot, int joint, float velocity);
+	void SetPose(int robot, const RobotPose& pose);
+	void GetPose(int robot, RobotPose& pose) const;
+
+	// Advances every angle by its velocity over dt seconds and limits it
+	void Update(float dt, JobSystem* jobs = NULL, int chunkSize = 16384);
+
+	// Plain scalar version of Update(), one joint at a time
+	void UpdateReference(float dt);
+
+	// Joints outside their limits, or outside [-180, 180) for continuous ones
+	int CountOutsideLimits() const;
+
+	float GetAngle(int robot, int joint) const
+	{
+		return angles[robot * NUM_JOINTS + joint];
+	}
+
+	// NUM_JOINTS angles of the robot in JointId order, valid until the next Init()
+	const float* GetAngles(int robot) const
+	{
+		return &angles[robot * NUM_JOINTS];
+	}
+
+	float GetVelocity(int robot, int joint) const
+	{
+		return velocities[robot * NUM_JOINTS + joint];
+	}
+
+	int GetNumRobots() const
+	{
+		return numRobots;
+	}
+
+	int GetNumJoints() const
+	{
+		return numRobots * NUM_JOINTS;
+	}
+};
+
+#endif	//JOINTREGISTRY_H
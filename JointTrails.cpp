@@ -0,0 +1,142 @@
+#include <math.h>
+#include <atomic>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "JobSystem.h"
+
+#include "JointTrails.h"
+
+
+const int trailJointParts[TRAIL_JOINTS] = { PART_LEFT_ARM_GUN, PART_RIGHT_ARM_GUN, PART_LEFT_FOOT, PART_RIGHT_FOOT };
+
+// Point tracked on each part's unit primitive: the muzzle end of the gun cylinders and the
+// middle of the feet
+static const float trailJointPoints[TRAIL_JOINTS][3] =
+{
+	{ 0.0f, 0.0f, 1.0f },
+	{ 0.0f, 0.0f, 1.0f },
+	{ 0.0f, 0.0f, 0.0f },
+	{ 0.0f, 0.0f, 0.0f }
+};
+
+
+JointTrails::JointTrails()
+{
+	numRobots = 0;
+	capacity = 0;
+	mask = 0;
+	numSamples = 0;
+	numStarted = 0;
+}
+
+void JointTrails::Init(int numRobots, int capacity)
+{
+	int size = 2;
+	while (size < capacity)
+		size *= 2;
+
+	this->numRobots = numRobots;
+	this->capacity = size;
+	mask = size - 1;
+	samples.assign((size_t)numRobots * TRAIL_JOINTS * size, VECTOR3D(0.0f, 0.0f, 0.0f));
+	times.assign(size, 0.0f);
+	numSamples = 0;
+	numStarted = 0;
+}
+
+void JointTrails::Push(const MATRIX4X4* partMatrices, float time, JobSystem* jobs, int chunkSize)
+{
+	long long sample = numSamples.load(std::memory_order_relaxed);
+	int slot = (int)(sample & mask);
+
+	// readers that see a slot written after this fence also see it is being rewritten
+	numStarted.store(sample + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	auto pushRange = [&](int begin, int end)
+	{
+		for (int r = begin; r < end; r++)
+		{
+			const MATRIX4X4* matrices = partMatrices + (size_t)r * NUM_ROBOT_PARTS;
+			VECTOR3D* trails = &samples[(size_t)r * TRAIL_JOINTS * capacity + slot];
+			for (int j = 0; j < TRAIL_JOINTS; j++)
+			{
+				const float* p = trailJointPoints[j];
+				trails[j * capacity] = matrices[trailJointParts[j]].TransformPoint(VECTOR3D(p[0], p[1], p[2]));
+			}
+		}
+	};
+
+	if (jobs)
+		jobs->ParallelFor(numRobots, chunkSize, pushRange);
+	else
+		pushRange(0, numRobots);
+	times[slot] = time;
+
+	numSamples.store(sample + 1, std::memory_order_release);
+}
+
+int JointTrails::GetTrail(int robot, int joint, VECTOR3D* points, float* sampleTimes) const
+{
+	long long end = numSamples.load(std::memory_order_acquire);
+	long long begin = end > capacity ? end - capacity : 0;
+
+	const VECTOR3D* trail = &samples[((size_t)robot * TRAIL_JOINTS + joint) * capacity];
+	for (long long i = begin; i < end; i++)
+	{
+		points[i - begin] = trail[i & mask];
+		if (sampleTimes)
+			sampleTimes[i - begin] = times[i & mask];
+	}
+
+	// Samples whose slots were reused by pushes started since are dropped from the front
+	std::atomic_thread_fence(std::memory_order_acquire);
+	long long started = numStarted.load(std::memory_order_relaxed);
+	long long valid = started - capacity;
+	if (valid <= begin)
+		return (int)(end - begin);
+	if (valid >= end)
+		return 0;
+
+	int count = (int)(end - valid);
+	int dropped = (int)(valid - begin);
+	for (int i = 0; i < count; i++)
+	{
+		points[i] = points[i + dropped];
+		if (sampleTimes)
+			sampleTimes[i] = sampleTimes[i + dropped];
+	}
+	return count;
+}
+
+float JointTrails::GetPathLength(int robot, int joint) const
+{
+	std::vector<VECTOR3D> points(capacity);
+	int count = GetTrail(robot, joint, &points[0]);
+
+	float length = 0.0f;
+	for (int i = 1; i < count; i++)
+		length += (points[i] - points[i - 1]).GetLength();
+	return length;
+}
+
+float JointTrails::GetMaxSpeed(int robot, int joint) const
+{
+	std::vector<VECTOR3D> points(capacity);
+	std::vector<float> sampleTimes(capacity);
+	int count = GetTrail(robot, joint, &points[0], &sampleTimes[0]);
+
+	float maxSpeed = 0.0f;
+	for (int i = 1; i < count; i++)
+	{
+		float interval = sampleTimes[i] - sampleTimes[i - 1];
+		if (interval <= 0.0f)
+			continue;
+		float speed = (points[i] - points[i - 1]).GetLength() / interval;
+		if (speed > maxSpeed)
+			maxSpeed = speed;
+	}
+	return maxSpeed;
+}
@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	JointTrails.h
+//	Recent path of the arm gun tips and feet of a set of robots, kept for drawing motion
+//	trails and measuring the paths of the step and arm animations.
+//
+//	Every robot and tracked joint has a fixed ring of samples, all sharing one write
+//	position, so memory is numRobots * TRAIL_JOINTS * capacity samples however long it
+//	runs. One thread pushes a sample for every robot per frame and then publishes the new
+//	sample count; other threads read without locks. A reader checks the count again after
+//	copying and drops the oldest samples, which the writer may have been overwriting
+//	meanwhile, the same way a seqlock reader retries.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef JOINTTRAILS_H
+#define JOINTTRAILS_H
+
+#include <atomic>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+
+class JobSystem;
+
+enum TrailJoint
+{
+	TRAIL_LEFT_GUN,
+	TRAIL_RIGHT_GUN,
+	TRAIL_LEFT_FOOT,
+	TRAIL_RIGHT_FOOT,
+	TRAIL_JOINTS
+};
+
+// Part each tracked joint is on
+extern const int trailJointParts[TRAIL_JOINTS];
+
+class JointTrails
+{
+private:
+	int numRobots;
+	int capacity;		// samples per trail, a power of two
+	int mask;
+
+	// Trail of (robot, joint) is samples[(robot * TRAIL_JOINTS + joint) * capacity], written
+	// at slot count % capacity, times in seconds per slot
+	std::vector<VECTOR3D> samples;
+	std::vector<float> times;
+	std::atomic<long long> numSamples;	// pushes completed
+	std::atomic<long long> numStarted;	// pushes started, ahead by one during a push
+
+public:
+	JointTrails();
+
+	// Drops every sample, not while another thread pushes
+	void Init(int numRobots, int capacity);
+
+	// Adds one sample per trail from each robot's part matrices (NUM_ROBOT_PARTS per robot).
+	// Only one thread may push at a time.
+	void Push(const MATRIX4X4* partMatrices, float time, JobSystem* jobs = NULL, int chunkSize = 512);
+
+	// Copies the trail oldest first into points (and times when given), which need room for
+	// capacity samples, returns how many there are. Safe while another thread pushes.
+	int GetTrail(int robot, int joint, VECTOR3D* points, float* sampleTimes = NULL) const;
+
+	// Length of the path over the samples held
+	float GetPathLength(int robot, int joint) const;
+
+	// Fastest speed between two consecutive samples, in units per second
+	float GetMaxSpeed(int robot, int joint) const;
+
+	int GetNumRobots() const
+	{
+		return numRobots;
+	}
+
+	int GetCapacity() const
+	{
+		return capacity;
+	}
+
+	long long GetNumSamples() const
+	{
+		return numSamples.load(std::memory_order_acquire);
+	}
+
+	size_t GetMemoryUsed() const
+	{
+		return samples.capacity() * sizeof(VECTOR3D) + times.capacity() * sizeof(float);
+	}
+};
+
+#endif	//JOINTTRAILS_H
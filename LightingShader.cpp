@@ -0,0 +1,217 @@
+#include <windows.h>
+#include <gl/glew.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "LightingShader.h"
+
+
+// Uniform buffer binding points of the two blocks
+static const GLuint lightsBinding = 0;
+static const GLuint materialBinding = 1;
+
+static const char* vertexSource =
+	"#version 150 compatibility\n"
+	"out vec3 eyePosition;\n"
+	"out vec3 eyeNormal;\n"
+	"out vec2 maskCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 eye = gl_ModelViewMatrix * gl_Vertex;\n"
+	"	eyePosition = eye.xyz / eye.w;\n"
+	"	eyeNormal = gl_NormalMatrix * gl_Normal;\n"
+	"	maskCoord = vec2(dot(gl_ObjectPlaneS[0], gl_Vertex), dot(gl_ObjectPlaneT[0], gl_Vertex));\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+	"}\n";
+
+static const char* fragmentSource =
+	"#version 150 compatibility\n"
+	"layout(std140) uniform Lights\n"
+	"{\n"
+	"	vec4 sceneAmbient;\n"
+	"	vec4 lightPosition[2];\n"
+	"	vec4 lightAmbient[2];\n"
+	"	vec4 lightDiffuse[2];\n"
+	"	vec4 lightSpecular[2];\n"
+	"	int numLights;\n"
+	"};\n"
+	"layout(std140) uniform Material\n"
+	"{\n"
+	"	vec4 materialAmbient;\n"
+	"	vec4 materialDiffuse;\n"
+	"	vec4 materialSpecular;\n"
+	"	float materialShininess;\n"
+	"};\n"
+	"uniform sampler2D shadowMask;\n"
+	"uniform bool useShadowMask;\n"
+	"in vec3 eyePosition;\n"
+	"in vec3 eyeNormal;\n"
+	"in vec2 maskCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 n = normalize(eyeNormal);\n"
+	"	vec3 colour = sceneAmbient.rgb * materialAmbient.rgb;\n"
+	"	for (int i = 0; i < numLights; i++)\n"
+	"	{\n"
+	"		vec3 l = normalize(lightPosition[i].xyz - eyePosition * lightPosition[i].w);\n"
+	"		float diffuse = max(dot(n, l), 0.0);\n"
+	"		colour += lightAmbient[i].rgb * materialAmbient.rgb + diffuse * lightDiffuse[i].rgb * materialDiffuse.rgb;\n"
+	"		if (diffuse > 0.0)\n"
+	"		{\n"
+	"			vec3 h = normalize(l + vec3(0.0, 0.0, 1.0));\n"
+	"			colour += pow(max(dot(n, h), 0.0), materialShininess) * lightSpecular[i].rgb * materialSpecular.rgb;\n"
+	"		}\n"
+	"	}\n"
+	"	colour = min(colour, vec3(1.0));\n"
+	"	if (useShadowMask)\n"
+	"		colour *= texture(shadowMask, maskCoord).r;\n"
+	"	gl_FragColor = vec4(colour, materialDiffuse.a);\n"
+	"}\n";
+
+static GLuint CompileShader(GLenum type, const char* source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		fprintf(stderr, "lighting shader: %s shader: %s\n", type == GL_VERTEX_SHADER ? "vertex" : "fragment", log);
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+
+LightingShader::LightingShader()
+{
+	program = 0;
+	lightBuffer = 0;
+	useShadowMaskLocation = -1;
+
+	// Fixed function defaults, every light off
+	memset(&lights, 0, sizeof(lights));
+	lights.sceneAmbient[0] = lights.sceneAmbient[1] = lights.sceneAmbient[2] = 0.2f;
+	lights.sceneAmbient[3] = 1.0f;
+}
+
+bool LightingShader::Init()
+{
+	// #version 150 compatibility needs GL 3.2
+	if (!GLEW_VERSION_3_2)
+	{
+		fprintf(stderr, "lighting shader: OpenGL 3.2 is not available\n");
+		return false;
+	}
+
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	if (!vertexShader || !fragmentShader)
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return false;
+	}
+
+	GLuint linked = glCreateProgram();
+	glAttachShader(linked, vertexShader);
+	glAttachShader(linked, fragmentShader);
+	glLinkProgram(linked);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(linked, GL_LINK_STATUS, &status);
+	if (!status)
+	{
+		char log[1024];
+		glGetProgramInfoLog(linked, sizeof(log), NULL, log);
+		fprintf(stderr, "lighting shader: link: %s\n", log);
+		glDeleteProgram(linked);
+		return false;
+	}
+
+	program = linked;
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Lights"), lightsBinding);
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Material"), materialBinding);
+	useShadowMaskLocation = glGetUniformLocation(program, "useShadowMask");
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "shadowMask"), 0);
+	glUniform1i(useShadowMaskLocation, 0);
+	glUseProgram(0);
+
+	glGenBuffers(1, &lightBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(lights), &lights, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	return true;
+}
+
+void LightingShader::SetLight(int i, const GLfloat position[4], const GLfloat ambient[4], const GLfloat diffuse[4],
+							  const GLfloat specular[4])
+{
+	if (i < 0 || i >= MAX_SHADER_LIGHTS)
+		return;
+
+	memcpy(lights.position[i], position, sizeof(lights.position[i]));
+	memcpy(lights.ambient[i], ambient, sizeof(lights.ambient[i]));
+	memcpy(lights.diffuse[i], diffuse, sizeof(lights.diffuse[i]));
+	memcpy(lights.specular[i], specular, sizeof(lights.specular[i]));
+	if (lights.numLights < i + 1)
+		lights.numLights = i + 1;
+
+	if (lightBuffer)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(lights), &lights);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+}
+
+int LightingShader::AddMaterial(const GLfloat ambient[4], const GLfloat diffuse[4], const GLfloat specular[4],
+								GLfloat shininess)
+{
+	ShaderMaterial material;
+	memset(&material, 0, sizeof(material));
+	memcpy(material.ambient, ambient, sizeof(material.ambient));
+	memcpy(material.diffuse, diffuse, sizeof(material.diffuse));
+	memcpy(material.specular, specular, sizeof(material.specular));
+	material.shininess = shininess;
+
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(material), &material, GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	materialBuffers.push_back(buffer);
+	return (int)materialBuffers.size() - 1;
+}
+
+void LightingShader::Begin()
+{
+	glUseProgram(program);
+	glBindBufferBase(GL_UNIFORM_BUFFER, lightsBinding, lightBuffer);
+}
+
+void LightingShader::End()
+{
+	glUseProgram(0);
+}
+
+void LightingShader::SetMaterial(int material)
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, materialBinding, materialBuffers[material]);
+}
+
+void LightingShader::SetShadowMask(bool enabled)
+{
+	glUniform1i(useShadowMaskLocation, enabled ? 1 : 0);
+}
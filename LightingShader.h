@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	LightingShader.h
+//	Per-pixel lighting in GLSL, in place of the fixed function GL_LIGHT0/GL_LIGHT1.
+//	It computes the same Blinn-Phong terms as the fixed function pipeline (infinite viewer,
+//	one-sided), but per fragment, so coarsely tessellated parts keep smooth highlights.
+//
+//	The lights live in one uniform buffer, uploaded by SetLight(). Every material has its
+//	own uniform buffer, so switching material is a single buffer binding. The shader keeps
+//	using the matrix stack and vertex arrays (GLSL 1.50 compatibility profile), so drawing
+//	code is unchanged. The ground's shadow mask, when enabled, is looked up through the
+//	object planes set with glTexGen.
+//
+//	Needs OpenGL 3.2 through GLEW, the first version with GLSL 1.50; Init() returns false
+//	when it is missing or the shader does not build, and the fixed function path stays in
+//	use. GLEW's header has to come before any other GL header, as it does here.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef LIGHTINGSHADER_H
+#define LIGHTINGSHADER_H
+
+#include <gl/glew.h>
+#include <vector>
+
+const int MAX_SHADER_LIGHTS = 2;
+
+// std140 layout of the Lights block
+struct ShaderLights
+{
+	float sceneAmbient[4];
+	float position[MAX_SHADER_LIGHTS][4];	// eye coordinates
+	float ambient[MAX_SHADER_LIGHTS][4];
+	float diffuse[MAX_SHADER_LIGHTS][4];
+	float specular[MAX_SHADER_LIGHTS][4];
+	int numLights;
+	int padding[3];
+};
+
+// std140 layout of the Material block
+struct ShaderMaterial
+{
+	float ambient[4];
+	float diffuse[4];
+	float specular[4];
+	float shininess;
+	float padding[3];
+};
+
+class LightingShader
+{
+private:
+	GLuint program;
+	GLuint lightBuffer;
+	std::vector<GLuint> materialBuffers;
+	GLint useShadowMaskLocation;
+
+	ShaderLights lights;
+
+public:
+	LightingShader();
+
+	// Compiles the shader and creates the light buffer, needs a current context
+	bool Init();
+
+	bool IsReady() const
+	{
+		return program != 0;
+	}
+
+	// Light i, with the fixed function defaults: position in eye coordinates as glLightfv()
+	// would store it with an identity modelview, w = 0 for a directional light
+	void SetLight(int i, const GLfloat position[4], const GLfloat ambient[4], const GLfloat diffuse[4],
+				  const GLfloat specular[4]);
+
+	// Returns the id SetMaterial() takes
+	int AddMaterial(const GLfloat ambient[4], const GLfloat diffuse[4], const GLfloat specular[4], GLfloat shininess);
+
+	void Begin();
+	void End();
+
+	void SetMaterial(int material);
+
+	// Modulates the lighting by the luminance texture bound to unit 0, at the texture
+	// coordinates the GL_OBJECT_PLANE of s and t give
+	void SetShadowMask(bool enabled);
+};
+
+#endif	//LIGHTINGSHADER_H
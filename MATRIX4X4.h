@@ -0,0 +1,238 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	MATRIX4X4.h
+//	Class declaration for a 4x4 matrix, column major like OpenGL so it can be passed
+//	straight to glLoadMatrixf/glMultMatrixf.
+//
+//	Translate/Rotate/Scale post-multiply the current matrix exactly like glTranslatef,
+//	glRotatef and glScalef do to the current transformation matrix, so transform code
+//	written against the GL matrix stack can be mirrored one call at a time.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MATRIX4X4_H
+#define MATRIX4X4_H
+
+#include <math.h>
+#include "VECTOR3D.h"
+
+class MATRIX4X4
+{
+public:
+	//constructors
+	MATRIX4X4(void)
+	{
+		LoadIdentity();
+	}
+
+	MATRIX4X4(const float* rhs)
+	{
+		for (int i = 0; i < 16; i++)
+			entries[i] = rhs[i];
+	}
+
+	void LoadIdentity(void)
+	{
+		for (int i = 0; i < 16; i++)
+			entries[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+	}
+
+	//matrix algebra
+	MATRIX4X4 operator*(const MATRIX4X4& rhs) const
+	{
+		MATRIX4X4 result;
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+			{
+				result.entries[c * 4 + r] = entries[r] * rhs.entries[c * 4]
+										  + entries[4 + r] * rhs.entries[c * 4 + 1]
+										  + entries[8 + r] * rhs.entries[c * 4 + 2]
+										  + entries[12 + r] * rhs.entries[c * 4 + 3];
+			}
+		}
+		return result;
+	}
+
+	void operator*=(const MATRIX4X4& rhs)
+	{
+		(*this) = (*this) * rhs;
+	}
+
+	// Post-multiplied transforms, same semantics as the glTranslatef etc. calls
+	void Translate(float x, float y, float z)
+	{
+		for (int r = 0; r < 4; r++)
+			entries[12 + r] += entries[r] * x + entries[4 + r] * y + entries[8 + r] * z;
+	}
+
+	void Scale(float x, float y, float z)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			entries[r] *= x;
+			entries[4 + r] *= y;
+			entries[8 + r] *= z;
+		}
+	}
+
+	// angle in degrees about the axis (x, y, z), as glRotatef
+	void Rotate(float angle, float x, float y, float z)
+	{
+		(*this) *= GetRotation(angle, x, y, z);
+	}
+
+	static MATRIX4X4 GetRotation(float angle, float x, float y, float z)
+	{
+		MATRIX4X4 rotation;
+
+		const float length = (float)sqrt(x * x + y * y + z * z);
+		if (length == 0.0f)
+			return rotation;
+		x /= length; y /= length; z /= length;
+
+		const float radians = angle * 3.14159265358979f / 180.0f;
+		const float c = (float)cos(radians);
+		const float s = (float)sin(radians);
+		const float t = 1.0f - c;
+
+		rotation.entries[0] = t * x * x + c;
+		rotation.entries[1] = t * x * y + s * z;
+		rotation.entries[2] = t * x * z - s * y;
+		rotation.entries[4] = t * x * y - s * z;
+		rotation.entries[5] = t * y * y + c;
+		rotation.entries[6] = t * y * z + s * x;
+		rotation.entries[8] = t * x * z + s * y;
+		rotation.entries[9] = t * y * z - s * x;
+		rotation.entries[10] = t * z * z + c;
+
+		return rotation;
+	}
+
+	// Same matrix gluPerspective() multiplies onto the stack, fovy in degrees
+	static MATRIX4X4 GetPerspective(float fovy, float aspect, float zNear, float zFar)
+	{
+		MATRIX4X4 projection;
+
+		const float f = 1.0f / (float)tan(fovy * 3.14159265358979f / 360.0f);
+		projection.entries[0] = f / aspect;
+		projection.entries[5] = f;
+		projection.entries[10] = (zFar + zNear) / (zNear - zFar);
+		projection.entries[11] = -1.0f;
+		projection.entries[14] = 2.0f * zFar * zNear / (zNear - zFar);
+		projection.entries[15] = 0.0f;
+
+		return projection;
+	}
+
+	// Same matrix gluLookAt() multiplies onto the stack
+	static MATRIX4X4 GetLookAt(const VECTOR3D& eye, const VECTOR3D& centre, const VECTOR3D& up)
+	{
+		MATRIX4X4 view;
+
+		VECTOR3D f = centre - eye;
+		f.Normalize();
+		VECTOR3D s = f.CrossProduct(up);
+		s.Normalize();
+		VECTOR3D u = s.CrossProduct(f);
+
+		view.entries[0] = s.x; view.entries[4] = s.y; view.entries[8] = s.z;
+		view.entries[1] = u.x; view.entries[5] = u.y; view.entries[9] = u.z;
+		view.entries[2] = -f.x; view.entries[6] = -f.y; view.entries[10] = -f.z;
+		view.entries[12] = -s.DotProduct(eye);
+		view.entries[13] = -u.DotProduct(eye);
+		view.entries[14] = f.DotProduct(eye);
+
+		return view;
+	}
+
+	// Flattens geometry onto the plane ax + by + cz + d = 0 along rays from the light,
+	// a point light when light[3] is 1 or a direction when it is 0
+	static MATRIX4X4 GetPlanarShadow(const float plane[4], const float light[4])
+	{
+		MATRIX4X4 shadow;
+
+		const float d = plane[0] * light[0] + plane[1] * light[1] + plane[2] * light[2] + plane[3] * light[3];
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+				shadow.entries[c * 4 + r] = (r == c ? d : 0.0f) - light[r] * plane[c];
+		}
+
+		return shadow;
+	}
+
+	// Inverse of a rotation plus translation, e.g. a view matrix without scaling
+	MATRIX4X4 GetRigidInverse() const
+	{
+		MATRIX4X4 inverse;
+		for (int c = 0; c < 3; c++)
+		{
+			for (int r = 0; r < 3; r++)
+				inverse.entries[c * 4 + r] = entries[r * 4 + c];
+		}
+
+		VECTOR3D t = inverse.TransformDirection(GetColumn(3));
+		inverse.entries[12] = -t.x;
+		inverse.entries[13] = -t.y;
+		inverse.entries[14] = -t.z;
+		return inverse;
+	}
+
+	// Inverse of any matrix with a bottom row of 0 0 0 1, e.g. a part matrix with its scale
+	MATRIX4X4 GetAffineInverse() const
+	{
+		const float* m = entries;
+		MATRIX4X4 inverse;
+
+		// inverse of the upper 3x3 from its cofactors
+		float c00 = m[5] * m[10] - m[9] * m[6];
+		float c01 = m[9] * m[2] - m[1] * m[10];
+		float c02 = m[1] * m[6] - m[5] * m[2];
+		float det = m[0] * c00 + m[4] * c01 + m[8] * c02;
+		float s = det != 0.0f ? 1.0f / det : 0.0f;
+
+		inverse.entries[0] = c00 * s;
+		inverse.entries[1] = c01 * s;
+		inverse.entries[2] = c02 * s;
+		inverse.entries[4] = (m[8] * m[6] - m[4] * m[10]) * s;
+		inverse.entries[5] = (m[0] * m[10] - m[8] * m[2]) * s;
+		inverse.entries[6] = (m[4] * m[2] - m[0] * m[6]) * s;
+		inverse.entries[8] = (m[4] * m[9] - m[8] * m[5]) * s;
+		inverse.entries[9] = (m[8] * m[1] - m[0] * m[9]) * s;
+		inverse.entries[10] = (m[0] * m[5] - m[4] * m[1]) * s;
+
+		VECTOR3D t = inverse.TransformDirection(GetColumn(3));
+		inverse.entries[12] = -t.x;
+		inverse.entries[13] = -t.y;
+		inverse.entries[14] = -t.z;
+		return inverse;
+	}
+
+	//transform a point (w = 1) or a direction (w = 0)
+	VECTOR3D TransformPoint(const VECTOR3D& p) const
+	{
+		return VECTOR3D(entries[0] * p.x + entries[4] * p.y + entries[8] * p.z + entries[12],
+						entries[1] * p.x + entries[5] * p.y + entries[9] * p.z + entries[13],
+						entries[2] * p.x + entries[6] * p.y + entries[10] * p.z + entries[14]);
+	}
+
+	VECTOR3D TransformDirection(const VECTOR3D& d) const
+	{
+		return VECTOR3D(entries[0] * d.x + entries[4] * d.y + entries[8] * d.z,
+						entries[1] * d.x + entries[5] * d.y + entries[9] * d.z,
+						entries[2] * d.x + entries[6] * d.y + entries[10] * d.z);
+	}
+
+	VECTOR3D GetColumn(int column) const
+	{
+		return VECTOR3D(entries[column * 4], entries[column * 4 + 1], entries[column * 4 + 2]);
+	}
+
+	//cast to pointer to a (float *) for glMultMatrixf etc
+	operator float* () const { return (float*)this; }
+	operator const float* () const { return (const float*)this; }
+
+	//member variables
+	float entries[16];
+};
+
+#endif	//MATRIX4X4_H
@@ -0,0 +1,486 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <math.h>
+#include <utility>
+#include <vector>
+#include "VECTOR3D.h"
+#include "QuadMesh.h"
+
+#include "MeshOptimizer.h"
+
+
+static const float PI = 3.14159265358979f;
+
+int IndexedMesh::GetNumTriangles() const
+{
+	if (!strips)
+		return (int)indices.size() / 3;
+
+	int triangles = 0, run = 0;
+	for (size_t i = 0; i <= indices.size(); i++)
+	{
+		if (i == indices.size() || indices[i] == STRIP_RESTART)
+		{
+			if (run > 2)
+				triangles += run - 2;
+			run = 0;
+		}
+		else
+			run++;
+	}
+	return triangles;
+}
+
+void IndexedMesh::Draw() const
+{
+	if (vertices.empty() || indices.empty())
+		return;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(Vertex), &vertices[0].position.x);
+	glNormalPointer(GL_FLOAT, sizeof(Vertex), &vertices[0].normal.x);
+
+	if (!strips)
+		glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, &indices[0]);
+	else
+	{
+		size_t start = 0;
+		for (size_t i = 0; i <= indices.size(); i++)
+		{
+			if (i == indices.size() || indices[i] == STRIP_RESTART)
+			{
+				if (i - start > 2)
+					glDrawElements(GL_TRIANGLE_STRIP, (GLsizei)(i - start), GL_UNSIGNED_INT, &indices[start]);
+				start = i + 1;
+			}
+		}
+	}
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+
+static void AddTriangle(IndexedMesh& mesh, unsigned int a, unsigned int b, unsigned int c)
+{
+	mesh.indices.push_back(a);
+	mesh.indices.push_back(b);
+	mesh.indices.push_back(c);
+}
+
+void BuildSphereMesh(int slices, int stacks, IndexedMesh& mesh)
+{
+	mesh.Clear();
+
+	// Rings from the +z pole down to the -z pole, the seam vertex is repeated at each end
+	for (int i = 0; i <= stacks; i++)
+	{
+		float rho = PI * i / stacks;
+		for (int j = 0; j <= slices; j++)
+		{
+			float theta = 2.0f * PI * j / slices;
+			IndexedMesh::Vertex v;
+			v.normal = VECTOR3D((float)(cos(theta) * sin(rho)), (float)(sin(theta) * sin(rho)), (float)cos(rho));
+			v.position = v.normal;
+			mesh.vertices.push_back(v);
+		}
+	}
+
+	const unsigned int ring = slices + 1;
+	for (int i = 0; i < stacks; i++)
+	{
+		for (int j = 0; j < slices; j++)
+		{
+			unsigned int v00 = i * ring + j, v01 = v00 + 1, v10 = v00 + ring, v11 = v10 + 1;
+			// the triangle touching a pole along a whole edge has no area
+			if (i < stacks - 1)
+				AddTriangle(mesh, v00, v10, v11);
+			if (i > 0)
+				AddTriangle(mesh, v00, v11, v01);
+		}
+	}
+}
+
+void BuildCylinderMesh(int slices, int stacks, IndexedMesh& mesh)
+{
+	mesh.Clear();
+
+	for (int i = 0; i <= stacks; i++)
+	{
+		float z = (float)i / stacks;
+		for (int j = 0; j <= slices; j++)
+		{
+			float theta = 2.0f * PI * j / slices;
+			IndexedMesh::Vertex v;
+			v.normal = VECTOR3D((float)cos(theta), (float)sin(theta), 0.0f);
+			v.position = VECTOR3D(v.normal.x, v.normal.y, z);
+			mesh.vertices.push_back(v);
+		}
+	}
+
+	const unsigned int ring = slices + 1;
+	for (int i = 0; i < stacks; i++)
+	{
+		for (int j = 0; j < slices; j++)
+		{
+			unsigned int v00 = i * ring + j, v01 = v00 + 1, v10 = v00 + ring, v11 = v10 + 1;
+			AddTriangle(mesh, v00, v01, v11);
+			AddTriangle(mesh, v00, v11, v10);
+		}
+	}
+}
+
+void BuildCubeMesh(IndexedMesh& mesh)
+{
+	mesh.Clear();
+
+	// face normal and the two in-face axes, ordered so corners wind counterclockwise outside
+	static const float faces[6][3][3] =
+	{
+		{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+		{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+		{ { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+		{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+		{ { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+	};
+	static const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+
+	for (int f = 0; f < 6; f++)
+	{
+		VECTOR3D n(faces[f][0]), u(faces[f][1]), v(faces[f][2]);
+		unsigned int first = (unsigned int)mesh.vertices.size();
+		for (int c = 0; c < 4; c++)
+		{
+			IndexedMesh::Vertex vertex;
+			vertex.position = (n + u * corners[c][0] + v * corners[c][1]) * 0.5f;
+			vertex.normal = n;
+			mesh.vertices.push_back(vertex);
+		}
+		AddTriangle(mesh, first, first + 1, first + 2);
+		AddTriangle(mesh, first, first + 2, first + 3);
+	}
+}
+
+void BuildQuadMeshTriangles(const QuadMesh& quadMesh, IndexedMesh& mesh)
+{
+	mesh.Clear();
+
+	const int size = quadMesh.GetMeshSize();
+	for (int row = 0; row <= size; row++)
+	{
+		for (int col = 0; col <= size; col++)
+		{
+			const MeshVertex& source = quadMesh.GetVertex(row, col);
+			IndexedMesh::Vertex v;
+			v.position = source.position;
+			v.normal = source.normal;
+			mesh.vertices.push_back(v);
+		}
+	}
+
+	// same corners and winding as the GL_QUADS DrawMesh() draws
+	const unsigned int stride = size + 1;
+	for (int row = 0; row < size; row++)
+	{
+		for (int col = 0; col < size; col++)
+		{
+			unsigned int v0 = row * stride + col, v1 = v0 + 1, v3 = v0 + stride, v2 = v3 + 1;
+			AddTriangle(mesh, v0, v1, v2);
+			AddTriangle(mesh, v0, v2, v3);
+		}
+	}
+}
+
+
+float ComputeACMR(const IndexedMesh& mesh, int cacheSize)
+{
+	int triangles = mesh.GetNumTriangles();
+	if (triangles == 0)
+		return 0.0f;
+
+	// A vertex is in the FIFO while fewer than cacheSize misses happened since it went in
+	std::vector<long long> insertedAt(mesh.vertices.size(), -(long long)cacheSize - 1);
+	long long misses = 0;
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		unsigned int v = mesh.indices[i];
+		if (v == STRIP_RESTART)
+			continue;
+		if (misses - insertedAt[v] >= cacheSize)
+		{
+			insertedAt[v] = misses;
+			misses++;
+		}
+	}
+	return (float)misses / triangles;
+}
+
+
+// Forsyth's scoring, see "Linear-Speed Vertex Cache Optimisation"
+static const int MAX_VALENCE_SCORE = 32;
+
+static float CachePositionScore(int position, int cacheSize)
+{
+	if (position < 0)
+		return 0.0f;
+	// the last triangle's vertices score the same, so its neighbours win regardless of order
+	if (position < 3)
+		return 0.75f;
+	return (float)pow(1.0f - (float)(position - 3) / (cacheSize - 3), 1.5f);
+}
+
+static float ValenceScore(int activeTriangles)
+{
+	return 2.0f * (float)pow((float)activeTriangles, -0.5f);
+}
+
+void OptimizeVertexCache(IndexedMesh& mesh, int cacheSize)
+{
+	if (mesh.strips || mesh.indices.empty() || cacheSize < 4)
+		return;
+
+	const int numVertices = (int)mesh.vertices.size();
+	const int numTriangles = (int)mesh.indices.size() / 3;
+	const std::vector<unsigned int>& indices = mesh.indices;
+
+	float cacheScores[64 + 3];
+	if (cacheSize > 64)
+		cacheSize = 64;
+	for (int i = 0; i < cacheSize + 3; i++)
+		cacheScores[i] = i < cacheSize ? CachePositionScore(i, cacheSize) : 0.0f;
+	float valenceScores[MAX_VALENCE_SCORE];
+	for (int i = 1; i < MAX_VALENCE_SCORE; i++)
+		valenceScores[i] = ValenceScore(i);
+
+	// Triangles around each vertex, the first activeCount of them not yet emitted
+	std::vector<int> triangleStart(numVertices + 1, 0), activeCount(numVertices, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+		activeCount[indices[i]]++;
+	for (int v = 0; v < numVertices; v++)
+		triangleStart[v + 1] = triangleStart[v] + activeCount[v];
+	std::vector<int> vertexTriangles(indices.size());
+	std::vector<int> fill(triangleStart.begin(), triangleStart.end() - 1);
+	for (int t = 0; t < numTriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+			vertexTriangles[fill[indices[3 * t + k]]++] = t;
+	}
+
+	std::vector<int> cachePosition(numVertices, -1);
+	std::vector<float> vertexScore(numVertices), triangleScore(numTriangles, 0.0f);
+	std::vector<bool> emitted(numTriangles, false);
+
+	auto scoreVertex = [&](int v) -> float
+	{
+		int active = activeCount[v];
+		if (active == 0)
+			return -1.0f;
+		float score = cachePosition[v] >= 0 ? cacheScores[cachePosition[v]] : 0.0f;
+		return score + (active < MAX_VALENCE_SCORE ? valenceScores[active] : ValenceScore(active));
+	};
+
+	for (int v = 0; v < numVertices; v++)
+		vertexScore[v] = scoreVertex(v);
+	int best = 0;
+	for (int t = 0; t < numTriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+			triangleScore[t] += vertexScore[indices[3 * t + k]];
+		if (triangleScore[t] > triangleScore[best])
+			best = t;
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	int cache[64 + 3], newCache[64 + 3];
+	int cacheCount = 0;
+	int cursor = 0;
+
+	for (int emittedCount = 0; emittedCount < numTriangles; emittedCount++)
+	{
+		// nothing in the cache has triangles left, continue from the input order
+		if (best < 0)
+		{
+			while (emitted[cursor])
+				cursor++;
+			best = cursor;
+		}
+
+		emitted[best] = true;
+		int newCount = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			int v = indices[3 * best + k];
+			output.push_back(v);
+			newCache[newCount++] = v;
+
+			// move the triangle past the vertex's active ones
+			int* triangles = &vertexTriangles[triangleStart[v]];
+			for (int i = 0; i < activeCount[v]; i++)
+			{
+				if (triangles[i] == best)
+				{
+					triangles[i] = triangles[activeCount[v] - 1];
+					triangles[activeCount[v] - 1] = best;
+					break;
+				}
+			}
+			activeCount[v]--;
+		}
+
+		// LRU: the triangle's vertices go to the front, the rest keep their order up to the
+		// cacheSize + 3 entries newCache holds
+		for (int i = 0; i < cacheCount && newCount < cacheSize + 3; i++)
+		{
+			int v = cache[i];
+			if (v != newCache[0] && v != newCache[1] && v != newCache[2])
+				newCache[newCount++] = v;
+		}
+
+		// rescore everything that was or is in the cache
+		for (int i = 0; i < cacheCount; i++)
+			cachePosition[cache[i]] = -1;
+		for (int i = 0; i < newCount; i++)
+			cachePosition[newCache[i]] = i < cacheSize ? i : -1;
+
+		best = -1;
+		float bestScore = -1.0f;
+		for (int i = 0; i < newCount + cacheCount; i++)
+		{
+			int v = i < newCount ? newCache[i] : cache[i - newCount];
+			float score = scoreVertex(v);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const int* triangles = &vertexTriangles[triangleStart[v]];
+			for (int j = 0; j < activeCount[v]; j++)
+			{
+				int t = triangles[j];
+				triangleScore[t] += delta;
+				if (i < newCount && triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		for (int i = 0; i < newCount; i++)
+			cache[i] = newCache[i];
+		cacheCount = newCount;
+	}
+
+	// Renumber vertices in the order the optimised triangles first use them
+	std::vector<unsigned int> remap(numVertices, STRIP_RESTART);
+	std::vector<IndexedMesh::Vertex> vertices;
+	vertices.reserve(numVertices);
+	for (size_t i = 0; i < output.size(); i++)
+	{
+		unsigned int& index = remap[output[i]];
+		if (index == STRIP_RESTART)
+		{
+			index = (unsigned int)vertices.size();
+			vertices.push_back(mesh.vertices[output[i]]);
+		}
+		output[i] = index;
+	}
+
+	mesh.vertices.swap(vertices);
+	mesh.indices.swap(output);
+}
+
+
+void BuildStrips(IndexedMesh& mesh, int lookahead)
+{
+	if (mesh.strips)
+		return;
+
+	const int numVertices = (int)mesh.vertices.size();
+	const int numTriangles = (int)mesh.indices.size() / 3;
+	const std::vector<unsigned int>& triangles = mesh.indices;
+
+	std::vector<int> triangleStart(numVertices + 1, 0);
+	for (size_t i = 0; i < triangles.size(); i++)
+		triangleStart[triangles[i] + 1]++;
+	for (int v = 0; v < numVertices; v++)
+		triangleStart[v + 1] += triangleStart[v];
+	std::vector<int> vertexTriangles(triangles.size());
+	std::vector<int> fill(triangleStart.begin(), triangleStart.end() - 1);
+	for (int t = 0; t < numTriangles; t++)
+	{
+		for (int k = 0; k < 3; k++)
+			vertexTriangles[fill[triangles[3 * t + k]]++] = t;
+	}
+
+	std::vector<bool> used(numTriangles, false);
+
+	// Strips only take triangles less than lookahead past the first unused one in list
+	// order, so they do not run off along a long path and lose the optimised cache locality
+	int start = 0;
+
+	// Unused triangle with the directed edge a->b, its third vertex in c
+	auto findNext = [&](unsigned int a, unsigned int b, unsigned int& c) -> int
+	{
+		for (int i = triangleStart[a]; i < triangleStart[a + 1]; i++)
+		{
+			int t = vertexTriangles[i];
+			if (used[t] || t >= start + lookahead)
+				continue;
+			for (int k = 0; k < 3; k++)
+			{
+				if (triangles[3 * t + k] == a && triangles[3 * t + (k + 1) % 3] == b)
+				{
+					c = triangles[3 * t + (k + 2) % 3];
+					return t;
+				}
+			}
+		}
+		return -1;
+	};
+
+	std::vector<unsigned int> output;
+	output.reserve(triangles.size() * 2);
+	for (start = 0; start < numTriangles; start++)
+	{
+		if (used[start])
+			continue;
+		used[start] = true;
+
+		// start from the rotation whose last edge continues into another triangle
+		const unsigned int* t = &triangles[3 * start];
+		int rotation = 0;
+		unsigned int c;
+		for (int r = 0; r < 3; r++)
+		{
+			if (findNext(t[(r + 2) % 3], t[(r + 1) % 3], c) >= 0)
+			{
+				rotation = r;
+				break;
+			}
+		}
+
+		if (!output.empty())
+			output.push_back(STRIP_RESTART);
+		size_t first = output.size();
+		for (int k = 0; k < 3; k++)
+			output.push_back(t[(rotation + k) % 3]);
+
+		// Triangle i of a strip is (s[i], s[i+1], s[i+2]) for even i and (s[i+1], s[i], s[i+2])
+		// for odd i, so the next triangle must run a->b or b->a over the last two vertices
+		for (;;)
+		{
+			size_t n = output.size() - first;
+			unsigned int a = output[output.size() - 2], b = output[output.size() - 1];
+			int next = (n - 2) % 2 == 0 ? findNext(a, b, c) : findNext(b, a, c);
+			if (next < 0)
+				break;
+			used[next] = true;
+			output.push_back(c);
+		}
+	}
+
+	mesh.indices.swap(output);
+	mesh.strips = true;
+}
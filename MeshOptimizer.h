@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	MeshOptimizer.h
+//	Indexed triangle meshes for the robot primitives and QuadMesh, and the passes that
+//	reorder them for the post-transform vertex cache.
+//
+//	OptimizeVertexCache() is Forsyth's linear-speed vertex cache optimisation: triangles
+//	are emitted greedily by a score that favours vertices recently used and vertices
+//	with few triangles left, then vertices are renumbered in first use order. BuildStrips()
+//	turns the optimised list into triangle strips separated by STRIP_RESTART, following
+//	the list order so the cache locality is kept. ComputeACMR() simulates a FIFO cache
+//	and returns the average number of vertices transformed per triangle.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+#include "VECTOR3D.h"
+
+class QuadMesh;
+
+// Separates strips in IndexedMesh::indices, the index primitive restart is given
+const unsigned int STRIP_RESTART = 0xFFFFFFFF;
+
+struct IndexedMesh
+{
+	struct Vertex
+	{
+		VECTOR3D position;
+		VECTOR3D normal;
+	};
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;	// triangle list, or strips when strips is set
+	bool strips = false;
+
+	void Clear()
+	{
+		vertices.clear();
+		indices.clear();
+		strips = false;
+	}
+
+	int GetNumTriangles() const;
+
+	// Vertex arrays and glDrawElements. Strips are drawn one glDrawElements call per strip,
+	// OpenGL 1.1 has no primitive restart.
+	void Draw() const;
+};
+
+// Unit sphere and unit cylinder (radius 1, z from 0 to 1, open ends) with the same
+// orientation and slices/stacks layout as gluSphere and gluCylinder, triangles in the
+// stack by stack order GLU draws them
+void BuildSphereMesh(int slices, int stacks, IndexedMesh& mesh);
+void BuildCylinderMesh(int slices, int stacks, IndexedMesh& mesh);
+
+// Unit cube centred on the origin, as glutSolidCube(1.0)
+void BuildCubeMesh(IndexedMesh& mesh);
+
+// Two triangles per quad of the QuadMesh, in the order DrawMesh() draws the quads
+void BuildQuadMeshTriangles(const QuadMesh& quadMesh, IndexedMesh& mesh);
+
+// Average cache misses per triangle for a FIFO post-transform cache of cacheSize entries
+float ComputeACMR(const IndexedMesh& mesh, int cacheSize);
+
+// Reorders the triangle list for a cache of cacheSize entries, then the vertices for fetch
+void OptimizeVertexCache(IndexedMesh& mesh, int cacheSize = 32);
+
+// Converts a triangle list into strips separated by STRIP_RESTART. A strip only takes
+// triangles less than lookahead after the first one not yet in a strip, so an optimised
+// order keeps its ACMR; a large lookahead gives fewer, longer strips.
+void BuildStrips(IndexedMesh& mesh, int lookahead = 32);
+
+#endif	//MESHOPTIMIZER_H
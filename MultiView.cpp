@@ -0,0 +1,99 @@
+#include <math.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+#include "RobotModel.h"
+#include "Camera.h"
+
+#include "MultiView.h"
+
+
+void View::Set(const MATRIX4X4& view, const MATRIX4X4& projection, int x, int y, int width, int height)
+{
+	this->view = view;
+	this->projection = projection;
+	frustum.Extract(projection * view);
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+}
+
+void View::Set(Camera& camera, int x, int y, int width, int height)
+{
+	view = camera.GetView();
+	projection = camera.GetProjection();
+	frustum = camera.GetFrustum();
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+}
+
+void GetCubeFaceViews(const VECTOR3D& centre, float zNear, float zFar, int x, int y, int faceSize, View views[6])
+{
+	// direction and up of each face, as the cube map lookup expects them
+	static const float faces[6][6] =
+	{
+		{  1.0f,  0.0f,  0.0f,   0.0f, -1.0f,  0.0f },
+		{ -1.0f,  0.0f,  0.0f,   0.0f, -1.0f,  0.0f },
+		{  0.0f,  1.0f,  0.0f,   0.0f,  0.0f,  1.0f },
+		{  0.0f, -1.0f,  0.0f,   0.0f,  0.0f, -1.0f },
+		{  0.0f,  0.0f,  1.0f,   0.0f, -1.0f,  0.0f },
+		{  0.0f,  0.0f, -1.0f,   0.0f, -1.0f,  0.0f }
+	};
+
+	MATRIX4X4 projection = MATRIX4X4::GetPerspective(90.0f, 1.0f, zNear, zFar);
+	for (int i = 0; i < 6; i++)
+	{
+		VECTOR3D direction(faces[i][0], faces[i][1], faces[i][2]);
+		VECTOR3D up(faces[i][3], faces[i][4], faces[i][5]);
+		MATRIX4X4 view = MATRIX4X4::GetLookAt(centre, centre + direction, up);
+
+		// +x, -x, +y across the top row, -y, +z, -z below
+		views[i].Set(view, projection, x + (i % 3) * faceSize, y + (1 - i / 3) * faceSize, faceSize, faceSize);
+	}
+}
+
+int CullViews(const View* views, int numViews, const BBox* boxes, int numBoxes, int* const* lists, int* counts,
+			  int* visibleInAny)
+{
+	for (int v = 0; v < numViews; v++)
+		counts[v] = 0;
+
+	int numVisible = 0;
+	for (int i = 0; i < numBoxes; i++)
+	{
+		// centre and half extents once per box, shared by every plane of every view
+		VECTOR3D centre = (boxes[i].min + boxes[i].max) * 0.5f;
+		VECTOR3D extent = (boxes[i].max - boxes[i].min) * 0.5f;
+
+		bool visible = false;
+		for (int v = 0; v < numViews; v++)
+		{
+			const Frustum& frustum = views[v].frustum;
+			bool outside = false;
+			for (int p = 0; p < 6 && !outside; p++)
+			{
+				const VECTOR3D& n = frustum.normals[p];
+				float distance = n.DotProduct(centre) + frustum.distances[p];
+				float radius = fabs(n.x) * extent.x + fabs(n.y) * extent.y + fabs(n.z) * extent.z;
+				outside = distance + radius < 0.0f;
+			}
+
+			if (!outside)
+			{
+				lists[v][counts[v]++] = i;
+				visible = true;
+			}
+		}
+
+		if (visible)
+		{
+			if (visibleInAny)
+				visibleInAny[numVisible] = i;
+			numVisible++;
+		}
+	}
+	return numVisible;
+}
@@ -0,0 +1,44 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	MultiView.h
+//	Several views of the same frame: split-screen inspection views or the six faces of a
+//	cube map. The scene is walked once per frame; CullViews() then sorts the robots'
+//	bounding boxes into a draw list per view in a single pass over the boxes, and each
+//	view only submits its own list.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MULTIVIEW_H
+#define MULTIVIEW_H
+
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+#include "RobotModel.h"
+#include "Camera.h"
+
+const int MAX_VIEWS = 6;
+
+struct View
+{
+	MATRIX4X4 view;
+	MATRIX4X4 projection;
+	Frustum frustum;		// world coordinates
+	int viewport[4];		// x, y, width, height in window pixels
+
+	void Set(const MATRIX4X4& view, const MATRIX4X4& projection, int x, int y, int width, int height);
+
+	// The camera's view, reusing its cached matrices and frustum
+	void Set(Camera& camera, int x, int y, int width, int height);
+};
+
+// The six 90 degree views out of centre, in the face order and orientation of
+// GL_TEXTURE_CUBE_MAP_POSITIVE_X to NEGATIVE_Z, laid out three across and two down
+// from (x, y) with faceSize pixels per face
+void GetCubeFaceViews(const VECTOR3D& centre, float zNear, float zFar, int x, int y, int faceSize, View views[6]);
+
+// Appends the index of every box to the list of each view whose frustum it touches. The
+// lists need room for numBoxes indices, counts are set to their lengths. Indices of the
+// boxes seen by any view go to visibleInAny when it is given. Returns how many there are.
+int CullViews(const View* views, int numViews, const BBox* boxes, int numBoxes, int* const* lists, int* counts,
+			  int* visibleInAny = NULL);
+
+#endif	//MULTIVIEW_H
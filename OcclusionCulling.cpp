@@ -0,0 +1,274 @@
+#include <math.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+
+#include "OcclusionCulling.h"
+
+
+static const float PI = 3.14159265f;
+
+// Sides of the polygon a sphere is drawn as
+static const int sphereSides = 8;
+
+OcclusionBuffer::OcclusionBuffer()
+{
+	width = height = 0;
+	tilesX = tilesY = 0;
+	nearW = 0.001f;
+}
+
+void OcclusionBuffer::Init(int width, int height)
+{
+	tilesX = (width + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+	tilesY = (height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+	this->width = tilesX * OCCLUSION_TILE_SIZE;
+	this->height = tilesY * OCCLUSION_TILE_SIZE;
+	depths.assign((size_t)this->width * this->height, 0.0f);
+	tileDepths.assign((size_t)tilesX * tilesY, 0.0f);
+}
+
+void OcclusionBuffer::Begin(const MATRIX4X4& view, const MATRIX4X4& projection)
+{
+	clip = projection * view;
+	eye = view.GetRigidInverse().GetColumn(3);
+	depths.assign(depths.size(), 0.0f);
+}
+
+// Screen x, y in pixels and 1/w of p, false when it is not in front of nearW
+static bool ProjectPoint(const MATRIX4X4& clip, const VECTOR3D& p, int width, int height, float nearW, float* screen)
+{
+	const float* m = clip.entries;
+	float w = m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15];
+	if (w < nearW)
+		return false;
+	float invW = 1.0f / w;
+	screen[0] = ((m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12]) * invW * 0.5f + 0.5f) * width;
+	screen[1] = ((m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13]) * invW * 0.5f + 0.5f) * height;
+	screen[2] = invW;
+	return true;
+}
+
+void OcclusionBuffer::DrawTriangle(const VECTOR3D& a, const VECTOR3D& b, const VECTOR3D& c)
+{
+	// Triangles reaching behind the near plane are left out, which only culls less
+	float sa[3], sb[3], sc[3];
+	if (ProjectPoint(clip, a, width, height, nearW, sa) && ProjectPoint(clip, b, width, height, nearW, sb) &&
+		ProjectPoint(clip, c, width, height, nearW, sc))
+		DrawScreenTriangle(sa, sb, sc);
+}
+
+void OcclusionBuffer::DrawSphere(const VECTOR3D& centre, float radius)
+{
+	// The silhouette is the circle where the cone from the eye touches the sphere. What
+	// shows of the sphere is nearer than the circle's plane, so a polygon inside the circle
+	// on that plane is hidden behind the sphere wherever it covers.
+	VECTOR3D d = centre - eye;
+	float distance2 = d.DotProduct(d);
+	float radius2 = radius * radius;
+	if (distance2 <= radius2 * 1.01f)
+		return;
+	VECTOR3D circleCentre = centre - d * (radius2 / distance2);
+	float circleRadius = radius * sqrtf((distance2 - radius2) / distance2);
+
+	// Any two directions across the line of sight
+	VECTOR3D axis = d / sqrtf(distance2);
+	VECTOR3D u = fabs(axis.x) < 0.9f ? VECTOR3D(1.0f, 0.0f, 0.0f).CrossProduct(axis) : VECTOR3D(0.0f, 1.0f, 0.0f).CrossProduct(axis);
+	u.Normalize();
+	VECTOR3D v = axis.CrossProduct(u);
+
+	float screen[sphereSides][3];
+	for (int i = 0; i < sphereSides; i++)
+	{
+		float angle = 2.0f * PI * i / sphereSides;
+		VECTOR3D p = circleCentre + (u * cosf(angle) + v * sinf(angle)) * circleRadius;
+		if (!ProjectPoint(clip, p, width, height, nearW, screen[i]))
+			return;
+	}
+	for (int i = 1; i + 1 < sphereSides; i++)
+		DrawScreenTriangle(screen[0], screen[i], screen[i + 1]);
+}
+
+void OcclusionBuffer::DrawScreenTriangle(const float* a, const float* b, const float* c)
+{
+	float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+	if (fabs(area) < 1e-6f)
+		return;
+	if (area < 0.0f)
+	{
+		const float* swap = b;
+		b = c;
+		c = swap;
+		area = -area;
+	}
+
+	float minX = fminf(a[0], fminf(b[0], c[0])), maxX = fmaxf(a[0], fmaxf(b[0], c[0]));
+	float minY = fminf(a[1], fminf(b[1], c[1])), maxY = fmaxf(a[1], fmaxf(b[1], c[1]));
+	int x0 = minX < 0.0f ? 0 : (int)minX;
+	int y0 = minY < 0.0f ? 0 : (int)minY;
+	int x1 = maxX >= width ? width - 1 : (int)maxX;
+	int y1 = maxY >= height ? height - 1 : (int)maxY;
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	// Edge functions A x + B y + C, positive inside, one per edge opposite each vertex
+	const float* from[3] = { b, c, a };
+	const float* to[3] = { c, a, b };
+	float A[3], B[3], C[3], inset[3];
+	for (int e = 0; e < 3; e++)
+	{
+		A[e] = from[e][1] - to[e][1];
+		B[e] = to[e][0] - from[e][0];
+		C[e] = -A[e] * from[e][0] - B[e] * from[e][1];
+		// how far in the centre must be for the whole pixel to be inside
+		inset[e] = 0.5f * (fabs(A[e]) + fabs(B[e]));
+	}
+
+	// 1/w is linear in screen space; take its farthest value across each pixel
+	float invArea = 1.0f / area;
+	float dzdx = (A[0] * a[2] + A[1] * b[2] + A[2] * c[2]) * invArea;
+	float dzdy = (B[0] * a[2] + B[1] * b[2] + B[2] * c[2]) * invArea;
+	float zInset = 0.5f * (fabs(dzdx) + fabs(dzdy));
+
+	for (int y = y0; y <= y1; y++)
+	{
+		float py = y + 0.5f;
+		float* row = &depths[(size_t)y * width];
+		for (int x = x0; x <= x1; x++)
+		{
+			float px = x + 0.5f;
+			float e0 = A[0] * px + B[0] * py + C[0];
+			float e1 = A[1] * px + B[1] * py + C[1];
+			float e2 = A[2] * px + B[2] * py + C[2];
+			if (e0 < inset[0] || e1 < inset[1] || e2 < inset[2])
+				continue;
+
+			float z = (e0 * a[2] + e1 * b[2] + e2 * c[2]) * invArea - zInset;
+			if (z > row[x])
+				row[x] = z;
+		}
+	}
+}
+
+void OcclusionBuffer::End()
+{
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		for (int tx = 0; tx < tilesX; tx++)
+		{
+			float farthest = depths[(size_t)ty * OCCLUSION_TILE_SIZE * width + tx * OCCLUSION_TILE_SIZE];
+			for (int y = 0; y < OCCLUSION_TILE_SIZE; y++)
+			{
+				const float* row = &depths[((size_t)ty * OCCLUSION_TILE_SIZE + y) * width + tx * OCCLUSION_TILE_SIZE];
+				for (int x = 0; x < OCCLUSION_TILE_SIZE; x++)
+					farthest = row[x] < farthest ? row[x] : farthest;
+			}
+			tileDepths[(size_t)ty * tilesX + tx] = farthest;
+		}
+	}
+}
+
+bool OcclusionBuffer::IsBoxVisible(const VECTOR3D& boxMin, const VECTOR3D& boxMax) const
+{
+	// Corners as the min corner's clip coordinates plus the box's edges along each axis
+	const float* m = clip.entries;
+	VECTOR3D size = boxMax - boxMin;
+	float base[4], edges[3][4];
+	for (int r = 0; r < 4; r++)
+	{
+		base[r] = m[r] * boxMin.x + m[4 + r] * boxMin.y + m[8 + r] * boxMin.z + m[12 + r];
+		edges[0][r] = m[r] * size.x;
+		edges[1][r] = m[4 + r] * size.y;
+		edges[2][r] = m[8 + r] * size.z;
+	}
+
+	float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f, nearest = 0.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		float p[4];
+		for (int r = 0; r < 4; r++)
+			p[r] = base[r] + ((i & 1) ? edges[0][r] : 0.0f) + ((i & 2) ? edges[1][r] : 0.0f) + ((i & 4) ? edges[2][r] : 0.0f);
+
+		// reaching behind the near plane, the box's extent on screen is unbounded
+		if (p[3] < nearW)
+			return true;
+		float invW = 1.0f / p[3];
+		float x = (p[0] * invW * 0.5f + 0.5f) * width;
+		float y = (p[1] * invW * 0.5f + 0.5f) * height;
+		minX = x < minX ? x : minX;
+		maxX = x > maxX ? x : maxX;
+		minY = y < minY ? y : minY;
+		maxY = y > maxY ? y : maxY;
+		nearest = invW > nearest ? invW : nearest;
+	}
+	if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+		return false;
+
+	int x0 = minX < 0.0f ? 0 : (int)minX;
+	int y0 = minY < 0.0f ? 0 : (int)minY;
+	int x1 = maxX >= width ? width - 1 : (int)maxX;
+	int y1 = maxY >= height ? height - 1 : (int)maxY;
+
+	// A tile whose farthest pixel is nearer than the box hides its part of the box whole
+	for (int ty = y0 / OCCLUSION_TILE_SIZE; ty <= y1 / OCCLUSION_TILE_SIZE; ty++)
+	{
+		for (int tx = x0 / OCCLUSION_TILE_SIZE; tx <= x1 / OCCLUSION_TILE_SIZE; tx++)
+		{
+			if (tileDepths[(size_t)ty * tilesX + tx] > nearest)
+				continue;
+
+			int px0 = tx * OCCLUSION_TILE_SIZE > x0 ? tx * OCCLUSION_TILE_SIZE : x0;
+			int py0 = ty * OCCLUSION_TILE_SIZE > y0 ? ty * OCCLUSION_TILE_SIZE : y0;
+			int px1 = (tx + 1) * OCCLUSION_TILE_SIZE - 1 < x1 ? (tx + 1) * OCCLUSION_TILE_SIZE - 1 : x1;
+			int py1 = (ty + 1) * OCCLUSION_TILE_SIZE - 1 < y1 ? (ty + 1) * OCCLUSION_TILE_SIZE - 1 : y1;
+			for (int y = py0; y <= py1; y++)
+			{
+				const float* row = &depths[(size_t)y * width];
+				for (int x = px0; x <= px1; x++)
+				{
+					if (row[x] <= nearest)
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+float OcclusionBuffer::GetCoverage() const
+{
+	int covered = 0;
+	for (size_t i = 0; i < depths.size(); i++)
+	{
+		if (depths[i] > 0.0f)
+			covered++;
+	}
+	return depths.empty() ? 0.0f : (float)covered / depths.size();
+}
+
+void DrawRobotOccluders(OcclusionBuffer& buffer, const MATRIX4X4* partMatrices, const VECTOR3D& offset)
+{
+	// The smallest scale of the unit sphere keeps it inside the body if the scale is uneven
+	const MATRIX4X4& body = partMatrices[PART_BODY];
+	float radius = body.GetColumn(0).GetLength();
+	radius = fminf(radius, body.GetColumn(1).GetLength());
+	radius = fminf(radius, body.GetColumn(2).GetLength());
+	buffer.DrawSphere(body.GetColumn(3) + offset, radius);
+}
+
+unsigned int GetVisibleRobotParts(const OcclusionBuffer& buffer, const BBox& bounds, const MATRIX4X4* partMatrices,
+								  const VECTOR3D& offset)
+{
+	if (!buffer.IsBoxVisible(bounds.min + offset, bounds.max + offset))
+		return 0;
+
+	unsigned int visible = 0;
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		BBox box = ComputePartBounds(robotParts[i].shape, partMatrices[i]);
+		if (buffer.IsBoxVisible(box.min + offset, box.max + offset))
+			visible |= 1u << i;
+	}
+	return visible;
+}
@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	OcclusionCulling.h
+//	CPU occlusion culling for crowds of robots. The largest occluders, the robots' body
+//	spheres and the ground, are rasterized into a low resolution software depth buffer,
+//	then every robot and part that survived the frustum is tested against it by its
+//	bounding box before it is drawn.
+//
+//	Occluders only cover the pixels they cover whole, at the farthest depth they have
+//	within each pixel, and a sphere is drawn as a polygon inside its silhouette at the
+//	depth of the silhouette's plane, so a box is never culled while any of it can show.
+//	The buffer keeps the farthest depth of every 8x8 tile as well, so most boxes are
+//	settled by a few tiles without reading their pixels (hierarchical Z).
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef OCCLUSIONCULLING_H
+#define OCCLUSIONCULLING_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+
+const int OCCLUSION_TILE_SIZE = 8;
+
+class OcclusionBuffer
+{
+private:
+	int width, height;			// pixels, whole tiles
+	int tilesX, tilesY;
+	std::vector<float> depths;		// 1/w per pixel, larger is nearer, 0 where nothing was drawn
+	std::vector<float> tileDepths;	// farthest depth of each tile's pixels
+	MATRIX4X4 clip;				// projection * view
+	VECTOR3D eye;				// world position of the view
+	float nearW;				// occluders and boxes in front of this are not trusted
+
+	void DrawScreenTriangle(const float* a, const float* b, const float* c);
+
+public:
+	OcclusionBuffer();
+
+	// Resolution of the buffer, rounded up to whole tiles
+	void Init(int width, int height);
+
+	// Clears the buffer for a view, view must be rigid
+	void Begin(const MATRIX4X4& view, const MATRIX4X4& projection);
+
+	// Occluders, drawn between Begin() and End()
+	void DrawTriangle(const VECTOR3D& a, const VECTOR3D& b, const VECTOR3D& c);
+	void DrawSphere(const VECTOR3D& centre, float radius);
+
+	// Builds the tile depths, after which boxes can be tested
+	void End();
+
+	// False when every pixel the box could cover is nearer in the buffer
+	bool IsBoxVisible(const VECTOR3D& boxMin, const VECTOR3D& boxMax) const;
+
+	int GetWidth() const
+	{
+		return width;
+	}
+
+	int GetHeight() const
+	{
+		return height;
+	}
+
+	// Fraction of the pixels an occluder was drawn into
+	float GetCoverage() const;
+};
+
+// Draws the robot's body sphere, its largest part, as an occluder
+void DrawRobotOccluders(OcclusionBuffer& buffer, const MATRIX4X4* partMatrices, const VECTOR3D& offset);
+
+// Bit i set for each part i that may show, 0 when the robot's bounds are hidden whole
+unsigned int GetVisibleRobotParts(const OcclusionBuffer& buffer, const BBox& bounds, const MATRIX4X4* partMatrices,
+								  const VECTOR3D& offset);
+
+const unsigned int ALL_ROBOT_PARTS = (1u << NUM_ROBOT_PARTS) - 1;
+
+#endif	//OCCLUSIONCULLING_H
@@ -0,0 +1,306 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <emmintrin.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "QuadMesh.h"
+#include "JobSystem.h"
+
+#include "Particles.h"
+
+
+void ParticleGround::Set(const QuadMesh& mesh, const VECTOR3D& offset)
+{
+	size = mesh.GetMeshSize();
+	heights.resize((size_t)(size + 1) * (size + 1));
+	if (size <= 0)
+		return;
+
+	VECTOR3D origin = mesh.GetVertex(0, 0).position;
+	x0 = origin.x + offset.x;
+	z0 = origin.z + offset.z;
+	dx = mesh.GetVertex(0, 1).position.x - origin.x;
+	dz = mesh.GetVertex(1, 0).position.z - origin.z;
+
+	for (int row = 0; row <= size; row++)
+	{
+		for (int col = 0; col <= size; col++)
+			heights[row * (size + 1) + col] = mesh.GetVertex(row, col).position.y + offset.y;
+	}
+}
+
+bool ParticleGround::GetHeight(float x, float z, float& height) const
+{
+	float col = (x - x0) / dx;
+	float row = (z - z0) / dz;
+	if (!(col >= 0.0f && col < (float)size && row >= 0.0f && row < (float)size))
+		return false;
+
+	int c = (int)col, r = (int)row;
+	float s = col - c, t = row - r;
+	const float* h = &heights[r * (size + 1) + c];
+	float top = h[0] + (h[1] - h[0]) * s;
+	float bottom = h[size + 1] + (h[size + 2] - h[size + 1]) * s;
+	height = top + (bottom - top) * t;
+	return true;
+}
+
+
+ParticleSystem::ParticleSystem()
+{
+	numParticles = 0;
+	maxParticles = 0;
+	random = 1;
+}
+
+void ParticleSystem::Init(int maxParticles, unsigned int seed)
+{
+	this->maxParticles = maxParticles;
+	int padded = (maxParticles + 3) & ~3;
+	for (int c = 0; c < 3; c++)
+	{
+		positions[c].assign(padded, 0.0f);
+		velocities[c].assign(padded, 0.0f);
+	}
+	ages.assign(padded, 0.0f);
+	lifetimes.assign(padded, 1.0f);
+	numParticles = 0;
+	random = seed ? seed : 1;
+}
+
+void ParticleSystem::Clear()
+{
+	numParticles = 0;
+}
+
+// xorshift, uniform in [0, 1)
+float ParticleSystem::Random()
+{
+	random ^= random << 13;
+	random ^= random >> 17;
+	random ^= random << 5;
+	return (random >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::Emit(const VECTOR3D& origin, const VECTOR3D& direction, float spread, float speed, float lifetime,
+						  int count)
+{
+	// two axes across the direction for the cone
+	VECTOR3D d = direction;
+	d.Normalize();
+	VECTOR3D u = fabs(d.y) < 0.9f ? d.CrossProduct(VECTOR3D(0.0f, 1.0f, 0.0f)) : d.CrossProduct(VECTOR3D(1.0f, 0.0f, 0.0f));
+	u.Normalize();
+	VECTOR3D w = d.CrossProduct(u);
+
+	for (int n = 0; n < count && numParticles < maxParticles; n++)
+	{
+		float angle = spread * (float)sqrt(Random());
+		float around = 2.0f * 3.14159265f * Random();
+		VECTOR3D v = d * (float)cos(angle) + (u * (float)cos(around) + w * (float)sin(around)) * (float)sin(angle);
+		v *= speed * (0.75f + 0.5f * Random());
+
+		int i = numParticles++;
+		positions[0][i] = origin.x;
+		positions[1][i] = origin.y;
+		positions[2][i] = origin.z;
+		velocities[0][i] = v.x;
+		velocities[1][i] = v.y;
+		velocities[2][i] = v.z;
+		ages[i] = 0.0f;
+		lifetimes[i] = lifetime * (0.75f + 0.5f * Random());
+	}
+}
+
+void ParticleSystem::UpdateGroups(float dt, const ParticleParams& params, const ParticleGround* ground, int beginGroup,
+								  int endGroup)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 fall = _mm_set1_ps(params.gravity * dt);
+	const __m128 keep = _mm_set1_ps(1.0f - params.drag * dt);
+	const __m128 bounce = _mm_set1_ps(-params.restitution);
+	const __m128 friction = _mm_set1_ps(params.friction);
+	bool collide = ground && ground->size > 0;
+
+	for (int g = beginGroup; g < endGroup; g++)
+	{
+		int i = g * 4;
+		__m128 vx = _mm_mul_ps(_mm_loadu_ps(&velocities[0][i]), keep);
+		__m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&velocities[1][i]), fall), keep);
+		__m128 vz = _mm_mul_ps(_mm_loadu_ps(&velocities[2][i]), keep);
+		__m128 px = _mm_add_ps(_mm_loadu_ps(&positions[0][i]), _mm_mul_ps(vx, step));
+		__m128 py = _mm_add_ps(_mm_loadu_ps(&positions[1][i]), _mm_mul_ps(vy, step));
+		__m128 pz = _mm_add_ps(_mm_loadu_ps(&positions[2][i]), _mm_mul_ps(vz, step));
+
+		if (collide)
+		{
+			// grid cell of each lane, clamped so lanes off the grid still read valid heights
+			__m128 size = _mm_set1_ps((float)ground->size);
+			__m128 col = _mm_div_ps(_mm_sub_ps(px, _mm_set1_ps(ground->x0)), _mm_set1_ps(ground->dx));
+			__m128 row = _mm_div_ps(_mm_sub_ps(pz, _mm_set1_ps(ground->z0)), _mm_set1_ps(ground->dz));
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(col, zero), _mm_cmplt_ps(col, size)),
+									   _mm_and_ps(_mm_cmpge_ps(row, zero), _mm_cmplt_ps(row, size)));
+			__m128 last = _mm_set1_ps((float)(ground->size - 1));
+			__m128 cellCol = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(col, zero), last)));
+			__m128 cellRow = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(row, zero), last)));
+			__m128 s = _mm_sub_ps(col, cellCol);
+			__m128 t = _mm_sub_ps(row, cellRow);
+
+			int cells[4];
+			__m128 stride = _mm_set1_ps((float)(ground->size + 1));
+			_mm_storeu_si128((__m128i*)cells, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(cellRow, stride), cellCol)));
+			const float* h = &ground->heights[0];
+			int below = ground->size + 1;
+			__m128 h00 = _mm_set_ps(h[cells[3]], h[cells[2]], h[cells[1]], h[cells[0]]);
+			__m128 h01 = _mm_set_ps(h[cells[3] + 1], h[cells[2] + 1], h[cells[1] + 1], h[cells[0] + 1]);
+			__m128 h10 = _mm_set_ps(h[cells[3] + below], h[cells[2] + below], h[cells[1] + below], h[cells[0] + below]);
+			__m128 h11 = _mm_set_ps(h[cells[3] + below + 1], h[cells[2] + below + 1], h[cells[1] + below + 1],
+									h[cells[0] + below + 1]);
+			__m128 top = _mm_add_ps(h00, _mm_mul_ps(_mm_sub_ps(h01, h00), s));
+			__m128 bottom = _mm_add_ps(h10, _mm_mul_ps(_mm_sub_ps(h11, h10), s));
+			__m128 height = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), t));
+
+			// below the ground: back onto it, bouncing when still moving down
+			__m128 hit = _mm_and_ps(inside, _mm_cmplt_ps(py, height));
+			__m128 falling = _mm_and_ps(hit, _mm_cmplt_ps(vy, zero));
+			py = _mm_or_ps(_mm_and_ps(hit, height), _mm_andnot_ps(hit, py));
+			vy = _mm_or_ps(_mm_and_ps(falling, _mm_mul_ps(vy, bounce)), _mm_andnot_ps(falling, vy));
+			vx = _mm_or_ps(_mm_and_ps(falling, _mm_mul_ps(vx, friction)), _mm_andnot_ps(falling, vx));
+			vz = _mm_or_ps(_mm_and_ps(falling, _mm_mul_ps(vz, friction)), _mm_andnot_ps(falling, vz));
+		}
+
+		_mm_storeu_ps(&velocities[0][i], vx);
+		_mm_storeu_ps(&velocities[1][i], vy);
+		_mm_storeu_ps(&velocities[2][i], vz);
+		_mm_storeu_ps(&positions[0][i], px);
+		_mm_storeu_ps(&positions[1][i], py);
+		_mm_storeu_ps(&positions[2][i], pz);
+		_mm_storeu_ps(&ages[i], _mm_add_ps(_mm_loadu_ps(&ages[i]), step));
+	}
+}
+
+// Moves the last particle into the place of every dead one
+void ParticleSystem::Compact()
+{
+	int i = 0;
+	while (i < numParticles)
+	{
+		if (ages[i] < lifetimes[i])
+		{
+			i++;
+			continue;
+		}
+
+		int last = --numParticles;
+		for (int c = 0; c < 3; c++)
+		{
+			positions[c][i] = positions[c][last];
+			velocities[c][i] = velocities[c][last];
+		}
+		ages[i] = ages[last];
+		lifetimes[i] = lifetimes[last];
+	}
+}
+
+void ParticleSystem::Update(float dt, const ParticleParams& params, const ParticleGround* ground, JobSystem* jobs,
+							int chunkSize)
+{
+	// the padding lanes of the last group are updated along with it and never read
+	int numGroups = (numParticles + 3) / 4;
+	auto updateRange = [&](int begin, int end)
+	{
+		UpdateGroups(dt, params, ground, begin, end);
+	};
+
+	if (jobs)
+		jobs->ParallelFor(numGroups, (chunkSize + 3) / 4, updateRange);
+	else
+		updateRange(0, numGroups);
+
+	Compact();
+}
+
+void ParticleSystem::UpdateReference(float dt, const ParticleParams& params, const ParticleGround* ground)
+{
+	float keep = 1.0f - params.drag * dt;
+	for (int i = 0; i < numParticles; i++)
+	{
+		float vx = velocities[0][i] * keep;
+		float vy = (velocities[1][i] + params.gravity * dt) * keep;
+		float vz = velocities[2][i] * keep;
+		float px = positions[0][i] + vx * dt;
+		float py = positions[1][i] + vy * dt;
+		float pz = positions[2][i] + vz * dt;
+
+		float height;
+		if (ground && ground->GetHeight(px, pz, height) && py < height)
+		{
+			py = height;
+			if (vy < 0.0f)
+			{
+				vy *= -params.restitution;
+				vx *= params.friction;
+				vz *= params.friction;
+			}
+		}
+
+		velocities[0][i] = vx;
+		velocities[1][i] = vy;
+		velocities[2][i] = vz;
+		positions[0][i] = px;
+		positions[1][i] = py;
+		positions[2][i] = pz;
+		ages[i] += dt;
+	}
+
+	Compact();
+}
+
+const std::vector<int>& ParticleSystem::SortBackToFront(const MATRIX4X4& view, JobSystem* jobs)
+{
+	keys.resize(numParticles);
+	sortedKeys.resize(numParticles);
+	sortedIndices.resize(numParticles);
+	sortScratch.resize(numParticles);
+	std::vector<int>& indices = sortedIndices;
+
+	// eye space z, most negative farthest, as unsigned keys in the same order
+	const float* m = view.entries;
+	auto depthRange = [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			float z = m[2] * positions[0][i] + m[6] * positions[1][i] + m[10] * positions[2][i] + m[14];
+			unsigned int bits;
+			memcpy(&bits, &z, sizeof(bits));
+			keys[i] = bits ^ ((bits >> 31) ? 0xFFFFFFFFu : 0x80000000u);
+			indices[i] = i;
+		}
+	};
+	if (jobs)
+		jobs->ParallelFor(numParticles, 16384, depthRange);
+	else
+		depthRange(0, numParticles);
+
+	// least significant byte first, each pass stable
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		int counts[257] = { 0 };
+		for (int i = 0; i < numParticles; i++)
+			counts[((keys[i] >> shift) & 0xFF) + 1]++;
+		for (int b = 0; b < 256; b++)
+			counts[b + 1] += counts[b];
+		for (int i = 0; i < numParticles; i++)
+		{
+			int to = counts[(keys[i] >> shift) & 0xFF]++;
+			sortedKeys[to] = keys[i];
+			sortScratch[to] = indices[i];
+		}
+		keys.swap(sortedKeys);
+		indices.swap(sortScratch);
+	}
+	return sortedIndices;
+}
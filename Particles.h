@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Particles.h
+//	Sparks fired from the cannon muzzle while it spins and from the arm gun tips while the
+//	arms move, emitted at the tips found through the robot's part matrices.
+//
+//	Particles are stored as structure of arrays, padded to groups of four, and Update()
+//	advances every group in the lanes of an SSE kernel: gravity, drag, ageing and bouncing
+//	off the ground, in chunks over a JobSystem when one is given. Dead particles are then
+//	compacted away. SortBackToFront() radix sorts them by view depth for blending.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+
+class QuadMesh;
+class JobSystem;
+
+// Heights of a QuadMesh's vertex grid for the particles to bounce off, interpolated
+// bilinearly across each quad. Particles outside the grid fall through.
+struct ParticleGround
+{
+	int size;				// quads per side
+	float x0, z0;			// world position of vertex (0, 0)
+	float dx, dz;			// spacing between columns along x and rows along z
+	std::vector<float> heights;	// (size + 1) per row, world y
+
+	ParticleGround()
+	{
+		size = 0;
+		x0 = z0 = 0.0f;
+		dx = dz = 1.0f;
+	}
+
+	// From the mesh's grid as laid out by InitMesh() along x and z, placed at offset
+	void Set(const QuadMesh& mesh, const VECTOR3D& offset);
+
+	// Ground height under (x, z), false outside the grid
+	bool GetHeight(float x, float z, float& height) const;
+};
+
+struct ParticleParams
+{
+	float gravity = -9.8f;
+	float drag = 0.4f;			// fraction of the velocity lost per second
+	float restitution = 0.35f;	// vertical speed kept by a bounce
+	float friction = 0.6f;		// horizontal speed kept by a bounce
+};
+
+class ParticleSystem
+{
+private:
+	int numParticles;
+	int maxParticles;
+
+	// Structure of arrays, maxParticles rounded up to a multiple of 4
+	std::vector<float> positions[3];
+	std::vector<float> velocities[3];
+	std::vector<float> ages;
+	std::vector<float> lifetimes;
+
+	unsigned int random;
+
+	// scratch for the depth sort
+	std::vector<unsigned int> keys, sortedKeys;
+	std::vector<int> sortedIndices, sortScratch;
+
+private:
+	float Random();
+	void UpdateGroups(float dt, const ParticleParams& params, const ParticleGround* ground, int beginGroup, int endGroup);
+	void Compact();
+
+public:
+	ParticleSystem();
+
+	// Room for maxParticles, emission beyond it is dropped
+	void Init(int maxParticles, unsigned int seed = 1);
+	void Clear();
+
+	// count particles from origin along direction, within spread radians of it, at speed
+	// give or take a quarter, living lifetime seconds give or take a quarter
+	void Emit(const VECTOR3D& origin, const VECTOR3D& direction, float spread, float speed, float lifetime, int count);
+
+	// Advances every particle by dt seconds and removes the dead ones
+	void Update(float dt, const ParticleParams& params, const ParticleGround* ground = NULL, JobSystem* jobs = NULL,
+				int chunkSize = 4096);
+
+	// Plain scalar version of Update(), one particle at a time
+	void UpdateReference(float dt, const ParticleParams& params, const ParticleGround* ground = NULL);
+
+	// Indices of the particles ordered farthest first from the eye of view
+	const std::vector<int>& SortBackToFront(const MATRIX4X4& view, JobSystem* jobs = NULL);
+
+	int GetNumParticles() const
+	{
+		return numParticles;
+	}
+
+	VECTOR3D GetPosition(int i) const
+	{
+		return VECTOR3D(positions[0][i], positions[1][i], positions[2][i]);
+	}
+
+	// 0 when emitted to 1 when it dies
+	float GetAge(int i) const
+	{
+		return ages[i] / lifetimes[i];
+	}
+};
+
+#endif	//PARTICLES_H
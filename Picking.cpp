@@ -0,0 +1,583 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "Collision.h"
+#include "QuadMesh.h"
+
+#include "Picking.h"
+
+
+// Leaves of the robot hierarchy hold at most this many robots
+static const int maxLeafRobots = 4;
+
+Ray GetPickRay(const MATRIX4X4& view, const MATRIX4X4& projection, const int viewport[4], float x, float y)
+{
+	float ndcX = 2.0f * (x - viewport[0]) / viewport[2] - 1.0f;
+	float ndcY = 2.0f * (y - viewport[1]) / viewport[3] - 1.0f;
+
+	MATRIX4X4 eyeToWorld = view.GetRigidInverse();
+	Ray ray;
+	ray.origin = eyeToWorld.GetColumn(3);
+	ray.direction = eyeToWorld.TransformDirection(VECTOR3D(ndcX / projection.entries[0], ndcY / projection.entries[5], -1.0f));
+	ray.direction.Normalize();
+	return ray;
+}
+
+bool IntersectRayBox(const Ray& ray, const VECTOR3D& boxMin, const VECTOR3D& boxMax, float tMax, float& t)
+{
+	const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+	const float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+	const float lo[3] = { boxMin.x, boxMin.y, boxMin.z };
+	const float hi[3] = { boxMax.x, boxMax.y, boxMax.z };
+
+	float tEnter = 0.0f, tExit = tMax;
+	for (int i = 0; i < 3; i++)
+	{
+		if (direction[i] == 0.0f)
+		{
+			if (origin[i] < lo[i] || origin[i] > hi[i])
+				return false;
+			continue;
+		}
+
+		float inverse = 1.0f / direction[i];
+		float t0 = (lo[i] - origin[i]) * inverse;
+		float t1 = (hi[i] - origin[i]) * inverse;
+		if (t0 > t1)
+			std::swap(t0, t1);
+		if (t0 > tEnter)
+			tEnter = t0;
+		if (t1 < tExit)
+			tExit = t1;
+		if (tEnter > tExit)
+			return false;
+	}
+
+	t = tEnter;
+	return true;
+}
+
+static bool IntersectRaySphere(const Ray& ray, const VECTOR3D& centre, float radius, float& t)
+{
+	VECTOR3D oc = ray.origin - centre;
+	float b = oc.DotProduct(ray.direction);
+	float c = oc.DotProduct(oc) - radius * radius;
+	float discriminant = b * b - c;
+	if (discriminant < 0.0f)
+		return false;
+
+	float root = sqrtf(discriminant);
+	t = -b - root;
+	if (t < 0.0f)
+		t = -b + root;
+	return t >= 0.0f;
+}
+
+static bool IntersectRayCapsule(const Ray& ray, const VECTOR3D& p0, const VECTOR3D& p1, float radius, float& t)
+{
+	VECTOR3D axis = p1 - p0;
+	VECTOR3D oa = ray.origin - p0;
+	float axisLength2 = axis.DotProduct(axis);
+	float axisDir = axis.DotProduct(ray.direction);
+	float axisOrigin = axis.DotProduct(oa);
+
+	bool found = false;
+	t = FLT_MAX;
+
+	// side: distance to the axis line equals the radius, within the segment
+	float a = axisLength2 - axisDir * axisDir;
+	if (a > 1e-8f * axisLength2)
+	{
+		float b = axisLength2 * ray.direction.DotProduct(oa) - axisOrigin * axisDir;
+		float c = axisLength2 * oa.DotProduct(oa) - axisOrigin * axisOrigin - radius * radius * axisLength2;
+		float discriminant = b * b - a * c;
+		if (discriminant < 0.0f)
+			return false;
+
+		float root = sqrtf(discriminant);
+		float tSide = (-b - root) / a;
+		if (tSide < 0.0f)
+			tSide = (-b + root) / a;
+		float along = axisOrigin + tSide * axisDir;
+		if (tSide >= 0.0f && along > 0.0f && along < axisLength2)
+		{
+			t = tSide;
+			found = true;
+		}
+	}
+
+	// end caps
+	float tCap;
+	if (IntersectRaySphere(ray, p0, radius, tCap) && tCap < t)
+	{
+		t = tCap;
+		found = true;
+	}
+	if (IntersectRaySphere(ray, p1, radius, tCap) && tCap < t)
+	{
+		t = tCap;
+		found = true;
+	}
+	return found;
+}
+
+static bool IntersectRayOrientedBox(const Ray& ray, const Collider& box, float& t)
+{
+	// in the box's axes, where it is axis aligned about the origin
+	VECTOR3D offset = ray.origin - box.centre;
+	Ray local;
+	local.origin.Set(offset.DotProduct(box.axes[0]), offset.DotProduct(box.axes[1]), offset.DotProduct(box.axes[2]));
+	local.direction.Set(ray.direction.DotProduct(box.axes[0]), ray.direction.DotProduct(box.axes[1]),
+						ray.direction.DotProduct(box.axes[2]));
+
+	VECTOR3D boxMin = box.halfExtents * -1.0f;
+	return IntersectRayBox(local, boxMin, box.halfExtents, FLT_MAX, t);
+}
+
+bool IntersectRayCollider(const Ray& ray, const Collider& collider, float& t)
+{
+	switch (collider.type)
+	{
+	case COLLIDER_SPHERE:
+		return IntersectRaySphere(ray, collider.centre, collider.radius, t);
+	case COLLIDER_CAPSULE:
+		return IntersectRayCapsule(ray, collider.p0, collider.p1, collider.radius, t);
+	case COLLIDER_BOX:
+		return IntersectRayOrientedBox(ray, collider, t);
+	}
+	return false;
+}
+
+// Two sided ray/triangle test (Moller-Trumbore)
+static bool IntersectRayTriangle(const Ray& ray, const VECTOR3D& v0, const VECTOR3D& v1, const VECTOR3D& v2, float& t)
+{
+	VECTOR3D edge1 = v1 - v0;
+	VECTOR3D edge2 = v2 - v0;
+	VECTOR3D p = ray.direction.CrossProduct(edge2);
+	float determinant = edge1.DotProduct(p);
+	if (fabsf(determinant) < 1e-12f)
+		return false;
+
+	float inverse = 1.0f / determinant;
+	VECTOR3D s = ray.origin - v0;
+	float u = s.DotProduct(p) * inverse;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	VECTOR3D q = s.CrossProduct(edge1);
+	float v = ray.direction.DotProduct(q) * inverse;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	t = edge2.DotProduct(q) * inverse;
+	return t >= 0.0f;
+}
+
+
+PickGround::PickGround()
+{
+	size = 0;
+	x0 = z0 = 0.0f;
+	dx = dz = 1.0f;
+}
+
+void PickGround::Set(const QuadMesh& mesh, const VECTOR3D& offset)
+{
+	size = mesh.GetMeshSize();
+	heights.resize((size_t)(size + 1) * (size + 1));
+	minHeights.clear();
+	maxHeights.clear();
+	levelSizes.clear();
+	if (size <= 0)
+		return;
+
+	VECTOR3D origin = mesh.GetVertex(0, 0).position;
+	x0 = origin.x + offset.x;
+	z0 = origin.z + offset.z;
+	dx = mesh.GetVertex(0, 1).position.x - origin.x;
+	dz = mesh.GetVertex(1, 0).position.z - origin.z;
+
+	for (int row = 0; row <= size; row++)
+	{
+		for (int col = 0; col <= size; col++)
+			heights[row * (size + 1) + col] = mesh.GetVertex(row, col).position.y + offset.y;
+	}
+
+	// level 0, the corners of each cell
+	levelSizes.push_back(size);
+	minHeights.push_back(std::vector<float>((size_t)size * size));
+	maxHeights.push_back(std::vector<float>((size_t)size * size));
+	for (int row = 0; row < size; row++)
+	{
+		for (int col = 0; col < size; col++)
+		{
+			const float* h = &heights[row * (size + 1) + col];
+			minHeights[0][row * size + col] = std::min(std::min(h[0], h[1]), std::min(h[size + 1], h[size + 2]));
+			maxHeights[0][row * size + col] = std::max(std::max(h[0], h[1]), std::max(h[size + 1], h[size + 2]));
+		}
+	}
+
+	// each level up merges up to 2x2 nodes of the one below
+	while (levelSizes.back() > 1)
+	{
+		int below = (int)levelSizes.size() - 1;
+		int belowSize = levelSizes[below];
+		int levelSize = (belowSize + 1) / 2;
+		levelSizes.push_back(levelSize);
+		minHeights.push_back(std::vector<float>((size_t)levelSize * levelSize, FLT_MAX));
+		maxHeights.push_back(std::vector<float>((size_t)levelSize * levelSize, -FLT_MAX));
+
+		for (int row = 0; row < belowSize; row++)
+		{
+			for (int col = 0; col < belowSize; col++)
+			{
+				int node = (row / 2) * levelSize + col / 2;
+				minHeights[below + 1][node] = std::min(minHeights[below + 1][node], minHeights[below][row * belowSize + col]);
+				maxHeights[below + 1][node] = std::max(maxHeights[below + 1][node], maxHeights[below][row * belowSize + col]);
+			}
+		}
+	}
+}
+
+void PickGround::GetNodeBounds(int level, int row, int col, VECTOR3D& boxMin, VECTOR3D& boxMax) const
+{
+	int row0 = row << level, row1 = std::min((row + 1) << level, size);
+	int col0 = col << level, col1 = std::min((col + 1) << level, size);
+	float xa = x0 + col0 * dx, xb = x0 + col1 * dx;
+	float za = z0 + row0 * dz, zb = z0 + row1 * dz;
+	int node = row * levelSizes[level] + col;
+
+	boxMin.Set(std::min(xa, xb), minHeights[level][node], std::min(za, zb));
+	boxMax.Set(std::max(xa, xb), maxHeights[level][node], std::max(za, zb));
+}
+
+bool PickGround::IntersectCell(const Ray& ray, int row, int col, float& t) const
+{
+	// the two triangles the ground contacts use, q0 q1 q2 and q0 q2 q3
+	const float* h = &heights[row * (size + 1) + col];
+	float xa = x0 + col * dx, xb = xa + dx;
+	float za = z0 + row * dz, zb = za + dz;
+	VECTOR3D q0(xa, h[0], za), q1(xb, h[1], za), q2(xb, h[size + 2], zb), q3(xa, h[size + 1], zb);
+
+	bool found = false;
+	float tTriangle;
+	t = FLT_MAX;
+	if (IntersectRayTriangle(ray, q0, q1, q2, tTriangle) && tTriangle < t)
+	{
+		t = tTriangle;
+		found = true;
+	}
+	if (IntersectRayTriangle(ray, q0, q2, q3, tTriangle) && tTriangle < t)
+	{
+		t = tTriangle;
+		found = true;
+	}
+	return found;
+}
+
+bool PickGround::IntersectNode(const Ray& ray, int level, int row, int col, PickHit& hit) const
+{
+	if (level == 0)
+	{
+		float t;
+		if (!IntersectCell(ray, row, col, t) || t >= hit.t)
+			return false;
+		hit.t = t;
+		hit.point = ray.origin + ray.direction * t;
+		hit.robot = -1;
+		hit.part = -1;
+		return true;
+	}
+
+	// children nearest first, so the first hit prunes the rest
+	int childRows[4], childCols[4];
+	float childT[4];
+	int numChildren = 0;
+	int childSize = levelSizes[level - 1];
+	for (int r = row * 2; r < std::min(row * 2 + 2, childSize); r++)
+	{
+		for (int c = col * 2; c < std::min(col * 2 + 2, childSize); c++)
+		{
+			VECTOR3D boxMin, boxMax;
+			float t;
+			GetNodeBounds(level - 1, r, c, boxMin, boxMax);
+			if (!IntersectRayBox(ray, boxMin, boxMax, hit.t, t))
+				continue;
+
+			int i = numChildren++;
+			for (; i > 0 && childT[i - 1] > t; i--)
+			{
+				childRows[i] = childRows[i - 1];
+				childCols[i] = childCols[i - 1];
+				childT[i] = childT[i - 1];
+			}
+			childRows[i] = r;
+			childCols[i] = c;
+			childT[i] = t;
+		}
+	}
+
+	bool found = false;
+	for (int i = 0; i < numChildren; i++)
+	{
+		if (childT[i] >= hit.t)
+			break;
+		if (IntersectNode(ray, level - 1, childRows[i], childCols[i], hit))
+			found = true;
+	}
+	return found;
+}
+
+bool PickGround::Intersect(const Ray& ray, PickHit& hit) const
+{
+	if (size <= 0)
+		return false;
+
+	int top = (int)levelSizes.size() - 1;
+	VECTOR3D boxMin, boxMax;
+	float t;
+	GetNodeBounds(top, 0, 0, boxMin, boxMax);
+	if (!IntersectRayBox(ray, boxMin, boxMax, hit.t, t))
+		return false;
+	return IntersectNode(ray, top, 0, 0, hit);
+}
+
+bool PickGround::IntersectBruteForce(const Ray& ray, PickHit& hit) const
+{
+	bool found = false;
+	for (int row = 0; row < size; row++)
+	{
+		for (int col = 0; col < size; col++)
+		{
+			float t;
+			if (!IntersectCell(ray, row, col, t) || t >= hit.t)
+				continue;
+			hit.t = t;
+			hit.point = ray.origin + ray.direction * t;
+			hit.robot = -1;
+			hit.part = -1;
+			found = true;
+		}
+	}
+	return found;
+}
+
+
+void PickScene::Clear()
+{
+	robots.clear();
+	colliders.clear();
+	order.clear();
+	nodes.clear();
+}
+
+void PickScene::AddRobot(int robot, const MATRIX4X4* partMatrices, const VECTOR3D& offset)
+{
+	PickRobot entry;
+	entry.robot = robot;
+	entry.firstCollider = (int)colliders.size();
+
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		Collider collider;
+		MakePartCollider(robotParts[i].shape, partMatrices[i], collider);
+		collider.robot = robot;
+		collider.part = i;
+		collider.centre += offset;
+		collider.p0 += offset;
+		collider.p1 += offset;
+
+		// the part bounds are the cylinder's, the capsule's rounded ends reach past them
+		if (collider.type == COLLIDER_CAPSULE)
+		{
+			VECTOR3D radius(collider.radius, collider.radius, collider.radius);
+			collider.bounds.min.Set(std::min(collider.p0.x, collider.p1.x), std::min(collider.p0.y, collider.p1.y),
+									std::min(collider.p0.z, collider.p1.z));
+			collider.bounds.max.Set(std::max(collider.p0.x, collider.p1.x), std::max(collider.p0.y, collider.p1.y),
+									std::max(collider.p0.z, collider.p1.z));
+			collider.bounds.min -= radius;
+			collider.bounds.max += radius;
+		}
+		else
+		{
+			collider.bounds.min += offset;
+			collider.bounds.max += offset;
+		}
+
+		if (i == 0)
+			entry.bounds = collider.bounds;
+		else
+		{
+			BBox& bounds = entry.bounds;
+			bounds.min.Set(std::min(bounds.min.x, collider.bounds.min.x), std::min(bounds.min.y, collider.bounds.min.y),
+						   std::min(bounds.min.z, collider.bounds.min.z));
+			bounds.max.Set(std::max(bounds.max.x, collider.bounds.max.x), std::max(bounds.max.y, collider.bounds.max.y),
+						   std::max(bounds.max.z, collider.bounds.max.z));
+		}
+		colliders.push_back(collider);
+	}
+	robots.push_back(entry);
+}
+
+void PickScene::Build()
+{
+	order.resize(robots.size());
+	for (size_t i = 0; i < robots.size(); i++)
+		order[i] = (int)i;
+
+	nodes.clear();
+	if (robots.empty())
+		return;
+	nodes.reserve(2 * robots.size() / maxLeafRobots + 2);
+	nodes.push_back(Node());
+	BuildNode(0, 0, (int)robots.size());
+}
+
+void PickScene::BuildNode(int node, int begin, int end)
+{
+	BBox bounds = robots[order[begin]].bounds;
+	VECTOR3D centreMin = (bounds.min + bounds.max) * 0.5f, centreMax = centreMin;
+	for (int i = begin + 1; i < end; i++)
+	{
+		const BBox& box = robots[order[i]].bounds;
+		bounds.min.Set(std::min(bounds.min.x, box.min.x), std::min(bounds.min.y, box.min.y), std::min(bounds.min.z, box.min.z));
+		bounds.max.Set(std::max(bounds.max.x, box.max.x), std::max(bounds.max.y, box.max.y), std::max(bounds.max.z, box.max.z));
+
+		VECTOR3D centre = (box.min + box.max) * 0.5f;
+		centreMin.Set(std::min(centreMin.x, centre.x), std::min(centreMin.y, centre.y), std::min(centreMin.z, centre.z));
+		centreMax.Set(std::max(centreMax.x, centre.x), std::max(centreMax.y, centre.y), std::max(centreMax.z, centre.z));
+	}
+	nodes[node].bounds = bounds;
+
+	if (end - begin <= maxLeafRobots)
+	{
+		nodes[node].first = begin;
+		nodes[node].count = end - begin;
+		return;
+	}
+
+	// median split of the robot centres along the widest axis
+	VECTOR3D extent = centreMax - centreMin;
+	int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+	int middle = (begin + end) / 2;
+	std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+		[&](int a, int b)
+		{
+			const BBox& boxA = robots[a].bounds;
+			const BBox& boxB = robots[b].bounds;
+			if (axis == 0)
+				return boxA.min.x + boxA.max.x < boxB.min.x + boxB.max.x;
+			if (axis == 1)
+				return boxA.min.y + boxA.max.y < boxB.min.y + boxB.max.y;
+			return boxA.min.z + boxA.max.z < boxB.min.z + boxB.max.z;
+		});
+
+	int children = (int)nodes.size();
+	nodes[node].first = children;
+	nodes[node].count = 0;
+	nodes.push_back(Node());
+	nodes.push_back(Node());
+	BuildNode(children, begin, middle);
+	BuildNode(children + 1, middle, end);
+}
+
+bool PickScene::IntersectRobot(const Ray& ray, const PickRobot& robot, PickHit& hit) const
+{
+	float t;
+	if (!IntersectRayBox(ray, robot.bounds.min, robot.bounds.max, hit.t, t))
+		return false;
+
+	bool found = false;
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		const Collider& collider = colliders[robot.firstCollider + i];
+		if (!IntersectRayBox(ray, collider.bounds.min, collider.bounds.max, hit.t, t))
+			continue;
+		if (!IntersectRayCollider(ray, collider, t) || t >= hit.t)
+			continue;
+
+		hit.t = t;
+		hit.point = ray.origin + ray.direction * t;
+		hit.robot = robot.robot;
+		hit.part = i;
+		found = true;
+	}
+	return found;
+}
+
+bool PickScene::Intersect(const Ray& ray, PickHit& hit, const PickGround* ground) const
+{
+	hit.t = FLT_MAX;
+	hit.robot = -1;
+	hit.part = -1;
+
+	bool found = false;
+	int stack[64];
+	int stackSize = 0;
+	if (!nodes.empty())
+		stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		float t;
+		if (!IntersectRayBox(ray, node.bounds.min, node.bounds.max, hit.t, t))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				if (IntersectRobot(ray, robots[order[i]], hit))
+					found = true;
+			}
+			continue;
+		}
+
+		// nearer child on top of the stack
+		const Node& left = nodes[node.first];
+		const Node& right = nodes[node.first + 1];
+		float tLeft = FLT_MAX, tRight = FLT_MAX;
+		bool hitLeft = IntersectRayBox(ray, left.bounds.min, left.bounds.max, hit.t, tLeft);
+		bool hitRight = IntersectRayBox(ray, right.bounds.min, right.bounds.max, hit.t, tRight);
+		if (hitLeft && hitRight && tLeft < tRight)
+		{
+			stack[stackSize++] = node.first + 1;
+			stack[stackSize++] = node.first;
+		}
+		else
+		{
+			if (hitLeft)
+				stack[stackSize++] = node.first;
+			if (hitRight)
+				stack[stackSize++] = node.first + 1;
+		}
+	}
+
+	// the ground last, a robot in front of it cuts the ray short
+	if (ground && ground->Intersect(ray, hit))
+		found = true;
+	return found;
+}
+
+bool PickScene::IntersectBruteForce(const Ray& ray, PickHit& hit, const PickGround* ground) const
+{
+	hit.t = FLT_MAX;
+	hit.robot = -1;
+	hit.part = -1;
+
+	bool found = false;
+	for (size_t i = 0; i < robots.size(); i++)
+	{
+		if (IntersectRobot(ray, robots[i], hit))
+			found = true;
+	}
+	if (ground && ground->Intersect(ray, hit))
+		found = true;
+	return found;
+}
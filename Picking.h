@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Picking.h
+//	Ray casts from the cursor into the scene, for selecting robot parts with the mouse.
+//
+//	Parts are hit as the same colliders the contact detection uses: the body a sphere,
+//	the cylinder parts capsules and the cube parts oriented boxes. PickScene puts a
+//	bounding volume hierarchy over the robots' bounding boxes, so a ray only looks at the
+//	parts of robots it passes close to. PickGround is a quadtree of height ranges over a
+//	QuadMesh grid, a ray descends it nearest node first and only tests the triangles of
+//	the cells it reaches.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "Collision.h"
+
+class QuadMesh;
+
+struct Ray
+{
+	VECTOR3D origin;
+	VECTOR3D direction;		// unit length, so hit distances are in world units
+};
+
+struct PickHit
+{
+	float t;				// distance along the ray
+	VECTOR3D point;
+	int robot;				// -1 for the ground
+	int part;
+};
+
+// Ray from the eye through window position (x, y) of viewport, GL window coordinates
+// with y up from the bottom. projection is a symmetric perspective and view a rigid
+// transform, as the Camera and View classes make them.
+Ray GetPickRay(const MATRIX4X4& view, const MATRIX4X4& projection, const int viewport[4], float x, float y);
+
+// Slab test, the distance where the ray enters the box if it does before tMax
+bool IntersectRayBox(const Ray& ray, const VECTOR3D& boxMin, const VECTOR3D& boxMax, float tMax, float& t);
+
+// Nearest hit of the ray on the collider's surface in front of the origin
+bool IntersectRayCollider(const Ray& ray, const Collider& collider, float& t);
+
+class PickGround
+{
+private:
+	int size;				// quads per side
+	float x0, z0, dx, dz;	// world position of vertex (0, 0) and grid spacing
+	std::vector<float> heights;	// (size + 1) per row, world y
+
+	// Height range of the nodes of each level, level 0 is one node per cell and each level
+	// up halves the nodes per side, rounding up
+	std::vector<std::vector<float> > minHeights, maxHeights;
+	std::vector<int> levelSizes;
+
+private:
+	void GetNodeBounds(int level, int row, int col, VECTOR3D& boxMin, VECTOR3D& boxMax) const;
+	bool IntersectCell(const Ray& ray, int row, int col, float& t) const;
+	bool IntersectNode(const Ray& ray, int level, int row, int col, PickHit& hit) const;
+
+public:
+	PickGround();
+
+	// From the mesh's grid as laid out by InitMesh() along x and z, placed at offset
+	void Set(const QuadMesh& mesh, const VECTOR3D& offset);
+
+	// Nearest ground hit closer than hit.t, which is updated
+	bool Intersect(const Ray& ray, PickHit& hit) const;
+
+	// Every triangle of the grid, for checking Intersect()
+	bool IntersectBruteForce(const Ray& ray, PickHit& hit) const;
+};
+
+class PickScene
+{
+private:
+	struct PickRobot
+	{
+		int robot;
+		int firstCollider;		// NUM_ROBOT_PARTS colliders from here
+		BBox bounds;
+	};
+
+	// Node of the hierarchy: leaves hold count robots from first in order, inner nodes
+	// (count 0) have their children at first and first + 1
+	struct Node
+	{
+		BBox bounds;
+		int first;
+		int count;
+	};
+
+	std::vector<PickRobot> robots;
+	std::vector<Collider> colliders;	// world space, bounds padded to enclose capsule ends
+	std::vector<int> order;
+	std::vector<Node> nodes;
+
+private:
+	void BuildNode(int node, int begin, int end);
+	bool IntersectRobot(const Ray& ray, const PickRobot& robot, PickHit& hit) const;
+
+public:
+	void Clear();
+
+	// Colliders for the robot's parts, moved by offset
+	void AddRobot(int robot, const MATRIX4X4* partMatrices, const VECTOR3D& offset);
+
+	// Builds the hierarchy over the robots added since Clear()
+	void Build();
+
+	// Nearest hit on a robot or the ground, when given
+	bool Intersect(const Ray& ray, PickHit& hit, const PickGround* ground = NULL) const;
+
+	// Every robot's bounding box in turn instead of the hierarchy, for checking Intersect()
+	bool IntersectBruteForce(const Ray& ray, PickHit& hit, const PickGround* ground = NULL) const;
+
+	int GetNumRobots() const
+	{
+		return (int)robots.size();
+	}
+};
+
+#endif	//PICKING_H
@@ -1,264 +1,473 @@
-#include <windows.h>
-#include <gl/gl.h>
-#include <gl/glu.h>
-#include <gl/glut.h>
-#include <string.h>
-#include <math.h>
-#include <utility>
-#include <vector>
-#include "VECTOR3D.h"
-
-#include "QuadMesh.h"
-
-
-QuadMesh::QuadMesh(int maxMeshSize, float meshDim)
-{
-	minMeshSize = 1;
-	numVertices = 0;
-	vertices = NULL;
-	numQuads = 0;
-	quads = NULL;
-	numFacesDrawn = 0;
-
-	this->maxMeshSize = maxMeshSize < minMeshSize ? minMeshSize : maxMeshSize;
-	this->meshDim = meshDim;
-	CreateMemory();
-
-	// Setup the material and lights used for the mesh
-	mat_ambient[0] = 0.0;
-	mat_ambient[1] = 0.0;
-	mat_ambient[2] = 0.0;
-	mat_ambient[3] = 1.0;
-	mat_specular[0] = 0.0;
-	mat_specular[1] = 0.0;
-	mat_specular[2] = 0.0;
-	mat_specular[3] = 1.0;
-	mat_diffuse[0] = 0.9;
-	mat_diffuse[1] = 0.5;
-	mat_diffuse[2] = 0.0;
-	mat_diffuse[3] = 1.0;
-	mat_shininess[0] = 0.0;
-
-}
-
-void QuadMesh::SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess)
-{
-	mat_ambient[0] = ambient.x;
-	mat_ambient[1] = ambient.y;
-	mat_ambient[2] = ambient.z;
-	mat_ambient[3] = 1.0;
-	mat_specular[0] = specular.x;
-	mat_specular[1] = specular.y;
-	mat_specular[2] = specular.z;
-	mat_specular[3] = 1.0;
-	mat_diffuse[0] = diffuse.x;
-	mat_diffuse[1] = diffuse.y;
-	mat_diffuse[2] = diffuse.z;
-	mat_diffuse[3] = 1.0;
-	mat_shininess[0] = shininess;
-}
-
-bool QuadMesh::CreateMemory()
-{
-	vertices = new MeshVertex[(maxMeshSize + 1) * (maxMeshSize + 1)];
-	if (!vertices)
-	{
-		return false;
-	}
-
-	quads = new MeshQuad[maxMeshSize * maxMeshSize];
-	if (!quads)
-	{
-		return false;
-	}
-
-	return true;
-}
-
-
-
-bool QuadMesh::InitMesh(int meshSize, VECTOR3D origin, double meshLength, double meshWidth, VECTOR3D dir1, VECTOR3D dir2)
-{
-	VECTOR3D o;
-	int currentVertex = 0;
-	double sf1, sf2;
-
-	VECTOR3D v1, v2;
-
-	v1.x = dir1.x;
-	v1.y = dir1.y;
-	v1.z = dir1.z;
-
-	sf1 = meshLength / meshSize;
-	v1 *= sf1;
-
-	v2.x = dir2.x;
-	v2.y = dir2.y;
-	v2.z = dir2.z;
-	sf2 = meshWidth / meshSize;
-	v2 *= sf2;
-
-	VECTOR3D meshpt;
-
-	// VERTICES
-	numVertices = (meshSize + 1) * (meshSize + 1);
-
-	// Starts at front left corner of mesh 
-	o.Set(origin.x, origin.y, origin.z);
-
-	for (int i = 0; i < meshSize + 1; i++)
-	{
-		for (int j = 0; j < meshSize + 1; j++)
-		{
-			// compute vertex position along mesh row (along x direction)
-			meshpt.x = o.x + j * v1.x;
-			meshpt.y = o.y + j * v1.y;
-			meshpt.z = o.z + j * v1.z;
-
-			vertices[currentVertex].position.Set(meshpt.x, meshpt.y, meshpt.z);
-			currentVertex++;
-		}
-		// go to next row in mesh (negative z direction)
-		o += v2;
-	}
-
-	// Build Quad Polygons
-	numQuads = (meshSize) * (meshSize);
-	int currentQuad = 0;
-
-	for (int j = 0; j < meshSize; j++)
-	{
-		for (int k = 0; k < meshSize; k++)
-		{
-			// Counterclockwise order
-			quads[currentQuad].vertices[0] = &vertices[j * (meshSize + 1) + k];
-			quads[currentQuad].vertices[1] = &vertices[j * (meshSize + 1) + k + 1];
-			quads[currentQuad].vertices[2] = &vertices[(j + 1) * (meshSize + 1) + k + 1];
-			quads[currentQuad].vertices[3] = &vertices[(j + 1) * (meshSize + 1) + k];
-			currentQuad++;
-		}
-	}
-
-	this->ComputeNormals();
-
-	return true;
-}
-
-void QuadMesh::DrawMesh(int meshSize)
-{
-	int currentQuad = 0;
-
-	glMaterialfv(GL_FRONT, GL_AMBIENT, mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
-
-	for (int j = 0; j < meshSize; j++)
-	{
-		for (int k = 0; k < meshSize; k++)
-		{
-			glBegin(GL_QUADS);
-
-			glNormal3f(quads[currentQuad].vertices[0]->normal.x,
-				quads[currentQuad].vertices[0]->normal.y,
-				quads[currentQuad].vertices[0]->normal.z);
-			glVertex3f(quads[currentQuad].vertices[0]->position.x,
-				quads[currentQuad].vertices[0]->position.y,
-				quads[currentQuad].vertices[0]->position.z);
-
-			glNormal3f(quads[currentQuad].vertices[1]->normal.x,
-				quads[currentQuad].vertices[1]->normal.y,
-				quads[currentQuad].vertices[1]->normal.z);
-
-			glVertex3f(quads[currentQuad].vertices[1]->position.x,
-				quads[currentQuad].vertices[1]->position.y,
-				quads[currentQuad].vertices[1]->position.z);
-
-			glNormal3f(quads[currentQuad].vertices[2]->normal.x,
-				quads[currentQuad].vertices[2]->normal.y,
-				quads[currentQuad].vertices[2]->normal.z);
-
-			glVertex3f(quads[currentQuad].vertices[2]->position.x,
-				quads[currentQuad].vertices[2]->position.y,
-				quads[currentQuad].vertices[2]->position.z);
-
-			glNormal3f(quads[currentQuad].vertices[3]->normal.x,
-				quads[currentQuad].vertices[3]->normal.y,
-				quads[currentQuad].vertices[3]->normal.z);
-
-			glVertex3f(quads[currentQuad].vertices[3]->position.x,
-				quads[currentQuad].vertices[3]->position.y,
-				quads[currentQuad].vertices[3]->position.z);
-			glEnd();
-			currentQuad++;
-		}
-	}
-}
-
-
-
-
-
-
-
-void QuadMesh::FreeMemory()
-{
-	if (vertices)
-		delete[] vertices;
-	vertices = NULL;
-	numVertices = 0;
-
-	if (quads)
-		delete[] quads;
-	quads = NULL;
-	numQuads = 0;
-}
-
-void QuadMesh::ComputeNormals()
-{
-	int currentQuad = 0;
-
-	for (int j = 0; j < this->maxMeshSize; j++)
-	{
-		for (int k = 0; k < this->maxMeshSize; k++)
-		{
-			VECTOR3D n0, n1, n2, n3, e0, e1, e2, e3, ne0, ne1, ne2, ne3;
-
-			quads[currentQuad].vertices[0]->normal.LoadZero();
-			quads[currentQuad].vertices[1]->normal.LoadZero();
-			quads[currentQuad].vertices[2]->normal.LoadZero();
-			quads[currentQuad].vertices[3]->normal.LoadZero();
-			e0 = quads[currentQuad].vertices[1]->position - quads[currentQuad].vertices[0]->position;
-			e1 = quads[currentQuad].vertices[2]->position - quads[currentQuad].vertices[1]->position;
-			e2 = quads[currentQuad].vertices[3]->position - quads[currentQuad].vertices[2]->position;
-			e3 = quads[currentQuad].vertices[0]->position - quads[currentQuad].vertices[3]->position;
-			e0.Normalize();
-			e1.Normalize();
-			e2.Normalize();
-			e3.Normalize();
-
-			n0 = e0.CrossProduct(-e3);
-			n0.Normalize();
-			quads[currentQuad].vertices[0]->normal += n0;
-
-			n1 = e1.CrossProduct(-e0);
-			n1.Normalize();
-			quads[currentQuad].vertices[1]->normal += n1;
-
-			n2 = e2.CrossProduct(-e1);
-			n2.Normalize();
-			quads[currentQuad].vertices[2]->normal += n2;
-
-			n3 = e3.CrossProduct(-e2);
-			n3.Normalize();
-			quads[currentQuad].vertices[3]->normal += n3;
-
-			quads[currentQuad].vertices[0]->normal.Normalize();
-			quads[currentQuad].vertices[1]->normal.Normalize();
-			quads[currentQuad].vertices[2]->normal.Normalize();
-			quads[currentQuad].vertices[3]->normal.Normalize();
-
-			currentQuad++;
-		}
-	}
-}
+#include <windows.h>
+#include <gl/gl.h>
+#include <gl/glu.h>
+#include <gl/glut.h>
+#include <string.h>
+#include <math.h>
+#include <utility>
+#include <vector>
+#include <functional>
+#include <new>
+#include "VECTOR3D.h"
+#include "Heightfield.h"
+#include "JobSystem.h"
+#include "Allocators.h"
+
+#include "QuadMesh.h"
+
+
+// Runs rows(begin, end) over [0, numRows), in parallel chunks of rows when jobs is given
+static void RunRows(int numRows, JobSystem* jobs, const std::function<void(int, int)>& rows)
+{
+	if (jobs)
+		jobs->ParallelFor(numRows, 16, rows);
+	else
+		rows(0, numRows);
+}
+
+QuadMesh::QuadMesh(int maxMeshSize, float meshDim, PoolAllocator* pool)
+{
+	minMeshSize = 1;
+	numVertices = 0;
+	vertices = NULL;
+	numQuads = 0;
+	quads = NULL;
+	numFacesDrawn = 0;
+	meshSize = 0;
+	this->pool = pool;
+	storage = NULL;
+
+	this->maxMeshSize = maxMeshSize < minMeshSize ? minMeshSize : maxMeshSize;
+	this->meshDim = meshDim;
+	CreateMemory();
+
+	// Setup the material and lights used for the mesh
+	mat_ambient[0] = 0.0;
+	mat_ambient[1] = 0.0;
+	mat_ambient[2] = 0.0;
+	mat_ambient[3] = 1.0;
+	mat_specular[0] = 0.0;
+	mat_specular[1] = 0.0;
+	mat_specular[2] = 0.0;
+	mat_specular[3] = 1.0;
+	mat_diffuse[0] = 0.9;
+	mat_diffuse[1] = 0.5;
+	mat_diffuse[2] = 0.0;
+	mat_diffuse[3] = 1.0;
+	mat_shininess[0] = 0.0;
+
+}
+
+void QuadMesh::SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess)
+{
+	mat_ambient[0] = ambient.x;
+	mat_ambient[1] = ambient.y;
+	mat_ambient[2] = ambient.z;
+	mat_ambient[3] = 1.0;
+	mat_specular[0] = specular.x;
+	mat_specular[1] = specular.y;
+	mat_specular[2] = specular.z;
+	mat_specular[3] = 1.0;
+	mat_diffuse[0] = diffuse.x;
+	mat_diffuse[1] = diffuse.y;
+	mat_diffuse[2] = diffuse.z;
+	mat_diffuse[3] = 1.0;
+	mat_shininess[0] = shininess;
+}
+
+// Quads follow the vertices, rounded up so they stay aligned
+static size_t GetVerticesSize(int maxMeshSize)
+{
+	size_t size = sizeof(MeshVertex) * (maxMeshSize + 1) * (maxMeshSize + 1);
+	return (size + 15) & ~(size_t)15;
+}
+
+size_t QuadMesh::GetStorageSize(int maxMeshSize)
+{
+	return GetVerticesSize(maxMeshSize) + sizeof(MeshQuad) * maxMeshSize * maxMeshSize;
+}
+
+bool QuadMesh::CreateMemory()
+{
+	size_t size = GetStorageSize(maxMeshSize);
+	if (pool && pool->GetBlockSize() >= size)
+		storage = pool->Allocate();
+	else
+	{
+		pool = NULL;
+		storage = ::operator new(size, std::nothrow);
+	}
+	if (!storage)
+	{
+		return false;
+	}
+
+	vertices = (MeshVertex*)storage;
+	for (int i = 0; i < (maxMeshSize + 1) * (maxMeshSize + 1); i++)
+		new (&vertices[i]) MeshVertex();
+
+	quads = (MeshQuad*)((char*)storage + GetVerticesSize(maxMeshSize));
+
+	return true;
+}
+
+
+
+bool QuadMesh::InitMesh(int meshSize, VECTOR3D origin, double meshLength, double meshWidth, VECTOR3D dir1, VECTOR3D dir2,
+						const Heightfield* heightfield, JobSystem* jobs)
+{
+	double sf1, sf2;
+
+	if (!storage || meshSize < minMeshSize || meshSize > maxMeshSize)
+		return false;
+
+	VECTOR3D v1, v2;
+
+	v1.x = dir1.x;
+	v1.y = dir1.y;
+	v1.z = dir1.z;
+
+	sf1 = meshLength / meshSize;
+	v1 *= sf1;
+
+	v2.x = dir2.x;
+	v2.y = dir2.y;
+	v2.z = dir2.z;
+	sf2 = meshWidth / meshSize;
+	v2 *= sf2;
+
+	this->meshSize = meshSize;
+	meshOrigin = origin;
+	meshStep1 = v1;
+	meshStep2 = v2;
+
+	// VERTICES
+	numVertices = (meshSize + 1) * (meshSize + 1);
+
+	// Heights displace vertices along the side of the mesh the normals face
+	VECTOR3D up = dir1.CrossProduct(dir2);
+	up.Normalize();
+
+	// Rows are independent, so they are filled in parallel when a job system is given
+	auto buildRows = [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			// Starts at front left corner of mesh, row i is i steps along dir2 (negative z direction)
+			VECTOR3D o = origin + v2 * (float)i;
+			MeshVertex* row = &vertices[i * (meshSize + 1)];
+			float v = (float)i / meshSize;
+
+			for (int j = 0; j < meshSize + 1; j++)
+			{
+				// compute vertex position along mesh row (along x direction)
+				row[j].position.Set(o.x + j * v1.x, o.y + j * v1.y, o.z + j * v1.z);
+			}
+
+			if (heightfield)
+			{
+				for (int j = 0; j < meshSize + 1; j++)
+					row[j].position += up * heightfield->Sample((float)j / meshSize, v);
+			}
+		}
+	};
+	RunRows(meshSize + 1, jobs, buildRows);
+
+	// Build Quad Polygons
+	numQuads = (meshSize) * (meshSize);
+	int currentQuad = 0;
+
+	for (int j = 0; j < meshSize; j++)
+	{
+		for (int k = 0; k < meshSize; k++)
+		{
+			// Counterclockwise order
+			quads[currentQuad].vertices[0] = &vertices[j * (meshSize + 1) + k];
+			quads[currentQuad].vertices[1] = &vertices[j * (meshSize + 1) + k + 1];
+			quads[currentQuad].vertices[2] = &vertices[(j + 1) * (meshSize + 1) + k + 1];
+			quads[currentQuad].vertices[3] = &vertices[(j + 1) * (meshSize + 1) + k];
+			currentQuad++;
+		}
+	}
+
+	if (heightfield)
+		ComputeHeightfieldNormals(dir1, dir2, (float)sf1, (float)sf2, jobs);
+	else
+		this->ComputeNormals();
+
+	return true;
+}
+
+// Normals straight from the height gradient at each vertex (central differences, one-sided at
+// the border), n = up - dh/du * u - dh/dv * v with u, v the unit grid directions
+void QuadMesh::ComputeHeightfieldNormals(VECTOR3D dir1, VECTOR3D dir2, float spacing1, float spacing2, JobSystem* jobs)
+{
+	VECTOR3D u = dir1, v = dir2;
+	u.Normalize();
+	v.Normalize();
+	VECTOR3D up = u.CrossProduct(v);
+	up.Normalize();
+
+	const int stride = meshSize + 1;
+
+	auto normalRows = [&](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			int below = i > 0 ? i - 1 : i;
+			int above = i < meshSize ? i + 1 : i;
+			float invRowSpan = 1.0f / ((above - below) * spacing2);
+
+			for (int j = 0; j < stride; j++)
+			{
+				int left = j > 0 ? j - 1 : j;
+				int right = j < meshSize ? j + 1 : j;
+
+				float dhdu = (vertices[i * stride + right].position.DotProduct(up) -
+							  vertices[i * stride + left].position.DotProduct(up)) / ((right - left) * spacing1);
+				float dhdv = (vertices[above * stride + j].position.DotProduct(up) -
+							  vertices[below * stride + j].position.DotProduct(up)) * invRowSpan;
+
+				VECTOR3D n = up - u * dhdu - v * dhdv;
+				n.Normalize();
+				vertices[i * stride + j].normal = n;
+			}
+		}
+	};
+	RunRows(stride, jobs, normalRows);
+}
+
+bool QuadMesh::InitPatch(const Heightfield& heightfield, int col0, int row0, int meshSize, int step, VECTOR3D origin, float spacing)
+{
+	if (!storage || meshSize < minMeshSize || meshSize > maxMeshSize)
+		return false;
+
+	this->meshSize = meshSize;
+	meshOrigin = origin + VECTOR3D(col0 * spacing, 0.0f, -row0 * spacing);
+	meshStep1 = VECTOR3D(step * spacing, 0.0f, 0.0f);
+	meshStep2 = VECTOR3D(0.0f, 0.0f, -step * spacing);
+	numVertices = (meshSize + 1) * (meshSize + 1);
+
+	const int lastCol = heightfield.GetWidth() - 1;
+	const int lastRow = heightfield.GetHeight() - 1;
+	for (int i = 0; i < meshSize + 1; i++)
+	{
+		int row = row0 + i * step;
+		int below = row - step < 0 ? 0 : row - step;
+		int above = row + step > lastRow ? lastRow : row + step;
+		MeshVertex* vertex = &vertices[i * (meshSize + 1)];
+
+		for (int j = 0; j < meshSize + 1; j++, vertex++)
+		{
+			int col = col0 + j * step;
+			int left = col - step < 0 ? 0 : col - step;
+			int right = col + step > lastCol ? lastCol : col + step;
+
+			vertex->position = meshOrigin + meshStep1 * (float)j + meshStep2 * (float)i;
+			vertex->position.y += heightfield.Get(col, row);
+
+			// rows run along -z, so the z slope is the negated row slope
+			float dhdx = (heightfield.Get(right, row) - heightfield.Get(left, row)) / ((right - left) * spacing);
+			float dhdz = -(heightfield.Get(col, above) - heightfield.Get(col, below)) / ((above - below) * spacing);
+			vertex->normal.Set(-dhdx, 1.0f, -dhdz);
+			vertex->normal.Normalize();
+		}
+	}
+
+	numQuads = meshSize * meshSize;
+	int currentQuad = 0;
+	for (int j = 0; j < meshSize; j++)
+	{
+		for (int k = 0; k < meshSize; k++)
+		{
+			quads[currentQuad].vertices[0] = &vertices[j * (meshSize + 1) + k];
+			quads[currentQuad].vertices[1] = &vertices[j * (meshSize + 1) + k + 1];
+			quads[currentQuad].vertices[2] = &vertices[(j + 1) * (meshSize + 1) + k + 1];
+			quads[currentQuad].vertices[3] = &vertices[(j + 1) * (meshSize + 1) + k];
+			currentQuad++;
+		}
+	}
+	return true;
+}
+
+void QuadMesh::ApplyMaterial()
+{
+	glMaterialfv(GL_FRONT, GL_AMBIENT, mat_ambient);
+	glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
+	glMaterialfv(GL_FRONT, GL_DIFFUSE, mat_diffuse);
+	glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
+}
+
+void QuadMesh::DrawMesh(int meshSize)
+{
+	int currentQuad = 0;
+
+	ApplyMaterial();
+
+	glBegin(GL_QUADS);
+	for (int j = 0; j < meshSize; j++)
+	{
+		for (int k = 0; k < meshSize; k++)
+		{
+			glNormal3f(quads[currentQuad].vertices[0]->normal.x,
+				quads[currentQuad].vertices[0]->normal.y,
+				quads[currentQuad].vertices[0]->normal.z);
+			glVertex3f(quads[currentQuad].vertices[0]->position.x,
+				quads[currentQuad].vertices[0]->position.y,
+				quads[currentQuad].vertices[0]->position.z);
+
+			glNormal3f(quads[currentQuad].vertices[1]->normal.x,
+				quads[currentQuad].vertices[1]->normal.y,
+				quads[currentQuad].vertices[1]->normal.z);
+
+			glVertex3f(quads[currentQuad].vertices[1]->position.x,
+				quads[currentQuad].vertices[1]->position.y,
+				quads[currentQuad].vertices[1]->position.z);
+
+			glNormal3f(quads[currentQuad].vertices[2]->normal.x,
+				quads[currentQuad].vertices[2]->normal.y,
+				quads[currentQuad].vertices[2]->normal.z);
+
+			glVertex3f(quads[currentQuad].vertices[2]->position.x,
+				quads[currentQuad].vertices[2]->position.y,
+				quads[currentQuad].vertices[2]->position.z);
+
+			glNormal3f(quads[currentQuad].vertices[3]->normal.x,
+				quads[currentQuad].vertices[3]->normal.y,
+				quads[currentQuad].vertices[3]->normal.z);
+
+			glVertex3f(quads[currentQuad].vertices[3]->position.x,
+				quads[currentQuad].vertices[3]->position.y,
+				quads[currentQuad].vertices[3]->position.z);
+			currentQuad++;
+		}
+	}
+	glEnd();
+}
+
+void QuadMesh::DrawSkirts(float depth)
+{
+	if (meshSize <= 0)
+		return;
+
+	VECTOR3D down = meshStep2.CrossProduct(meshStep1);
+	down.Normalize();
+	down *= depth;
+
+	// Border vertices walked in order: bottom row, right column, top row, left column
+	const int stride = meshSize + 1;
+	const int starts[4] = { 0, meshSize, meshSize * stride + meshSize, meshSize * stride };
+	const int steps[4] = { 1, stride, -1, -stride };
+
+	for (int side = 0; side < 4; side++)
+	{
+		glBegin(GL_QUAD_STRIP);
+		for (int i = 0, v = starts[side]; i <= meshSize; i++, v += steps[side])
+		{
+			const MeshVertex& vertex = vertices[v];
+			VECTOR3D bottom = vertex.position + down;
+			glNormal3f(vertex.normal.x, vertex.normal.y, vertex.normal.z);
+			glVertex3f(vertex.position.x, vertex.position.y, vertex.position.z);
+			glVertex3f(bottom.x, bottom.y, bottom.z);
+		}
+		glEnd();
+	}
+}
+
+bool QuadMesh::GetQuadRange(const VECTOR3D& boxMin, const VECTOR3D& boxMax, int& row0, int& row1, int& col0, int& col1) const
+{
+	if (meshSize <= 0)
+		return false;
+
+	// Project the box corners onto the two grid directions, in units of cells
+	float len1 = meshStep1.GetQuaddLength();
+	float len2 = meshStep2.GetQuaddLength();
+	float minCol = 1e30f, maxCol = -1e30f, minRow = 1e30f, maxRow = -1e30f;
+	for (int i = 0; i < 8; i++)
+	{
+		VECTOR3D corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+		VECTOR3D d = corner - meshOrigin;
+		float col = d.DotProduct(meshStep1) / len1;
+		float row = d.DotProduct(meshStep2) / len2;
+		if (col < minCol) minCol = col;
+		if (col > maxCol) maxCol = col;
+		if (row < minRow) minRow = row;
+		if (row > maxRow) maxRow = row;
+	}
+
+	col0 = (int)floor(minCol);
+	col1 = (int)floor(maxCol);
+	row0 = (int)floor(minRow);
+	row1 = (int)floor(maxRow);
+	if (col1 < 0 || row1 < 0 || col0 >= meshSize || row0 >= meshSize)
+		return false;
+
+	if (col0 < 0) col0 = 0;
+	if (row0 < 0) row0 = 0;
+	if (col1 >= meshSize) col1 = meshSize - 1;
+	if (row1 >= meshSize) row1 = meshSize - 1;
+	return true;
+}
+
+void QuadMesh::FreeMemory()
+{
+	if (pool)
+		pool->Free(storage);
+	else
+		::operator delete(storage);
+	storage = NULL;
+
+	vertices = NULL;
+	numVertices = 0;
+	quads = NULL;
+	numQuads = 0;
+}
+
+void QuadMesh::ComputeNormals()
+{
+	int currentQuad = 0;
+
+	for (int j = 0; j < this->meshSize; j++)
+	{
+		for (int k = 0; k < this->meshSize; k++)
+		{
+			VECTOR3D n0, n1, n2, n3, e0, e1, e2, e3, ne0, ne1, ne2, ne3;
+
+			quads[currentQuad].vertices[0]->normal.LoadZero();
+			quads[currentQuad].vertices[1]->normal.LoadZero();
+			quads[currentQuad].vertices[2]->normal.LoadZero();
+			quads[currentQuad].vertices[3]->normal.LoadZero();
+			e0 = quads[currentQuad].vertices[1]->position - quads[currentQuad].vertices[0]->position;
+			e1 = quads[currentQuad].vertices[2]->position - quads[currentQuad].vertices[1]->position;
+			e2 = quads[currentQuad].vertices[3]->position - quads[currentQuad].vertices[2]->position;
+			e3 = quads[currentQuad].vertices[0]->position - quads[currentQuad].vertices[3]->position;
+			e0.Normalize();
+			e1.Normalize();
+			e2.Normalize();
+			e3.Normalize();
+
+			n0 = e0.CrossProduct(-e3);
+			n0.Normalize();
+			quads[currentQuad].vertices[0]->normal += n0;
+
+			n1 = e1.CrossProduct(-e0);
+			n1.Normalize();
+			quads[currentQuad].vertices[1]->normal += n1;
+
+			n2 = e2.CrossProduct(-e1);
+			n2.Normalize();
+			quads[currentQuad].vertices[2]->normal += n2;
+
+			n3 = e3.CrossProduct(-e2);
+			n3.Normalize();
+			quads[currentQuad].vertices[3]->normal += n3;
+
+			quads[currentQuad].vertices[0]->normal.Normalize();
+			quads[currentQuad].vertices[1]->normal.Normalize();
+			quads[currentQuad].vertices[2]->normal.Normalize();
+			quads[currentQuad].vertices[3]->normal.Normalize();
+
+			currentQuad++;
+		}
+	}
+}
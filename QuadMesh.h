@@ -1,65 +1,110 @@
-struct MeshVertex
-{
-	VECTOR3D	position;
-	VECTOR3D    normal;
-};
-
-
-
-struct MeshQuad
-{
-	// pointers to vertices of each quad
-	MeshVertex* vertices[4];
-};
-
-class QuadMesh
-{
-private:
-
-	int maxMeshSize;
-	int minMeshSize;
-	float meshDim;
-
-	int numVertices;
-	MeshVertex* vertices;
-
-	int numQuads;
-	MeshQuad* quads;
-
-	int numFacesDrawn;
-
-	GLfloat mat_ambient[4];
-	GLfloat mat_specular[4];
-	GLfloat mat_diffuse[4];
-	GLfloat mat_shininess[1];
-
-
-private:
-	bool CreateMemory();
-	void FreeMemory();
-
-public:
-
-	typedef std::pair<int, int> MaxMeshDim;
-
-	QuadMesh(int maxMeshSize = 40, float meshDim = 1.0f);
-
-	~QuadMesh()
-	{
-		FreeMemory();
-	}
-
-	MaxMeshDim GetMaxMeshDimentions()
-	{
-		return MaxMeshDim(minMeshSize, maxMeshSize);
-	}
-
-	bool InitMesh(int meshSize, VECTOR3D origin, double meshLength, double meshWidth, VECTOR3D dir1, VECTOR3D dir2);
-	void DrawMesh(int meshSize);
-	void UpdateMesh();
-	void SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess);
-	void ComputeNormals();
-
-
-};
-
+class Heightfield;
+class JobSystem;
+class PoolAllocator;
+
+struct MeshVertex
+{
+	VECTOR3D	position;
+	VECTOR3D    normal;
+};
+
+
+
+struct MeshQuad
+{
+	// pointers to vertices of each quad
+	MeshVertex* vertices[4];
+};
+
+class QuadMesh
+{
+private:
+
+	int maxMeshSize;
+	int minMeshSize;
+	float meshDim;
+
+	int numVertices;
+	MeshVertex* vertices;
+
+	int numQuads;
+	MeshQuad* quads;
+
+	// vertices and quads share one allocation, from the pool when one is given
+	PoolAllocator* pool;
+	void* storage;
+
+	int numFacesDrawn;
+
+	// Grid layout from the last InitMesh(), vertex (row, col) = origin + col * step1 + row * step2
+	int meshSize;
+	VECTOR3D meshOrigin;
+	VECTOR3D meshStep1;
+	VECTOR3D meshStep2;
+
+	GLfloat mat_ambient[4];
+	GLfloat mat_specular[4];
+	GLfloat mat_diffuse[4];
+	GLfloat mat_shininess[1];
+
+
+private:
+	bool CreateMemory();
+	void FreeMemory();
+	void ComputeHeightfieldNormals(VECTOR3D dir1, VECTOR3D dir2, float spacing1, float spacing2, JobSystem* jobs);
+
+public:
+
+	typedef std::pair<int, int> MaxMeshDim;
+
+	// Storage comes from pool when given, which must have blocks of at least
+	// GetStorageSize(maxMeshSize) bytes
+	QuadMesh(int maxMeshSize = 40, float meshDim = 1.0f, PoolAllocator* pool = NULL);
+
+	static size_t GetStorageSize(int maxMeshSize);
+
+	~QuadMesh()
+	{
+		FreeMemory();
+	}
+
+	MaxMeshDim GetMaxMeshDimentions()
+	{
+		return MaxMeshDim(minMeshSize, maxMeshSize);
+	}
+
+	// Flat grid along dir1/dir2, or displaced by heightfield (sampled across the whole grid)
+	// when given, with normals taken from the height gradient. Rows are built in parallel
+	// when jobs is given.
+	bool InitMesh(int meshSize, VECTOR3D origin, double meshLength, double meshWidth, VECTOR3D dir1, VECTOR3D dir2,
+				  const Heightfield* heightfield = NULL, JobSystem* jobs = NULL);
+	// Terrain patch of meshSize x meshSize quads over the heightfield grid points
+	// (col0 + j * step, row0 + i * step), laid out along +x and -z from origin with
+	// spacing between neighbouring grid points. Normals come from the height differences
+	// across step.
+	bool InitPatch(const Heightfield& heightfield, int col0, int row0, int meshSize, int step, VECTOR3D origin, float spacing);
+	void DrawMesh(int meshSize);
+	// Sets the mesh material, for drawing its vertices some other way
+	void ApplyMaterial();
+	// Walls hanging depth below the mesh border, hiding cracks against coarser neighbours
+	void DrawSkirts(float depth);
+	void UpdateMesh();
+	void SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess);
+	void ComputeNormals();
+
+	int GetMeshSize() const
+	{
+		return meshSize;
+	}
+
+	// Vertices are stored row by row, (meshSize + 1) per row
+	const MeshVertex& GetVertex(int row, int col) const
+	{
+		return vertices[row * (meshSize + 1) + col];
+	}
+
+	// Range of quads whose cells overlap the box projected onto the mesh plane, false if none
+	bool GetQuadRange(const VECTOR3D& boxMin, const VECTOR3D& boxMax, int& row0, int& row1, int& col0, int& col1) const;
+
+};
+
@@ -0,0 +1,63 @@
+#include <string.h>
+#include <vector>
+
+#include "RedrawScheduler.h"
+
+
+RedrawScheduler::RedrawScheduler(double minFrameInterval)
+{
+	this->minFrameInterval = minFrameInterval;
+	lastFrameTime = -1e30;
+	pending = false;
+	forced = true;		// nothing has been drawn yet
+	numRequests = 0;
+	numFrames = 0;
+}
+
+void RedrawScheduler::Track(const void* data, size_t size)
+{
+	TrackedState state = { data, size };
+	states.push_back(state);
+
+	// the new block counts as changed until the next frame
+	drawnState.resize(drawnState.size() + size);
+	forced = true;
+}
+
+bool RedrawScheduler::HasChanged() const
+{
+	size_t offset = 0;
+	for (size_t i = 0; i < states.size(); i++)
+	{
+		if (memcmp(states[i].data, &drawnState[offset], states[i].size) != 0)
+			return true;
+		offset += states[i].size;
+	}
+	return false;
+}
+
+double RedrawScheduler::Request(double now)
+{
+	numRequests++;
+	if (pending || (!forced && !HasChanged()))
+		return -1.0;
+
+	pending = true;
+	double delay = lastFrameTime + minFrameInterval - now;
+	return delay > 0.0 ? delay : 0.0;
+}
+
+void RedrawScheduler::FrameDrawn(double now)
+{
+	size_t offset = 0;
+	for (size_t i = 0; i < states.size(); i++)
+	{
+		memcpy(&drawnState[offset], states[i].data, states[i].size);
+		offset += states[i].size;
+	}
+
+	lastFrameTime = now;
+	pending = false;
+	forced = false;
+	numFrames++;
+}
@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	RedrawScheduler.h
+//	Decides when a redisplay is worth posting. The scene state that affects a frame is
+//	registered with Track(); FrameDrawn() keeps a copy of it, and Request() only asks for a
+//	redisplay when some of it differs from that copy. Requests made while a redisplay is
+//	already on its way are folded into it, and frames are spaced at least one refresh
+//	interval apart, so input and animation ticks arriving faster than the display give
+//	one frame per refresh showing the latest state.
+//
+//	It makes no GLUT calls, the caller posts the redisplay (or a timer for a delayed one)
+//	and passes the time in, so the policy can be run headlessly.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef REDRAWSCHEDULER_H
+#define REDRAWSCHEDULER_H
+
+#include <vector>
+
+class RedrawScheduler
+{
+private:
+	struct TrackedState
+	{
+		const void* data;
+		size_t size;
+	};
+
+	std::vector<TrackedState> states;
+	std::vector<unsigned char> drawnState;	// every tracked block as of the last frame
+
+	double minFrameInterval;
+	double lastFrameTime;
+	bool pending;		// a redisplay has been asked for and not drawn yet
+	bool forced;		// redraw even when nothing tracked changed
+
+	long long numRequests;
+	long long numFrames;
+
+public:
+	// minFrameInterval in milliseconds, one refresh of the display
+	RedrawScheduler(double minFrameInterval = 1000.0 / 60.0);
+
+	// Registers a block of scene state, which must stay valid for the scheduler's lifetime
+	void Track(const void* data, size_t size);
+
+	template <typename T>
+	void Track(const T& state)
+	{
+		Track(&state, sizeof(T));
+	}
+
+	// The next request redraws even if nothing tracked changed, e.g. for state that is not tracked
+	void Invalidate()
+	{
+		forced = true;
+	}
+
+	// True when some tracked state differs from the last frame drawn
+	bool HasChanged() const;
+
+	// Call wherever the scene may have changed, now in milliseconds. Returns the delay in
+	// milliseconds after which a redisplay should be posted (0 for right away), or -1 when
+	// none is needed because nothing changed or one is already on its way.
+	double Request(double now);
+
+	// Call from the display callback, records the state the frame shows
+	void FrameDrawn(double now);
+
+	long long GetNumRequests() const
+	{
+		return numRequests;
+	}
+
+	long long GetNumFrames() const
+	{
+		return numFrames;
+	}
+};
+
+#endif	//REDRAWSCHEDULER_H
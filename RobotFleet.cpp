@@ -0,0 +1,116 @@
+#include <math.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "RobotVariants.h"
+#include "JointRegistry.h"
+#include "JobSystem.h"
+
+#include "RobotFleet.h"
+
+
+RobotFleet::RobotFleet()
+{
+	numRobots = 0;
+}
+
+void RobotFleet::Init(int numRobots, float spacing, const RobotDimensions& dims)
+{
+	this->numRobots = numRobots < 0 ? 0 : numRobots;
+	this->dims = dims;
+
+	positions.resize(this->numRobots);
+	variants.clear();
+	joints.Init(this->numRobots);
+	animations.assign(this->numRobots, RobotAnimation());
+	frame.Resize(this->numRobots);
+
+	int side = (int)ceil(sqrt((double)this->numRobots));
+	float offset = 0.5f * (side - 1) * spacing;
+
+	for (int i = 0; i < this->numRobots; i++)
+	{
+		positions[i].Set((i % side) * spacing - offset, 0.0f, (i / side) * spacing - offset);
+
+		// Stagger the animations so the fleet is not moving in lock step
+		RobotPose pose;
+		joints.SetAngle(i, JOINT_ROBOT_SPIN, (float)((i * 37) % 360));
+		joints.GetPose(i, pose);
+		StartStepAnimation(pose, animations[i]);
+		for (int t = 0; t < i % 50; t++)
+			AnimateRobot(pose, animations[i]);
+		if (i % 3 == 0)
+			StartArmAnimation(pose, animations[i]);
+		if (i % 2 == 0)
+			StartCannonAnimation(animations[i]);
+		joints.SetPose(i, pose);
+	}
+}
+
+void RobotFleet::SetVariants(const RobotVariant* variants)
+{
+	if (!variants)
+	{
+		this->variants.clear();
+		for (int i = 0; i < numRobots; i++)
+			positions[i].y = 0.0f;
+		return;
+	}
+
+	this->variants.assign(variants, variants + numRobots);
+	float restHeight = GetRestHeight(dims);
+	for (int i = 0; i < numRobots; i++)
+	{
+		RobotDimensions variantDims;
+		GetVariantDimensions(variants[i], variantDims);
+		positions[i].y = GetRestHeight(variantDims) - restHeight;
+	}
+}
+
+void RobotFleet::Update(JobSystem* jobs, FleetFrame* target, int chunkSize)
+{
+	FleetFrame& output = target ? *target : frame;
+	if (output.numRobots != numRobots)
+		output.Resize(numRobots);
+
+	if (jobs)
+		jobs->ParallelFor(numRobots, chunkSize, [this, &output](int begin, int end) { UpdateRange(begin, end, output); });
+	else
+		UpdateRange(0, numRobots, output);
+}
+
+void RobotFleet::UpdateRange(int begin, int end, FleetFrame& target)
+{
+	for (int i = begin; i < end; i++)
+	{
+		// animation sampling, restart the walk cycle whenever it finishes. Robots own
+		// disjoint entries of the registry, so chunks update it in parallel.
+		RobotPose pose;
+		joints.GetPose(i, pose);
+		RobotAnimation& animation = animations[i];
+		AnimateRobot(pose, animation);
+		if (!animation.stepping)
+			StartStepAnimation(pose, animation);
+		joints.SetPose(i, pose);
+
+		// forward kinematics, from the robot's own dimensions when it is a variant
+		MATRIX4X4 root;
+		root.Translate(positions[i].x, positions[i].y, positions[i].z);
+		MATRIX4X4* parts = &target.partMatrices[(size_t)i * NUM_ROBOT_PARTS];
+		if (variants.empty())
+			ComputeRobotTransforms(dims, pose, root, parts);
+		else
+		{
+			RobotDimensions variantDims;
+			GetVariantDimensions(variants[i], variantDims);
+			ComputeRobotTransforms(variantDims, pose, root, parts);
+		}
+
+		// bounding box refit
+		target.bounds[i] = ComputeRobotBounds(parts);
+
+		// the frame's own copy of the angles, the registry moves on with the next update
+		target.poses[i] = pose;
+	}
+}
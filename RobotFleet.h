@@ -0,0 +1,122 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	RobotFleet.h
+//	Many robots updated together. Each robot keeps its own animation state and its joints
+//	in the fleet's JointRegistry, and Update() runs the per-robot pipeline (animation tick, forward kinematics,
+//	bounding box refit) over contiguous arrays, in parallel chunks when given a job
+//	system. Rendering reads the results afterwards on the main thread.
+//
+//	Robots are all built from the same dimensions unless the fleet is given variants,
+//	when each robot's dimensions are expanded from its own record as its part matrices
+//	are computed.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ROBOTFLEET_H
+#define ROBOTFLEET_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "RobotVariants.h"
+#include "JointRegistry.h"
+
+class JobSystem;
+
+// Outputs of one fleet update, NUM_ROBOT_PARTS matrices per robot
+struct FleetFrame
+{
+	int numRobots = 0;
+	std::vector<MATRIX4X4> partMatrices;
+	std::vector<BBox> bounds;
+	std::vector<RobotPose> poses;	// joint angles the part matrices were computed from
+
+	void Resize(int numRobots)
+	{
+		this->numRobots = numRobots;
+		partMatrices.resize((size_t)numRobots * NUM_ROBOT_PARTS);
+		bounds.resize(numRobots);
+		poses.resize(numRobots);
+	}
+
+	const MATRIX4X4* GetPartMatrices(int robot) const
+	{
+		return &partMatrices[(size_t)robot * NUM_ROBOT_PARTS];
+	}
+};
+
+class RobotFleet
+{
+private:
+	int numRobots;
+	RobotDimensions dims;
+
+	std::vector<VECTOR3D> positions;
+	JointRegistry joints;
+	std::vector<RobotAnimation> animations;
+	std::vector<RobotVariant> variants;		// empty when every robot uses dims
+
+	// Results of the last Update() that was not given its own frame
+	FleetFrame frame;
+
+private:
+	void UpdateRange(int begin, int end, FleetFrame& target);
+
+public:
+	RobotFleet();
+
+	// Lays robots out on a square grid in the y = 0 plane, centred on the origin
+	void Init(int numRobots, float spacing, const RobotDimensions& dims);
+
+	// One variant per robot, copied, or NULL to build them all from the fleet's dimensions
+	// again. Robots are raised or lowered to stand on the same ground as the others. Not
+	// while an Update() is running.
+	void SetVariants(const RobotVariant* variants);
+
+	bool HasVariants() const
+	{
+		return !variants.empty();
+	}
+
+	const RobotVariant& GetVariant(int robot) const
+	{
+		return variants[robot];
+	}
+
+	// One animation tick for every robot, serially when jobs is NULL. Results go to
+	// target when given, so a caller can keep several frames in flight.
+	void Update(JobSystem* jobs, FleetFrame* target = NULL, int chunkSize = 256);
+
+	int GetNumRobots()
+	{
+		return numRobots;
+	}
+
+	const FleetFrame& GetFrame() const
+	{
+		return frame;
+	}
+
+	const MATRIX4X4* GetPartMatrices(int robot) const
+	{
+		return frame.GetPartMatrices(robot);
+	}
+
+	const BBox& GetBounds(int robot) const
+	{
+		return frame.bounds[robot];
+	}
+
+	RobotPose GetPose(int robot) const
+	{
+		RobotPose pose;
+		joints.GetPose(robot, pose);
+		return pose;
+	}
+
+	const JointRegistry& GetJoints() const
+	{
+		return joints;
+	}
+};
+
+#endif	//ROBOTFLEET_H
@@ -0,0 +1,395 @@
+#include <math.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+
+#include "RobotModel.h"
+
+
+const RobotPartInfo robotParts[NUM_ROBOT_PARTS] =
+{
+	{ SHAPE_SPHERE, 100, 100, true },	// PART_BODY
+	{ SHAPE_CYLINDER, 50, 50, false },	// PART_CANNON
+	{ SHAPE_CUBE, 0, 0, false },		// PART_NOTCH
+	{ SHAPE_CYLINDER, 100, 100, false },// PART_LEFT_HIP
+	{ SHAPE_CUBE, 0, 0, false },		// PART_LEFT_UPPER_LEG
+	{ SHAPE_CUBE, 0, 0, false },		// PART_LEFT_LOWER_LEG
+	{ SHAPE_CUBE, 0, 0, false },		// PART_LEFT_FOOT
+	{ SHAPE_CYLINDER, 100, 100, false },// PART_RIGHT_HIP
+	{ SHAPE_CUBE, 0, 0, false },		// PART_RIGHT_UPPER_LEG
+	{ SHAPE_CUBE, 0, 0, false },		// PART_RIGHT_LOWER_LEG
+	{ SHAPE_CUBE, 0, 0, false },		// PART_RIGHT_FOOT
+	{ SHAPE_CYLINDER, 100, 100, false },// PART_LEFT_SHOULDER
+	{ SHAPE_CUBE, 0, 0, false },		// PART_LEFT_UPPER_ARM
+	{ SHAPE_CYLINDER, 100, 100, false },// PART_LEFT_ARM_GUN
+	{ SHAPE_CYLINDER, 100, 100, false },// PART_RIGHT_SHOULDER
+	{ SHAPE_CUBE, 0, 0, false },		// PART_RIGHT_UPPER_ARM
+	{ SHAPE_CYLINDER, 100, 100, false },// PART_RIGHT_ARM_GUN
+};
+
+
+// Limits wide enough for the scripted animations: the step swings the hip from -20 to 40
+// degrees and the arm takes the shoulder to -45 and the elbow to 90
+const JointInfo robotJoints[NUM_JOINTS] =
+{
+	{ "body", -60.0f, 60.0f, 0.0f, false },
+	{ "cannon", -180.0f, 180.0f, 0.0f, true },
+	{ "right hip", -60.0f, 75.0f, 0.0f, false },
+	{ "right knee", -90.0f, 90.0f, 0.0f, false },
+	{ "left hip", -60.0f, 75.0f, 0.0f, false },
+	{ "left knee", -90.0f, 90.0f, 0.0f, false },
+	{ "left shoulder", -120.0f, 60.0f, 0.0f, false },
+	{ "left elbow", -30.0f, 135.0f, 0.0f, false },
+	{ "right shoulder", -120.0f, 60.0f, 0.0f, false },
+	{ "right elbow", -30.0f, 135.0f, 0.0f, false },
+	{ "robot spin", -180.0f, 180.0f, 0.0f, true },
+	{ "vertical spin", -180.0f, 180.0f, 0.0f, true },
+};
+
+
+float WrapAngle(float angle)
+{
+	float wrapped = angle - 360.0f * floorf((angle + 180.0f) * (1.0f / 360.0f));
+
+	// the rounded number of turns can be one off near an odd multiple of 180, which leaves
+	// the result just below -180 or at 180 itself
+	if (wrapped < -180.0f)
+		wrapped += 360.0f;
+	if (wrapped >= 180.0f)
+		wrapped -= 360.0f;
+	return wrapped;
+}
+
+float LimitJointAngle(int joint, float angle)
+{
+	const JointInfo& info = robotJoints[joint];
+	if (info.continuous)
+		return WrapAngle(angle);
+	if (angle < info.minAngle)
+		return info.minAngle;
+	if (angle > info.maxAngle)
+		return info.maxAngle;
+	return angle;
+}
+
+void LimitPose(RobotPose& pose)
+{
+	for (int i = 0; i < NUM_JOINTS; i++)
+		pose.angles[i] = LimitJointAngle(i, pose.angles[i]);
+}
+
+void ResetPose(RobotPose& pose)
+{
+	for (int i = 0; i < NUM_JOINTS; i++)
+		pose.angles[i] = robotJoints[i].restAngle;
+}
+
+
+void RobotDimensions::Init(float robotBodySize)
+{
+	this->robotBodySize = robotBodySize;
+	cannonLength = 0.5 * robotBodySize;
+	cannonWidth = 0.2 * robotBodySize;
+	notchSize = 0.8 * cannonWidth;
+	notchLength = 0.5 * cannonLength;
+	hipRad = 0.5 * robotBodySize;
+	hipLength = 0.5 * robotBodySize;
+	upperLegLength = robotBodySize;
+	upperLegHeight = 0.2 * robotBodySize;
+	upperLegWidth = 0.3 * robotBodySize;
+	lowerLegLength = 1.2 * upperLegLength;
+	lowerLegHeight = upperLegHeight;
+	lowerLegWidth = upperLegWidth;
+	footLength = robotBodySize;
+	footHeight = 0.5 * robotBodySize;
+	footDepth = robotBodySize;
+	shoulderRad = hipRad;
+	shoulderLength = 2.0 * hipLength;
+	upperArmLength = 1.3 * upperLegLength;
+	upperArmHeight = upperLegHeight;
+	upperArmWidth = upperLegWidth;
+	armGunLength = 1.2 * upperArmLength;
+	armGunRad = 0.5 * upperArmWidth;
+}
+
+
+void StartStepAnimation(RobotPose& pose, RobotAnimation& animation)
+{
+	// reset angles and setup angle incrementers
+	pose.angles[JOINT_LEFT_HIP] = 0.0;
+	pose.angles[JOINT_LEFT_KNEE] = 0.0;
+	//initialize the amount of rotation
+	animation.hipR = 1.0;
+	animation.kneeR = -1.0;
+	animation.stepping = true;
+}
+
+void StartArmAnimation(RobotPose& pose, RobotAnimation& animation)
+{
+	pose.angles[JOINT_RIGHT_SHOULDER] = 0.0;
+	pose.angles[JOINT_RIGHT_ELBOW] = 0.0;
+	//initialize the amount of rotation
+	animation.shoulderR = -0.75;
+	animation.elbowR = 1.5;
+	animation.armMoving = true;
+}
+
+void StartCannonAnimation(RobotAnimation& animation)
+{
+	animation.stopCannon = false;
+	// make cannon spin
+	animation.cannonRotating = true;
+}
+
+void StopCannonAnimation(RobotAnimation& animation)
+{
+	animation.stopCannon = true;
+}
+
+static bool CannonTick(RobotPose& pose, RobotAnimation& animation)
+{
+	if (!animation.stopCannon)
+	{
+		pose.angles[JOINT_CANNON] += 1.0;
+		return true;
+	}
+
+	//cannon no longer rotating
+	return false;
+}
+
+static bool StepTick(RobotPose& pose, RobotAnimation& animation)
+{
+	//starts at 0, increments till >40
+	//decrements till <-10
+	//stops when <-20
+	if (pose.angles[JOINT_LEFT_HIP] >= 40.0)
+	{
+		animation.hipR = -1.5;
+		animation.kneeR = 0.25;
+	}
+	else if (pose.angles[JOINT_LEFT_HIP] <= -20.0)
+	{
+		return false;
+	}
+	else if (pose.angles[JOINT_LEFT_HIP] <= -10.0)
+	{
+		animation.hipR = -0.5;
+		animation.kneeR = 2.5;
+	}
+
+	pose.angles[JOINT_LEFT_HIP] += animation.hipR;
+	pose.angles[JOINT_LEFT_KNEE] += animation.kneeR;
+	return true;
+}
+
+static bool ArmTick(RobotPose& pose, RobotAnimation& animation)
+{
+	//starts at 0, decrement till < -45
+	//return when back to starting i.e. >0
+	if (pose.angles[JOINT_RIGHT_SHOULDER] <= -45.0)
+	{
+		animation.shoulderR = 0.75;
+		animation.elbowR = -1.5;
+	}
+	else if (pose.angles[JOINT_RIGHT_SHOULDER] > 0.0)
+	{
+		return false;
+	}
+
+	pose.angles[JOINT_RIGHT_SHOULDER] += animation.shoulderR;
+	pose.angles[JOINT_RIGHT_ELBOW] += animation.elbowR;
+	return true;
+}
+
+bool AnimateRobot(RobotPose& pose, RobotAnimation& animation)
+{
+	if (animation.cannonRotating)
+		animation.cannonRotating = CannonTick(pose, animation);
+	if (animation.stepping)
+		animation.stepping = StepTick(pose, animation);
+	if (animation.armMoving)
+		animation.armMoving = ArmTick(pose, animation);
+	LimitPose(pose);
+
+	return animation.cannonRotating || animation.stepping || animation.armMoving;
+}
+
+
+// Hip, upper leg, lower leg and foot. M starts at the parent (root) frame.
+static void ComputeLegTransforms(const RobotDimensions& d, MATRIX4X4 M, float hipX, float hipAngle, float kneeAngle,
+								 MATRIX4X4* hip, MATRIX4X4* upperLeg, MATRIX4X4* lowerLeg, MATRIX4X4* foot)
+{
+	// Position hip with respect to parent body
+	M.Translate(hipX, (-1.5 * d.hipRad), 0.0);
+	M.Rotate(90, 0.0, 1.0, 0.0);
+
+	// rotate hip and sub-parts (legs etc)
+	M.Rotate(hipAngle, 0.0, 0.0, 1.0);
+
+	// build hip
+	*hip = M;
+	hip->Scale(d.hipRad, d.hipRad, d.hipLength);
+
+	//rotate 45 degrees about the hip joint
+	M.Rotate(45, 0.0, 0.0, 1.0);
+
+	//position upperleg w/ resp. to hip
+	M.Translate(0.0, -(d.hipRad + 0.5 * d.upperLegLength), 0.5 * d.hipLength);
+
+	*upperLeg = M;
+	upperLeg->Scale(d.upperLegHeight, d.upperLegLength, d.upperLegWidth);
+
+	M.Translate(0.0, -0.5 * d.upperLegLength, 0.0);
+
+	//rotates will occur at the knee joint now
+	M.Rotate(kneeAngle, 0.0, 0.0, 1.0);
+
+	//translate first to change pivot point to knee
+	M.Translate(-0.5 * d.lowerLegLength, 0.0, 0.0);
+
+	*lowerLeg = M;
+	lowerLeg->Scale(d.lowerLegLength, d.lowerLegHeight, d.lowerLegWidth);
+
+	//position foot w/ resp. to lower leg
+	M.Translate(-0.5 * d.lowerLegLength, 0.0, 0.0);
+
+	//rotate foot so that it is flat
+	M.Rotate(-45, 0.0, 0.0, 1.0);
+
+	*foot = M;
+	foot->Scale(d.footLength, d.footHeight, d.footDepth);
+}
+
+// Shoulder, upper arm and arm gun. M starts at the parent (root) frame.
+static void ComputeArmTransforms(const RobotDimensions& d, MATRIX4X4 M, float shoulderX, float upperArmZ,
+								 float shoulderAngle, float elbowAngle,
+								 MATRIX4X4* shoulder, MATRIX4X4* upperArm, MATRIX4X4* armGun)
+{
+	// Position shoulder with respect to parent body
+	M.Translate(shoulderX, 1.5 * d.shoulderRad, 0.0);
+	M.Rotate(90, 0.0, 1.0, 0.0);
+
+	// rotate shoulder and sub-parts (arms etc)
+	M.Rotate(shoulderAngle, 0.0, 0.0, 1.0);
+
+	// build shoulder
+	*shoulder = M;
+	shoulder->Scale(d.shoulderRad, d.shoulderRad, d.shoulderLength);
+
+	//rotate -45 degrees about the shoulder joint
+	M.Rotate(-45, 0.0, 0.0, 1.0);
+
+	//position upperarm w/ resp. to shoulder
+	M.Translate(0.0, -(d.shoulderRad + 0.5 * d.upperArmLength), upperArmZ);
+
+	*upperArm = M;
+	upperArm->Scale(d.upperArmHeight, d.upperArmLength, d.upperArmWidth);
+
+	M.Translate(0.0, -0.5 * d.upperArmLength, 0.0);
+
+	//rotates will occur at the elbow joint (base of cylinder)
+	M.Rotate(elbowAngle, 0.0, 0.0, 1.0);
+	M.Rotate(-90, 0.0, 1.0, 0.0);
+
+	*armGun = M;
+	armGun->Scale(d.armGunRad, d.armGunRad, d.armGunLength);
+}
+
+void ComputeRobotTransforms(const RobotDimensions& d, const RobotPose& pose, const MATRIX4X4& root,
+							MATRIX4X4 partMatrices[NUM_ROBOT_PARTS])
+{
+	MATRIX4X4 R = root;
+
+	//allows for rotating entire model horizontally (y-axis)
+	R.Rotate(pose.angles[JOINT_ROBOT_SPIN], 0.0, 1.0, 0.0);
+
+	//allows for rotating entire model verticaly (x-axis)
+	R.Rotate(pose.angles[JOINT_VERTICAL_SPIN], 1.0, 0.0, 0.0);
+
+	//CTM = R_y*R_x
+	MATRIX4X4 B = R;
+
+	// spin body and cannon.
+	B.Rotate(pose.angles[JOINT_BODY], 1.0, 0.0, 0.0);
+
+	//CTM = R_y * R_x * R_x(bodyAngle) * S
+	partMatrices[PART_BODY] = B;
+	partMatrices[PART_BODY].Scale(d.robotBodySize, d.robotBodySize, d.robotBodySize);
+
+	// Position cannon with respect to parent (body), place it slightly within the body
+	MATRIX4X4 C = B;
+	C.Translate(0.0, 0.0, (d.robotBodySize - 0.25 * d.cannonLength));
+
+	//rotate cannon and notch on z-axis
+	C.Rotate(pose.angles[JOINT_CANNON], 0.0, 0.0, 1.0);
+
+	partMatrices[PART_CANNON] = C;
+	partMatrices[PART_CANNON].Scale(d.cannonWidth, d.cannonWidth, d.cannonLength);
+
+	// position notch above cylinder
+	C.Translate(0.0, (d.cannonWidth + 0.5 * d.notchSize), (d.cannonLength - 0.5 * d.notchLength));
+	partMatrices[PART_NOTCH] = C;
+	partMatrices[PART_NOTCH].Scale(d.notchSize, d.notchSize, d.notchLength);
+
+	ComputeLegTransforms(d, R, d.robotBodySize,
+		pose.angles[JOINT_LEFT_HIP], pose.angles[JOINT_LEFT_KNEE],
+		&partMatrices[PART_LEFT_HIP], &partMatrices[PART_LEFT_UPPER_LEG],
+		&partMatrices[PART_LEFT_LOWER_LEG], &partMatrices[PART_LEFT_FOOT]);
+
+	ComputeLegTransforms(d, R, -(d.robotBodySize + d.hipLength),
+		pose.angles[JOINT_RIGHT_HIP], pose.angles[JOINT_RIGHT_KNEE],
+		&partMatrices[PART_RIGHT_HIP], &partMatrices[PART_RIGHT_UPPER_LEG],
+		&partMatrices[PART_RIGHT_LOWER_LEG], &partMatrices[PART_RIGHT_FOOT]);
+
+	ComputeArmTransforms(d, R, d.robotBodySize, d.shoulderLength - 0.5 * d.upperArmWidth,
+		pose.angles[JOINT_LEFT_SHOULDER], pose.angles[JOINT_LEFT_ELBOW],
+		&partMatrices[PART_LEFT_SHOULDER], &partMatrices[PART_LEFT_UPPER_ARM], &partMatrices[PART_LEFT_ARM_GUN]);
+
+	ComputeArmTransforms(d, R, -(d.robotBodySize + d.shoulderLength), 0.5 * d.upperArmWidth,
+		pose.angles[JOINT_RIGHT_SHOULDER], pose.angles[JOINT_RIGHT_ELBOW],
+		&partMatrices[PART_RIGHT_SHOULDER], &partMatrices[PART_RIGHT_UPPER_ARM], &partMatrices[PART_RIGHT_ARM_GUN]);
+}
+
+
+BBox ComputePartBounds(PartShape shape, const MATRIX4X4& M)
+{
+	// Local bounds of the unit primitive as centre and half extent
+	VECTOR3D centre(0.0f, 0.0f, 0.0f);
+	VECTOR3D extent(0.5f, 0.5f, 0.5f);
+	if (shape == SHAPE_SPHERE)
+	{
+		extent.Set(1.0f, 1.0f, 1.0f);
+	}
+	else if (shape == SHAPE_CYLINDER)
+	{
+		centre.Set(0.0f, 0.0f, 0.5f);
+		extent.Set(1.0f, 1.0f, 0.5f);
+	}
+
+	VECTOR3D c = M.TransformPoint(centre);
+	VECTOR3D e;
+	e.x = fabs(M.entries[0]) * extent.x + fabs(M.entries[4]) * extent.y + fabs(M.entries[8]) * extent.z;
+	e.y = fabs(M.entries[1]) * extent.x + fabs(M.entries[5]) * extent.y + fabs(M.entries[9]) * extent.z;
+	e.z = fabs(M.entries[2]) * extent.x + fabs(M.entries[6]) * extent.y + fabs(M.entries[10]) * extent.z;
+
+	BBox box;
+	box.min = c - e;
+	box.max = c + e;
+	return box;
+}
+
+BBox ComputeRobotBounds(const MATRIX4X4 partMatrices[NUM_ROBOT_PARTS])
+{
+	BBox bounds = ComputePartBounds(robotParts[0].shape, partMatrices[0]);
+	for (int i = 1; i < NUM_ROBOT_PARTS; i++)
+	{
+		BBox box = ComputePartBounds(robotParts[i].shape, partMatrices[i]);
+		if (box.min.x < bounds.min.x) bounds.min.x = box.min.x;
+		if (box.min.y < bounds.min.y) bounds.min.y = box.min.y;
+		if (box.min.z < bounds.min.z) bounds.min.z = box.min.z;
+		if (box.max.x > bounds.max.x) bounds.max.x = box.max.x;
+		if (box.max.y > bounds.max.y) bounds.max.y = box.max.y;
+		if (box.max.z > bounds.max.z) bounds.max.z = box.max.z;
+	}
+	return bounds;
+}
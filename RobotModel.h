@@ -0,0 +1,178 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	RobotModel.h
+//	CPU side description of the hierarchical robot: dimensions, joint angles, the
+//	scripted animations and the forward kinematics that place every part.
+//
+//	Every part is drawn as a unit primitive (sphere, cylinder or cube) transformed by
+//	its part matrix, so the matrices alone are enough to render, cull or collide a robot.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ROBOTMODEL_H
+#define ROBOTMODEL_H
+
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+
+// Structure defining an axis aligned bounding box
+typedef struct BoundingBox {
+	VECTOR3D min;
+	VECTOR3D max;
+} BBox;
+
+// Note how everything depends on robot body dimensions so that can scale entire robot proportionately
+// just by changing robot body scale
+struct RobotDimensions
+{
+	float robotBodySize;
+	float cannonLength;
+	float cannonWidth;
+	float notchSize;
+	float notchLength;
+	float hipRad;
+	float hipLength;
+	float upperLegLength;
+	float upperLegHeight;
+	float upperLegWidth;
+	float lowerLegLength;
+	float lowerLegHeight;
+	float lowerLegWidth;
+	float footLength;
+	float footHeight;
+	float footDepth;
+	float shoulderRad;
+	float shoulderLength;
+	float upperArmLength;
+	float upperArmHeight;
+	float upperArmWidth;
+	float armGunLength;
+	float armGunRad;
+
+	RobotDimensions(float robotBodySize = 2.0f)
+	{
+		Init(robotBodySize);
+	}
+
+	void Init(float robotBodySize);
+};
+
+// Joints of the robot, indexing the angles of RobotPose. The order is also the channel
+// order of the animation log.
+enum JointId
+{
+	JOINT_BODY,
+	JOINT_CANNON,
+	JOINT_RIGHT_HIP,
+	JOINT_RIGHT_KNEE,
+	JOINT_LEFT_HIP,
+	JOINT_LEFT_KNEE,
+	JOINT_LEFT_SHOULDER,
+	JOINT_LEFT_ELBOW,
+	JOINT_RIGHT_SHOULDER,
+	JOINT_RIGHT_ELBOW,
+	JOINT_ROBOT_SPIN,		// rotates the whole robot horizontally
+	JOINT_VERTICAL_SPIN,	// and vertically
+	NUM_JOINTS
+};
+
+struct JointInfo
+{
+	const char* name;
+	float minAngle, maxAngle;	// degrees, limited joints are clamped to these
+	float restAngle;
+	bool continuous;			// turns freely, kept within [-180, 180) instead of clamped
+};
+
+extern const JointInfo robotJoints[NUM_JOINTS];
+
+// Joint angles in degrees, never outside their joint's limits
+struct RobotPose
+{
+	float angles[NUM_JOINTS] = {};
+};
+
+// The same direction as angle within [-180, 180)
+float WrapAngle(float angle);
+
+// angle moved within the joint's limits, or for a continuous joint the same direction
+// within [-180, 180)
+float LimitJointAngle(int joint, float angle);
+
+// Every angle of the pose within its joint's limits
+void LimitPose(RobotPose& pose);
+
+// Every joint at its rest angle
+void ResetPose(RobotPose& pose);
+
+// State of the scripted cannon, step and arm animations
+struct RobotAnimation
+{
+	bool cannonRotating = false;
+	bool stopCannon = false;
+	bool stepping = false;
+	bool armMoving = false;
+
+	// hip and knee rotations for animation
+	float hipR = 0.0f, kneeR = 0.0f;
+
+	float shoulderR = 0.0f, elbowR = 0.0f; //shoulder and elbow rotations
+};
+
+enum RobotPart
+{
+	PART_BODY,
+	PART_CANNON,
+	PART_NOTCH,
+	PART_LEFT_HIP,
+	PART_LEFT_UPPER_LEG,
+	PART_LEFT_LOWER_LEG,
+	PART_LEFT_FOOT,
+	PART_RIGHT_HIP,
+	PART_RIGHT_UPPER_LEG,
+	PART_RIGHT_LOWER_LEG,
+	PART_RIGHT_FOOT,
+	PART_LEFT_SHOULDER,
+	PART_LEFT_UPPER_ARM,
+	PART_LEFT_ARM_GUN,
+	PART_RIGHT_SHOULDER,
+	PART_RIGHT_UPPER_ARM,
+	PART_RIGHT_ARM_GUN,
+	NUM_ROBOT_PARTS
+};
+
+// Unit primitive each part is drawn with
+enum PartShape
+{
+	SHAPE_SPHERE,	// radius 1 at the origin
+	SHAPE_CYLINDER,	// radius 1 along +z from 0 to 1
+	SHAPE_CUBE		// side 1 centred at the origin
+};
+
+struct RobotPartInfo
+{
+	PartShape shape;
+	int slices, stacks;		// GLU tessellation for spheres and cylinders
+	bool bodyMaterial;		// body material instead of the leg material
+};
+
+extern const RobotPartInfo robotParts[NUM_ROBOT_PARTS];
+
+// Animation control, mirrors the keys that start and stop each animation
+void StartStepAnimation(RobotPose& pose, RobotAnimation& animation);
+void StartArmAnimation(RobotPose& pose, RobotAnimation& animation);
+void StartCannonAnimation(RobotAnimation& animation);
+void StopCannonAnimation(RobotAnimation& animation);
+
+// Advances every running animation by one tick, returns true while any is still running
+bool AnimateRobot(RobotPose& pose, RobotAnimation& animation);
+
+// Forward kinematics: world matrix of every part, root is the robot's placement
+void ComputeRobotTransforms(const RobotDimensions& dims, const RobotPose& pose, const MATRIX4X4& root,
+							MATRIX4X4 partMatrices[NUM_ROBOT_PARTS]);
+
+// Bounds of one part's unit primitive under its part matrix
+BBox ComputePartBounds(PartShape shape, const MATRIX4X4& partMatrix);
+
+// Bounds enclosing every part
+BBox ComputeRobotBounds(const MATRIX4X4 partMatrices[NUM_ROBOT_PARTS]);
+
+#endif	//ROBOTMODEL_H
@@ -0,0 +1,788 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "JobSystem.h"
+#include "QuadMesh.h"
+#include "Particles.h"
+
+#include "RobotPhysics.h"
+
+
+static const float PI = 3.14159265f;
+static const float DEGREES = 180.0f / PI;
+
+// Body each part belongs to
+static const int partBodyTable[NUM_ROBOT_PARTS] =
+{
+	BODY_TORSO, BODY_TORSO, BODY_TORSO,
+	BODY_LEFT_THIGH, BODY_LEFT_THIGH, BODY_LEFT_SHIN, BODY_LEFT_SHIN,
+	BODY_RIGHT_THIGH, BODY_RIGHT_THIGH, BODY_RIGHT_SHIN, BODY_RIGHT_SHIN,
+	BODY_LEFT_UPPER_ARM, BODY_LEFT_UPPER_ARM, BODY_LEFT_GUN,
+	BODY_RIGHT_UPPER_ARM, BODY_RIGHT_UPPER_ARM, BODY_RIGHT_GUN
+};
+
+
+// Quaternions are w, x, y, z
+static void MultiplyQuaternions(const float a[4], const float b[4], float result[4])
+{
+	float w = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+	float x = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+	float y = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+	float z = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+	result[0] = w;
+	result[1] = x;
+	result[2] = y;
+	result[3] = z;
+}
+
+// Row major rotation of a unit quaternion
+static void GetRotation(const float q[4], float m[9])
+{
+	float w = q[0], x = q[1], y = q[2], z = q[3];
+	m[0] = 1.0f - 2.0f * (y * y + z * z);
+	m[1] = 2.0f * (x * y - w * z);
+	m[2] = 2.0f * (x * z + w * y);
+	m[3] = 2.0f * (x * y + w * z);
+	m[4] = 1.0f - 2.0f * (x * x + z * z);
+	m[5] = 2.0f * (y * z - w * x);
+	m[6] = 2.0f * (x * z - w * y);
+	m[7] = 2.0f * (y * z + w * x);
+	m[8] = 1.0f - 2.0f * (x * x + y * y);
+}
+
+static VECTOR3D Multiply(const float m[9], const VECTOR3D& v)
+{
+	return VECTOR3D(m[0] * v.x + m[1] * v.y + m[2] * v.z,
+					m[3] * v.x + m[4] * v.y + m[5] * v.z,
+					m[6] * v.x + m[7] * v.y + m[8] * v.z);
+}
+
+// a * b for row major 3x3 matrices, with b transposed when transposeB is set
+static void Multiply(const float a[9], const float b[9], bool transposeB, float result[9])
+{
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			float sum = 0.0f;
+			for (int k = 0; k < 3; k++)
+				sum += a[r * 3 + k] * (transposeB ? b[c * 3 + k] : b[k * 3 + c]);
+			result[r * 3 + c] = sum;
+		}
+	}
+}
+
+static void Invert(const float m[9], float inverse[9])
+{
+	float c0 = m[4] * m[8] - m[5] * m[7];
+	float c1 = m[5] * m[6] - m[3] * m[8];
+	float c2 = m[3] * m[7] - m[4] * m[6];
+	float s = 1.0f / (m[0] * c0 + m[1] * c1 + m[2] * c2);
+	inverse[0] = c0 * s;
+	inverse[1] = (m[2] * m[7] - m[1] * m[8]) * s;
+	inverse[2] = (m[1] * m[5] - m[2] * m[4]) * s;
+	inverse[3] = c1 * s;
+	inverse[4] = (m[0] * m[8] - m[2] * m[6]) * s;
+	inverse[5] = (m[2] * m[3] - m[0] * m[5]) * s;
+	inverse[6] = c2 * s;
+	inverse[7] = (m[1] * m[6] - m[0] * m[7]) * s;
+	inverse[8] = (m[0] * m[4] - m[1] * m[3]) * s;
+}
+
+// Angle in radians that b is turned from a about axis, local to a
+static float GetHingeAngle(const float a[4], const float b[4], const VECTOR3D& axis)
+{
+	float conjugate[4] = { a[0], -a[1], -a[2], -a[3] };
+	float relative[4];
+	MultiplyQuaternions(conjugate, b, relative);
+	float angle = 2.0f * atan2f(relative[1] * axis.x + relative[2] * axis.y + relative[3] * axis.z, relative[0]);
+	if (angle > PI)
+		angle -= 2.0f * PI;
+	else if (angle < -PI)
+		angle += 2.0f * PI;
+	return angle;
+}
+
+static float Clamp(float value, float lower, float upper)
+{
+	return value < lower ? lower : (value > upper ? upper : value);
+}
+
+
+// Hip and knee angles that put the end of the shin at (y, z) from the hip, in body sizes. The
+// thigh is 1.5 and the shin 1.2 body sizes long and at rest they meet at a right angle,
+// the thigh reaching back and the shin forward.
+static void SolveLeg(float y, float z, float& hip, float& knee)
+{
+	const float thigh = 1.5f, shin = 1.2f;
+	const float half = 0.70710678f;
+
+	float reach2 = y * y + z * z;
+	float bend = (thigh * thigh + shin * shin - reach2) / (2.0f * thigh * shin);
+	float angle = acosf(Clamp(bend, -1.0f, 1.0f));
+	knee = angle - 0.5f * PI;
+
+	// Rotating about +x turns (y, z) as the complex number y + iz, so the hip turns the foot
+	// by the difference of the arguments
+	float c = cosf(knee), s = sinf(knee);
+	float footY = -half * thigh + (-half * shin * c - half * shin * s);
+	float footZ = -half * thigh + (-half * shin * s + half * shin * c);
+	hip = atan2f(z, y) - atan2f(footZ, footY);
+	if (hip > PI)
+		hip -= 2.0f * PI;
+	else if (hip < -PI)
+		hip += 2.0f * PI;
+}
+
+void GetWalkTargets(float phase, RobotPose& pose)
+{
+	// Each foot slides back along the ground for half the stride and lifts forward for the
+	// other half, the legs half a stride apart
+	const float stride = 0.4f, lift = 0.3f;
+	const float restY = -0.70710678f * (1.5f + 1.2f), restZ = -0.70710678f * (1.5f - 1.2f);
+	const int hips[2] = { JOINT_LEFT_HIP, JOINT_RIGHT_HIP };
+	const int knees[2] = { JOINT_LEFT_KNEE, JOINT_RIGHT_KNEE };
+
+	for (int leg = 0; leg < 2; leg++)
+	{
+		float legPhase = phase + leg * PI;
+		float raise = -sinf(legPhase);
+		float hip, knee;
+		SolveLeg(restY + (raise > 0.0f ? lift * raise : 0.0f), restZ + stride * cosf(legPhase), hip, knee);
+		pose.angles[hips[leg]] = LimitJointAngle(hips[leg], hip * DEGREES);
+		pose.angles[knees[leg]] = LimitJointAngle(knees[leg], knee * DEGREES);
+	}
+}
+
+
+RobotPhysics::RobotPhysics()
+{
+	ground = NULL;
+	accumulator = 0.0f;
+	numRobots = 0;
+	standingHeight = 0.0f;
+}
+
+void RobotPhysics::BuildTemplate()
+{
+	// Robot at rest with its root at the origin, every body frame starts out along the world axes
+	RobotPose rest;
+	MATRIX4X4 root;
+	MATRIX4X4 parts[NUM_ROBOT_PARTS];
+	ComputeRobotTransforms(dims, rest, root, parts);
+
+	// Mass, centre and inertia of every part's primitive with density 1
+	float partMass[NUM_ROBOT_PARTS];
+	VECTOR3D partCentre[NUM_ROBOT_PARTS];
+	float partInertia[NUM_ROBOT_PARTS][9];
+	for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+	{
+		const MATRIX4X4& M = parts[p];
+		VECTOR3D axes[3] = { M.GetColumn(0), M.GetColumn(1), M.GetColumn(2) };
+		float a = axes[0].GetLength(), b = axes[1].GetLength(), c = axes[2].GetLength();
+		for (int k = 0; k < 3; k++)
+			axes[k].Normalize();
+
+		float m, principal[3];
+		if (robotParts[p].shape == SHAPE_SPHERE)
+		{
+			m = 4.0f / 3.0f * PI * a * b * c;
+			principal[0] = 0.2f * m * (b * b + c * c);
+			principal[1] = 0.2f * m * (a * a + c * c);
+			principal[2] = 0.2f * m * (a * a + b * b);
+			partCentre[p] = M.TransformPoint(VECTOR3D(0.0f, 0.0f, 0.0f));
+		}
+		else if (robotParts[p].shape == SHAPE_CYLINDER)
+		{
+			float radius2 = 0.5f * (a * a + b * b);
+			m = PI * a * b * c;
+			principal[0] = m * (3.0f * radius2 + c * c) / 12.0f;
+			principal[1] = principal[0];
+			principal[2] = 0.5f * m * radius2;
+			partCentre[p] = M.TransformPoint(VECTOR3D(0.0f, 0.0f, 0.5f));
+		}
+		else
+		{
+			m = a * b * c;
+			principal[0] = m * (b * b + c * c) / 12.0f;
+			principal[1] = m * (a * a + c * c) / 12.0f;
+			principal[2] = m * (a * a + b * b) / 12.0f;
+			partCentre[p] = M.TransformPoint(VECTOR3D(0.0f, 0.0f, 0.0f));
+		}
+
+		// R diag(principal) R^T with the part's axes as the columns of R
+		for (int r = 0; r < 3; r++)
+		{
+			for (int col = 0; col < 3; col++)
+			{
+				float sum = 0.0f;
+				for (int k = 0; k < 3; k++)
+					sum += principal[k] * (&axes[k].x)[r] * (&axes[k].x)[col];
+				partInertia[p][r * 3 + col] = sum;
+			}
+		}
+		partMass[p] = m;
+	}
+
+	// Bodies gather their parts, moved to the body's centre of mass by the parallel axis theorem
+	float bodyMass[NUM_ROBOT_BODIES] = {};
+	VECTOR3D weighted[NUM_ROBOT_BODIES];
+	for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+	{
+		partBodies[p] = partBodyTable[p];
+		bodyMass[partBodies[p]] += partMass[p];
+		weighted[partBodies[p]] += partCentre[p] * partMass[p];
+	}
+	for (int b = 0; b < NUM_ROBOT_BODIES; b++)
+		centres[b] = weighted[b] / bodyMass[b];
+
+	float inertia[NUM_ROBOT_BODIES][9] = {};
+	for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+	{
+		int b = partBodies[p];
+		VECTOR3D d = partCentre[p] - centres[b];
+		const float* dv = &d.x;
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				inertia[b][r * 3 + c] += partInertia[p][r * 3 + c]
+									   + partMass[p] * ((r == c ? d.GetQuaddLength() : 0.0f) - dv[r] * dv[c]);
+
+		partOffsets[p].LoadIdentity();
+		partOffsets[p].Translate(-centres[b].x, -centres[b].y, -centres[b].z);
+		partOffsets[p] = partOffsets[p] * parts[p];
+	}
+	for (int b = 0; b < NUM_ROBOT_BODIES; b++)
+	{
+		bodyInfo[b].invMass = 1.0f / bodyMass[b];
+		Invert(inertia[b], bodyInfo[b].invInertia);
+	}
+
+	// Hinges at the joints the part matrices rotate about, each about its parent's local z
+	struct { int bodyA, bodyB, joint, axisPart; VECTOR3D pivot; } layout[NUM_ROBOT_HINGES] =
+	{
+		{ BODY_TORSO, BODY_LEFT_THIGH, JOINT_LEFT_HIP, PART_LEFT_HIP, parts[PART_LEFT_HIP].GetColumn(3) },
+		{ BODY_LEFT_THIGH, BODY_LEFT_SHIN, JOINT_LEFT_KNEE, PART_LEFT_UPPER_LEG,
+		  parts[PART_LEFT_UPPER_LEG].GetColumn(3) - parts[PART_LEFT_UPPER_LEG].GetColumn(1) * 0.5f },
+		{ BODY_TORSO, BODY_RIGHT_THIGH, JOINT_RIGHT_HIP, PART_RIGHT_HIP, parts[PART_RIGHT_HIP].GetColumn(3) },
+		{ BODY_RIGHT_THIGH, BODY_RIGHT_SHIN, JOINT_RIGHT_KNEE, PART_RIGHT_UPPER_LEG,
+		  parts[PART_RIGHT_UPPER_LEG].GetColumn(3) - parts[PART_RIGHT_UPPER_LEG].GetColumn(1) * 0.5f },
+		{ BODY_TORSO, BODY_LEFT_UPPER_ARM, JOINT_LEFT_SHOULDER, PART_LEFT_SHOULDER, parts[PART_LEFT_SHOULDER].GetColumn(3) },
+		{ BODY_LEFT_UPPER_ARM, BODY_LEFT_GUN, JOINT_LEFT_ELBOW, PART_LEFT_UPPER_ARM, parts[PART_LEFT_ARM_GUN].GetColumn(3) },
+		{ BODY_TORSO, BODY_RIGHT_UPPER_ARM, JOINT_RIGHT_SHOULDER, PART_RIGHT_SHOULDER, parts[PART_RIGHT_SHOULDER].GetColumn(3) },
+		{ BODY_RIGHT_UPPER_ARM, BODY_RIGHT_GUN, JOINT_RIGHT_ELBOW, PART_RIGHT_UPPER_ARM, parts[PART_RIGHT_ARM_GUN].GetColumn(3) },
+	};
+	for (int i = 0; i < NUM_ROBOT_HINGES; i++)
+	{
+		HingeInfo& hinge = hinges[i];
+		hinge.bodyA = layout[i].bodyA;
+		hinge.bodyB = layout[i].bodyB;
+		hinge.joint = layout[i].joint;
+		hinge.anchorA = layout[i].pivot - centres[hinge.bodyA];
+		hinge.anchorB = layout[i].pivot - centres[hinge.bodyB];
+		hinge.axis = parts[layout[i].axisPart].GetColumn(2);
+		hinge.axis.Normalize();
+		hinge.reference = hinge.axis.CrossProduct(fabs(hinge.axis.y) < 0.9f ? VECTOR3D(0.0f, 1.0f, 0.0f)
+																		   : VECTOR3D(1.0f, 0.0f, 0.0f));
+		hinge.reference.Normalize();
+	}
+
+	// Points that can touch the ground: box corners, sphere centres and cylinder end centres
+	features.clear();
+	float lowest = 0.0f;
+	for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+	{
+		const MATRIX4X4& M = partOffsets[p];
+		ContactFeature feature;
+		feature.body = partBodies[p];
+		if (robotParts[p].shape == SHAPE_CUBE)
+		{
+			feature.radius = 0.0f;
+			for (int k = 0; k < 8; k++)
+			{
+				feature.point = M.TransformPoint(VECTOR3D(k & 1 ? 0.5f : -0.5f, k & 2 ? 0.5f : -0.5f, k & 4 ? 0.5f : -0.5f));
+				features.push_back(feature);
+			}
+		}
+		else
+		{
+			feature.radius = M.GetColumn(0).GetLength();
+			feature.point = M.TransformPoint(VECTOR3D(0.0f, 0.0f, 0.0f));
+			features.push_back(feature);
+			if (robotParts[p].shape == SHAPE_CYLINDER)
+			{
+				feature.point = M.TransformPoint(VECTOR3D(0.0f, 0.0f, 1.0f));
+				features.push_back(feature);
+			}
+		}
+	}
+	for (size_t f = 0; f < features.size(); f++)
+	{
+		float bottom = centres[features[f].body].y + features[f].point.y - features[f].radius;
+		if (f == 0 || bottom < lowest)
+			lowest = bottom;
+	}
+	standingHeight = -lowest;
+}
+
+void RobotPhysics::Init(const RobotDimensions& dims, int numRobots, const VECTOR3D* positions, const float* headings)
+{
+	this->dims = dims;
+	this->numRobots = numRobots < 0 ? 0 : numRobots;
+	accumulator = 0.0f;
+	BuildTemplate();
+
+	bodies.resize((size_t)this->numRobots * NUM_ROBOT_BODIES);
+	impulses.assign(this->numRobots, RobotImpulses());
+	contactImpulses.assign((size_t)this->numRobots * features.size(), ContactImpulses());
+	targets.assign(this->numRobots, RobotPose());
+
+	for (int r = 0; r < this->numRobots; r++)
+	{
+		float half = 0.5f * headings[r] / DEGREES;
+		float heading[4] = { cosf(half), 0.0f, sinf(half), 0.0f };
+		MATRIX4X4 root;
+		root.Translate(positions[r].x, positions[r].y, positions[r].z);
+		root.Rotate(headings[r], 0.0f, 1.0f, 0.0f);
+
+		for (int b = 0; b < NUM_ROBOT_BODIES; b++)
+		{
+			Body& body = bodies[r * NUM_ROBOT_BODIES + b];
+			body.position = root.TransformPoint(centres[b]);
+			for (int k = 0; k < 4; k++)
+				body.orientation[k] = heading[k];
+			body.velocity.LoadZero();
+			body.angularVelocity.LoadZero();
+		}
+	}
+}
+
+float RobotPhysics::GetGroundHeight(float x, float z) const
+{
+	float height;
+	if (ground && ground->GetHeight(x, z, height))
+		return height;
+	return params.groundHeight;
+}
+
+VECTOR3D RobotPhysics::GetGroundNormal(float x, float z) const
+{
+	if (!ground)
+		return VECTOR3D(0.0f, 1.0f, 0.0f);
+
+	// Central differences over half a grid cell
+	float ex = 0.5f * ground->dx, ez = 0.5f * ground->dz;
+	float slopeX = (GetGroundHeight(x + ex, z) - GetGroundHeight(x - ex, z)) / (2.0f * ex);
+	float slopeZ = (GetGroundHeight(x, z + ez) - GetGroundHeight(x, z - ez)) / (2.0f * ez);
+	VECTOR3D normal(-slopeX, 1.0f, -slopeZ);
+	normal.Normalize();
+	return normal;
+}
+
+void RobotPhysics::StepRobot(int robot, float h, std::vector<SolverRow>& rows, std::vector<SolverPoint>& points)
+{
+	Body* body = &bodies[(size_t)robot * NUM_ROBOT_BODIES];
+	RobotImpulses& stored = impulses[robot];
+	const RobotPose& target = targets[robot];
+	const float bias = params.baumgarte / h;
+	const float unlimited = FLT_MAX;
+
+	// Forces, and the world frame rotation and inverse inertia of every body
+	float rotation[NUM_ROBOT_BODIES][9];
+	float invInertia[NUM_ROBOT_BODIES][9];
+	float linearDamping = 1.0f / (1.0f + h * params.linearDamping);
+	float angularDamping = 1.0f / (1.0f + h * params.angularDamping);
+	for (int b = 0; b < NUM_ROBOT_BODIES; b++)
+	{
+		body[b].velocity.y += params.gravity * h;
+		body[b].velocity = body[b].velocity * linearDamping;
+		body[b].angularVelocity = body[b].angularVelocity * angularDamping;
+
+		float scaled[9];
+		GetRotation(body[b].orientation, rotation[b]);
+		Multiply(rotation[b], bodyInfo[b].invInertia, false, scaled);
+		Multiply(scaled, rotation[b], true, invInertia[b]);
+	}
+
+	rows.clear();
+	points.clear();
+	auto addRow = [&](int a, int b, const VECTOR3D& linear, const VECTOR3D& angularA, const VECTOR3D& angularB,
+					  float targetSpeed, float correction, float lower, float upper, float* warmStart)
+	{
+		SolverRow row;
+		row.a = a;
+		row.b = b;
+		row.linear = linear;
+		row.angularA = angularA;
+		row.angularB = angularB;
+		float k = 0.0f;
+		if (a >= 0)
+		{
+			row.turnA = Multiply(invInertia[a], angularA);
+			k += bodyInfo[a].invMass * linear.GetQuaddLength() + angularA.DotProduct(row.turnA);
+		}
+		if (b >= 0)
+		{
+			row.turnB = Multiply(invInertia[b], angularB);
+			k += bodyInfo[b].invMass * linear.GetQuaddLength() + angularB.DotProduct(row.turnB);
+		}
+		row.mass = k > 0.0f ? 1.0f / k : 0.0f;
+		row.target = targetSpeed;
+		row.correction = correction;
+		row.massScale = 1.0f;
+		row.impulseScale = 0.0f;
+		row.lower = lower;
+		row.upper = upper;
+		row.impulse = Clamp(*warmStart * params.warmStarting, lower, upper);
+		row.normalRow = -1;
+		row.warmStart = warmStart;
+		rows.push_back(row);
+	};
+
+	// Motors are springs toward the target angle, soft enough that two planted feet do not
+	// leave the legs fighting each other
+	float omega = 2.0f * PI * params.motorFrequency;
+	float stiffness = 2.0f * params.motorDampingRatio + h * omega;
+	float motorRate = omega / stiffness;
+	float motorImpulseScale = 1.0f / (1.0f + h * omega * stiffness);
+	float motorMassScale = h * omega * stiffness * motorImpulseScale;
+
+	// Hinges: the anchors meet, the axes line up, and the motor and limits act about the axis
+	const VECTOR3D unit[3] = { VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 1.0f, 0.0f), VECTOR3D(0.0f, 0.0f, 1.0f) };
+	const VECTOR3D zero(0.0f, 0.0f, 0.0f);
+	for (int i = 0; i < NUM_ROBOT_HINGES; i++)
+	{
+		const HingeInfo& hinge = hinges[i];
+		HingeImpulses& hingeImpulses = stored.hinges[i];
+		int a = hinge.bodyA, b = hinge.bodyB;
+		VECTOR3D rA = Multiply(rotation[a], hinge.anchorA);
+		VECTOR3D rB = Multiply(rotation[b], hinge.anchorB);
+		VECTOR3D gap = (body[b].position + rB) - (body[a].position + rA);
+
+		// K P = (1/mA + 1/mB) P + (IA^-1 (rA x P)) x rA + (IB^-1 (rB x P)) x rB
+		SolverPoint point;
+		point.a = a;
+		point.b = b;
+		point.rA = rA;
+		point.rB = rB;
+		float k[9];
+		for (int c = 0; c < 3; c++)
+		{
+			VECTOR3D column = unit[c] * (bodyInfo[a].invMass + bodyInfo[b].invMass)
+							+ Multiply(invInertia[a], rA.CrossProduct(unit[c])).CrossProduct(rA)
+							+ Multiply(invInertia[b], rB.CrossProduct(unit[c])).CrossProduct(rB);
+			k[c] = column.x;
+			k[3 + c] = column.y;
+			k[6 + c] = column.z;
+		}
+		Invert(k, point.invK);
+		point.correction = gap * -bias;
+		point.impulse = VECTOR3D(hingeImpulses.point) * params.warmStarting;
+		point.warmStart = hingeImpulses.point;
+		points.push_back(point);
+
+		VECTOR3D axis = Multiply(rotation[a], hinge.axis);
+		VECTOR3D axisB = Multiply(rotation[b], hinge.axis);
+		VECTOR3D reference = Multiply(rotation[a], hinge.reference);
+		VECTOR3D perpendicular[2] = { reference, axis.CrossProduct(reference) };
+		VECTOR3D misalignment = axisB.CrossProduct(axis);
+		for (int k = 0; k < 2; k++)
+			addRow(a, b, zero, -perpendicular[k], perpendicular[k],
+				   0.0f, bias * misalignment.DotProduct(perpendicular[k]), -unlimited, unlimited, &hingeImpulses.angular[k]);
+
+		float angle = GetHingeAngle(body[a].orientation, body[b].orientation, hinge.axis);
+		float error = target.angles[hinge.joint] / DEGREES - angle;
+		float speed = Clamp(motorRate * error, -params.maxMotorSpeed, params.maxMotorSpeed);
+		float torque = params.maxMotorTorque * h;
+		addRow(a, b, zero, -axis, axis, speed, 0.0f, -torque, torque, &hingeImpulses.motor);
+		rows.back().massScale = motorMassScale;
+		rows.back().impulseScale = motorImpulseScale;
+
+		const JointInfo& info = robotJoints[hinge.joint];
+		float minAngle = info.minAngle / DEGREES, maxAngle = info.maxAngle / DEGREES;
+		if (angle < minAngle)
+			addRow(a, b, zero, -axis, axis, 0.0f, bias * (minAngle - angle), 0.0f, unlimited, &hingeImpulses.limit);
+		else if (angle > maxAngle)
+			addRow(a, b, zero, -axis, axis, 0.0f, bias * (maxAngle - angle), -unlimited, 0.0f, &hingeImpulses.limit);
+		else
+			hingeImpulses.limit = 0.0f;
+	}
+
+	// Upright controller, turns the torso's up axis back toward the vertical about x and z
+	VECTOR3D up(rotation[BODY_TORSO][1], rotation[BODY_TORSO][4], rotation[BODY_TORSO][7]);
+	VECTOR3D tilt = up.CrossProduct(unit[1]);
+	float uprightTorque = params.maxUprightTorque * h;
+	addRow(-1, BODY_TORSO, zero, zero, unit[0], params.uprightGain * tilt.x, 0.0f, -uprightTorque, uprightTorque, &stored.upright[0]);
+	addRow(-1, BODY_TORSO, zero, zero, unit[2], params.uprightGain * tilt.z, 0.0f, -uprightTorque, uprightTorque, &stored.upright[1]);
+
+	// Ground contacts, with friction limited by the normal impulse
+	ContactImpulses* contacts = &contactImpulses[(size_t)robot * features.size()];
+	for (size_t f = 0; f < features.size(); f++)
+	{
+		const ContactFeature& feature = features[f];
+		const Body& owner = body[feature.body];
+		VECTOR3D point = owner.position + Multiply(rotation[feature.body], feature.point);
+		float depth = point.y - feature.radius - GetGroundHeight(point.x, point.z);
+		if (depth > params.contactMargin)
+		{
+			contacts[f].normal = contacts[f].tangent[0] = contacts[f].tangent[1] = 0.0f;
+			continue;
+		}
+
+		VECTOR3D normal = GetGroundNormal(point.x, point.z);
+		VECTOR3D r = point - normal * feature.radius - owner.position;
+		VECTOR3D tangent = normal.CrossProduct(fabs(normal.x) < 0.9f ? unit[0] : unit[2]);
+		tangent.Normalize();
+		VECTOR3D tangents[2] = { tangent, normal.CrossProduct(tangent) };
+
+		// separated contacts only stop the approach that would close the gap within the step
+		float speed = depth > 0.0f ? -depth / h : 0.0f;
+		float correction = depth < -params.slop ? bias * (-depth - params.slop) : 0.0f;
+		int normalRow = (int)rows.size();
+		addRow(-1, feature.body, normal, zero, r.CrossProduct(normal), speed, correction, 0.0f, unlimited, &contacts[f].normal);
+		for (int k = 0; k < 2; k++)
+		{
+			addRow(-1, feature.body, tangents[k], zero, r.CrossProduct(tangents[k]), 0.0f, 0.0f, -unlimited, unlimited, &contacts[f].tangent[k]);
+			rows.back().normalRow = normalRow;
+		}
+	}
+
+	// Sequential impulses, warm started with the impulses of the last step
+	auto apply = [&](const SolverRow& row, float impulse)
+	{
+		if (row.a >= 0)
+		{
+			body[row.a].velocity -= row.linear * (bodyInfo[row.a].invMass * impulse);
+			body[row.a].angularVelocity += row.turnA * impulse;
+		}
+		if (row.b >= 0)
+		{
+			body[row.b].velocity += row.linear * (bodyInfo[row.b].invMass * impulse);
+			body[row.b].angularVelocity += row.turnB * impulse;
+		}
+	};
+
+	auto applyPoint = [&](const SolverPoint& point, const VECTOR3D& impulse)
+	{
+		body[point.a].velocity -= impulse * bodyInfo[point.a].invMass;
+		body[point.a].angularVelocity -= Multiply(invInertia[point.a], point.rA.CrossProduct(impulse));
+		body[point.b].velocity += impulse * bodyInfo[point.b].invMass;
+		body[point.b].angularVelocity += Multiply(invInertia[point.b], point.rB.CrossProduct(impulse));
+	};
+
+	int numRows = (int)rows.size();
+	int numPoints = (int)points.size();
+	for (int i = 0; i < numPoints; i++)
+		applyPoint(points[i], points[i].impulse);
+	for (int i = 0; i < numRows; i++)
+		apply(rows[i], rows[i].impulse);
+
+	// One pass over every constraint, with or without the position corrections
+	auto solve = [&](bool correct)
+	{
+		for (int i = 0; i < numPoints; i++)
+		{
+			SolverPoint& point = points[i];
+			const Body& A = body[point.a];
+			const Body& B = body[point.b];
+			VECTOR3D speed = B.velocity + B.angularVelocity.CrossProduct(point.rB)
+						   - A.velocity - A.angularVelocity.CrossProduct(point.rA);
+			VECTOR3D impulse = Multiply(point.invK, (correct ? point.correction : zero) - speed);
+			applyPoint(point, impulse);
+			point.impulse += impulse;
+		}
+
+		for (int i = 0; i < numRows; i++)
+		{
+			SolverRow& row = rows[i];
+			if (row.normalRow >= 0)
+			{
+				row.upper = params.friction * rows[row.normalRow].impulse;
+				row.lower = -row.upper;
+			}
+
+			float speed = 0.0f;
+			if (row.a >= 0)
+				speed += row.angularA.DotProduct(body[row.a].angularVelocity) - row.linear.DotProduct(body[row.a].velocity);
+			if (row.b >= 0)
+				speed += row.angularB.DotProduct(body[row.b].angularVelocity) + row.linear.DotProduct(body[row.b].velocity);
+
+			float target = correct ? row.target + row.correction : row.target;
+			float impulse = Clamp(row.impulse + row.massScale * row.mass * (target - speed) - row.impulseScale * row.impulse,
+								  row.lower, row.upper);
+			apply(row, impulse - row.impulse);
+			row.impulse = impulse;
+		}
+	};
+
+	for (int iteration = 0; iteration < params.iterations; iteration++)
+		solve(true);
+
+	// Integration
+	for (int b = 0; b < NUM_ROBOT_BODIES; b++)
+	{
+		Body& state = body[b];
+		state.position += state.velocity * h;
+
+		float spin[4] = { 0.0f, state.angularVelocity.x, state.angularVelocity.y, state.angularVelocity.z };
+		float change[4];
+		MultiplyQuaternions(spin, state.orientation, change);
+		float length = 0.0f;
+		for (int k = 0; k < 4; k++)
+		{
+			state.orientation[k] += 0.5f * h * change[k];
+			length += state.orientation[k] * state.orientation[k];
+		}
+		length = 1.0f / sqrtf(length);
+		for (int k = 0; k < 4; k++)
+			state.orientation[k] *= length;
+	}
+
+	// The corrections have moved the bodies, relaxing without them takes back the speed they added
+	for (int iteration = 0; iteration < params.relaxIterations; iteration++)
+		solve(false);
+
+	for (int i = 0; i < numPoints; i++)
+	{
+		points[i].warmStart[0] = points[i].impulse.x;
+		points[i].warmStart[1] = points[i].impulse.y;
+		points[i].warmStart[2] = points[i].impulse.z;
+	}
+	for (int i = 0; i < numRows; i++)
+		*rows[i].warmStart = rows[i].impulse;
+}
+
+int RobotPhysics::Step(float dt, JobSystem* jobs, int chunkSize)
+{
+	float h = params.timeStep;
+	accumulator += dt;
+	int steps = (int)(accumulator / h);
+	if (steps > params.maxSteps)
+	{
+		steps = params.maxSteps;
+		accumulator = steps * h;
+	}
+	accumulator -= steps * h;
+	if (steps == 0)
+		return 0;
+
+	// Islands never touch, so each runs all of its steps in one go
+	auto stepRange = [&](int begin, int end)
+	{
+		std::vector<SolverRow> rows;
+		std::vector<SolverPoint> points;
+		rows.reserve(NUM_ROBOT_HINGES * 4 + 2 + features.size() * 3);
+		points.reserve(NUM_ROBOT_HINGES);
+		for (int r = begin; r < end; r++)
+			for (int s = 0; s < steps; s++)
+				StepRobot(r, h, rows, points);
+	};
+
+	if (jobs)
+		jobs->ParallelFor(numRobots, chunkSize, stepRange);
+	else
+		stepRange(0, numRobots);
+	return steps;
+}
+
+void RobotPhysics::GetPartMatrices(int robot, MATRIX4X4 partMatrices[NUM_ROBOT_PARTS]) const
+{
+	MATRIX4X4 frames[NUM_ROBOT_BODIES];
+	for (int b = 0; b < NUM_ROBOT_BODIES; b++)
+	{
+		const Body& body = bodies[(size_t)robot * NUM_ROBOT_BODIES + b];
+		float m[9];
+		GetRotation(body.orientation, m);
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				frames[b].entries[c * 4 + r] = m[r * 3 + c];
+		frames[b].entries[12] = body.position.x;
+		frames[b].entries[13] = body.position.y;
+		frames[b].entries[14] = body.position.z;
+	}
+
+	for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+		partMatrices[p] = frames[partBodies[p]] * partOffsets[p];
+
+	// Body and cannon turned by their target angles within the torso
+	MATRIX4X4 root = frames[BODY_TORSO];
+	root.Translate(-centres[BODY_TORSO].x, -centres[BODY_TORSO].y, -centres[BODY_TORSO].z);
+	RobotPose torsoPose;
+	torsoPose.angles[JOINT_BODY] = targets[robot].angles[JOINT_BODY];
+	torsoPose.angles[JOINT_CANNON] = targets[robot].angles[JOINT_CANNON];
+	MATRIX4X4 turned[NUM_ROBOT_PARTS];
+	ComputeRobotTransforms(dims, torsoPose, root, turned);
+	partMatrices[PART_BODY] = turned[PART_BODY];
+	partMatrices[PART_CANNON] = turned[PART_CANNON];
+	partMatrices[PART_NOTCH] = turned[PART_NOTCH];
+}
+
+void RobotPhysics::GetPose(int robot, RobotPose& pose) const
+{
+	pose = RobotPose();
+	const Body* body = &bodies[(size_t)robot * NUM_ROBOT_BODIES];
+	for (int i = 0; i < NUM_ROBOT_HINGES; i++)
+	{
+		const HingeInfo& hinge = hinges[i];
+		pose.angles[hinge.joint] = GetHingeAngle(body[hinge.bodyA].orientation, body[hinge.bodyB].orientation, hinge.axis) * DEGREES;
+	}
+}
+
+float RobotPhysics::GetUprightness(int robot) const
+{
+	float m[9];
+	GetRotation(bodies[(size_t)robot * NUM_ROBOT_BODIES + BODY_TORSO].orientation, m);
+	return m[4];
+}
+
+float RobotPhysics::GetMaxHingeError() const
+{
+	float largest = 0.0f;
+	for (int r = 0; r < numRobots; r++)
+	{
+		const Body* body = &bodies[(size_t)r * NUM_ROBOT_BODIES];
+		for (int i = 0; i < NUM_ROBOT_HINGES; i++)
+		{
+			const HingeInfo& hinge = hinges[i];
+			float a[9], b[9];
+			GetRotation(body[hinge.bodyA].orientation, a);
+			GetRotation(body[hinge.bodyB].orientation, b);
+			VECTOR3D gap = (body[hinge.bodyB].position + Multiply(b, hinge.anchorB))
+						 - (body[hinge.bodyA].position + Multiply(a, hinge.anchorA));
+			if (gap.GetLength() > largest)
+				largest = gap.GetLength();
+		}
+	}
+	return largest;
+}
+
+float RobotPhysics::GetMaxSpeed() const
+{
+	float largest = 0.0f;
+	for (size_t i = 0; i < bodies.size(); i++)
+	{
+		float speed = bodies[i].velocity.GetLength();
+		if (speed > largest)
+			largest = speed;
+	}
+	return largest;
+}
+
+bool RobotPhysics::IsFinite() const
+{
+	for (size_t i = 0; i < bodies.size(); i++)
+	{
+		const Body& body = bodies[i];
+		float sum = body.position.x + body.position.y + body.position.z
+				  + body.velocity.x + body.velocity.y + body.velocity.z
+				  + body.angularVelocity.x + body.angularVelocity.y + body.angularVelocity.z
+				  + body.orientation[0] + body.orientation[1] + body.orientation[2] + body.orientation[3];
+		if (!(sum - sum == 0.0f))
+			return false;
+	}
+	return true;
+}
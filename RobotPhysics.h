@@ -0,0 +1,241 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	RobotPhysics.h
+//	Rigid body simulation of walking robots. Each robot is nine bodies: the torso (body,
+//	cannon and notch), a thigh and a shin per leg and an upper arm and a gun per arm,
+//	joined by hinges at the hips, knees, shoulders and elbows. Motors on the hinges drive
+//	them toward target angles, such as those of a RobotPose or of GetWalkTargets().
+//
+//	Every fixed time step runs a sequential impulse solver over the hinges, their motors and
+//	limits and the contacts of the parts against a QuadMesh ground, warm started from the
+//	last step's impulses. Robots do not touch each other, so each one is an island of its
+//	own and the islands are solved in parallel over a JobSystem.
+//
+//	The robots have no ankles or sideways hips to balance with, so a torque limited upright
+//	controller keeps the torso from tipping over, leaving it free to turn about the vertical.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ROBOTPHYSICS_H
+#define ROBOTPHYSICS_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+
+class JobSystem;
+struct ParticleGround;
+
+enum RobotBody
+{
+	BODY_TORSO,
+	BODY_LEFT_THIGH,
+	BODY_LEFT_SHIN,
+	BODY_RIGHT_THIGH,
+	BODY_RIGHT_SHIN,
+	BODY_LEFT_UPPER_ARM,
+	BODY_LEFT_GUN,
+	BODY_RIGHT_UPPER_ARM,
+	BODY_RIGHT_GUN,
+	NUM_ROBOT_BODIES
+};
+
+const int NUM_ROBOT_HINGES = 8;
+
+struct PhysicsParams
+{
+	float gravity = -9.8f;
+	float timeStep = 1.0f / 120.0f;
+	int iterations = 8;
+	float warmStarting = 0.8f;		// fraction of the last step's impulses the solver starts from
+	int relaxIterations = 2;		// after the positions move, without the position corrections
+	float friction = 0.8f;
+	float baumgarte = 0.2f;			// fraction of the position error corrected per step
+	float slop = 0.01f;				// penetration left uncorrected, keeps contacts resting
+	float contactMargin = 0.1f;		// contacts are made this far before touching
+	float groundHeight = -10.0f;	// where there is no ground mesh
+	float linearDamping = 0.02f;	// fraction of the velocity lost per second
+	float angularDamping = 0.1f;
+	float motorFrequency = 15.0f;	// of the spring each motor drives its hinge with, in hertz
+	float motorDampingRatio = 1.0f;
+	float maxMotorSpeed = 6.0f;		// radians per second
+	float maxMotorTorque = 4000.0f;
+	float maxUprightTorque = 6000.0f;
+	float uprightGain = 8.0f;
+	int maxSteps = 10;				// per Step() call, the rest of a longer frame is dropped
+};
+
+// Gait for the legs at phase (radians) of the stride, the other joints of pose are left alone
+void GetWalkTargets(float phase, RobotPose& pose);
+
+class RobotPhysics
+{
+private:
+	struct Body
+	{
+		VECTOR3D position;			// centre of mass
+		float orientation[4];		// unit quaternion w, x, y, z from the local frame
+		VECTOR3D velocity;
+		VECTOR3D angularVelocity;
+	};
+
+	// Constant for every robot, built once from the dimensions
+	struct BodyInfo
+	{
+		float invMass;
+		float invInertia[9];		// local frame, row major
+	};
+
+	struct HingeInfo
+	{
+		int bodyA, bodyB;			// parent and child
+		int joint;					// JointId of its angle
+		VECTOR3D anchorA, anchorB;	// local
+		VECTOR3D axis;				// local, the same in A and B at angle 0
+		VECTOR3D reference;			// local to A, perpendicular to the axis
+	};
+
+	// Point of a part that can touch the ground, the surface is radius below it
+	struct ContactFeature
+	{
+		int body;
+		VECTOR3D point;				// local
+		float radius;
+	};
+
+	// Accumulated impulses of the last step, for warm starting
+	struct HingeImpulses
+	{
+		float point[3];
+		float angular[2];
+		float motor;
+		float limit;
+	};
+
+	struct RobotImpulses
+	{
+		HingeImpulses hinges[NUM_ROBOT_HINGES];
+		float upright[2];
+	};
+
+	struct ContactImpulses
+	{
+		float normal, tangent[2];
+	};
+
+	// One velocity constraint between bodies a and b of a robot, -1 for the world
+	struct SolverRow
+	{
+		int a, b;
+		VECTOR3D linear;			// b's linear Jacobian, a's is its negative
+		VECTOR3D angularA, angularB;
+		VECTOR3D turnA, turnB;		// inverse inertia times the angular Jacobians
+		float mass;					// effective mass
+		float target;				// relative velocity the row drives toward
+		float correction;			// added to the target to take out position error
+		float massScale, impulseScale;	// softness of spring rows, 1 and 0 for rigid ones
+		float lower, upper;			// limits of the accumulated impulse
+		float impulse;
+		int normalRow;				// friction rows take their limits from this row, -1 otherwise
+		float* warmStart;			// where the impulse is kept between steps
+	};
+
+	// Hinge anchors held together by one 3x3 block, which converges far faster than three rows
+	struct SolverPoint
+	{
+		int a, b;
+		VECTOR3D rA, rB;			// anchors relative to the centres of mass
+		float invK[9];				// inverse of the effective mass matrix
+		VECTOR3D correction;
+		VECTOR3D impulse;
+		float* warmStart;
+	};
+
+	PhysicsParams params;
+	const ParticleGround* ground;
+	float accumulator;
+	int numRobots;
+
+	RobotDimensions dims;
+	float standingHeight;
+	VECTOR3D centres[NUM_ROBOT_BODIES];		// of mass, in the robot's frame at rest
+	BodyInfo bodyInfo[NUM_ROBOT_BODIES];
+	HingeInfo hinges[NUM_ROBOT_HINGES];
+	std::vector<ContactFeature> features;
+	int partBodies[NUM_ROBOT_PARTS];
+	MATRIX4X4 partOffsets[NUM_ROBOT_PARTS];	// part matrices in their body's local frame
+
+	// Per robot, robot r's entries from r times the count per robot
+	std::vector<Body> bodies;
+	std::vector<RobotImpulses> impulses;
+	std::vector<ContactImpulses> contactImpulses;
+	std::vector<RobotPose> targets;
+
+private:
+	void BuildTemplate();
+	float GetGroundHeight(float x, float z) const;
+	VECTOR3D GetGroundNormal(float x, float z) const;
+	void StepRobot(int robot, float h, std::vector<SolverRow>& rows, std::vector<SolverPoint>& points);
+
+public:
+	RobotPhysics();
+
+	// numRobots robots at rest with their root, as ComputeRobotTransforms() takes it, at
+	// positions[i] and turned by headings[i] degrees about the vertical
+	void Init(const RobotDimensions& dims, int numRobots, const VECTOR3D* positions, const float* headings);
+
+	// Height of the root above the ground when the robot stands on its feet at rest
+	float GetStandingHeight() const
+	{
+		return standingHeight;
+	}
+
+	void SetParams(const PhysicsParams& params)
+	{
+		this->params = params;
+	}
+
+	// Heights the robots stand on, NULL for a flat ground at params.groundHeight
+	void SetGround(const ParticleGround* ground)
+	{
+		this->ground = ground;
+	}
+
+	// Angles the motors drive the hinges toward
+	void SetTargets(int robot, const RobotPose& pose)
+	{
+		targets[robot] = pose;
+	}
+
+	// Advances every robot by dt seconds in whole fixed time steps, the remainder is carried
+	// over to the next call. Returns the number of steps taken.
+	int Step(float dt, JobSystem* jobs = NULL, int chunkSize = 4);
+
+	// World matrix of every part, as ComputeRobotTransforms() gives them. The body and cannon
+	// joints are not simulated, their parts follow the target angles within the torso.
+	void GetPartMatrices(int robot, MATRIX4X4 partMatrices[NUM_ROBOT_PARTS]) const;
+
+	// The hinges' current angles, the other joints at 0
+	void GetPose(int robot, RobotPose& pose) const;
+
+	VECTOR3D GetTorsoPosition(int robot) const
+	{
+		return bodies[robot * NUM_ROBOT_BODIES + BODY_TORSO].position;
+	}
+
+	// Cosine of the torso's tilt from upright
+	float GetUprightness(int robot) const;
+
+	// Largest gap between the two sides of a hinge, over every robot
+	float GetMaxHingeError() const;
+
+	// Largest speed of any body, and whether every body's state is a finite number
+	float GetMaxSpeed() const;
+	bool IsFinite() const;
+
+	int GetNumRobots() const
+	{
+		return numRobots;
+	}
+};
+
+#endif	//ROBOTPHYSICS_H
@@ -0,0 +1,140 @@
+#include <math.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+
+#include "RobotVariants.h"
+
+
+// Integer hash with good avalanche, so neighbouring indices give unrelated variants
+static unsigned int Hash(unsigned int x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+// Uniform in [0, 1) from the next hash of state
+static float NextRandom(unsigned int& state)
+{
+	state = Hash(state + 0x9e3779b9u);
+	return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+static void SetColour(float* colour, float r, float g, float b)
+{
+	colour[0] = r;
+	colour[1] = g;
+	colour[2] = b;
+	colour[3] = 1.0f;
+}
+
+// Hue in [0, 1) around the colour circle
+static void HSVToRGB(float h, float s, float v, float* rgb)
+{
+	float sector = h * 6.0f;
+	int i = (int)sector % 6;
+	float f = sector - floorf(sector);
+	float p = v * (1.0f - s), q = v * (1.0f - s * f), t = v * (1.0f - s * (1.0f - f));
+	switch (i)
+	{
+	case 0: SetColour(rgb, v, t, p); break;
+	case 1: SetColour(rgb, q, v, p); break;
+	case 2: SetColour(rgb, p, v, t); break;
+	case 3: SetColour(rgb, p, q, v); break;
+	case 4: SetColour(rgb, t, p, v); break;
+	default: SetColour(rgb, v, p, q); break;
+	}
+}
+
+void GenerateVariantPalette(unsigned int seed, VariantPalette& palette)
+{
+	unsigned int state = Hash(seed);
+	for (int i = 0; i < VARIANT_PALETTE_SIZE; i++)
+	{
+		// evenly spread hues, jittered within their share of the circle
+		VariantMaterial& body = palette.body[i];
+		float hue = (i + 0.8f * NextRandom(state)) / VARIANT_PALETTE_SIZE;
+		HSVToRGB(hue, 0.6f + 0.35f * NextRandom(state), 0.6f + 0.35f * NextRandom(state), body.diffuse);
+		SetColour(body.ambient, 0.15f * body.diffuse[0], 0.15f * body.diffuse[1], 0.15f * body.diffuse[2]);
+		float specular = 0.4f + 0.3f * NextRandom(state);
+		SetColour(body.specular, specular, specular, specular);
+		body.shininess = 16.0f + 48.0f * NextRandom(state);
+
+		// dark metal with a slight tint, lit mostly by its highlights
+		VariantMaterial& legs = palette.legs[i];
+		HSVToRGB(NextRandom(state), 0.3f * NextRandom(state), 0.03f + 0.15f * NextRandom(state), legs.diffuse);
+		float ambient = 0.15f + 0.15f * NextRandom(state);
+		SetColour(legs.ambient, ambient, ambient, ambient);
+		specular = 0.5f + 0.3f * NextRandom(state);
+		SetColour(legs.specular, specular, specular, specular);
+		legs.shininess = 60.0f + 60.0f * NextRandom(state);
+	}
+}
+
+RobotVariant MakeRobotVariant(unsigned int seed, int index, float baseBodySize)
+{
+	unsigned int state = Hash(seed ^ Hash((unsigned int)index));
+	RobotVariant variant;
+	variant.bodySize = baseBodySize * (0.75f + 0.5f * NextRandom(state));
+	for (int i = 0; i < NUM_VARIANT_PROPORTIONS; i++)
+		variant.proportions[i] = (unsigned char)(NextRandom(state) * 256.0f);
+	variant.bodyMaterial = (unsigned char)(NextRandom(state) * VARIANT_PALETTE_SIZE);
+	variant.legMaterial = (unsigned char)(NextRandom(state) * VARIANT_PALETTE_SIZE);
+	return variant;
+}
+
+float GetVariantProportion(const RobotVariant& variant, int proportion)
+{
+	return 0.7f + variant.proportions[proportion] * (0.6f / 255.0f);
+}
+
+void GetVariantDimensions(const RobotVariant& variant, RobotDimensions& dims)
+{
+	dims.Init(variant.bodySize);
+
+	float legLength = GetVariantProportion(variant, VARIANT_LEG_LENGTH);
+	dims.upperLegLength *= legLength;
+	dims.lowerLegLength *= legLength;
+
+	float thickness = GetVariantProportion(variant, VARIANT_LIMB_THICKNESS);
+	dims.upperLegHeight *= thickness;
+	dims.upperLegWidth *= thickness;
+	dims.lowerLegHeight *= thickness;
+	dims.lowerLegWidth *= thickness;
+	dims.upperArmHeight *= thickness;
+	dims.upperArmWidth *= thickness;
+	dims.armGunRad *= thickness;
+
+	// the arm keeps its length relative to the legs, as in RobotDimensions::Init()
+	float armLength = GetVariantProportion(variant, VARIANT_ARM_LENGTH);
+	dims.upperArmLength *= legLength * armLength;
+	dims.armGunLength *= legLength * armLength;
+
+	float cannon = GetVariantProportion(variant, VARIANT_CANNON_SIZE);
+	dims.cannonLength *= cannon;
+	dims.cannonWidth *= cannon;
+	dims.notchSize *= cannon;
+	dims.notchLength *= cannon;
+
+	float joints = GetVariantProportion(variant, VARIANT_JOINT_SIZE);
+	dims.hipRad *= joints;
+	dims.shoulderRad *= joints;
+
+	float foot = GetVariantProportion(variant, VARIANT_FOOT_SIZE);
+	dims.footLength *= foot;
+	dims.footHeight *= foot;
+	dims.footDepth *= foot;
+}
+
+float GetRestHeight(const RobotDimensions& dims)
+{
+	RobotPose pose;
+	MATRIX4X4 root;
+	MATRIX4X4 partMatrices[NUM_ROBOT_PARTS];
+	ComputeRobotTransforms(dims, pose, root, partMatrices);
+	return -ComputeRobotBounds(partMatrices).min.y;
+}
@@ -0,0 +1,68 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	RobotVariants.h
+//	Procedural robot variants. Every dimension of RobotDimensions follows from
+//	robotBodySize, so a variant is only a body size, a handful of proportion scales and
+//	two material indices, packed into a 12 byte record. It is expanded into its
+//	RobotDimensions when its part matrices are computed; the parts are still drawn from
+//	the shared unit primitives, scaled by those matrices, so no variant has meshes of
+//	its own.
+//
+//	Materials come from a small palette of body and leg materials generated once, so the
+//	renderer only needs one material, or shader uniform buffer, per palette entry.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ROBOTVARIANTS_H
+#define ROBOTVARIANTS_H
+
+#include "RobotModel.h"
+
+// Proportions a variant scales, each by 0.7 to 1.3 times the standard robot's
+enum VariantProportion
+{
+	VARIANT_LEG_LENGTH,
+	VARIANT_LIMB_THICKNESS,
+	VARIANT_ARM_LENGTH,
+	VARIANT_CANNON_SIZE,
+	VARIANT_JOINT_SIZE,
+	VARIANT_FOOT_SIZE,
+	NUM_VARIANT_PROPORTIONS
+};
+
+const int VARIANT_PALETTE_SIZE = 16;
+
+struct RobotVariant
+{
+	float bodySize;										// robotBodySize
+	unsigned char proportions[NUM_VARIANT_PROPORTIONS];	// 0 to 255 for 0.7 to 1.3
+	unsigned char bodyMaterial, legMaterial;			// palette entries
+};
+
+struct VariantMaterial
+{
+	float ambient[4];
+	float diffuse[4];
+	float specular[4];
+	float shininess;
+};
+
+struct VariantPalette
+{
+	VariantMaterial body[VARIANT_PALETTE_SIZE];
+	VariantMaterial legs[VARIANT_PALETTE_SIZE];
+};
+
+// Bright body colours around the hue circle and dark metallic leg finishes
+void GenerateVariantPalette(unsigned int seed, VariantPalette& palette);
+
+// Variant index of the sequence seed names, the same whichever order they are made in.
+// Body sizes range from 0.75 to 1.25 times baseBodySize.
+RobotVariant MakeRobotVariant(unsigned int seed, int index, float baseBodySize = 2.0f);
+
+float GetVariantProportion(const RobotVariant& variant, int proportion);
+
+void GetVariantDimensions(const RobotVariant& variant, RobotDimensions& dims);
+
+// How far the root is above the soles of the feet in the rest pose
+float GetRestHeight(const RobotDimensions& dims);
+
+#endif	//ROBOTVARIANTS_H
@@ -0,0 +1,284 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "QuadMesh.h"
+#include "RobotModel.h"
+#include "MeshOptimizer.h"
+#include "JobSystem.h"
+
+#include "Shadows.h"
+
+
+// Vertices closer to the light than this are behind it, their triangles are dropped
+static const float nearDistance = 0.01f;
+
+// Receivers must be this much farther from the light than a caster to be in its shadow
+static const float depthBias = 0.05f;
+
+// Widest the map gets when the light is close to or inside the casters' bounds
+static const float maxHalfAngle = 1.0471976f;	// 60 degrees
+
+
+ShadowMap::ShadowMap(int size)
+{
+	this->size = size;
+	depth.assign((size_t)size * size, 0.0f);
+	focal = 0.5f * size;
+	rendered = false;
+	numTriangles = 0;
+
+	// shadows only need the outline, so the shapes are much coarser than the drawn parts
+	BuildSphereMesh(24, 16, shapes[SHAPE_SPHERE]);
+	BuildCylinderMesh(24, 1, shapes[SHAPE_CYLINDER]);
+	BuildCubeMesh(shapes[SHAPE_CUBE]);
+}
+
+void ShadowMap::GatherParts(const ShadowCaster* casters, int numCasters)
+{
+	parts.resize((size_t)numCasters * NUM_ROBOT_PARTS);
+	for (int i = 0; i < numCasters; i++)
+	{
+		for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+		{
+			MATRIX4X4& part = parts[(size_t)i * NUM_ROBOT_PARTS + p];
+			part = casters[i].partMatrices[p];
+			part.entries[12] += casters[i].offset.x;
+			part.entries[13] += casters[i].offset.y;
+			part.entries[14] += casters[i].offset.z;
+		}
+	}
+}
+
+void ShadowMap::Render(const VECTOR3D& light, const ShadowCaster* casters, int numCasters)
+{
+	GatherParts(casters, numCasters);
+	RenderParts(light);
+	renderedParts.swap(parts);
+	renderedLight = light;
+	rendered = true;
+}
+
+bool ShadowMap::Update(const VECTOR3D& light, const ShadowCaster* casters, int numCasters)
+{
+	GatherParts(casters, numCasters);
+	if (rendered && light.x == renderedLight.x && light.y == renderedLight.y && light.z == renderedLight.z &&
+		parts.size() == renderedParts.size() &&
+		(parts.empty() || memcmp(&parts[0], &renderedParts[0], parts.size() * sizeof(MATRIX4X4)) == 0))
+	{
+		return false;
+	}
+
+	RenderParts(light);
+	renderedParts.swap(parts);
+	renderedLight = light;
+	rendered = true;
+	return true;
+}
+
+void ShadowMap::RenderParts(const VECTOR3D& light)
+{
+	memset(&depth[0], 0, depth.size() * sizeof(float));
+	numTriangles = 0;
+	if (parts.empty())
+		return;
+
+	// Fit the map around a sphere enclosing every part
+	BBox bounds = ComputePartBounds(robotParts[0].shape, parts[0]);
+	for (size_t i = 1; i < parts.size(); i++)
+	{
+		BBox box = ComputePartBounds(robotParts[i % NUM_ROBOT_PARTS].shape, parts[i]);
+		if (box.min.x < bounds.min.x) bounds.min.x = box.min.x;
+		if (box.min.y < bounds.min.y) bounds.min.y = box.min.y;
+		if (box.min.z < bounds.min.z) bounds.min.z = box.min.z;
+		if (box.max.x > bounds.max.x) bounds.max.x = box.max.x;
+		if (box.max.y > bounds.max.y) bounds.max.y = box.max.y;
+		if (box.max.z > bounds.max.z) bounds.max.z = box.max.z;
+	}
+	VECTOR3D centre = (bounds.min + bounds.max) * 0.5f;
+	float radius = (bounds.max - bounds.min).GetLength() * 0.5f;
+
+	VECTOR3D direction = centre - light;
+	float distance = direction.GetLength();
+	float halfAngle = distance > radius ? (float)asin(radius / distance) : maxHalfAngle;
+	if (halfAngle > maxHalfAngle)
+		halfAngle = maxHalfAngle;
+	focal = 0.5f * size / (float)tan(halfAngle);
+
+	VECTOR3D up(0.0f, 1.0f, 0.0f);
+	if (fabs(direction.y) > 0.99f * distance)
+		up = VECTOR3D(0.0f, 0.0f, 1.0f);
+	lightView = MATRIX4X4::GetLookAt(light, centre, up);
+
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		const IndexedMesh& shape = shapes[robotParts[i % NUM_ROBOT_PARTS].shape];
+		MATRIX4X4 toLight = lightView * parts[i];
+
+		projected.resize(shape.vertices.size());
+		for (size_t v = 0; v < shape.vertices.size(); v++)
+		{
+			VECTOR3D p = toLight.TransformPoint(shape.vertices[v].position);
+			float d = -p.z;
+			if (d < nearDistance)
+				projected[v] = VECTOR3D(0.0f, 0.0f, -1.0f);
+			else
+				projected[v] = VECTOR3D(0.5f * size + focal * p.x / d, 0.5f * size + focal * p.y / d, 1.0f / d);
+		}
+
+		for (size_t t = 0; t + 2 < shape.indices.size(); t += 3)
+		{
+			const VECTOR3D& a = projected[shape.indices[t]];
+			const VECTOR3D& b = projected[shape.indices[t + 1]];
+			const VECTOR3D& c = projected[shape.indices[t + 2]];
+			if (a.z > 0.0f && b.z > 0.0f && c.z > 0.0f)
+			{
+				RasterizeTriangle(a, b, c);
+				numTriangles++;
+			}
+		}
+	}
+}
+
+// Keeps the largest 1 / distance at every pixel centre inside the triangle, either winding
+void ShadowMap::RasterizeTriangle(const VECTOR3D& a, const VECTOR3D& b, const VECTOR3D& c)
+{
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (area == 0.0f)
+		return;
+
+	int minX = (int)floorf(fminf(a.x, fminf(b.x, c.x)));
+	int maxX = (int)ceilf(fmaxf(a.x, fmaxf(b.x, c.x)));
+	int minY = (int)floorf(fminf(a.y, fminf(b.y, c.y)));
+	int maxY = (int)ceilf(fmaxf(a.y, fmaxf(b.y, c.y)));
+	if (minX < 0) minX = 0;
+	if (minY < 0) minY = 0;
+	if (maxX > size - 1) maxX = size - 1;
+	if (maxY > size - 1) maxY = size - 1;
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// Barycentric weights of a and b step linearly across the pixels
+	float invArea = 1.0f / area;
+	float stepAX = (b.y - c.y) * invArea, stepAY = (c.x - b.x) * invArea;
+	float stepBX = (c.y - a.y) * invArea, stepBY = (a.x - c.x) * invArea;
+
+	float px = minX + 0.5f, py = minY + 0.5f;
+	float rowA = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) * invArea;
+	float rowB = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) * invArea;
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		float* row = &depth[(size_t)y * size];
+		float wa = rowA, wb = rowB;
+		for (int x = minX; x <= maxX; x++)
+		{
+			float wc = 1.0f - wa - wb;
+			if (wa >= 0.0f && wb >= 0.0f && wc >= 0.0f)
+			{
+				float z = wa * a.z + wb * b.z + wc * c.z;
+				if (z > row[x])
+					row[x] = z;
+			}
+			wa += stepAX;
+			wb += stepBX;
+		}
+		rowA += stepAY;
+		rowB += stepBY;
+	}
+}
+
+float ShadowMap::GetVisibility(const VECTOR3D& point) const
+{
+	if (!rendered)
+		return 1.0f;
+
+	VECTOR3D p = lightView.TransformPoint(point);
+	float distance = -p.z;
+	if (distance <= nearDistance + depthBias)
+		return 1.0f;
+
+	// Texel containing the projection, with its eight neighbours
+	int cx = (int)floorf(0.5f * size + focal * p.x / distance);
+	int cy = (int)floorf(0.5f * size + focal * p.y / distance);
+	float threshold = 1.0f / (distance - depthBias);
+
+	int lit = 0;
+	for (int y = cy - 1; y <= cy + 1; y++)
+	{
+		for (int x = cx - 1; x <= cx + 1; x++)
+		{
+			if (x < 0 || y < 0 || x >= size || y >= size || depth[(size_t)y * size + x] <= threshold)
+				lit++;
+		}
+	}
+	return lit / 9.0f;
+}
+
+
+void BuildShadowMask(const ShadowMap* const* maps, int numMaps, const QuadMesh& ground, const VECTOR3D& groundOffset,
+					 float ambient, int maskSize, unsigned char* mask, JobSystem* jobs)
+{
+	int meshSize = ground.GetMeshSize();
+
+	auto buildRows = [&](int begin, int end)
+	{
+		for (int j = begin; j < end; j++)
+		{
+			// texel centres in grid cells, row along t and column along s
+			float t = (j + 0.5f) * meshSize / maskSize;
+			int row = (int)t < meshSize ? (int)t : meshSize - 1;
+			float ft = t - row;
+
+			for (int i = 0; i < maskSize; i++)
+			{
+				float s = (i + 0.5f) * meshSize / maskSize;
+				int col = (int)s < meshSize ? (int)s : meshSize - 1;
+				float fs = s - col;
+
+				const VECTOR3D& p00 = ground.GetVertex(row, col).position;
+				const VECTOR3D& p01 = ground.GetVertex(row, col + 1).position;
+				const VECTOR3D& p10 = ground.GetVertex(row + 1, col).position;
+				const VECTOR3D& p11 = ground.GetVertex(row + 1, col + 1).position;
+				VECTOR3D p0 = p00 + (p01 - p00) * fs;
+				VECTOR3D p1 = p10 + (p11 - p10) * fs;
+				VECTOR3D point = p0 + (p1 - p0) * ft + groundOffset;
+
+				float light = 1.0f;
+				if (numMaps > 0)
+				{
+					light = 0.0f;
+					for (int m = 0; m < numMaps; m++)
+						light += maps[m]->GetVisibility(point);
+					light /= numMaps;
+				}
+				mask[(size_t)j * maskSize + i] = (unsigned char)(255.0f * (ambient + (1.0f - ambient) * light) + 0.5f);
+			}
+		}
+	};
+
+	if (jobs)
+		jobs->ParallelFor(maskSize, 8, buildRows);
+	else
+		buildRows(0, maskSize);
+}
+
+void GetShadowMaskPlanes(const QuadMesh& ground, float sPlane[4], float tPlane[4])
+{
+	// The grid's edges from vertex (0, 0), flattened so the heights do not matter
+	int meshSize = ground.GetMeshSize();
+	VECTOR3D origin = ground.GetVertex(0, 0).position;
+	VECTOR3D edgeS = ground.GetVertex(0, meshSize).position - origin;
+	VECTOR3D edgeT = ground.GetVertex(meshSize, 0).position - origin;
+	edgeS.y = 0.0f;
+	edgeT.y = 0.0f;
+	origin.y = 0.0f;
+
+	edgeS /= edgeS.GetQuaddLength();
+	edgeT /= edgeT.GetQuaddLength();
+	sPlane[0] = edgeS.x; sPlane[1] = 0.0f; sPlane[2] = edgeS.z; sPlane[3] = -edgeS.DotProduct(origin);
+	tPlane[0] = edgeT.x; tPlane[1] = 0.0f; tPlane[2] = edgeT.z; tPlane[3] = -edgeT.DotProduct(origin);
+}
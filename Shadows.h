@@ -0,0 +1,102 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Shadows.h
+//	Robot shadows on the ground, computed on the CPU so they work with the fixed function
+//	pipeline.
+//
+//	Planar shadows draw the casters a second time, flattened onto the ground plane by
+//	MATRIX4X4::GetPlanarShadow(). ShadowMap is the general path: it rasterises the depth
+//	of the casters as seen from a point light into a float buffer, fitted around the
+//	casters' bounds. BuildShadowMask() looks every texel of a texture over the ground up
+//	in the maps, the ground is then drawn modulated by that texture.
+//
+//	The casters are the robots that are drawn this frame. ShadowMap::Update() keeps the
+//	part matrices and light of its last render and only renders again when they change.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SHADOWS_H
+#define SHADOWS_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "MeshOptimizer.h"
+
+class QuadMesh;
+class JobSystem;
+
+// One robot casting a shadow, its parts are moved by offset into the shadow's frame
+struct ShadowCaster
+{
+	const MATRIX4X4* partMatrices;
+	VECTOR3D offset;
+};
+
+class ShadowMap
+{
+private:
+	int size;
+	std::vector<float> depth;		// 1 / distance along the light's view axis of the nearest caster, 0 where none
+
+	MATRIX4X4 lightView;
+	float focal;					// map pixels per unit of x / distance
+
+	// Coarse unit sphere, cylinder and cube, indexed by PartShape
+	IndexedMesh shapes[3];
+
+	// Inputs of the last render, offsets folded into the part matrices
+	bool rendered;
+	VECTOR3D renderedLight;
+	std::vector<MATRIX4X4> renderedParts;
+	std::vector<MATRIX4X4> parts;
+
+	// Part vertices in map space: pixel x, pixel y, 1 / distance
+	std::vector<VECTOR3D> projected;
+	int numTriangles;
+
+	void GatherParts(const ShadowCaster* casters, int numCasters);
+	void RenderParts(const VECTOR3D& light);
+	void RasterizeTriangle(const VECTOR3D& a, const VECTOR3D& b, const VECTOR3D& c);
+
+public:
+	ShadowMap(int size = 512);
+
+	// Depth of the casters seen from a point light
+	void Render(const VECTOR3D& light, const ShadowCaster* casters, int numCasters);
+
+	// Renders only when the light or any part matrix differs from the last render,
+	// returns true when it did
+	bool Update(const VECTOR3D& light, const ShadowCaster* casters, int numCasters);
+
+	// Fraction of the 3x3 texels around the point's projection that the light reaches
+	float GetVisibility(const VECTOR3D& point) const;
+
+	// Unit primitive the map draws a part shape with
+	const IndexedMesh& GetShape(PartShape shape) const
+	{
+		return shapes[shape];
+	}
+
+	int GetSize() const
+	{
+		return size;
+	}
+
+	// Triangles rasterised by the last render
+	int GetNumTriangles() const
+	{
+		return numTriangles;
+	}
+};
+
+// Fills mask, maskSize x maskSize texels over the ground grid, with the light reaching
+// each texel averaged over the maps: 255 when fully lit, 255 * ambient when fully shadowed.
+// The ground's vertices are moved by groundOffset into the maps' frame. Rows are built in
+// parallel when jobs is given.
+void BuildShadowMask(const ShadowMap* const* maps, int numMaps, const QuadMesh& ground, const VECTOR3D& groundOffset,
+					 float ambient, int maskSize, unsigned char* mask, JobSystem* jobs = NULL);
+
+// Object linear texture coordinate planes that map the ground grid onto the mask
+void GetShadowMaskPlanes(const QuadMesh& ground, float sPlane[4], float tPlane[4]);
+
+#endif	//SHADOWS_H
@@ -0,0 +1,519 @@
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <emmintrin.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "MeshOptimizer.h"
+#include "JobSystem.h"
+
+#include "Skinning.h"
+
+
+void SkinMesh::Resize(int count)
+{
+	numVertices = (count + 3) & ~3;
+	for (int c = 0; c < 3; c++)
+	{
+		positions[c].assign(numVertices, 0.0f);
+		normals[c].assign(numVertices, 0.0f);
+	}
+	for (int k = 0; k < MAX_SKIN_INFLUENCES; k++)
+	{
+		bones[k].assign(numVertices, 0);
+		weights[k].assign(numVertices, 0.0f);
+	}
+}
+
+void SkinBones::Set(const SkinMesh& mesh, const MATRIX4X4 partMatrices[NUM_ROBOT_PARTS])
+{
+	for (int b = 0; b < NUM_ROBOT_PARTS; b++)
+	{
+		MATRIX4X4 skin = partMatrices[b] * mesh.inverseBind[b];
+		const float* m = skin.entries;
+
+		// rows of the column major matrix
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 4; c++)
+				matrices[b][r * 4 + c] = m[c * 4 + r];
+		}
+
+		// rotation to quaternion, from the largest of w, x, y, z for precision
+		float q[4];
+		float trace = m[0] + m[5] + m[10];
+		if (trace > 0.0f)
+		{
+			float s = 0.5f / (float)sqrt(trace + 1.0f);
+			q[3] = 0.25f / s;
+			q[0] = (m[6] - m[9]) * s;
+			q[1] = (m[8] - m[2]) * s;
+			q[2] = (m[1] - m[4]) * s;
+		}
+		else if (m[0] > m[5] && m[0] > m[10])
+		{
+			float s = 2.0f * (float)sqrt(1.0f + m[0] - m[5] - m[10]);
+			q[3] = (m[6] - m[9]) / s;
+			q[0] = 0.25f * s;
+			q[1] = (m[4] + m[1]) / s;
+			q[2] = (m[8] + m[2]) / s;
+		}
+		else if (m[5] > m[10])
+		{
+			float s = 2.0f * (float)sqrt(1.0f + m[5] - m[0] - m[10]);
+			q[3] = (m[8] - m[2]) / s;
+			q[0] = (m[4] + m[1]) / s;
+			q[1] = 0.25f * s;
+			q[2] = (m[9] + m[6]) / s;
+		}
+		else
+		{
+			float s = 2.0f * (float)sqrt(1.0f + m[10] - m[0] - m[5]);
+			q[3] = (m[1] - m[4]) / s;
+			q[0] = (m[8] + m[2]) / s;
+			q[1] = (m[9] + m[6]) / s;
+			q[2] = 0.25f * s;
+		}
+
+		// dual part 0.5 * (t, 0) * q
+		float tx = m[12], ty = m[13], tz = m[14];
+		float* dq = dualQuaternions[b];
+		dq[0] = q[0];
+		dq[1] = q[1];
+		dq[2] = q[2];
+		dq[3] = q[3];
+		dq[4] = 0.5f * (tx * q[3] + ty * q[2] - tz * q[1]);
+		dq[5] = 0.5f * (-tx * q[2] + ty * q[3] + tz * q[0]);
+		dq[6] = 0.5f * (tx * q[1] - ty * q[0] + tz * q[3]);
+		dq[7] = -0.5f * (tx * q[0] + ty * q[1] + tz * q[2]);
+	}
+}
+
+bool IsSkinnedPart(int part)
+{
+	return part == PART_LEFT_UPPER_LEG || part == PART_LEFT_LOWER_LEG ||
+		   part == PART_RIGHT_UPPER_LEG || part == PART_RIGHT_LOWER_LEG;
+}
+
+
+// Centre line of one leg's tube: straight down the upper leg, a quadratic curve around
+// the knee, straight along the lower leg
+struct LegPath
+{
+	VECTOR3D top, cornerStart, knee, cornerEnd, ankle;
+	float lengths[3];
+
+	VECTOR3D GetPoint(float s, VECTOR3D& tangent) const
+	{
+		if (s < lengths[0])
+		{
+			tangent = cornerStart - top;
+			tangent.Normalize();
+			return top + tangent * s;
+		}
+		s -= lengths[0];
+		if (s < lengths[1])
+		{
+			// arc length of the curve taken as proportional to its parameter
+			float t = s / lengths[1];
+			tangent = (knee - cornerStart) * (2.0f * (1.0f - t)) + (cornerEnd - knee) * (2.0f * t);
+			tangent.Normalize();
+			return cornerStart * ((1.0f - t) * (1.0f - t)) + knee * (2.0f * t * (1.0f - t)) + cornerEnd * (t * t);
+		}
+		s -= lengths[1];
+		tangent = ankle - cornerEnd;
+		tangent.Normalize();
+		return cornerEnd + tangent * s;
+	}
+};
+
+void BuildLegSkin(const RobotDimensions& dims, int slices, int rings, SkinMesh& mesh)
+{
+	RobotPose bindPose;
+	MATRIX4X4 root;
+	MATRIX4X4 bind[NUM_ROBOT_PARTS];
+	ComputeRobotTransforms(dims, bindPose, root, bind);
+	for (int b = 0; b < NUM_ROBOT_PARTS; b++)
+		mesh.inverseBind[b] = bind[b].GetAffineInverse();
+
+	const int legs[2][2] = { { PART_LEFT_UPPER_LEG, PART_LEFT_LOWER_LEG }, { PART_RIGHT_UPPER_LEG, PART_RIGHT_LOWER_LEG } };
+	const int verticesPerLeg = slices * rings;
+	mesh.Resize(2 * verticesPerLeg);
+	mesh.indices.clear();
+
+	// Cross section a little larger than the legs' boxes, which it replaces
+	float halfWidth = 0.6f * dims.upperLegWidth;
+	float halfHeight = 0.6f * dims.upperLegHeight;
+	float cornerSize = 2.0f * halfHeight;
+
+	for (int leg = 0; leg < 2; leg++)
+	{
+		const MATRIX4X4& upper = bind[legs[leg][0]];
+		const MATRIX4X4& lower = bind[legs[leg][1]];
+
+		// from inside the hip cylinder down to the middle of the foot
+		LegPath path;
+		path.top = upper.TransformPoint(VECTOR3D(0.0f, 0.5f + 0.5f * dims.hipRad / dims.upperLegLength, 0.0f));
+		path.knee = upper.TransformPoint(VECTOR3D(0.0f, -0.5f, 0.0f));
+		path.ankle = lower.TransformPoint(VECTOR3D(-0.5f, 0.0f, 0.0f));
+		VECTOR3D up = path.top - path.knee;
+		VECTOR3D along = path.ankle - path.knee;
+		up.Normalize();
+		along.Normalize();
+		path.cornerStart = path.knee + up * cornerSize;
+		path.cornerEnd = path.knee + along * cornerSize;
+		path.lengths[0] = (path.cornerStart - path.top).GetLength();
+		path.lengths[1] = 0.5f * ((path.cornerStart - path.knee).GetLength() + (path.cornerEnd - path.knee).GetLength() +
+								  (path.cornerEnd - path.cornerStart).GetLength());
+		path.lengths[2] = (path.ankle - path.cornerEnd).GetLength();
+		float total = path.lengths[0] + path.lengths[1] + path.lengths[2];
+		float kneeS = path.lengths[0] + 0.5f * path.lengths[1];
+		float blend = 1.5f * cornerSize;
+
+		// the knee bends about the parts' z axis, which the rings keep as one of their axes
+		VECTOR3D hinge = upper.TransformDirection(VECTOR3D(0.0f, 0.0f, 1.0f));
+		hinge.Normalize();
+
+		for (int r = 0; r < rings; r++)
+		{
+			float s = total * r / (rings - 1);
+			VECTOR3D tangent;
+			VECTOR3D centre = path.GetPoint(s, tangent);
+			VECTOR3D side = tangent.CrossProduct(hinge);
+			side.Normalize();
+
+			// smoothstep from the upper to the lower leg across the knee
+			float t = (s - (kneeS - blend)) / (2.0f * blend);
+			t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+			float lowerWeight = t * t * (3.0f - 2.0f * t);
+
+			for (int i = 0; i < slices; i++)
+			{
+				float angle = 2.0f * 3.14159265f * i / slices;
+				float c = (float)cos(angle), sn = (float)sin(angle);
+				VECTOR3D position = centre + hinge * (c * halfWidth) + side * (sn * halfHeight);
+				VECTOR3D normal = hinge * (c / halfWidth) + side * (sn / halfHeight);
+				normal.Normalize();
+
+				int v = leg * verticesPerLeg + r * slices + i;
+				mesh.positions[0][v] = position.x;
+				mesh.positions[1][v] = position.y;
+				mesh.positions[2][v] = position.z;
+				mesh.normals[0][v] = normal.x;
+				mesh.normals[1][v] = normal.y;
+				mesh.normals[2][v] = normal.z;
+
+				mesh.bones[0][v] = legs[leg][0];
+				mesh.weights[0][v] = 1.0f - lowerWeight;
+				mesh.bones[1][v] = legs[leg][1];
+				mesh.weights[1][v] = lowerWeight;
+			}
+		}
+
+		// two triangles per quad, wound counterclockwise seen from outside
+		VECTOR3D p0(mesh.positions[0][leg * verticesPerLeg], mesh.positions[1][leg * verticesPerLeg],
+					mesh.positions[2][leg * verticesPerLeg]);
+		VECTOR3D p1(mesh.positions[0][leg * verticesPerLeg + 1], mesh.positions[1][leg * verticesPerLeg + 1],
+					mesh.positions[2][leg * verticesPerLeg + 1]);
+		VECTOR3D p2(mesh.positions[0][leg * verticesPerLeg + slices], mesh.positions[1][leg * verticesPerLeg + slices],
+					mesh.positions[2][leg * verticesPerLeg + slices]);
+		VECTOR3D n0(mesh.normals[0][leg * verticesPerLeg], mesh.normals[1][leg * verticesPerLeg],
+					mesh.normals[2][leg * verticesPerLeg]);
+		bool flip = (p1 - p0).CrossProduct(p2 - p0).DotProduct(n0) < 0.0f;
+
+		for (int r = 0; r + 1 < rings; r++)
+		{
+			for (int i = 0; i < slices; i++)
+			{
+				unsigned int a = leg * verticesPerLeg + r * slices + i;
+				unsigned int b = leg * verticesPerLeg + r * slices + (i + 1) % slices;
+				unsigned int c = a + slices;
+				unsigned int d = b + slices;
+				unsigned int quad[6] = { a, b, c, b, d, c };
+				if (flip)
+				{
+					quad[1] = c;
+					quad[2] = b;
+					quad[4] = c;
+					quad[5] = d;
+				}
+				mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// padding repeats the first vertex
+	for (int v = 2 * verticesPerLeg; v < mesh.numVertices; v++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			mesh.positions[c][v] = mesh.positions[c][0];
+			mesh.normals[c][v] = mesh.normals[c][0];
+		}
+		for (int k = 0; k < MAX_SKIN_INFLUENCES; k++)
+		{
+			mesh.bones[k][v] = mesh.bones[k][0];
+			mesh.weights[k][v] = mesh.weights[k][0];
+		}
+	}
+}
+
+
+// Scalar versions, one vertex at a time
+
+static void SkinLinearVertex(const SkinMesh& mesh, const SkinBones& bones, int v, IndexedMesh::Vertex& out)
+{
+	float m[12] = { 0.0f };
+	for (int k = 0; k < MAX_SKIN_INFLUENCES; k++)
+	{
+		float w = mesh.weights[k][v];
+		if (w == 0.0f)
+			continue;
+		const float* b = bones.matrices[mesh.bones[k][v]];
+		for (int e = 0; e < 12; e++)
+			m[e] += w * b[e];
+	}
+
+	float px = mesh.positions[0][v], py = mesh.positions[1][v], pz = mesh.positions[2][v];
+	float nx = mesh.normals[0][v], ny = mesh.normals[1][v], nz = mesh.normals[2][v];
+	out.position.x = m[0] * px + m[1] * py + m[2] * pz + m[3];
+	out.position.y = m[4] * px + m[5] * py + m[6] * pz + m[7];
+	out.position.z = m[8] * px + m[9] * py + m[10] * pz + m[11];
+
+	VECTOR3D normal(m[0] * nx + m[1] * ny + m[2] * nz, m[4] * nx + m[5] * ny + m[6] * nz, m[8] * nx + m[9] * ny + m[10] * nz);
+	normal.Normalize();
+	out.normal = normal;
+}
+
+static void SkinDualQuaternionVertex(const SkinMesh& mesh, const SkinBones& bones, int v, IndexedMesh::Vertex& out)
+{
+	// blend with every bone on the same side of the quaternion double cover as the first
+	float dq[8] = { 0.0f };
+	const float* first = bones.dualQuaternions[mesh.bones[0][v]];
+	for (int k = 0; k < MAX_SKIN_INFLUENCES; k++)
+	{
+		float w = mesh.weights[k][v];
+		if (w == 0.0f)
+			continue;
+		const float* b = bones.dualQuaternions[mesh.bones[k][v]];
+		if (b[0] * first[0] + b[1] * first[1] + b[2] * first[2] + b[3] * first[3] < 0.0f)
+			w = -w;
+		for (int e = 0; e < 8; e++)
+			dq[e] += w * b[e];
+	}
+
+	float length = (float)sqrt(dq[0] * dq[0] + dq[1] * dq[1] + dq[2] * dq[2] + dq[3] * dq[3]);
+	for (int e = 0; e < 8; e++)
+		dq[e] /= length;
+
+	VECTOR3D r(dq[0], dq[1], dq[2]);
+	VECTOR3D d(dq[4], dq[5], dq[6]);
+	float rw = dq[3], dw = dq[7];
+
+	// rotation p + 2 r x (r x p + w p), then translation 2 (rw d - dw r + r x d)
+	VECTOR3D p(mesh.positions[0][v], mesh.positions[1][v], mesh.positions[2][v]);
+	VECTOR3D n(mesh.normals[0][v], mesh.normals[1][v], mesh.normals[2][v]);
+	VECTOR3D translation = (d * rw - r * dw + r.CrossProduct(d)) * 2.0f;
+	out.position = p + r.CrossProduct(r.CrossProduct(p) + p * rw) * 2.0f + translation;
+	out.normal = n + r.CrossProduct(r.CrossProduct(n) + n * rw) * 2.0f;
+}
+
+void SkinVerticesReference(const SkinMesh& mesh, const SkinBones& bones, SkinningMethod method,
+						   IndexedMesh::Vertex* vertices)
+{
+	for (int v = 0; v < mesh.numVertices; v++)
+	{
+		if (method == SKINNING_LINEAR)
+			SkinLinearVertex(mesh, bones, v, vertices[v]);
+		else
+			SkinDualQuaternionVertex(mesh, bones, v, vertices[v]);
+	}
+}
+
+
+// SSE kernels, four vertices per group, each lane gathering its own bones
+
+static inline __m128 Gather(const float* b0, const float* b1, const float* b2, const float* b3, int e)
+{
+	return _mm_set_ps(b3[e], b2[e], b1[e], b0[e]);
+}
+
+static void StoreGroup(IndexedMesh::Vertex* out, __m128 px, __m128 py, __m128 pz, __m128 nx, __m128 ny, __m128 nz)
+{
+	float lanes[6][4];
+	_mm_storeu_ps(lanes[0], px);
+	_mm_storeu_ps(lanes[1], py);
+	_mm_storeu_ps(lanes[2], pz);
+	_mm_storeu_ps(lanes[3], nx);
+	_mm_storeu_ps(lanes[4], ny);
+	_mm_storeu_ps(lanes[5], nz);
+	for (int l = 0; l < 4; l++)
+	{
+		out[l].position.x = lanes[0][l];
+		out[l].position.y = lanes[1][l];
+		out[l].position.z = lanes[2][l];
+		out[l].normal.x = lanes[3][l];
+		out[l].normal.y = lanes[4][l];
+		out[l].normal.z = lanes[5][l];
+	}
+}
+
+static void SkinLinearGroups(const SkinMesh& mesh, const SkinBones& bones, IndexedMesh::Vertex* vertices,
+							 int beginGroup, int endGroup)
+{
+	const __m128 zero = _mm_setzero_ps();
+	for (int g = beginGroup; g < endGroup; g++)
+	{
+		int v = g * 4;
+		__m128 m[12];
+		for (int e = 0; e < 12; e++)
+			m[e] = zero;
+
+		for (int k = 0; k < MAX_SKIN_INFLUENCES; k++)
+		{
+			__m128 w = _mm_loadu_ps(&mesh.weights[k][v]);
+			if (_mm_movemask_ps(_mm_cmpneq_ps(w, zero)) == 0)
+				continue;
+			const int* b = &mesh.bones[k][v];
+			const float* b0 = bones.matrices[b[0]];
+			const float* b1 = bones.matrices[b[1]];
+			const float* b2 = bones.matrices[b[2]];
+			const float* b3 = bones.matrices[b[3]];
+			for (int e = 0; e < 12; e++)
+				m[e] = _mm_add_ps(m[e], _mm_mul_ps(w, Gather(b0, b1, b2, b3, e)));
+		}
+
+		__m128 px = _mm_loadu_ps(&mesh.positions[0][v]);
+		__m128 py = _mm_loadu_ps(&mesh.positions[1][v]);
+		__m128 pz = _mm_loadu_ps(&mesh.positions[2][v]);
+		__m128 nx = _mm_loadu_ps(&mesh.normals[0][v]);
+		__m128 ny = _mm_loadu_ps(&mesh.normals[1][v]);
+		__m128 nz = _mm_loadu_ps(&mesh.normals[2][v]);
+
+		__m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], px), _mm_mul_ps(m[1], py)), _mm_add_ps(_mm_mul_ps(m[2], pz), m[3]));
+		__m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[4], px), _mm_mul_ps(m[5], py)), _mm_add_ps(_mm_mul_ps(m[6], pz), m[7]));
+		__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[8], px), _mm_mul_ps(m[9], py)), _mm_add_ps(_mm_mul_ps(m[10], pz), m[11]));
+
+		__m128 tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], nx), _mm_mul_ps(m[1], ny)), _mm_mul_ps(m[2], nz));
+		__m128 ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[4], nx), _mm_mul_ps(m[5], ny)), _mm_mul_ps(m[6], nz));
+		__m128 tz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[8], nx), _mm_mul_ps(m[9], ny)), _mm_mul_ps(m[10], nz));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+		tx = _mm_div_ps(tx, length);
+		ty = _mm_div_ps(ty, length);
+		tz = _mm_div_ps(tz, length);
+
+		StoreGroup(vertices + v, x, y, z, tx, ty, tz);
+	}
+}
+
+// r x a for vectors held one component per register
+static inline void Cross(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz, __m128& cx, __m128& cy, __m128& cz)
+{
+	cx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+	cy = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+	cz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+}
+
+// v + 2 r x (r x v + w v)
+static inline void Rotate(__m128 rx, __m128 ry, __m128 rz, __m128 rw, __m128& vx, __m128& vy, __m128& vz)
+{
+	__m128 cx, cy, cz;
+	Cross(rx, ry, rz, vx, vy, vz, cx, cy, cz);
+	cx = _mm_add_ps(cx, _mm_mul_ps(rw, vx));
+	cy = _mm_add_ps(cy, _mm_mul_ps(rw, vy));
+	cz = _mm_add_ps(cz, _mm_mul_ps(rw, vz));
+	__m128 ex, ey, ez;
+	Cross(rx, ry, rz, cx, cy, cz, ex, ey, ez);
+	__m128 two = _mm_set1_ps(2.0f);
+	vx = _mm_add_ps(vx, _mm_mul_ps(two, ex));
+	vy = _mm_add_ps(vy, _mm_mul_ps(two, ey));
+	vz = _mm_add_ps(vz, _mm_mul_ps(two, ez));
+}
+
+static void SkinDualQuaternionGroups(const SkinMesh& mesh, const SkinBones& bones, IndexedMesh::Vertex* vertices,
+									 int beginGroup, int endGroup)
+{
+	const __m128 zero = _mm_setzero_ps();
+	for (int g = beginGroup; g < endGroup; g++)
+	{
+		int v = g * 4;
+		__m128 dq[8];
+		__m128 first[4];
+
+		for (int k = 0; k < MAX_SKIN_INFLUENCES; k++)
+		{
+			__m128 w = _mm_loadu_ps(&mesh.weights[k][v]);
+			if (k > 0 && _mm_movemask_ps(_mm_cmpneq_ps(w, zero)) == 0)
+				continue;
+			const int* b = &mesh.bones[k][v];
+			const float* b0 = bones.dualQuaternions[b[0]];
+			const float* b1 = bones.dualQuaternions[b[1]];
+			const float* b2 = bones.dualQuaternions[b[2]];
+			const float* b3 = bones.dualQuaternions[b[3]];
+
+			__m128 q[8];
+			for (int e = 0; e < 8; e++)
+				q[e] = Gather(b0, b1, b2, b3, e);
+
+			if (k == 0)
+			{
+				for (int e = 0; e < 4; e++)
+					first[e] = q[e];
+				for (int e = 0; e < 8; e++)
+					dq[e] = _mm_mul_ps(w, q[e]);
+				continue;
+			}
+
+			// negate the weight in lanes whose bone is on the other side of the double cover
+			__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(q[0], first[0]), _mm_mul_ps(q[1], first[1])),
+									_mm_add_ps(_mm_mul_ps(q[2], first[2]), _mm_mul_ps(q[3], first[3])));
+			__m128 signBit = _mm_and_ps(_mm_cmplt_ps(dot, zero), _mm_set1_ps(-0.0f));
+			w = _mm_xor_ps(w, signBit);
+			for (int e = 0; e < 8; e++)
+				dq[e] = _mm_add_ps(dq[e], _mm_mul_ps(w, q[e]));
+		}
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dq[0], dq[0]), _mm_mul_ps(dq[1], dq[1])),
+											   _mm_add_ps(_mm_mul_ps(dq[2], dq[2]), _mm_mul_ps(dq[3], dq[3]))));
+		for (int e = 0; e < 8; e++)
+			dq[e] = _mm_div_ps(dq[e], length);
+
+		__m128 px = _mm_loadu_ps(&mesh.positions[0][v]);
+		__m128 py = _mm_loadu_ps(&mesh.positions[1][v]);
+		__m128 pz = _mm_loadu_ps(&mesh.positions[2][v]);
+		__m128 nx = _mm_loadu_ps(&mesh.normals[0][v]);
+		__m128 ny = _mm_loadu_ps(&mesh.normals[1][v]);
+		__m128 nz = _mm_loadu_ps(&mesh.normals[2][v]);
+		Rotate(dq[0], dq[1], dq[2], dq[3], px, py, pz);
+		Rotate(dq[0], dq[1], dq[2], dq[3], nx, ny, nz);
+
+		// translation 2 (rw d - dw r + r x d)
+		__m128 cx, cy, cz;
+		Cross(dq[0], dq[1], dq[2], dq[4], dq[5], dq[6], cx, cy, cz);
+		__m128 two = _mm_set1_ps(2.0f);
+		px = _mm_add_ps(px, _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(dq[3], dq[4]), _mm_mul_ps(dq[7], dq[0])), cx)));
+		py = _mm_add_ps(py, _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(dq[3], dq[5]), _mm_mul_ps(dq[7], dq[1])), cy)));
+		pz = _mm_add_ps(pz, _mm_mul_ps(two, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(dq[3], dq[6]), _mm_mul_ps(dq[7], dq[2])), cz)));
+
+		StoreGroup(vertices + v, px, py, pz, nx, ny, nz);
+	}
+}
+
+void SkinVertices(const SkinMesh& mesh, const SkinBones& bones, SkinningMethod method, IndexedMesh::Vertex* vertices,
+				  JobSystem* jobs, int chunkSize)
+{
+	int numGroups = mesh.numVertices / 4;
+	auto skinGroups = [&](int begin, int end)
+	{
+		if (method == SKINNING_LINEAR)
+			SkinLinearGroups(mesh, bones, vertices, begin, end);
+		else
+			SkinDualQuaternionGroups(mesh, bones, vertices, begin, end);
+	};
+
+	if (jobs)
+		jobs->ParallelFor(numGroups, (chunkSize + 3) / 4, skinGroups);
+	else
+		skinGroups(0, numGroups);
+}
@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Skinning.h
+//	A continuous skin over the robot's legs, deformed by the leg parts as bones, in place
+//	of the separate upper and lower leg cubes that open a gap at the knee when it bends.
+//
+//	Every vertex follows up to four bones. Linear blend skinning averages the bones'
+//	matrices, which shrinks the skin around a sharply bent joint; dual quaternion
+//	skinning blends the bones' rigid motions instead and keeps its volume. The bones are
+//	robot parts, moved from the bind pose (every joint at 0) by part * bind part^-1, the
+//	scaling of the parts' unit primitives cancels out.
+//
+//	SkinVertices() is the SSE kernel: the mesh is kept as structure of arrays, padded to
+//	groups of four vertices, and each group is skinned in the four lanes. Groups are
+//	dealt out in chunks over a JobSystem when one is given. SkinVerticesReference() is the
+//	plain scalar version the kernel is checked against.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SKINNING_H
+#define SKINNING_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "MeshOptimizer.h"
+
+class JobSystem;
+
+const int MAX_SKIN_INFLUENCES = 4;
+
+enum SkinningMethod
+{
+	SKINNING_LINEAR,
+	SKINNING_DUAL_QUATERNION
+};
+
+struct SkinMesh
+{
+	int numVertices;			// a multiple of 4, the padding repeats the first vertex
+
+	// Bind pose, structure of arrays
+	std::vector<float> positions[3];
+	std::vector<float> normals[3];
+
+	// Influence k of vertex i is bones[k][i] with weights[k][i], unused ones have weight 0
+	std::vector<int> bones[MAX_SKIN_INFLUENCES];
+	std::vector<float> weights[MAX_SKIN_INFLUENCES];
+
+	std::vector<unsigned int> indices;	// triangle list
+
+	// Inverse of every part's matrix in the bind pose
+	MATRIX4X4 inverseBind[NUM_ROBOT_PARTS];
+
+	SkinMesh()
+	{
+		numVertices = 0;
+	}
+
+	// Sets the vertex count, rounded up to a multiple of 4, with every weight 0
+	void Resize(int count);
+};
+
+// Bind to current pose of every part, as 3x4 row major matrices and as dual quaternions
+// (real x, y, z, w then dual x, y, z, w)
+struct SkinBones
+{
+	float matrices[NUM_ROBOT_PARTS][12];
+	float dualQuaternions[NUM_ROBOT_PARTS][8];
+
+	void Set(const SkinMesh& mesh, const MATRIX4X4 partMatrices[NUM_ROBOT_PARTS]);
+};
+
+// Tube along each leg from inside the hip to the ankle, slices vertices around and rings
+// along it, rounded at the knee and following the upper and lower leg with a blend
+// across the knee. Leaves the hips and feet to the rigid parts.
+void BuildLegSkin(const RobotDimensions& dims, int slices, int rings, SkinMesh& mesh);
+
+// Skins every vertex of mesh into vertices, which needs room for mesh.numVertices
+void SkinVertices(const SkinMesh& mesh, const SkinBones& bones, SkinningMethod method, IndexedMesh::Vertex* vertices,
+				  JobSystem* jobs = NULL, int chunkSize = 256);
+void SkinVerticesReference(const SkinMesh& mesh, const SkinBones& bones, SkinningMethod method,
+						   IndexedMesh::Vertex* vertices);
+
+// True for the parts the leg skin replaces
+bool IsSkinnedPart(int part);
+
+#endif	//SKINNING_H
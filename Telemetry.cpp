@@ -0,0 +1,239 @@
+#include <windows.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+#include "JobSystem.h"
+
+#include "Telemetry.h"
+
+
+// Slots start on cache lines of their own
+static const int slotAlignment = 64;
+
+static long long SteadyNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+TelemetryPublisher::TelemetryPublisher()
+{
+	mapping = NULL;
+	header = NULL;
+	slot = NULL;
+	size = 0;
+}
+
+bool TelemetryPublisher::Open(const char* name, int maxRobots, int numSlots)
+{
+	Close();
+
+	// a reader copies the latest slot while the next is written, so there must be two, and
+	// the header stores the slot size as an int
+	if (numSlots < 2 || maxRobots < 0)
+		return false;
+	unsigned long long slotSize = sizeof(TelemetrySlot) + (unsigned long long)maxRobots * sizeof(TelemetryRobot);
+	slotSize = (slotSize + slotAlignment - 1) / slotAlignment * slotAlignment;
+	if (slotSize > INT_MAX || slotSize * numSlots > (size_t)-1 - slotAlignment)
+		return false;
+	size_t totalSize = slotAlignment + (size_t)slotSize * numSlots;
+
+	// Named memory backed by the paging file, gone once every process has closed it
+	HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)totalSize >> 32),
+									   (DWORD)(totalSize & 0xFFFFFFFF), name);
+	if (handle == NULL)
+		return false;
+	if (GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+	void* view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, totalSize);
+	if (view == NULL)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	mapping = handle;
+	size = totalSize;
+	header = new (view) TelemetryHeader;
+	header->maxRobots = maxRobots;
+	header->numSlots = numSlots;
+	header->slotSize = (int)slotSize;
+	header->numPublished.store(0, std::memory_order_relaxed);
+	for (int i = 0; i < numSlots; i++)
+	{
+		TelemetrySlot* s = new ((char*)view + slotAlignment + i * (size_t)slotSize) TelemetrySlot;
+		s->sequence.store(0, std::memory_order_relaxed);
+		s->numRobots = 0;
+	}
+
+	// readers that see the magic see the layout
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = TELEMETRY_MAGIC;
+	return true;
+}
+
+void TelemetryPublisher::Close()
+{
+	if (header)
+		UnmapViewOfFile(header);
+	if (mapping)
+		CloseHandle((HANDLE)mapping);
+	mapping = NULL;
+	header = NULL;
+	slot = NULL;
+	size = 0;
+}
+
+void TelemetryPublisher::BeginFrame(long long frameNumber, double time, float frameTime, int numRobots)
+{
+	long long frame = header->numPublished.load(std::memory_order_relaxed);
+	slot = (TelemetrySlot*)((char*)header + slotAlignment + (size_t)(frame % header->numSlots) * header->slotSize);
+
+	// readers that see anything written after this fence also see the slot is being written
+	unsigned int sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot->numRobots = numRobots < header->maxRobots ? numRobots : header->maxRobots;
+	slot->frameNumber = frameNumber;
+	slot->time = time;
+	slot->frameTime = frameTime;
+}
+
+void TelemetryPublisher::WriteRobots(int first, int count, const RobotPose* poses, const MATRIX4X4* partMatrices,
+									 const VECTOR3D& offset, JobSystem* jobs, int chunkSize)
+{
+	if (first + count > slot->numRobots)
+		count = slot->numRobots - first;
+	TelemetryRobot* robots = GetRobots() + first;
+
+	auto writeRange = [&](int begin, int end)
+	{
+		for (int r = begin; r < end; r++)
+		{
+			TelemetryRobot& robot = robots[r];
+			memcpy(robot.angles, poses[r].angles, sizeof(robot.angles));
+			const MATRIX4X4* matrices = partMatrices + (size_t)r * NUM_ROBOT_PARTS;
+			for (int p = 0; p < NUM_ROBOT_PARTS; p++)
+			{
+				// column major entries to rows
+				const float* m = matrices[p].entries;
+				float* t = robot.transforms[p];
+				t[0] = m[0];	t[1] = m[4];	t[2] = m[8];	t[3] = m[12] + offset.x;
+				t[4] = m[1];	t[5] = m[5];	t[6] = m[9];	t[7] = m[13] + offset.y;
+				t[8] = m[2];	t[9] = m[6];	t[10] = m[10];	t[11] = m[14] + offset.z;
+			}
+		}
+	};
+
+	if (jobs)
+		jobs->ParallelFor(count, chunkSize, writeRange);
+	else
+		writeRange(0, count);
+}
+
+void TelemetryPublisher::EndFrame()
+{
+	slot->publishTime = SteadyNanoseconds();
+	unsigned int sequence = slot->sequence.load(std::memory_order_relaxed);
+	slot->sequence.store(sequence + 1, std::memory_order_release);
+	header->numPublished.store(header->numPublished.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	slot = NULL;
+}
+
+
+TelemetryReader::TelemetryReader()
+{
+	mapping = NULL;
+	header = NULL;
+}
+
+bool TelemetryReader::Open(const char* name)
+{
+	Close();
+
+	HANDLE handle = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	if (handle == NULL)
+		return false;
+	const TelemetryHeader* view = (const TelemetryHeader*)MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	// a publisher still setting up looks the same as none
+	bool ready = view->magic == TELEMETRY_MAGIC;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!ready)
+	{
+		UnmapViewOfFile(view);
+		CloseHandle(handle);
+		return false;
+	}
+	mapping = handle;
+	header = view;
+	return true;
+}
+
+void TelemetryReader::Close()
+{
+	if (header)
+		UnmapViewOfFile(header);
+	if (mapping)
+		CloseHandle((HANDLE)mapping);
+	mapping = NULL;
+	header = NULL;
+}
+
+const TelemetrySlot* TelemetryReader::GetSlot(long long frame) const
+{
+	return (const TelemetrySlot*)((const char*)header + slotAlignment + (size_t)(frame % header->numSlots) * header->slotSize);
+}
+
+bool TelemetryReader::ReadLatest(TelemetrySnapshot& snapshot, int maxRetries, int* retries) const
+{
+	if ((int)snapshot.robots.size() < header->maxRobots)
+		snapshot.robots.resize(header->maxRobots);
+
+	for (int attempt = 0; attempt <= maxRetries; attempt++)
+	{
+		long long published = header->numPublished.load(std::memory_order_acquire);
+		if (published == 0)
+			return false;
+
+		const TelemetrySlot* slot = GetSlot(published - 1);
+		unsigned int sequence = slot->sequence.load(std::memory_order_acquire);
+		if ((sequence & 1) == 0)
+		{
+			int numRobots = slot->numRobots;
+			if (numRobots > header->maxRobots)
+				numRobots = header->maxRobots;
+			snapshot.frameNumber = slot->frameNumber;
+			snapshot.time = slot->time;
+			snapshot.frameTime = slot->frameTime;
+			snapshot.publishTime = slot->publishTime;
+			snapshot.numRobots = numRobots;
+			if (numRobots > 0)
+				memcpy(&snapshot.robots[0], slot + 1, (size_t)numRobots * sizeof(TelemetryRobot));
+
+			// the copy is whole when nothing started writing the slot meanwhile
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot->sequence.load(std::memory_order_relaxed) == sequence)
+				return true;
+		}
+		if (retries)
+			(*retries)++;
+	}
+	return false;
+}
@@ -0,0 +1,162 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Telemetry.h
+//	Joint state of every robot published each frame through named shared memory, for
+//	monitoring tools running as separate processes on the same machine.
+//
+//	The shared memory holds a small ring of frame slots. One publisher writes each frame
+//	into the next slot and then publishes the frame count; any number of readers copy the
+//	latest slot without locks. Every slot has a sequence number that is odd while the slot
+//	is written, so a reader that finds it odd, or changed after its copy, retries on the
+//	slot of the newer frame (a seqlock). The publisher never waits for a reader, and a
+//	reader only has to retry when it copies one slot for longer than the ring lasts.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "RobotModel.h"
+
+class JobSystem;
+
+// Joint state of one robot in a frame
+struct TelemetryRobot
+{
+	float angles[NUM_JOINTS];					// RobotPose angles, in JointId order
+	float transforms[NUM_ROBOT_PARTS][12];		// world matrix of each part, top three rows
+};
+
+// Start of the shared memory, the slots follow on the next cache line
+struct TelemetryHeader
+{
+	unsigned int magic;			// TELEMETRY_MAGIC once the rest is set up
+	int maxRobots;
+	int numSlots;
+	int slotSize;				// bytes, a TelemetrySlot and maxRobots TelemetryRobot records
+	std::atomic<long long> numPublished;	// frames published, the latest is in slot (n - 1) % numSlots
+};
+
+// Start of each slot, followed by its robots
+struct TelemetrySlot
+{
+	std::atomic<unsigned int> sequence;	// odd while the slot is written
+	int numRobots;
+	long long frameNumber;
+	double time;				// seconds, as the publisher counts them
+	float frameTime;			// milliseconds since the previous frame
+	long long publishTime;		// steady_clock nanoseconds when the frame was complete
+};
+
+const unsigned int TELEMETRY_MAGIC = 0x4d4c4554;	// "TELM"
+
+// One frame as a reader copied it
+struct TelemetrySnapshot
+{
+	long long frameNumber = -1;
+	double time = 0.0;
+	float frameTime = 0.0f;
+	long long publishTime = 0;
+	int numRobots = 0;
+	std::vector<TelemetryRobot> robots;	// numRobots are valid
+};
+
+class TelemetryPublisher
+{
+private:
+	void* mapping;
+	TelemetryHeader* header;
+	TelemetrySlot* slot;		// being written between BeginFrame() and EndFrame()
+	size_t size;
+
+	TelemetryRobot* GetRobots()
+	{
+		return (TelemetryRobot*)(slot + 1);
+	}
+
+public:
+	TelemetryPublisher();
+
+	~TelemetryPublisher()
+	{
+		Close();
+	}
+
+	// Creates the shared memory for frames of up to maxRobots in a ring of numSlots, at
+	// least 2. False for fewer slots, for a slot too large for TelemetryHeader::slotSize,
+	// when it could not be created or when another publisher has the name already.
+	bool Open(const char* name, int maxRobots, int numSlots = 4);
+	void Close();
+
+	bool IsOpen() const
+	{
+		return header != NULL;
+	}
+
+	// Starts the next frame, numRobots at most maxRobots. Only one thread may publish.
+	void BeginFrame(long long frameNumber, double time, float frameTime, int numRobots);
+
+	// Robots first to first + count - 1 of the frame from their poses and part matrices,
+	// NUM_ROBOT_PARTS per robot, with offset added to their positions
+	void WriteRobots(int first, int count, const RobotPose* poses, const MATRIX4X4* partMatrices, const VECTOR3D& offset,
+					 JobSystem* jobs = NULL, int chunkSize = 256);
+
+	// Makes the frame visible to readers
+	void EndFrame();
+
+	long long GetNumPublished() const
+	{
+		return header ? header->numPublished.load(std::memory_order_relaxed) : 0;
+	}
+
+	size_t GetSharedSize() const
+	{
+		return size;
+	}
+};
+
+class TelemetryReader
+{
+private:
+	void* mapping;
+	const TelemetryHeader* header;
+
+	const TelemetrySlot* GetSlot(long long frame) const;
+
+public:
+	TelemetryReader();
+
+	~TelemetryReader()
+	{
+		Close();
+	}
+
+	// Maps a publisher's shared memory read only, false when there is no publisher of
+	// that name yet
+	bool Open(const char* name);
+	void Close();
+
+	bool IsOpen() const
+	{
+		return header != NULL;
+	}
+
+	int GetMaxRobots() const
+	{
+		return header->maxRobots;
+	}
+
+	long long GetNumPublished() const
+	{
+		return header->numPublished.load(std::memory_order_acquire);
+	}
+
+	// Copies the latest frame, retrying while the publisher overwrites it up to maxRetries
+	// times. False before the first frame or when every retry was overwritten. retries,
+	// when given, counts the copies that were thrown away.
+	bool ReadLatest(TelemetrySnapshot& snapshot, int maxRetries = 100, int* retries = NULL) const;
+};
+
+#endif	//TELEMETRY_H
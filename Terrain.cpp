@@ -0,0 +1,342 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <math.h>
+#include <utility>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "QuadMesh.h"
+#include "Heightfield.h"
+#include "JobSystem.h"
+#include "Allocators.h"
+
+#include "Terrain.h"
+
+
+void TerrainView::Set(const MATRIX4X4& modelview, const MATRIX4X4& projection, int viewportHeight, float tolerance)
+{
+	eye = modelview.GetRigidInverse().TransformPoint(VECTOR3D(0.0f, 0.0f, 0.0f));
+	frustum.Extract(projection * modelview);
+
+	// entries[5] is cot(fovy / 2), the projected size of a unit at unit distance in half viewports
+	errorScale = 0.5f * viewportHeight * projection.entries[5];
+	this->tolerance = tolerance;
+}
+
+
+Terrain::Terrain()
+{
+	heights = NULL;
+	size = 0;
+	patchSize = 0;
+	spacing = 1.0f;
+	ambient = VECTOR3D(0.0f, 0.0f, 0.0f);
+	diffuse = VECTOR3D(0.9f, 0.5f, 0.0f);
+	specular = VECTOR3D(0.0f, 0.0f, 0.0f);
+	shininess = 0.0f;
+	patchPool = NULL;
+	frameNumber = 0;
+	patchLifetime = 120;
+}
+
+Terrain::~Terrain()
+{
+	FreePatches();
+	delete patchPool;
+}
+
+void Terrain::FreePatches()
+{
+	for (size_t i = 0; i < patchNodes.size(); i++)
+	{
+		delete nodes[patchNodes[i]].patch;
+		nodes[patchNodes[i]].patch = NULL;
+	}
+	patchNodes.clear();
+}
+
+bool Terrain::Init(const Heightfield* heights, int patchSize, float spacing, VECTOR3D origin, JobSystem* jobs)
+{
+	FreePatches();
+	nodes.clear();
+	levelStarts.clear();
+	selection.clear();
+	selected.clear();
+	this->size = 0;
+
+	int cells = heights->GetWidth() - 1;
+	if (patchSize < 1 || heights->GetHeight() - 1 != cells || cells < patchSize)
+		return false;
+	int levels = 1;
+	while ((patchSize << (levels - 1)) < cells)
+		levels++;
+	if ((patchSize << (levels - 1)) != cells)
+		return false;
+
+	if (!patchPool || patchPool->GetBlockSize() < QuadMesh::GetStorageSize(patchSize))
+	{
+		delete patchPool;
+		patchPool = new PoolAllocator(QuadMesh::GetStorageSize(patchSize));
+	}
+
+	this->heights = heights;
+	this->size = cells;
+	this->patchSize = patchSize;
+	this->spacing = spacing;
+	this->origin = origin;
+
+	// Breadth first, so every depth is one contiguous range and children follow their parents
+	nodes.reserve(((size_t)1 << (2 * levels)) / 3 + 1);
+	TerrainNode root = { 0, 0, cells, -1, 0.0f, 0.0f, 0.0f, NULL, 0 };
+	nodes.push_back(root);
+	for (int depth = 0; depth < levels; depth++)
+	{
+		int levelStart = (int)nodes.size() - (1 << (2 * depth));
+		levelStarts.push_back(levelStart);
+		if (depth == levels - 1)
+			break;
+
+		for (int i = levelStart; i < levelStart + (1 << (2 * depth)); i++)
+		{
+			nodes[i].firstChild = (int)nodes.size();
+			int half = nodes[i].size / 2;
+			for (int c = 0; c < 4; c++)
+			{
+				TerrainNode child = { nodes[i].col0 + (c & 1) * half, nodes[i].row0 + (c >> 1) * half, half, -1, 0.0f, 0.0f, 0.0f, NULL, 0 };
+				nodes.push_back(child);
+			}
+		}
+	}
+	levelStarts.push_back((int)nodes.size());
+	selected.assign(nodes.size(), false);
+
+	// Bottom up, every node needs its children's bounds and errors
+	for (int depth = levels - 1; depth >= 0; depth--)
+	{
+		int begin = levelStarts[depth];
+		JobSystem::RangeFunction computeNodes = [&](int first, int last)
+		{
+			for (int i = begin + first; i < begin + last; i++)
+			{
+				ComputeNodeBounds(nodes[i]);
+				ComputeNodeError(nodes[i]);
+			}
+		};
+
+		int count = levelStarts[depth + 1] - begin;
+		if (jobs)
+			jobs->ParallelFor(count, 4, computeNodes);
+		else
+			computeNodes(0, count);
+	}
+	return true;
+}
+
+void Terrain::ComputeNodeBounds(TerrainNode& node)
+{
+	if (node.firstChild < 0)
+	{
+		float low = heights->Get(node.col0, node.row0), high = low;
+		for (int row = node.row0; row <= node.row0 + node.size; row++)
+		{
+			for (int col = node.col0; col <= node.col0 + node.size; col++)
+			{
+				float h = heights->Get(col, row);
+				if (h < low) low = h;
+				if (h > high) high = h;
+			}
+		}
+		node.minHeight = low;
+		node.maxHeight = high;
+		return;
+	}
+
+	// Coarser levels sample a subset of the same grid points, so the children bound them
+	node.minHeight = nodes[node.firstChild].minHeight;
+	node.maxHeight = nodes[node.firstChild].maxHeight;
+	for (int c = 1; c < 4; c++)
+	{
+		const TerrainNode& child = nodes[node.firstChild + c];
+		if (child.minHeight < node.minHeight) node.minHeight = child.minHeight;
+		if (child.maxHeight > node.maxHeight) node.maxHeight = child.maxHeight;
+	}
+}
+
+// Error of the node's level against its children's level, plus the children's own error.
+// By the triangle inequality this bounds the error against full resolution without
+// visiting every grid point once per level. Both levels are drawn as GL_QUADS, which GL
+// splits along the diagonal from each quad's first corner to its third, so the two
+// surfaces only differ at the grid points the children add: the midpoints of the coarse
+// edges and of those diagonals.
+void Terrain::ComputeNodeError(TerrainNode& node)
+{
+	node.error = 0.0f;
+	if (node.firstChild < 0)
+		return;
+
+	float childError = 0.0f;
+	for (int c = 0; c < 4; c++)
+	{
+		if (nodes[node.firstChild + c].error > childError)
+			childError = nodes[node.firstChild + c].error;
+	}
+
+	float levelError = 0.0f;
+	const int step = node.size / patchSize;
+	const int half = step / 2;
+	for (int i = 0; i <= 2 * patchSize; i++)
+	{
+		int row = node.row0 + i * half;
+		int row0 = node.row0 + (i / 2) * step;
+		int row1 = row0 + ((i & 1) ? step : 0);
+
+		for (int j = 0; j <= 2 * patchSize; j++)
+		{
+			if (!((i | j) & 1))
+				continue;	// also a grid point of this level
+
+			int col = node.col0 + j * half;
+			int col0 = node.col0 + (j / 2) * step;
+			int col1 = col0 + ((j & 1) ? step : 0);
+
+			// on a coarse edge one of the pairs is the same point, in a quad it is the diagonal
+			float coarse = 0.5f * (heights->Get(col0, row0) + heights->Get(col1, row1));
+			float error = (float)fabs(heights->Get(col, row) - coarse);
+			if (error > levelError)
+				levelError = error;
+		}
+	}
+	node.error = childError + levelError;
+}
+
+void Terrain::SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess)
+{
+	this->ambient = ambient;
+	this->diffuse = diffuse;
+	this->specular = specular;
+	this->shininess = (float)shininess;
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].patch)
+			nodes[i].patch->SetMaterial(ambient, diffuse, specular, shininess);
+	}
+}
+
+int Terrain::Select(const TerrainView& view)
+{
+	for (size_t i = 0; i < selection.size(); i++)
+		selected[selection[i]] = false;
+	selection.clear();
+	if (!nodes.empty())
+		SelectNode(0, view, true);
+	for (size_t i = 0; i < selection.size(); i++)
+		selected[selection[i]] = true;
+	return (int)selection.size();
+}
+
+void Terrain::SelectNode(int index, const TerrainView& view, bool cull)
+{
+	const TerrainNode& node = nodes[index];
+
+	// the skirts hang up to the node's error below its lowest point. Deeper skirts only fill
+	// the gap to a coarser neighbour, which lies within the heights of the node's edge.
+	VECTOR3D boxMin(origin.x + node.col0 * spacing, origin.y + node.minHeight - node.error, origin.z - (node.row0 + node.size) * spacing);
+	VECTOR3D boxMax(origin.x + (node.col0 + node.size) * spacing, origin.y + node.maxHeight, origin.z - node.row0 * spacing);
+
+	if (cull)
+	{
+		FrustumResult result = view.frustum.ClassifyBox(boxMin, boxMax);
+		if (result == FRUSTUM_OUTSIDE)
+			return;
+		// children of a node completely inside are inside too
+		cull = result == FRUSTUM_INTERSECT;
+	}
+
+	if (node.firstChild >= 0)
+	{
+		// distance from the eye to the nearest point of the box
+		VECTOR3D nearest(view.eye.x < boxMin.x ? boxMin.x : (view.eye.x > boxMax.x ? boxMax.x : view.eye.x),
+						 view.eye.y < boxMin.y ? boxMin.y : (view.eye.y > boxMax.y ? boxMax.y : view.eye.y),
+						 view.eye.z < boxMin.z ? boxMin.z : (view.eye.z > boxMax.z ? boxMax.z : view.eye.z));
+		float distance = (nearest - view.eye).GetLength();
+
+		if (node.error * view.errorScale > view.tolerance * distance)
+		{
+			for (int c = 0; c < 4; c++)
+				SelectNode(node.firstChild + c, view, cull);
+			return;
+		}
+	}
+
+	selection.push_back(index);
+}
+
+// Error of the selected node of at least size cells containing cell (col, row), 0 when the
+// cell is off the terrain or finer nodes cover it. A coarser neighbour contains the whole
+// edge it shares, so one cell beside each edge finds it.
+float Terrain::GetNeighbourError(int col, int row, int size) const
+{
+	if (col < 0 || row < 0 || col >= this->size || row >= this->size)
+		return 0.0f;
+
+	int index = 0;
+	while (true)
+	{
+		const TerrainNode& node = nodes[index];
+		if (selected[index])
+			return node.error;
+		if (node.firstChild < 0 || node.size <= size)
+			return 0.0f;
+		int half = node.size / 2;
+		index = node.firstChild + (col >= node.col0 + half ? 1 : 0) + (row >= node.row0 + half ? 2 : 0);
+	}
+}
+
+void Terrain::Draw()
+{
+	frameNumber++;
+
+	for (size_t i = 0; i < selection.size(); i++)
+	{
+		TerrainNode& node = nodes[selection[i]];
+		if (!node.patch)
+		{
+			node.patch = new QuadMesh(patchSize, 1.0f, patchPool);
+			node.patch->InitPatch(*heights, node.col0, node.row0, patchSize, node.size / patchSize, origin, spacing);
+			node.patch->SetMaterial(ambient, diffuse, specular, shininess);
+			patchNodes.push_back(selection[i]);
+		}
+		node.lastDrawn = frameNumber;
+
+		node.patch->DrawMesh(patchSize);
+
+		// Along an edge each side is at most its error from the true heights, so the gap to a
+		// coarser neighbour is at most both errors. Finer neighbours hang their own skirts.
+		float neighbourError = 0.0f;
+		const int edgeCells[4][2] = { { node.col0 - 1, node.row0 }, { node.col0 + node.size, node.row0 },
+									  { node.col0, node.row0 - 1 }, { node.col0, node.row0 + node.size } };
+		for (int e = 0; e < 4; e++)
+		{
+			float error = GetNeighbourError(edgeCells[e][0], edgeCells[e][1], node.size);
+			if (error > neighbourError)
+				neighbourError = error;
+		}
+		node.patch->DrawSkirts(node.error + neighbourError + spacing);
+	}
+
+	// Patches out of view for a while go back to the pool
+	for (size_t i = 0; i < patchNodes.size();)
+	{
+		TerrainNode& node = nodes[patchNodes[i]];
+		if (frameNumber - node.lastDrawn > patchLifetime)
+		{
+			delete node.patch;
+			node.patch = NULL;
+			patchNodes[i] = patchNodes.back();
+			patchNodes.pop_back();
+		}
+		else
+			i++;
+	}
+}
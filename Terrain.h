@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	Terrain.h
+//	Quadtree of QuadMesh patches over a Heightfield, drawn with geomipmapping.
+//
+//	Every node covers a square of cells and is drawn as one patchSize x patchSize
+//	QuadMesh, sampling the heights at every (node size / patchSize)th grid point, so the
+//	leaves are full resolution and each level up is the next mip level. Each node keeps
+//	a bound on the height error of drawing it at its own level instead of at full
+//	resolution, its children's bound plus the error of its level against theirs.
+//
+//	Select() walks the tree, culls nodes against the view frustum and stops at the first
+//	node whose error projects to no more than the pixel tolerance, so far away terrain is
+//	covered by few large nodes and the triangle count grows only slowly with the terrain
+//	size. Neighbouring nodes of different levels are joined with skirts, deep enough for
+//	the node's error plus that of its coarsest selected neighbour.
+//
+//	Patch meshes come from a pool and go back to it once they have not been drawn for
+//	patchLifetime frames, so moving around the terrain reuses the same memory.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+#include "Allocators.h"
+
+class Heightfield;
+class JobSystem;
+class QuadMesh;
+
+// Camera as seen by the terrain, in the terrain's (modelview) coordinate frame
+struct TerrainView
+{
+	VECTOR3D eye;
+	Frustum frustum;
+	float errorScale;	// pixels covered by one unit of height error at unit distance
+	float tolerance;	// largest screen space error in pixels
+
+	void Set(const MATRIX4X4& modelview, const MATRIX4X4& projection, int viewportHeight, float tolerance);
+};
+
+struct TerrainNode
+{
+	int col0, row0;		// first grid point
+	int size;			// cells per side
+	int firstChild;		// index of the first of four children, -1 for a full resolution leaf
+	float minHeight, maxHeight;
+	float error;		// bound on the height error of drawing the node at its own level
+	QuadMesh* patch;	// built the first time the node is drawn
+	int lastDrawn;		// frame number the patch was last drawn in
+};
+
+class Terrain
+{
+private:
+	const Heightfield* heights;
+	int size;
+	int patchSize;
+	float spacing;
+	VECTOR3D origin;
+
+	std::vector<TerrainNode> nodes;		// breadth first, the root is nodes[0]
+	std::vector<int> levelStarts;		// first node of each depth, plus the end
+
+	std::vector<int> selection;
+	std::vector<bool> selected;			// per node, whether it is in the selection
+
+	PoolAllocator* patchPool;
+	std::vector<int> patchNodes;		// nodes that currently have a patch
+	int frameNumber;
+	int patchLifetime;
+
+	VECTOR3D ambient, diffuse, specular;
+	float shininess;
+
+	void FreePatches();
+	void ComputeNodeBounds(TerrainNode& node);
+	void ComputeNodeError(TerrainNode& node);
+	void SelectNode(int index, const TerrainView& view, bool cull);
+	float GetNeighbourError(int col, int row, int size) const;
+
+public:
+	Terrain();
+	~Terrain();
+
+	// heights must be square with (patchSize << k) + 1 grid points per side. The terrain lies
+	// along +x (columns) and -z (rows) from origin, spacing apart, with heights along +y.
+	// Node bounds and errors are computed level by level, in parallel when jobs is given.
+	bool Init(const Heightfield* heights, int patchSize, float spacing, VECTOR3D origin, JobSystem* jobs = NULL);
+
+	void SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess);
+
+	// Frames a patch is kept after it was last drawn
+	void SetPatchLifetime(int frames)
+	{
+		patchLifetime = frames;
+	}
+
+	// Chooses the nodes to draw for the view, returns how many
+	int Select(const TerrainView& view);
+
+	// Draws the last selection, building patches that have not been drawn before, then
+	// releases patches that have not been drawn for patchLifetime frames
+	void Draw();
+
+	const AllocationStats* GetPatchPoolStats()
+	{
+		return patchPool ? &patchPool->GetStats() : NULL;
+	}
+
+	int GetNumPatches()
+	{
+		return (int)patchNodes.size();
+	}
+
+	const std::vector<int>& GetSelection()
+	{
+		return selection;
+	}
+
+	const TerrainNode& GetNode(int index)
+	{
+		return nodes[index];
+	}
+
+	// Triangles drawn for the last selection, patches and skirts
+	int GetSelectedTriangles()
+	{
+		return (int)selection.size() * (2 * patchSize * patchSize + 8 * patchSize);
+	}
+
+	int GetSize()
+	{
+		return size;
+	}
+
+	int GetNumNodes()
+	{
+		return (int)nodes.size();
+	}
+};
+
+#endif	//TERRAIN_H
@@ -0,0 +1,242 @@
+#include <math.h>
+#include <vector>
+#include <functional>
+#include "VECTOR3D.h"
+#include "JobSystem.h"
+
+#include "VertexQuantizer.h"
+
+
+static const float QUANTIZE_RANGE = 32767.0f;
+
+QuantizationBox MakeQuantizationBox(const VECTOR3D& boxMin, const VECTOR3D& boxMax)
+{
+	QuantizationBox box;
+	box.offset = (boxMin + boxMax) * 0.5f;
+	box.scale = (boxMax - boxMin) * (0.5f / QUANTIZE_RANGE);
+	return box;
+}
+
+// A flat box has a zero step along some axis, everything quantizes to the offset there
+static inline float InverseScale(float scale)
+{
+	return scale > 0.0f ? 1.0f / scale : 0.0f;
+}
+
+void EncodeOctahedral(const VECTOR3D& n, float& u, float& v)
+{
+	float length = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (length == 0.0f)
+	{
+		u = v = 0.0f;
+		return;
+	}
+
+	u = n.x / length;
+	v = n.y / length;
+	if (n.z < 0.0f)
+	{
+		// fold the lower half over the diagonals
+		float foldedU = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+		float foldedV = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+		u = foldedU;
+		v = foldedV;
+	}
+}
+
+VECTOR3D DecodeOctahedral(float u, float v)
+{
+	VECTOR3D n(u, v, 1.0f - fabsf(u) - fabsf(v));
+	if (n.z < 0.0f)
+	{
+		float t = -n.z;
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+	}
+	n.Normalize();
+	return n;
+}
+
+static inline short QuantizeCoordinate(float value, float offset, float invScale)
+{
+	float q = (value - offset) * invScale;
+	if (q > QUANTIZE_RANGE) q = QUANTIZE_RANGE;
+	if (q < -QUANTIZE_RANGE) q = -QUANTIZE_RANGE;
+	return (short)(q >= 0.0f ? q + 0.5f : q - 0.5f);
+}
+
+// Signed normalized value with range steps either side of zero
+static inline int QuantizeUnit(float value, float range)
+{
+	float q = value * range;
+	return (int)(q >= 0.0f ? q + 0.5f : q - 0.5f);
+}
+
+static inline const VECTOR3D& StridedVector(const VECTOR3D* base, int stride, int i)
+{
+	return *(const VECTOR3D*)((const char*)base + (size_t)i * stride);
+}
+
+static inline VECTOR3D& StridedVector(VECTOR3D* base, int stride, int i)
+{
+	return *(VECTOR3D*)((char*)base + (size_t)i * stride);
+}
+
+void EncodeVertices(const VECTOR3D* positions, const VECTOR3D* normals, int stride, int count,
+					const QuantizationBox& box, CompactVertex* out)
+{
+	const float invX = InverseScale(box.scale.x), invY = InverseScale(box.scale.y), invZ = InverseScale(box.scale.z);
+	for (int i = 0; i < count; i++)
+	{
+		const VECTOR3D& p = StridedVector(positions, stride, i);
+		out[i].position[0] = QuantizeCoordinate(p.x, box.offset.x, invX);
+		out[i].position[1] = QuantizeCoordinate(p.y, box.offset.y, invY);
+		out[i].position[2] = QuantizeCoordinate(p.z, box.offset.z, invZ);
+
+		float u, v;
+		EncodeOctahedral(StridedVector(normals, stride, i), u, v);
+		out[i].normal[0] = (signed char)QuantizeUnit(u, 127.0f);
+		out[i].normal[1] = (signed char)QuantizeUnit(v, 127.0f);
+	}
+}
+
+void EncodeVertices(const VECTOR3D* positions, const VECTOR3D* normals, int stride, int count,
+					const QuantizationBox& box, CompactVertex16* out)
+{
+	const float invX = InverseScale(box.scale.x), invY = InverseScale(box.scale.y), invZ = InverseScale(box.scale.z);
+	for (int i = 0; i < count; i++)
+	{
+		const VECTOR3D& p = StridedVector(positions, stride, i);
+		out[i].position[0] = QuantizeCoordinate(p.x, box.offset.x, invX);
+		out[i].position[1] = QuantizeCoordinate(p.y, box.offset.y, invY);
+		out[i].position[2] = QuantizeCoordinate(p.z, box.offset.z, invZ);
+
+		float u, v;
+		EncodeOctahedral(StridedVector(normals, stride, i), u, v);
+		out[i].normal[0] = (short)QuantizeUnit(u, 32767.0f);
+		out[i].normal[1] = (short)QuantizeUnit(v, 32767.0f);
+	}
+}
+
+void DecodeVertices(const CompactVertex* in, int count, const QuantizationBox& box,
+					VECTOR3D* positions, VECTOR3D* normals, int stride)
+{
+	for (int i = 0; i < count; i++)
+	{
+		StridedVector(positions, stride, i).Set(box.offset.x + in[i].position[0] * box.scale.x,
+												box.offset.y + in[i].position[1] * box.scale.y,
+												box.offset.z + in[i].position[2] * box.scale.z);
+		StridedVector(normals, stride, i) = DecodeOctahedral(in[i].normal[0] * (1.0f / 127.0f), in[i].normal[1] * (1.0f / 127.0f));
+	}
+}
+
+void DecodeVertices(const CompactVertex16* in, int count, const QuantizationBox& box,
+					VECTOR3D* positions, VECTOR3D* normals, int stride)
+{
+	for (int i = 0; i < count; i++)
+	{
+		StridedVector(positions, stride, i).Set(box.offset.x + in[i].position[0] * box.scale.x,
+												box.offset.y + in[i].position[1] * box.scale.y,
+												box.offset.z + in[i].position[2] * box.scale.z);
+		StridedVector(normals, stride, i) = DecodeOctahedral(in[i].normal[0] * (1.0f / 32767.0f), in[i].normal[1] * (1.0f / 32767.0f));
+	}
+}
+
+
+CompactMesh::CompactMesh()
+{
+	normals16 = false;
+}
+
+// Runs chunks(begin, end) over [0, numChunks), in parallel when jobs is given
+static void RunChunks(int numChunks, JobSystem* jobs, const std::function<void(int, int)>& chunks)
+{
+	if (jobs)
+		jobs->ParallelFor(numChunks, 1, chunks);
+	else
+		chunks(0, numChunks);
+}
+
+void CompactMesh::Encode(const VECTOR3D* positions, const VECTOR3D* normals, int stride, int count,
+						 bool normals16, int chunkSize, JobSystem* jobs)
+{
+	this->normals16 = normals16;
+	if (chunkSize < 1)
+		chunkSize = count > 0 ? count : 1;
+
+	chunks.resize((count + chunkSize - 1) / chunkSize);
+	vertices.clear();
+	vertices16.clear();
+	if (normals16)
+		vertices16.resize(count);
+	else
+		vertices.resize(count);
+
+	auto encodeChunks = [&](int begin, int end)
+	{
+		for (int c = begin; c < end; c++)
+		{
+			CompactChunk& chunk = chunks[c];
+			chunk.first = c * chunkSize;
+			chunk.count = count - chunk.first < chunkSize ? count - chunk.first : chunkSize;
+
+			VECTOR3D boxMin = StridedVector(positions, stride, chunk.first), boxMax = boxMin;
+			for (int i = chunk.first + 1; i < chunk.first + chunk.count; i++)
+			{
+				const VECTOR3D& p = StridedVector(positions, stride, i);
+				if (p.x < boxMin.x) boxMin.x = p.x;
+				if (p.y < boxMin.y) boxMin.y = p.y;
+				if (p.z < boxMin.z) boxMin.z = p.z;
+				if (p.x > boxMax.x) boxMax.x = p.x;
+				if (p.y > boxMax.y) boxMax.y = p.y;
+				if (p.z > boxMax.z) boxMax.z = p.z;
+			}
+			chunk.box = MakeQuantizationBox(boxMin, boxMax);
+
+			const VECTOR3D* chunkPositions = &StridedVector(positions, stride, chunk.first);
+			const VECTOR3D* chunkNormals = &StridedVector(normals, stride, chunk.first);
+			if (normals16)
+				EncodeVertices(chunkPositions, chunkNormals, stride, chunk.count, chunk.box, &vertices16[chunk.first]);
+			else
+				EncodeVertices(chunkPositions, chunkNormals, stride, chunk.count, chunk.box, &vertices[chunk.first]);
+		}
+	};
+	RunChunks((int)chunks.size(), jobs, encodeChunks);
+}
+
+void CompactMesh::Decode(VECTOR3D* positions, VECTOR3D* normals, int stride, JobSystem* jobs) const
+{
+	auto decodeChunks = [&](int begin, int end)
+	{
+		for (int c = begin; c < end; c++)
+		{
+			const CompactChunk& chunk = chunks[c];
+			VECTOR3D* chunkPositions = &StridedVector(positions, stride, chunk.first);
+			VECTOR3D* chunkNormals = &StridedVector(normals, stride, chunk.first);
+			if (normals16)
+				DecodeVertices(&vertices16[chunk.first], chunk.count, chunk.box, chunkPositions, chunkNormals, stride);
+			else
+				DecodeVertices(&vertices[chunk.first], chunk.count, chunk.box, chunkPositions, chunkNormals, stride);
+		}
+	};
+	RunChunks((int)chunks.size(), jobs, decodeChunks);
+}
+
+VECTOR3D CompactMesh::GetPositionErrorBound() const
+{
+	VECTOR3D bound;
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		const VECTOR3D& scale = chunks[c].box.scale;
+		if (0.5f * scale.x > bound.x) bound.x = 0.5f * scale.x;
+		if (0.5f * scale.y > bound.y) bound.y = 0.5f * scale.y;
+		if (0.5f * scale.z > bound.z) bound.z = 0.5f * scale.z;
+	}
+	return bound;
+}
+
+size_t CompactMesh::GetMemorySize() const
+{
+	return vertices.size() * sizeof(CompactVertex) + vertices16.size() * sizeof(CompactVertex16) +
+		   chunks.size() * sizeof(CompactChunk);
+}
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	VertexQuantizer.h
+//	Compact vertex formats for the ground and robot meshes.
+//
+//	Positions are stored as three signed 16-bit integers relative to a bounding box,
+//	p = offset + q * scale with q in [-32767, 32767], so each coordinate is within half a
+//	step (scale / 2) of the original. Normals are octahedral encoded, the unit sphere is
+//	folded onto the square [-1, 1]^2 and stored as two signed 8- or 16-bit values, which
+//	keeps normals within about 0.9 and 0.04 degrees (see -bench quantize).
+//
+//	CompactVertex (8-bit normals) is 8 bytes and CompactVertex16 (16-bit normals) is 10
+//	bytes, against 24 for a MeshVertex. CompactMesh splits a vertex array into chunks of
+//	consecutive vertices, each quantized against its own bounding box, so large grids keep
+//	their precision.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VERTEXQUANTIZER_H
+#define VERTEXQUANTIZER_H
+
+#include <vector>
+#include "VECTOR3D.h"
+
+class JobSystem;
+
+struct CompactVertex
+{
+	short position[3];
+	signed char normal[2];
+};
+
+struct CompactVertex16
+{
+	short position[3];
+	short normal[2];
+};
+
+// Maps quantized positions back, p = offset + q * scale
+struct QuantizationBox
+{
+	VECTOR3D offset;
+	VECTOR3D scale;
+};
+
+// Box centred on the bounds, with steps just covering them
+QuantizationBox MakeQuantizationBox(const VECTOR3D& boxMin, const VECTOR3D& boxMax);
+
+// Octahedral encoding of a unit vector, and back to a unit vector
+void EncodeOctahedral(const VECTOR3D& n, float& u, float& v);
+VECTOR3D DecodeOctahedral(float u, float v);
+
+// Kernels over count vertices whose position and normal are stride bytes apart, e.g. an
+// array of MeshVertex or IndexedMesh::Vertex
+void EncodeVertices(const VECTOR3D* positions, const VECTOR3D* normals, int stride, int count,
+					const QuantizationBox& box, CompactVertex* out);
+void EncodeVertices(const VECTOR3D* positions, const VECTOR3D* normals, int stride, int count,
+					const QuantizationBox& box, CompactVertex16* out);
+void DecodeVertices(const CompactVertex* in, int count, const QuantizationBox& box,
+					VECTOR3D* positions, VECTOR3D* normals, int stride);
+void DecodeVertices(const CompactVertex16* in, int count, const QuantizationBox& box,
+					VECTOR3D* positions, VECTOR3D* normals, int stride);
+
+struct CompactChunk
+{
+	QuantizationBox box;
+	int first, count;
+};
+
+class CompactMesh
+{
+private:
+	bool normals16;
+	std::vector<CompactChunk> chunks;
+	std::vector<CompactVertex> vertices;
+	std::vector<CompactVertex16> vertices16;
+
+public:
+	CompactMesh();
+
+	// Chunks of chunkSize vertices are encoded in parallel when jobs is given
+	void Encode(const VECTOR3D* positions, const VECTOR3D* normals, int stride, int count,
+				bool normals16, int chunkSize = 4096, JobSystem* jobs = NULL);
+	void Decode(VECTOR3D* positions, VECTOR3D* normals, int stride, JobSystem* jobs = NULL) const;
+
+	int GetNumVertices() const
+	{
+		return normals16 ? (int)vertices16.size() : (int)vertices.size();
+	}
+
+	const std::vector<CompactChunk>& GetChunks() const
+	{
+		return chunks;
+	}
+
+	// Largest position error of any vertex, half a step of the coarsest chunk along each axis
+	VECTOR3D GetPositionErrorBound() const;
+
+	// Bytes used by the vertices and chunk boxes
+	size_t GetMemorySize() const;
+};
+
+#endif	//VERTEXQUANTIZER_H
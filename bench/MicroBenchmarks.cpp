@@ -0,0 +1,225 @@
+#include <windows.h>
+#include <gl/gl.h>
+#include <math.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "QuadMesh.h"
+#include "Heightfield.h"
+#include "RobotModel.h"
+
+
+// Flat ground grid as bot2 lays it out, meshSize x meshSize quads over 32 x 32 units
+static void InitGround(QuadMesh& mesh, int meshSize, const Heightfield* heightfield)
+{
+	mesh.InitMesh(meshSize, VECTOR3D(-16.0f, 0.0f, 16.0f), 32.0, 32.0, VECTOR3D(1.0f, 0.0f, 0.0f),
+				  VECTOR3D(0.0f, 0.0f, -1.0f), heightfield);
+}
+
+static void QuadsPerSecond(benchmark::State& state, int meshSize)
+{
+	state.SetItemsProcessed(state.iterations() * (long long)meshSize * meshSize);
+}
+
+static void BM_QuadMeshInitMesh(benchmark::State& state)
+{
+	const int meshSize = (int)state.range(0);
+	QuadMesh mesh(meshSize, 32.0f);
+	for (auto _ : state)
+	{
+		InitGround(mesh, meshSize, NULL);
+		benchmark::ClobberMemory();
+	}
+	QuadsPerSecond(state, meshSize);
+}
+BENCHMARK(BM_QuadMeshInitMesh)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_QuadMeshInitMeshHeightfield(benchmark::State& state)
+{
+	const int meshSize = (int)state.range(0);
+	Heightfield heights;
+	heights.GenerateNoise(meshSize + 1, meshSize + 1, 5, 4.0f, 3.0f, 1);
+	QuadMesh mesh(meshSize, 32.0f);
+	for (auto _ : state)
+	{
+		InitGround(mesh, meshSize, &heights);
+		benchmark::ClobberMemory();
+	}
+	QuadsPerSecond(state, meshSize);
+}
+BENCHMARK(BM_QuadMeshInitMeshHeightfield)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_QuadMeshComputeNormals(benchmark::State& state)
+{
+	const int meshSize = (int)state.range(0);
+	QuadMesh mesh(meshSize, 32.0f);
+	InitGround(mesh, meshSize, NULL);
+	for (auto _ : state)
+	{
+		mesh.ComputeNormals();
+		benchmark::ClobberMemory();
+	}
+	QuadsPerSecond(state, meshSize);
+}
+BENCHMARK(BM_QuadMeshComputeNormals)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+
+
+// Vector math over a batch of vectors, large enough that the loop dominates
+static const int vectorBatch = 4096;
+
+static std::vector<VECTOR3D> MakeVectors(unsigned int seed)
+{
+	std::vector<VECTOR3D> vectors(vectorBatch);
+	for (int i = 0; i < vectorBatch; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		float a = (seed >> 8) * (1.0f / 16777216.0f) * 6.2831853f;
+		vectors[i] = VECTOR3D((float)cos(a), (float)sin(a * 0.5f), (float)i / vectorBatch - 0.5f);
+	}
+	return vectors;
+}
+
+static void BM_VectorArithmetic(benchmark::State& state)
+{
+	std::vector<VECTOR3D> a = MakeVectors(1), b = MakeVectors(2), result(vectorBatch);
+	for (auto _ : state)
+	{
+		for (int i = 0; i < vectorBatch; i++)
+			result[i] = (a[i] + b[i]) * 0.5f - a[i];
+		benchmark::DoNotOptimize(&result[0]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * vectorBatch);
+}
+BENCHMARK(BM_VectorArithmetic);
+
+static void BM_VectorDotCross(benchmark::State& state)
+{
+	std::vector<VECTOR3D> a = MakeVectors(1), b = MakeVectors(2), result(vectorBatch);
+	for (auto _ : state)
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < vectorBatch; i++)
+		{
+			result[i] = a[i].CrossProduct(b[i]);
+			sum += a[i].DotProduct(b[i]);
+		}
+		benchmark::DoNotOptimize(sum);
+		benchmark::DoNotOptimize(&result[0]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * vectorBatch);
+}
+BENCHMARK(BM_VectorDotCross);
+
+static void BM_VectorNormalize(benchmark::State& state)
+{
+	std::vector<VECTOR3D> source = MakeVectors(3), vectors(vectorBatch);
+	for (auto _ : state)
+	{
+		vectors = source;
+		for (int i = 0; i < vectorBatch; i++)
+			vectors[i].Normalize();
+		benchmark::DoNotOptimize(&vectors[0]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * vectorBatch);
+}
+BENCHMARK(BM_VectorNormalize);
+
+static void BM_MatrixMultiply(benchmark::State& state)
+{
+	MATRIX4X4 a = MATRIX4X4::GetRotation(30.0f, 0.0f, 1.0f, 0.0f);
+	a.Translate(1.0f, 2.0f, 3.0f);
+	MATRIX4X4 b = MATRIX4X4::GetRotation(-15.0f, 1.0f, 0.0f, 0.0f);
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(&a);
+		MATRIX4X4 product = a * b;
+		benchmark::DoNotOptimize(&product);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MatrixMultiply);
+
+static void BM_MatrixTransformPoint(benchmark::State& state)
+{
+	MATRIX4X4 m = MATRIX4X4::GetRotation(30.0f, 0.0f, 1.0f, 0.0f);
+	m.Translate(1.0f, 2.0f, 3.0f);
+	std::vector<VECTOR3D> points = MakeVectors(4), result(vectorBatch);
+	for (auto _ : state)
+	{
+		for (int i = 0; i < vectorBatch; i++)
+			result[i] = m.TransformPoint(points[i]);
+		benchmark::DoNotOptimize(&result[0]);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * vectorBatch);
+}
+BENCHMARK(BM_MatrixTransformPoint);
+
+
+// Forward kinematics of the whole part hierarchy, one robot per iteration
+static void BM_RobotTransforms(benchmark::State& state)
+{
+	RobotDimensions dims;
+	RobotPose pose;
+	RobotAnimation animation;
+	StartStepAnimation(pose, animation);
+	for (int i = 0; i < 7; i++)
+		AnimateRobot(pose, animation);
+
+	MATRIX4X4 root;
+	root.Translate(3.0f, 0.0f, -2.0f);
+	MATRIX4X4 partMatrices[NUM_ROBOT_PARTS];
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(&pose);
+		ComputeRobotTransforms(dims, pose, root, partMatrices);
+		benchmark::DoNotOptimize(partMatrices);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RobotTransforms);
+
+// One animation tick with the step, arm and cannon animations running, restarted as they end
+static void BM_AnimateRobot(benchmark::State& state)
+{
+	RobotPose pose;
+	RobotAnimation animation;
+	StartCannonAnimation(animation);
+	for (auto _ : state)
+	{
+		if (!animation.stepping)
+			StartStepAnimation(pose, animation);
+		if (!animation.armMoving)
+			StartArmAnimation(pose, animation);
+		benchmark::DoNotOptimize(AnimateRobot(pose, animation));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AnimateRobot);
+
+// Animation tick followed by the transforms, the per robot work of a fleet frame
+static void BM_AnimateAndTransform(benchmark::State& state)
+{
+	RobotDimensions dims;
+	RobotPose pose;
+	RobotAnimation animation;
+	StartCannonAnimation(animation);
+	MATRIX4X4 root;
+	MATRIX4X4 partMatrices[NUM_ROBOT_PARTS];
+	for (auto _ : state)
+	{
+		if (!animation.stepping)
+			StartStepAnimation(pose, animation);
+		AnimateRobot(pose, animation);
+		ComputeRobotTransforms(dims, pose, root, partMatrices);
+		benchmark::DoNotOptimize(partMatrices);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AnimateAndTransform);
+
+BENCHMARK_MAIN();
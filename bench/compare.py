@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""Compares two microbench JSON runs and flags regressions.
+
+    compare.py baseline.json current.json [--threshold 0.10] [--metric cpu_time]
+
+Each benchmark's time in current is compared with baseline. A benchmark is a
+regression when it got slower by more than the threshold (a fraction, 0.10 is
+10%). Runs made with --benchmark_repetitions are compared by their median,
+also when only the aggregates were reported.
+Exits 1 when any benchmark regressed, when a baseline benchmark is missing
+from current or has no time to compare with, or when there is nothing to
+compare at all, so it can gate a build.
+"""
+
+import argparse
+import json
+import sys
+
+
+# Nanoseconds per unit
+TIME_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load_times(file_name, metric):
+    with open(file_name) as f:
+        run = json.load(f)
+
+    # name -> time of every iteration run, and of the median aggregate when there is one
+    iterations = {}
+    medians = {}
+    for bench in run["benchmarks"]:
+        if bench.get("error_occurred"):
+            continue
+        name = bench.get("run_name", bench["name"])
+        time = bench[metric] * TIME_UNITS[bench.get("time_unit", "ns")]
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[name] = time
+        else:
+            iterations.setdefault(name, []).append(time)
+
+    # --benchmark_report_aggregates_only leaves only the medians
+    times = {}
+    for name in set(iterations) | set(medians):
+        if name in medians:
+            times[name] = medians[name]
+        else:
+            times[name] = sum(iterations[name]) / len(iterations[name])
+    return times
+
+
+def format_time(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return "%.3g %s" % (ns / scale, unit)
+    return "%.3g ns" % ns
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flags microbench regressions between two JSON runs")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="slowdown counted as a regression, as a fraction (default 0.10)")
+    parser.add_argument("--metric", choices=("cpu_time", "real_time"), default="cpu_time")
+    args = parser.parse_args()
+
+    baseline = load_times(args.baseline, args.metric)
+    current = load_times(args.current, args.metric)
+
+    regressions = 0
+    failures = 0
+    width = max([len(name) for name in list(baseline) + list(current)] + [9])
+    print("%-*s %12s %12s %9s" % (width, "benchmark", "baseline", "current", "change"))
+    for name in sorted(baseline):
+        if name not in current:
+            print("%-*s %12s %12s %9s" % (width, name, format_time(baseline[name]), "-", "MISSING"))
+            failures += 1
+            continue
+        if baseline[name] <= 0.0:
+            print("%-*s %12s %12s %9s" % (width, name, format_time(baseline[name]), format_time(current[name]),
+                                          "NO TIME"))
+            failures += 1
+            continue
+
+        change = current[name] / baseline[name] - 1.0
+        if change > args.threshold:
+            verdict = "  REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            verdict = "  faster"
+        else:
+            verdict = ""
+        print("%-*s %12s %12s %+8.1f%%%s" % (width, name, format_time(baseline[name]), format_time(current[name]),
+                                              change * 100.0, verdict))
+
+    for name in sorted(current):
+        if name not in baseline:
+            print("%-*s %12s %12s %9s" % (width, name, "-", format_time(current[name]), "new"))
+
+    compared = len(baseline) - failures
+    if compared == 0:
+        print("no benchmarks to compare")
+        return 1
+    print("%d of %d benchmarks regressed by more than %.0f%%" % (regressions, compared, args.threshold * 100.0))
+    if failures:
+        print("%d baseline benchmarks missing from the current run or without a time" % failures)
+    return 1 if regressions or failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,2 @@
+// Lower-case <gl/gl.h> as the Windows sources include it, forwarded to the Linux header
+#include <GL/gl.h>
@@ -0,0 +1,2 @@
+// Lower-case <gl/glu.h> as the Windows sources include it, forwarded to the Linux header
+#include <GL/glu.h>
@@ -0,0 +1,2 @@
+// Lower-case <gl/glut.h> as the Windows sources include it, forwarded to the Linux header
+#include <GL/glut.h>
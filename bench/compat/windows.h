@@ -0,0 +1 @@
+// Stand-in for <windows.h> on Linux, the sources only include it ahead of the GL headers
@@ -1,818 +1,2264 @@
-/*******************************************************************
-		   Hierarchical Multi-Part Model Example
-********************************************************************/
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include <math.h>
-#include <gl/glut.h>
-#include <utility>
-#include <vector>
-#include "VECTOR3D.h"
-#include "QuadMesh.h"
-
-const float PI = 3.142857;
-
-const int vWidth = 650;    // Viewport width in pixels
-const int vHeight = 500;    // Viewport height in pixels
-
-// Note how everything depends on robot body dimensions so that can scale entire robot proportionately
-// just by changing robot body scale
-float robotBodySize = 2.0;
-float cannonLength = 0.5 * robotBodySize;
-float cannonWidth = 0.2 * robotBodySize;
-float notchSize = 0.8 * cannonWidth;
-float notchLength = 0.5 * cannonLength;
-float hipRad = 0.5*robotBodySize;
-float hipLength = 0.5 * robotBodySize;
-float upperLegLength = robotBodySize;
-float upperLegHeight = 0.2 * robotBodySize;
-float upperLegWidth = 0.3 * robotBodySize;
-float lowerLegLength = 1.2 * upperLegLength;
-float lowerLegHeight = upperLegHeight;
-float lowerLegWidth = upperLegWidth;
-float footLength = robotBodySize;
-float footHeight = 0.5*robotBodySize;
-float footDepth = robotBodySize;
-float shoulderRad = hipRad;
-float shoulderLength = 2.0 * hipLength;
-float upperArmLength = 1.3*upperLegLength;
-float upperArmHeight = upperLegHeight;
-float upperArmWidth = upperLegWidth;
-float armGunLength = 1.2 * upperArmLength;
-float armGunRad = 0.5*upperArmWidth;
-
-// Control Robot body rotation
-float bodyAngle = 0.0;
-
-// Control cannon rotation
-float cannonAngle = 0.0;
-
-// right foot
-float rightHipAngle = 0.0;
-float rightKneeAngle = 0.0;
-
-// left foot
-float leftHipAngle = 0.0;
-float leftKneeAngle = 0.0;
-
-float* currentRotation = NULL;
-
-//left arm
-float leftShoulderAngle = 0.0;
-float leftElbowAngle = 0.0;
-
-//right arm
-float rightShoulderAngle = 0.0;
-float rightElbowAngle = 0.0;
-
-
-//rotates whole robot
-float robotSpin = 0.0; // horzontal
-float verticalSpin = 0.0;  // vertical
-
-// Lighting/shading and material properties for robot - upcoming lecture - just copy for now
-// Robot RGBA material properties (NOTE: we will learn about this later in the semester)
-GLfloat robotLeg_mat_ambient[] = { 0.25f,0.25f,0.25f,1.0f };
-GLfloat robotLeg_mat_specular[] = { 0.7746f,0.7746f,0.7746f,1.0f };
-GLfloat robotLeg_mat_diffuse[] = { 0.05f,0.05f,0.05f,1.0f };
-GLfloat robotLeg_mat_shininess[] = { 100.0F };
-
-
-GLfloat robotBody_mat_ambient[] = { 0.0215f, 0.1745f, 0.0215f, 0.55f };
-GLfloat robotBody_mat_diffuse[] = { 0.9f,0.0f,0.0f,1.0f };
-GLfloat robotBody_mat_specular[] = { 0.7f, 0.6f, 0.6f, 1.0f };
-GLfloat robotBody_mat_shininess[] = { 32.0F };
-
-
-// Light properties
-GLfloat light_position0[] = { -4.0F, 8.0F, 8.0F, 1.0F };
-GLfloat light_position1[] = { 4.0F, 8.0F, 8.0F, 1.0F };
-GLfloat light_diffuse[] = { 1.0, 1.0, 1.0, 1.0 };
-GLfloat light_specular[] = { 1.0, 1.0, 1.0, 1.0 };
-GLfloat light_ambient[] = { 0.2F, 0.2F, 0.2F, 1.0F };
-
-
-// Mouse button
-int currentButton;
-
-// A flat open mesh
-QuadMesh* groundMesh = NULL;
-
-// Structure defining a bounding box, currently unused
-typedef struct BoundingBox {
-	VECTOR3D min;
-	VECTOR3D max;
-} BBox;
-
-// Default Mesh Size
-int meshSize = 16;
-
-// Prototypes for functions in this module
-void initOpenGL(int w, int h);
-void display(void);
-void reshape(int w, int h);
-void mouse(int button, int state, int x, int y);
-void mouseMotionHandler(int xMouse, int yMouse);
-void keyboard(unsigned char key, int x, int y);
-void functionKeys(int key, int x, int y);
-void cannonAnimation(int param);
-void stepAnimation(int param);
-void armAnimation(int param);
-void drawRobot();
-void drawBody();
-void drawCannon();
-void drawLeftLeg();
-void drawRightLeg();
-void drawLeftArm();
-void drawRightArm();
-
-
-//void drawLowerBody();
-
-int main(int argc, char** argv)
-{
-	// Initialize GLUT
-	glutInit(&argc, argv);
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-	glutInitWindowSize(vWidth, vHeight);
-	glutInitWindowPosition(200, 30);
-	glutCreateWindow("3D Hierarchical Example");
-
-	// Initialize GL
-	initOpenGL(vWidth, vHeight);
-
-	// Register callback functions
-	glutDisplayFunc(display);
-	glutReshapeFunc(reshape);
-	glutMouseFunc(mouse);
-	glutMotionFunc(mouseMotionHandler);
-	glutKeyboardFunc(keyboard);
-	glutSpecialFunc(functionKeys);
-
-	// Start event loop, never returns
-	glutMainLoop();
-
-	return 0;
-}
-
-
-// Set up OpenGL. For viewport and projection setup see reshape(). 
-void initOpenGL(int w, int h)
-{
-	// Set up and enable lighting
-	glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
-	glLightfv(GL_LIGHT0, GL_SPECULAR, light_specular);
-	glLightfv(GL_LIGHT1, GL_AMBIENT, light_ambient);
-	glLightfv(GL_LIGHT1, GL_DIFFUSE, light_diffuse);
-	glLightfv(GL_LIGHT1, GL_SPECULAR, light_specular);
-
-	glLightfv(GL_LIGHT0, GL_POSITION, light_position0);
-	glLightfv(GL_LIGHT1, GL_POSITION, light_position1);
-
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
-	glEnable(GL_LIGHT1);   // This second light is currently off
-
-	// Other OpenGL setup
-	glEnable(GL_DEPTH_TEST);   // Remove hidded surfaces
-	glShadeModel(GL_SMOOTH);   // Use smooth shading, makes boundaries between polygons harder to see 
-	glClearColor(0.4F, 0.4F, 0.4F, 0.0F);  // Color and depth for glClear
-	glClearDepth(1.0f);
-	glEnable(GL_NORMALIZE);    // Renormalize normal vectors 
-	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);   // Nicer perspective
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-
-
-	// Other initializatuion
-	// Set up ground quad mesh
-	VECTOR3D origin = VECTOR3D(-16.0f, 0.0f, 16.0f);
-	VECTOR3D dir1v = VECTOR3D(1.0f, 0.0f, 0.0f);
-	VECTOR3D dir2v = VECTOR3D(0.0f, 0.0f, -1.0f);
-	groundMesh = new QuadMesh(meshSize, 32.0);
-	groundMesh->InitMesh(meshSize, origin, 32.0, 32.0, dir1v, dir2v);
-
-	VECTOR3D ambient = VECTOR3D(0.0f, 0.05f, 0.0f);
-	VECTOR3D diffuse = VECTOR3D(0.4f, 0.8f, 0.4f);
-	VECTOR3D specular = VECTOR3D(0.04f, 0.04f, 0.04f);
-	float shininess = 0.2;
-	groundMesh->SetMaterial(ambient, diffuse, specular, shininess);
-
-}
-
-
-// Callback, called whenever GLUT determines that the window should be redisplayed
-// or glutPostRedisplay() has been called.
-void display(void)
-{
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	const GLfloat identity[] = {1.0, 0.0, 0.0, 0.0,
-								0.0, 1.0, 0.0, 0.0,
-								0.0, 0.0, 1.0, 0.0,
-								0.0, 0.0, 0.0, 1.0 };
-
-	glLoadMatrixf(identity);
-	// Create Viewing Matrix V
-	// Set up the camera at position (0, 6, 22) looking at the origin, up along positive y axis
-	gluLookAt(0.0, 6.0, 22.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
-
-	// Draw Robot
-
-	// Apply modelling transformations M to move robot
-	// Current transformation matrix is set to IV, where I is identity matrix
-	// CTM = IV
-	drawRobot();
-
-	// Draw ground
-	glPushMatrix();
-	const GLfloat T1[] = {	1.0, 0.0, 0.0, 0.0,
-							0.0, 1.0, 0.0, 0.0,
-							0.0, 0.0, 1.0, 0.0,
-							0.0, -10.0, 0.0, 1.0 };
-		glMultMatrixf(T1);
-		groundMesh->DrawMesh(meshSize);
-	glPopMatrix();
-
-	glutSwapBuffers();   // Double buffering, swap buffers
-}
-
-void drawRobot()
-{
-
-	
-	glPushMatrix();
-		
-		//allows for rotating entire model horizontally (y-axis)
-		glRotatef(robotSpin, 0.0, 1.0, 0.0);
-
-		//allows for rotating entire model verticaly (x-axis)
-		glRotatef(verticalSpin, 1.0, 0.0, 0.0);
-
-
-
-		//CTM = IV*R_y*R_x
-		glPushMatrix();
-			
-			// spin body and cannon. 
-			glRotatef(bodyAngle, 1.0, 0.0, 0.0);
-
-			//CTM = I * V * R_y * R_x * R_x(bodyAngle)
-			drawBody();
-			drawCannon();
-
-		glPopMatrix();
-	
-		drawLeftLeg();
-		drawRightLeg();
-		drawLeftArm();
-		drawRightArm();
-
-	glPopMatrix();
-
-}
-
-
-void drawBody()
-{
-	glMaterialfv(GL_FRONT, GL_AMBIENT, robotBody_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, robotBody_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, robotBody_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, robotBody_mat_shininess);
-
-	//CTM = I*V* R_y * R_x * R_x(bodyAngle)
-	glPushMatrix();
-		//CTM = I*V* R_y * R_x * R_x(bodyAngle)*S
-		glScalef(robotBodySize, robotBodySize, robotBodySize);
-		gluSphere(gluNewQuadric(), 1.0, 100, 100);
-	glPopMatrix();
-}
-
-
-void drawCannon()
-{
-	// Set robot material properties per body part. Can have seperate material properties for each part
-	glMaterialfv(GL_FRONT, GL_AMBIENT, robotLeg_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, robotLeg_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, robotLeg_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, robotLeg_mat_shininess);
-
-	//CTM = I*V* R_y * R_x * R_x(bodyAngle)
-	glPushMatrix();
-
-		// Position cannon with respect to parent (body), place it slightly within the body
-	
-		glTranslatef(0.0, 0.0, (robotBodySize - 0.25 * cannonLength));
-
-		//rotate cannon and notch on z-axis
-		glRotatef(cannonAngle, 0.0, 0.0, 1.0);
-
-		//CTM = I * V * R_y * R_x * R_x(bodyAngle) * T1 * R1
-		glPushMatrix();
-			// Build cannon
-			glScalef(cannonWidth, cannonWidth, cannonLength);
-			gluCylinder(gluNewQuadric(), 1.0, 1.0, 1.0, 50, 50);
-
-		glPopMatrix();
-
-		// position notch above cylinder
-		glTranslatef(0.0, (cannonWidth + 0.5 * notchSize), (cannonLength - 0.5 * notchLength));
-
-		glPushMatrix();
-			glScalef(notchSize, notchSize, notchLength);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-	glPopMatrix();
-
-	
-}
-
-void drawLeftLeg()
-{
-	glMaterialfv(GL_FRONT, GL_AMBIENT, robotLeg_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, robotLeg_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, robotLeg_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, robotLeg_mat_shininess);
-
-	//CTM = IV* R_y * R_x 
-	glPushMatrix();
-
-		// Position hip with respect to parent body
-		glTranslatef(robotBodySize, (-1.5 * hipRad), 0.0);
-
-		glRotatef(90,0.0,1.0,0.0);
-		
-		// rotate hip and sub-parts (legs etc)
-		glRotatef(leftHipAngle, 0.0, 0.0, 1.0);
-
-
-		// build hip
-		glPushMatrix();
-			glScalef(hipRad,hipRad,hipLength);
-			gluCylinder(gluNewQuadric(), 1.0, 1.0, 1.0, 100, 100);
-		glPopMatrix();
-
-		//rotate 45 degrees about the hip joint
-		glRotatef(45, 0.0, 0.0, 1.0);
-
-		//position upperleg w/ resp. to hip
-		glTranslatef(0.0, -(hipRad + 0.5 * upperLegLength), 0.5 * hipLength);
-
-		//place upperleg on hip
-		glPushMatrix();
-			glScalef(upperLegHeight, upperLegLength, upperLegWidth);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-		glTranslatef(0.0, -0.5 * upperLegLength, 0.0);
-		
-		//rotates will occur at the knee joint now
-		glRotatef(leftKneeAngle, 0.0, 0.0, 1.0);
-
-		//translate first to change pivot point to knee
-		glTranslatef(-0.5 * lowerLegLength, 0.0, 0.0);
-
-		glPushMatrix();
-			glScalef(lowerLegLength, lowerLegHeight, lowerLegWidth);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-		//position foot w/ resp. to lower leg
-		glTranslatef(-0.5 * lowerLegLength, 0.0, 0.0);
-
-		//rotate foot so that it is flat
-		glRotatef(-45, 0.0, 0.0, 1.0);
-
-
-		glPushMatrix();
-			glScalef(footLength, footHeight, footDepth);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-
-	glPopMatrix();
-}
-
-void drawRightLeg()
-{
-	glMaterialfv(GL_FRONT, GL_AMBIENT, robotLeg_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, robotLeg_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, robotLeg_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, robotLeg_mat_shininess);
-
-	//CTM = IV* R_y * R_x 
-	glPushMatrix();
-
-		// Position hip with respect to parent body
-		glTranslatef(-(robotBodySize + hipLength), (-1.5 * hipRad), 0.0);
-
-
-		glRotatef(90, 0.0, 1.0, 0.0);
-
-		// rotate hip and sub-parts (legs etc)
-		glRotatef(rightHipAngle, 0.0, 0.0, 1.0);
-
-		// build hip
-		glPushMatrix();
-			glScalef(hipRad, hipRad, hipLength);
-			gluCylinder(gluNewQuadric(), 1.0, 1.0, 1.0, 100, 100);
-		glPopMatrix();
-
-		//rotate 45 degrees about the hip joint
-		glRotatef(45, 0.0, 0.0, 1.0);
-
-		//position upperleg w/ resp. to hip
-		glTranslatef(0.0, -(hipRad + 0.5 * upperLegLength), 0.5 * hipLength);
-
-		//place upperleg on hip
-		glPushMatrix();
-			glScalef(upperLegHeight, upperLegLength, upperLegWidth);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-		glTranslatef(0.0, -0.5 * upperLegLength, 0.0);
-
-		//rotates will occur at the knee joint now
-		glRotatef(rightKneeAngle, 0.0, 0.0, 1.0);
-
-		//translate first to change pivot point to knee
-		glTranslatef(-0.5 * lowerLegLength, 0.0, 0.0);
-		glPushMatrix();
-			glScalef(lowerLegLength, lowerLegHeight, lowerLegWidth);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-		//position foot w/ resp. to lower leg
-		glTranslatef(-0.5 * lowerLegLength, 0.0, 0.0);
-
-		//rotate foot so that it is flat
-		glRotatef(-45, 0.0, 0.0, 1.0);
-
-		glPushMatrix();
-			glScalef(footLength, footHeight, footDepth);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-
-	glPopMatrix();
-
-}
-
-void drawLeftArm() 
-{
-	glMaterialfv(GL_FRONT, GL_AMBIENT, robotLeg_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, robotLeg_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, robotLeg_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, robotLeg_mat_shininess);
-
-	//CTM = IV*R_y*R_x
-	glPushMatrix();
-
-		// Position shoulder with respect to parent body
-		glTranslatef(robotBodySize, 1.5 * shoulderRad, 0.0);
-		glRotatef(90, 0.0, 1.0, 0.0);
-
-		// rotate shoulder and sub-parts (arms etc)
-		glRotatef(leftShoulderAngle, 0.0, 0.0, 1.0);
-
-		// build shoulder
-		glPushMatrix();
-			glScalef(shoulderRad, shoulderRad, shoulderLength);
-			gluCylinder(gluNewQuadric(), 1.0, 1.0, 1.0, 100, 100);
-		glPopMatrix();
-
-		//rotate -45 degrees about the shoulder joint
-		glRotatef(-45, 0.0, 0.0, 1.0);
-
-		//position upperarm w/ resp. to shoulder
-		glTranslatef(0.0, -(shoulderRad + 0.5 * upperArmLength), shoulderLength - 0.5 * upperArmWidth);
-
-		//place upperArm on shoulder
-		glPushMatrix();
-			glScalef(upperArmHeight, upperArmLength, upperArmWidth);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-		glTranslatef(0.0, -0.5 * upperArmLength, 0.0);
-
-		//rotates will occur at the elbow joint (base of cylinder)
-		glRotatef(leftElbowAngle, 0.0, 0.0, 1.0);
-
-		glRotatef(-90, 0.0, 1.0, 0.0);
-
-		glPushMatrix();
-			glScalef(armGunRad, armGunRad, armGunLength);
-			gluCylinder(gluNewQuadric(), 1.0, 1.0, 1.0, 100, 100);
-		glPopMatrix();
-
-	glPopMatrix();
-}
-
-void drawRightArm()
-{
-	glMaterialfv(GL_FRONT, GL_AMBIENT, robotLeg_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, robotLeg_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, robotLeg_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, robotLeg_mat_shininess);
-
-	//CTM = IV*R_y*R_x
-	glPushMatrix();
-
-		// Position shoulder with respect to parent body
-		glTranslatef(-(robotBodySize + shoulderLength), 1.5 * shoulderRad, 0.0);
-		glRotatef(90, 0.0, 1.0, 0.0);
-
-		// rotate shoulder and sub-parts (arms etc)
-		glRotatef(rightShoulderAngle, 0.0, 0.0, 1.0);
-
-		// build shoulder
-		glPushMatrix();
-			glScalef(shoulderRad, shoulderRad, shoulderLength);
-			gluCylinder(gluNewQuadric(), 1.0, 1.0, 1.0, 100, 100);
-		glPopMatrix();
-
-		//rotate -45 degrees about the shoulder joint
-		glRotatef(-45, 0.0, 0.0, 1.0);
-
-		//position upperarm w/ resp. to shoulder
-		glTranslatef(0.0, -(shoulderRad + 0.5 * upperArmLength), 0.5 * upperArmWidth);
-
-		//place upperArm on shoulder
-		glPushMatrix();
-			glScalef(upperArmHeight, upperArmLength, upperArmWidth);
-			glutSolidCube(1.0);
-		glPopMatrix();
-
-		glTranslatef(0.0, -0.5 * upperArmLength, 0.0);
-
-		//rotates will occur at the elbow joint (base of cylinder)
-		glRotatef(rightElbowAngle, 0.0, 0.0, 1.0);
-		glRotatef(-90, 0.0, 1.0, 0.0);
-
-		glPushMatrix();
-			glScalef(armGunRad, armGunRad, armGunLength);
-			gluCylinder(gluNewQuadric(), 1.0, 1.0, 1.0, 100, 100);
-		glPopMatrix();
-
-	glPopMatrix();
-
-}
-
-
-// Callback, called at initialization and whenever user resizes the window.
-void reshape(int w, int h)
-{
-	// Set up viewport, projection, then change to modelview matrix mode - 
-	// display function will then set up camera and do modeling transforms.
-	glViewport(0, 0, (GLsizei)w, (GLsizei)h);
-
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(60.0, (GLdouble)w / h, 0.2, 40.0);
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-
-	// Set up the camera at position (0, 6, 22) looking at the origin, up along positive y axis
-	gluLookAt(0.0, 6.0, 22.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
-}
-
-bool cannonRotating = false;
-bool stopCannon = false;
-
-// hip and knee rotations for animation
-float hipR = 0.0, kneeR = 0.0;
-
-float shoulderR = 0.0, elbowR = 0.0; //shoulder and elbow rotations
-
-// Callback, handles input from the keyboard, non-arrow keys
-void keyboard(unsigned char key, int x, int y)
-{
-	//need to add function for ARROW KEYS, this just supposed to toggle the joint
-	switch (key)
-	{
-	case 'b':
-		currentRotation = &bodyAngle;
-		break;
-	case 'h':
-		currentRotation = &rightHipAngle;
-		break;
-	case 'k':
-		currentRotation = &rightKneeAngle;
-		break;
-
-	case 'w':
-		// reset angles and setup angle incrementers
-		leftHipAngle = 0.0;
-		leftKneeAngle = 0.0;
-		//initialize the amount of rotation
-		hipR = 1.0;
-		kneeR = -1.0;
-		glutTimerFunc(10, stepAnimation, 0);
-		break;
-	case 'W':
-		leftHipAngle = 0.0;
-		leftKneeAngle = 0.0;
-		break;
-
-	case 'a':
-		rightShoulderAngle = 0.0;
-		rightElbowAngle = 0.0;
-		//initialize the amount of rotation
-		shoulderR = -0.75;
-		elbowR = 1.5;
-		glutTimerFunc(10, armAnimation, 0);
-		break;
-	case 'A':
-		rightShoulderAngle = 0.0;
-		rightElbowAngle = 0.0;
-		break;
-
-	case 'q':
-	case 'Q':
-		exit(0);
-		break;
-
-	case 'c':
-		stopCannon = false;
-		if (!cannonRotating)
-		{
-			cannonRotating = true;
-			// make cannon spin
-			glutTimerFunc(10, cannonAnimation, 0);
-		}
-			break;
-	case 'C':
-		stopCannon = true;
-		break;
-
-	//Spins whole robot
-	case 's':
-		robotSpin += 2.0;
-		if (robotSpin > 360.0)
-			robotSpin -= 360.0;
-		break;
-	case 'S':
-		robotSpin -= 2.0;
-		if (robotSpin < 0.0)
-			robotSpin += 360.0;
-		break;
-	case 'v':
-		verticalSpin += 2.0;
-		if (verticalSpin > 360.0)
-			verticalSpin -= 360.0;
-		break;
-	case 'V':
-		verticalSpin -= 2.0;
-		if (verticalSpin < 0.0)
-			verticalSpin += 360.0;
-		break;
-		
-	}
-
-	glutPostRedisplay();   // Trigger a window redisplay
-}
-
-void cannonAnimation(int)
-{
-	if (!stopCannon)
-	{
-		cannonAngle += 1.0;
-		glutPostRedisplay();
-		glutTimerFunc(10, cannonAnimation, 0);
-	}
-	else
-	{ 
-		//cannon no longer rotating
-		cannonRotating = false;
-	}
-	
-}
-
-void stepAnimation(int)
-{
-	//starts at 0, increments till >40
-	//decrements till <-10
-	//stops when <-20
-	if (leftHipAngle >= 40.0)
-	{
-		hipR = -1.5;
-		kneeR = 0.25;
-	}
-	else if (leftHipAngle <= -20.0)
-	{
-		return;
-	}
-	else if (leftHipAngle <= -10.0)
-	{	
-		hipR = -0.5;
-		kneeR = 2.5;
-	}
-	
-	leftHipAngle += hipR;
-	leftKneeAngle += kneeR;
-	glutPostRedisplay();
-	glutTimerFunc(10, stepAnimation, 0);
-}
-
-void armAnimation(int)
-{
-	//starts at 0, decrement till < -45
-	//return when back to starting i.e. >0
-	if (rightShoulderAngle <= -45.0)
-	{
-		shoulderR = 0.75;
-		elbowR = -1.5;
-	}
-	else if (rightShoulderAngle > 0.0)
-	{
-		return;
-	}
-
-	rightShoulderAngle += shoulderR;
-	rightElbowAngle += elbowR;
-	glutPostRedisplay();
-	glutTimerFunc(10, armAnimation, 0);
-}
-
-
-// Callback, handles input from the keyboard, function and arrow keys
-void functionKeys(int key, int x, int y)
-{
-	switch (key) 
-	{
-	case GLUT_KEY_LEFT:
-		if (!currentRotation == NULL) {
-			*currentRotation -= 2.0;
-			if (*currentRotation < 0.0)
-				*currentRotation += 360.0;
-		}
-		break;
-
-	case GLUT_KEY_RIGHT:
-		if (!currentRotation == NULL) {
-			*currentRotation += 2.0;
-			if (*currentRotation > 360.0)
-				*currentRotation -= 360.0;
-		}
-		break;
-	}
-	/*
-	// Help key
-	if (key == GLUT_KEY_F1)
-	{
-
-	}
-	// Do transformations with arrow keys
-	//else if (...)   // GLUT_KEY_DOWN, GLUT_KEY_UP, GLUT_KEY_RIGHT, GLUT_KEY_LEFT
-	//{
-	//}
-	*/
-
-	glutPostRedisplay();   // Trigger a window redisplay
-}
-
-
-// Mouse button callback - use only if you want to 
-void mouse(int button, int state, int x, int y)
-{
-	currentButton = button;
-
-	switch (button)
-	{
-	case GLUT_LEFT_BUTTON:
-		if (state == GLUT_DOWN)
-		{
-			;
-
-		}
-		break;
-	case GLUT_RIGHT_BUTTON:
-		if (state == GLUT_DOWN)
-		{
-			;
-		}
-		break;
-	default:
-		break;
-	}
-
-	glutPostRedisplay();   // Trigger a window redisplay
-}
-
-
-// Mouse motion callback - use only if you want to 
-void mouseMotionHandler(int xMouse, int yMouse)
-{
-	if (currentButton == GLUT_LEFT_BUTTON)
-	{
-		;
-	}
-
-	glutPostRedisplay();   // Trigger a window redisplay
-}
-
+/*******************************************************************
+		   Hierarchical Multi-Part Model Example
+********************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <gl/glew.h>
+#include <gl/glut.h>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include "VECTOR3D.h"
+#include "QuadMesh.h"
+#include "MATRIX4X4.h"
+#include "AnimationRecorder.h"
+#include "RobotModel.h"
+#include "JointRegistry.h"
+#include "RobotFleet.h"
+#include "JobSystem.h"
+#include "FramePipeline.h"
+#include "Collision.h"
+#include "Heightfield.h"
+#include "Terrain.h"
+#include "MeshOptimizer.h"
+#include "Allocators.h"
+#include "Shadows.h"
+#include "LightingShader.h"
+#include "RedrawScheduler.h"
+#include "Camera.h"
+#include "MultiView.h"
+#include "Skinning.h"
+#include "JointTrails.h"
+#include "Particles.h"
+#include "Picking.h"
+#include "RobotPhysics.h"
+#include "ImageCompare.h"
+#include "OcclusionCulling.h"
+#include "RobotVariants.h"
+#include "Telemetry.h"
+#include "Benchmarks.h"
+
+const float PI = 3.142857;
+
+const int vWidth = 650;    // Viewport width in pixels
+const int vHeight = 500;    // Viewport height in pixels
+
+// Note how everything depends on robot body dimensions so that can scale entire robot proportionately
+// just by changing robot body scale, see RobotDimensions
+RobotDimensions robotDims(2.0);
+
+// Joint angles of the robot, kept within their limits by the registry, and the state of
+// its scripted animations
+JointRegistry robotJointState(1);
+RobotAnimation robotAnimation;
+
+// World matrix of every robot part, recomputed by display()
+MATRIX4X4 robotPartMatrices[NUM_ROBOT_PARTS];
+
+// Joint the arrow keys turn, -1 for none
+int currentJoint = -1;
+
+// Joint angles captured by the animation recorder, one channel per joint in JointId order,
+// which is part of the log format. They point into robotJointState, defined above.
+const float* robotAngles = robotJointState.GetAngles(0);
+const float* jointChannels[NUM_JOINTS] = { &robotAngles[JOINT_BODY], &robotAngles[JOINT_CANNON],
+										   &robotAngles[JOINT_RIGHT_HIP], &robotAngles[JOINT_RIGHT_KNEE],
+										   &robotAngles[JOINT_LEFT_HIP], &robotAngles[JOINT_LEFT_KNEE],
+										   &robotAngles[JOINT_LEFT_SHOULDER], &robotAngles[JOINT_LEFT_ELBOW],
+										   &robotAngles[JOINT_RIGHT_SHOULDER], &robotAngles[JOINT_RIGHT_ELBOW],
+										   &robotAngles[JOINT_ROBOT_SPIN], &robotAngles[JOINT_VERTICAL_SPIN] };
+const int NUM_JOINT_CHANNELS = NUM_JOINTS;
+
+// Joint that moves each part, selected by clicking the part
+const int partJoints[NUM_ROBOT_PARTS] =
+{
+	JOINT_BODY, JOINT_CANNON, JOINT_CANNON,
+	JOINT_LEFT_HIP, JOINT_LEFT_HIP, JOINT_LEFT_KNEE, JOINT_LEFT_KNEE,
+	JOINT_RIGHT_HIP, JOINT_RIGHT_HIP, JOINT_RIGHT_KNEE, JOINT_RIGHT_KNEE,
+	JOINT_LEFT_SHOULDER, JOINT_LEFT_SHOULDER, JOINT_LEFT_ELBOW,
+	JOINT_RIGHT_SHOULDER, JOINT_RIGHT_SHOULDER, JOINT_RIGHT_ELBOW
+};
+
+// Input and animation log, only active when started with -record
+AnimationRecorder animationRecorder;
+
+// Set while -replay runs the recorded input headlessly
+bool replaying = false;
+
+// Lighting/shading and material properties for robot - upcoming lecture - just copy for now
+// Robot RGBA material properties (NOTE: we will learn about this later in the semester)
+GLfloat robotLeg_mat_ambient[] = { 0.25f,0.25f,0.25f,1.0f };
+GLfloat robotLeg_mat_specular[] = { 0.7746f,0.7746f,0.7746f,1.0f };
+GLfloat robotLeg_mat_diffuse[] = { 0.05f,0.05f,0.05f,1.0f };
+GLfloat robotLeg_mat_shininess[] = { 100.0F };
+
+
+GLfloat robotBody_mat_ambient[] = { 0.0215f, 0.1745f, 0.0215f, 0.55f };
+GLfloat robotBody_mat_diffuse[] = { 0.9f,0.0f,0.0f,1.0f };
+GLfloat robotBody_mat_specular[] = { 0.7f, 0.6f, 0.6f, 1.0f };
+GLfloat robotBody_mat_shininess[] = { 32.0F };
+
+
+// Light properties, positions in the eye coordinates of the initial camera
+GLfloat light_position0[] = { -4.0F, 8.0F, 8.0F, 1.0F };
+GLfloat light_position1[] = { 4.0F, 8.0F, 8.0F, 1.0F };
+GLfloat light_diffuse[] = { 1.0, 1.0, 1.0, 1.0 };
+GLfloat light_specular[] = { 1.0, 1.0, 1.0, 1.0 };
+GLfloat light_ambient[] = { 0.2F, 0.2F, 0.2F, 1.0F };
+
+// The lights stay put in the world while the camera moves, they are placed again whenever
+// the camera's matrices change
+VECTOR3D worldLights[2];
+MATRIX4X4 lightsView;
+bool lightsPlaced = false;
+
+
+// Mouse button
+int currentButton;
+int lastMouseX, lastMouseY;
+
+// A left click that does not drag the camera picks the part under the cursor and selects
+// its joint for the arrow keys, the parts it moves are outlined. Clicking the fleet or the
+// ground clears the selection.
+int clickX, clickY;
+PickScene pickScene;
+PickGround pickGround;
+
+// Orbit camera, the left button drags it around the robot and the right button zooms.
+// 'm' switches to following the robot as it spins.
+Camera camera;
+int windowWidth = vWidth, windowHeight = vHeight;
+
+// 'n' cycles the camera alone, four split-screen views (the camera, front, side and top)
+// and the six cube map faces seen from the robot's body
+enum MultiViewMode
+{
+	MULTIVIEW_OFF,
+	MULTIVIEW_SPLIT,
+	MULTIVIEW_CUBE
+};
+int multiViewMode = MULTIVIEW_OFF;
+
+// A flat open mesh
+QuadMesh* groundMesh = NULL;
+
+// Quadric shared by every sphere and cylinder part
+GLUquadric* partQuadric = NULL;
+
+// Parts and the flat ground are drawn with GLU and GL_QUADS as before, or from vertex
+// cache optimised index lists or strips; 'o' cycles through the three
+enum PrimitiveMode
+{
+	PRIMITIVES_GLU,
+	PRIMITIVES_LISTS,
+	PRIMITIVES_STRIPS
+};
+int primitiveMode = PRIMITIVES_GLU;
+std::vector<IndexedMesh> primitiveLists, primitiveStrips;
+int partPrimitive[NUM_ROBOT_PARTS];
+IndexedMesh groundLists, groundStrips;
+
+// Per-pixel lighting, used whenever the shader builds and toggled with 'g'. The shading no
+// longer depends on the tessellation, so the parts are drawn from much coarser meshes.
+LightingShader lightingShader;
+bool perPixelLighting = false;
+int bodyMaterial, legMaterial, groundMaterial;
+const int shadedSlices = 48;
+const int shadedStacks = 32;
+std::vector<IndexedMesh> shadedLists, shadedStrips;
+
+// 'j' cycles the rigid upper and lower leg parts and a continuous skin over the legs,
+// deformed by the leg parts with linear blend or dual quaternion skinning
+enum LegMode
+{
+	LEGS_RIGID,
+	LEGS_LINEAR_SKIN,
+	LEGS_DUAL_QUATERNION_SKIN
+};
+int legMode = LEGS_RIGID;
+SkinMesh legSkin;
+IndexedMesh skinnedLegs;
+
+// Scratch memory for the frame being drawn, reset at the start of display()
+FrameArena frameArena;
+
+// Crowd of extra robots updated in parallel, toggled with 'f'
+const int fleetSize = 64;
+RobotFleet fleet;
+JobSystem* jobSystem = NULL;
+bool showFleet = false;
+
+// Fleet robots of random proportions and materials from a shared palette, toggled with 'e'
+bool fleetVariety = false;
+std::vector<RobotVariant> fleetVariants;
+VariantPalette variantPalette;
+int variantBodyMaterials[VARIANT_PALETTE_SIZE], variantLegMaterials[VARIANT_PALETTE_SIZE];
+
+// When running, the fleet is simulated on its own thread one frame ahead of display(), toggled with 'p'
+FramePipeline framePipeline;
+
+// Where the arm gun tips and feet of the robot and the fleet have been, drawn as fading
+// trails when toggled with 'r'. The fleet's trails are pushed by whichever thread
+// simulates it.
+const int trailLength = 64;
+JointTrails robotTrails, fleetTrails;
+bool showTrails = false;
+
+// Sparks fired from the cannon muzzle while it spins and from the arm gun tips while the
+// arms move, advanced with the animation ticks and bouncing off the ground
+const int maxParticles = 20000;
+ParticleSystem particles;
+ParticleGround particleGround;
+ParticleParams particleParams;
+long long particleFrameNumber = 0;
+
+// Physics mode, toggled with 'y': the robot walks on the ground as rigid bodies whose hinge
+// motors follow the walk cycle for the legs and the robot's joints for everything else
+RobotPhysics robotPhysics;
+bool physicsMode = false;
+long long physicsTicks = 0;
+
+// Redisplays are only posted when the tracked scene state changed since the last frame,
+// at most one per refresh, see requestRedraw()
+RedrawScheduler redrawScheduler;
+long long fleetFrameNumber = 0;
+std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+// Ground and self contacts of the robot, shown as yellow points when toggled with 'x'
+bool showContacts = false;
+CollisionWorld collisionWorld;
+std::vector<GroundContact> groundContacts;
+std::vector<PartContact> partContacts;
+
+// Out of physics mode the robot stands at the origin, above the drawn ground, with the
+// bottom of its feet this high at rest. Its contacts are found with the ground moved up
+// there, sunk by contactSkin so that resting feet touch it.
+float robotFootHeight = 0.0f;
+const float contactSkin = 0.05f;
+
+// Default Mesh Size
+int meshSize = 16;
+
+// Rolling terrain for the ground, toggled with 't' or loaded with -heightmap
+Heightfield groundHeights;
+bool terrainGround = false;
+
+// The terrain is drawn from a finer quadtree of the same heights, groundMesh stays at
+// meshSize for contacts. Heightmaps whose size does not fit the quadtree use groundMesh.
+Terrain groundTerrain;
+bool groundTerrainReady = false;
+const int terrainCells = 256;
+const int terrainPatchSize = 16;
+
+// Robot shadows on the ground, 'l' cycles off, planar and shadow mapped. Planar shadows
+// need the flat ground, on the terrain the shadow maps are used instead.
+enum ShadowMode
+{
+	SHADOWS_OFF,
+	SHADOWS_PLANAR,
+	SHADOWS_MAPPED
+};
+int shadowMode = SHADOWS_PLANAR;
+const float shadowDarkness = 0.45f;
+
+// One map per light, looked up into a mask texture over the ground whenever one is rendered again
+ShadowMap shadowMaps[2];
+const int shadowMaskSize = 256;
+unsigned char shadowMask[shadowMaskSize * shadowMaskSize];
+GLuint shadowTexture = 0;
+bool shadowMaskDirty = true;
+
+// Fleet robots and parts hidden behind nearer robots' bodies or the ground are not drawn,
+// toggled with 'u'. The buffer has a quarter of each view's pixels.
+OcclusionBuffer occlusionBuffer;
+bool occlusionCulling = false;
+
+// Joint angles and part matrices of the robot and the fleet, published through shared
+// memory after every frame when started with -publish. Another process reads them with
+// -monitor. The robot is robot 0 and the fleet robots follow when the fleet is shown.
+const char* telemetryName = "Local\\RobotTelemetry";
+TelemetryPublisher telemetryPublisher;
+long long telemetryFrameNumber = 0;
+double lastTelemetryTime = 0.0;
+double telemetryPublishTime = 0.0, maxTelemetryPublishTime = 0.0;
+
+// What display() gathers once per frame for drawing every view
+struct FrameScene
+{
+	const FleetFrame* fleetFrame;	// NULL when the fleet is not drawn
+	VECTOR3D fleetOffset;
+	ShadowCaster* casters;
+	int numCasters;
+	bool planarShadows, mappedShadows;
+};
+
+// Prototypes for functions in this module
+void initOpenGL(int w, int h);
+void display(void);
+void reshape(int w, int h);
+void mouse(int button, int state, int x, int y);
+void mouseMotionHandler(int xMouse, int yMouse);
+void keyboard(unsigned char key, int x, int y);
+void functionKeys(int key, int x, int y);
+void handleKey(unsigned char key);
+void handleSpecialKey(int key);
+void turnJoint(int joint, float degrees);
+RobotPose getRobotPose();
+void setRobotPose(const RobotPose& pose);
+void placeLights(const MATRIX4X4& view);
+void requestRedraw();
+void redrawTimer(int param);
+double elapsedMilliseconds();
+void startAnimationTimer();
+void animationTimer(int param);
+bool animationTick();
+void startPhysics();
+void startPipeline();
+void stopPipeline();
+void computeRobotParts(MATRIX4X4 partMatrices[NUM_ROBOT_PARTS]);
+int replayAnimation(const char* fileName);
+int runShadingTest();
+int runRenderTest(const char* directory, bool record);
+void closeRecorder();
+void publishTelemetry(const FleetFrame* fleetFrame);
+void closePublisher();
+int monitorTelemetry(double seconds);
+void drawRobotParts(const MATRIX4X4* partMatrices, const IndexedMesh* legs, unsigned int parts = ALL_ROBOT_PARTS,
+					const RobotVariant* variant = NULL);
+void setPartMaterial(bool body, const RobotVariant* variant = NULL);
+void findContacts(const MATRIX4X4 partMatrices[NUM_ROBOT_PARTS]);
+void drawContacts();
+void pickJoint(int x, int y);
+void selectJoint(int joint);
+void drawSelection();
+VECTOR3D getFleetOffset();
+void pushRobotTrails(const MATRIX4X4* partMatrices);
+void emitSparks(const MATRIX4X4* partMatrices);
+void drawParticles(const View& view);
+void drawTrails(const JointTrails& trails, const int* robots, int count);
+void initGround();
+int getViews(View* views);
+void drawView(const View& view, const int* drawList, const unsigned int* partMasks, int count, const FrameScene& scene);
+void cullOccludedParts(const View& view, const FrameScene& scene, const int* drawList, int count, unsigned int* partMasks);
+void drawTerrain(const View& view);
+void drawFleet(const FleetFrame& fleetFrame, const int* drawList, const unsigned int* partMasks, int count);
+void getShadowLights(VECTOR3D lights[2]);
+void updateShadowMask(const ShadowCaster* casters, int numCasters);
+void drawPlanarShadows(const ShadowCaster* casters, int numCasters);
+void drawShadowParts(const MATRIX4X4* partMatrices);
+void initPrimitives();
+void optimizeMesh(IndexedMesh& lists, IndexedMesh& strips);
+
+
+//void drawLowerBody();
+
+int main(int argc, char** argv)
+{
+	// Headless replay of a recorded session, no window is created
+	if (argc > 2 && strcmp(argv[1], "-replay") == 0)
+		return replayAnimation(argv[2]);
+
+	// Headless benchmarks, see Benchmarks.cpp
+	if (argc > 1 && strcmp(argv[1], "-bench") == 0)
+		return RunBenchmark(argc > 2 ? argv[2] : "all");
+
+	// Prints what a running -publish instance publishes, see monitorTelemetry()
+	if (argc > 1 && strcmp(argv[1], "-monitor") == 0)
+		return monitorTelemetry(argc > 2 ? atof(argv[2]) : 0.0);
+
+	// Initialize GLUT
+	glutInit(&argc, argv);
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_STENCIL);
+	glutInitWindowSize(vWidth, vHeight);
+	glutInitWindowPosition(200, 30);
+	glutCreateWindow("3D Hierarchical Example");
+
+	// Load the OpenGL 3 entry points for the lighting shader, needs the window's context
+	glewInit();
+
+	// Initialize GL
+	initOpenGL(vWidth, vHeight);
+
+	// Image comparison and timing of the lighting paths, see runShadingTest()
+	if (argc > 1 && strcmp(argv[1], "-shadingtest") == 0)
+		return runShadingTest();
+
+	// Reference image test of the canonical poses, see runRenderTest()
+	if (argc > 2 && strcmp(argv[1], "-rendertest") == 0)
+		return runRenderTest(argv[2], argc > 3 && strcmp(argv[3], "record") == 0);
+
+	// Register callback functions
+	glutDisplayFunc(display);
+	glutReshapeFunc(reshape);
+	glutMouseFunc(mouse);
+	glutMotionFunc(mouseMotionHandler);
+	glutKeyboardFunc(keyboard);
+	glutSpecialFunc(functionKeys);
+
+	// Optionally use a 16-bit PGM heightmap for the ground
+	if (argc > 2 && strcmp(argv[1], "-heightmap") == 0)
+	{
+		if (groundHeights.LoadHeightmap(argv[2], 4.0f))
+		{
+			terrainGround = true;
+			initGround();
+		}
+		else
+			fprintf(stderr, "heightmap: could not read %s\n", argv[2]);
+	}
+
+	// Optionally log every input event and animation tick for later replay
+	if (argc > 2 && strcmp(argv[1], "-record") == 0)
+	{
+		if (animationRecorder.Open(argv[2], jointChannels, NUM_JOINT_CHANNELS))
+			atexit(closeRecorder);
+		else
+			fprintf(stderr, "record: could not open %s\n", argv[2]);
+	}
+
+	// Optionally publish the joint state of every frame drawn
+	if (argc > 1 && strcmp(argv[1], "-publish") == 0)
+	{
+		if (telemetryPublisher.Open(telemetryName, 1 + fleetSize))
+			atexit(closePublisher);
+		else
+			fprintf(stderr, "publish: could not create %s, is another instance publishing?\n", telemetryName);
+	}
+
+	// Start event loop, never returns
+	glutMainLoop();
+
+	return 0;
+}
+
+
+// Set up OpenGL. For viewport and projection setup see reshape(). 
+void initOpenGL(int /*w*/, int /*h*/)
+{
+	// Set up and enable lighting
+	glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, light_specular);
+	glLightfv(GL_LIGHT1, GL_AMBIENT, light_ambient);
+	glLightfv(GL_LIGHT1, GL_DIFFUSE, light_diffuse);
+	glLightfv(GL_LIGHT1, GL_SPECULAR, light_specular);
+
+	MATRIX4X4 eyeToWorld = Camera().GetView().GetRigidInverse();
+	worldLights[0] = eyeToWorld.TransformPoint(VECTOR3D(light_position0[0], light_position0[1], light_position0[2]));
+	worldLights[1] = eyeToWorld.TransformPoint(VECTOR3D(light_position1[0], light_position1[1], light_position1[2]));
+
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glEnable(GL_LIGHT1);   // This second light is currently off
+
+	// Other OpenGL setup
+	glEnable(GL_DEPTH_TEST);   // Remove hidded surfaces
+	glShadeModel(GL_SMOOTH);   // Use smooth shading, makes boundaries between polygons harder to see 
+	glClearColor(0.4F, 0.4F, 0.4F, 0.0F);  // Color and depth for glClear
+	glClearDepth(1.0f);
+	glEnable(GL_NORMALIZE);    // Renormalize normal vectors 
+	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);   // Nicer perspective
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+
+	// Other initializatuion
+	jobSystem = new JobSystem();
+
+	// Set up ground quad mesh
+	groundMesh = new QuadMesh(meshSize, 32.0);
+	initGround();
+
+	VECTOR3D ambient = VECTOR3D(0.0f, 0.05f, 0.0f);
+	VECTOR3D diffuse = VECTOR3D(0.4f, 0.8f, 0.4f);
+	VECTOR3D specular = VECTOR3D(0.04f, 0.04f, 0.04f);
+	float shininess = 0.2;
+	groundMesh->SetMaterial(ambient, diffuse, specular, shininess);
+	groundTerrain.SetMaterial(ambient, diffuse, specular, shininess);
+
+	partQuadric = gluNewQuadric();
+	initPrimitives();
+
+	BuildLegSkin(robotDims, 24, 48, legSkin);
+	skinnedLegs.vertices.resize(legSkin.numVertices);
+	skinnedLegs.indices = legSkin.indices;
+
+	MATRIX4X4 root, restMatrices[NUM_ROBOT_PARTS];
+	ComputeRobotTransforms(robotDims, getRobotPose(), root, restMatrices);
+	robotFootHeight = ComputeRobotBounds(restMatrices).min.y;
+
+	// Robots of the fleet stand on the ground around the main robot
+	fleet.Init(fleetSize, 10.0f, robotDims);
+	robotTrails.Init(1, trailLength);
+	fleetTrails.Init(fleetSize, trailLength);
+	particles.Init(maxParticles);
+
+	GenerateVariantPalette(1, variantPalette);
+	for (int i = 0; i < fleetSize; i++)
+		fleetVariants.push_back(MakeRobotVariant(1, i, robotDims.robotBodySize));
+
+	// Per-pixel lighting with the same lights and materials
+	if (lightingShader.Init())
+	{
+		lightingShader.SetLight(0, light_position0, light_ambient, light_diffuse, light_specular);
+		lightingShader.SetLight(1, light_position1, light_ambient, light_diffuse, light_specular);
+
+		const GLfloat ground_mat_ambient[] = { ambient.x, ambient.y, ambient.z, 1.0f };
+		const GLfloat ground_mat_diffuse[] = { diffuse.x, diffuse.y, diffuse.z, 1.0f };
+		const GLfloat ground_mat_specular[] = { specular.x, specular.y, specular.z, 1.0f };
+		bodyMaterial = lightingShader.AddMaterial(robotBody_mat_ambient, robotBody_mat_diffuse,
+			robotBody_mat_specular, robotBody_mat_shininess[0]);
+		legMaterial = lightingShader.AddMaterial(robotLeg_mat_ambient, robotLeg_mat_diffuse,
+			robotLeg_mat_specular, robotLeg_mat_shininess[0]);
+		groundMaterial = lightingShader.AddMaterial(ground_mat_ambient, ground_mat_diffuse,
+			ground_mat_specular, shininess);
+		for (int i = 0; i < VARIANT_PALETTE_SIZE; i++)
+		{
+			const VariantMaterial& body = variantPalette.body[i];
+			const VariantMaterial& legs = variantPalette.legs[i];
+			variantBodyMaterials[i] = lightingShader.AddMaterial(body.ambient, body.diffuse, body.specular, body.shininess);
+			variantLegMaterials[i] = lightingShader.AddMaterial(legs.ambient, legs.diffuse, legs.specular, legs.shininess);
+		}
+		perPixelLighting = true;
+	}
+
+	// Everything a frame depends on, a change to any of it is redrawn
+	redrawScheduler.Track(robotAngles, NUM_JOINTS * sizeof(float));
+	redrawScheduler.Track(primitiveMode);
+	redrawScheduler.Track(shadowMode);
+	redrawScheduler.Track(perPixelLighting);
+	redrawScheduler.Track(terrainGround);
+	redrawScheduler.Track(showFleet);
+	redrawScheduler.Track(showContacts);
+	redrawScheduler.Track(fleetFrameNumber);
+	redrawScheduler.Track(camera.GetParams());
+	redrawScheduler.Track(multiViewMode);
+	redrawScheduler.Track(legMode);
+	redrawScheduler.Track(showTrails);
+	redrawScheduler.Track(particleFrameNumber);
+	redrawScheduler.Track(currentJoint);
+	redrawScheduler.Track(physicsMode);
+	redrawScheduler.Track(physicsTicks);
+	redrawScheduler.Track(occlusionCulling);
+	redrawScheduler.Track(fleetVariety);
+}
+
+
+// Builds the ground mesh, flat or displaced by the terrain heightfield
+void initGround()
+{
+	if (!groundMesh)
+		return;
+
+	VECTOR3D origin = VECTOR3D(-16.0f, 0.0f, 16.0f);
+	VECTOR3D dir1v = VECTOR3D(1.0f, 0.0f, 0.0f);
+	VECTOR3D dir2v = VECTOR3D(0.0f, 0.0f, -1.0f);
+
+	if (terrainGround && groundHeights.GetWidth() == 0)
+		groundHeights.GenerateNoise(terrainCells + 1, terrainCells + 1, 4, 3.0f, 2.0f, 1, jobSystem);
+
+	groundMesh->InitMesh(meshSize, origin, 32.0, 32.0, dir1v, dir2v, terrainGround ? &groundHeights : NULL, jobSystem);
+	BuildQuadMeshTriangles(*groundMesh, groundLists);
+	optimizeMesh(groundLists, groundStrips);
+
+	particleGround.Set(*groundMesh, VECTOR3D(0.0f, -10.0f, 0.0f));
+	pickGround.Set(*groundMesh, VECTOR3D(0.0f, -10.0f, 0.0f));
+
+	groundTerrainReady = terrainGround &&
+		groundTerrain.Init(&groundHeights, terrainPatchSize, 32.0f / (groundHeights.GetWidth() - 1), origin, jobSystem);
+	shadowMaskDirty = true;
+}
+
+
+// Reorders lists for the vertex cache and makes strips from them
+void optimizeMesh(IndexedMesh& lists, IndexedMesh& strips)
+{
+	OptimizeVertexCache(lists);
+	strips = lists;
+	BuildStrips(strips);
+}
+
+// One mesh per distinct part primitive, parts with the same shape and tessellation share it
+void initPrimitives()
+{
+	primitiveLists.clear();
+	primitiveStrips.clear();
+	shadedLists.clear();
+	shadedStrips.clear();
+
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		const RobotPartInfo& part = robotParts[i];
+
+		partPrimitive[i] = -1;
+		for (int j = 0; j < i && partPrimitive[i] < 0; j++)
+		{
+			const RobotPartInfo& other = robotParts[j];
+			if (other.shape == part.shape && other.slices == part.slices && other.stacks == part.stacks)
+				partPrimitive[i] = partPrimitive[j];
+		}
+		if (partPrimitive[i] >= 0)
+			continue;
+
+		// Per-pixel lighting only needs enough triangles for a smooth outline, and none
+		// along a cylinder's axis
+		int slices = part.slices < shadedSlices ? part.slices : shadedSlices;
+		int stacks = part.stacks < shadedStacks ? part.stacks : shadedStacks;
+
+		IndexedMesh lists, strips, shaded, shadedStrip;
+		switch (part.shape)
+		{
+		case SHAPE_SPHERE:
+			BuildSphereMesh(part.slices, part.stacks, lists);
+			BuildSphereMesh(slices, stacks, shaded);
+			break;
+		case SHAPE_CYLINDER:
+			BuildCylinderMesh(part.slices, part.stacks, lists);
+			BuildCylinderMesh(slices, 1, shaded);
+			break;
+		case SHAPE_CUBE:
+			BuildCubeMesh(lists);
+			BuildCubeMesh(shaded);
+			break;
+		}
+		optimizeMesh(lists, strips);
+		optimizeMesh(shaded, shadedStrip);
+
+		partPrimitive[i] = (int)primitiveLists.size();
+		primitiveLists.push_back(lists);
+		primitiveStrips.push_back(strips);
+		shadedLists.push_back(shaded);
+		shadedStrips.push_back(shadedStrip);
+	}
+}
+
+
+// Callback, called whenever GLUT determines that the window should be redisplayed
+// or glutPostRedisplay() has been called.
+void display(void)
+{
+	frameArena.Reset();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	// The scene is walked once for all the views. Part matrices come from the same forward
+	// kinematics the fleet and headless code use, see ComputeRobotTransforms(), or from the
+	// physics in physics mode.
+	computeRobotParts(robotPartMatrices);
+	if (legMode != LEGS_RIGID)
+	{
+		SkinBones bones;
+		bones.Set(legSkin, robotPartMatrices);
+		SkinVertices(legSkin, bones, legMode == LEGS_LINEAR_SKIN ? SKINNING_LINEAR : SKINNING_DUAL_QUATERNION,
+			&skinnedLegs.vertices[0], jobSystem);
+	}
+
+	// Create Viewing Matrix V, the camera's matrices are only computed again when it moved
+	VECTOR3D target(0.0f, 0.0f, 0.0f);
+	if (physicsMode)
+		target = robotPartMatrices[PART_BODY].GetColumn(3);
+	camera.Follow(target, robotJointState.GetAngle(0, JOINT_ROBOT_SPIN));
+	View views[MAX_VIEWS];
+	int numViews = getViews(views);
+
+	// Fleet robots are placed relative to the ground, drawn from their updated part matrices
+	FrameScene scene;
+	scene.fleetFrame = NULL;
+	scene.fleetOffset = getFleetOffset();
+	if (showFleet)
+	{
+		scene.fleetFrame = &fleet.GetFrame();
+		if (framePipeline.IsRunning())
+		{
+			const FrameSnapshot* snapshot = framePipeline.AcquireLatest();
+			scene.fleetFrame = snapshot ? &snapshot->fleet : NULL;
+		}
+	}
+
+	// Bounds of every robot in world coordinates, the main robot first, sorted into the
+	// views' draw lists in one pass
+	int numFleetRobots = scene.fleetFrame ? scene.fleetFrame->numRobots : 0;
+	int numBoxes = 1 + numFleetRobots;
+	BBox* boxes = frameArena.AllocateArray<BBox>(numBoxes);
+	boxes[0] = ComputeRobotBounds(robotPartMatrices);
+	for (int i = 0; i < numFleetRobots; i++)
+	{
+		boxes[1 + i].min = scene.fleetFrame->bounds[i].min + scene.fleetOffset;
+		boxes[1 + i].max = scene.fleetFrame->bounds[i].max + scene.fleetOffset;
+	}
+
+	int* drawLists[MAX_VIEWS];
+	int drawCounts[MAX_VIEWS];
+	for (int v = 0; v < numViews; v++)
+		drawLists[v] = frameArena.AllocateArray<int>(numBoxes);
+	int* visible = frameArena.AllocateArray<int>(numBoxes);
+	int numVisible = CullViews(views, numViews, boxes, numBoxes, drawLists, drawCounts, visible);
+
+	// The robot and every fleet robot drawn in some view cast shadows
+	scene.casters = frameArena.AllocateArray<ShadowCaster>(numBoxes);
+	scene.casters[0].partMatrices = robotPartMatrices;
+	scene.casters[0].offset = VECTOR3D(0.0f, 0.0f, 0.0f);
+	scene.numCasters = 1;
+	for (int i = 0; i < numVisible; i++)
+	{
+		if (visible[i] == 0)
+			continue;
+		scene.casters[scene.numCasters].partMatrices = scene.fleetFrame->GetPartMatrices(visible[i] - 1);
+		scene.casters[scene.numCasters].offset = scene.fleetOffset;
+		scene.numCasters++;
+	}
+
+	scene.planarShadows = shadowMode == SHADOWS_PLANAR && !terrainGround;
+	scene.mappedShadows = shadowMode != SHADOWS_OFF && !scene.planarShadows;
+	if (scene.mappedShadows)
+		updateShadowMask(scene.casters, scene.numCasters);
+
+	// Each view only submits its own draw list, in its own part of the window
+	if (numViews > 1)
+		glEnable(GL_SCISSOR_TEST);
+	for (int v = 0; v < numViews; v++)
+	{
+		const View& view = views[v];
+		glViewport(view.viewport[0], view.viewport[1], view.viewport[2], view.viewport[3]);
+		if (numViews > 1)
+		{
+			glScissor(view.viewport[0], view.viewport[1], view.viewport[2], view.viewport[3]);
+			glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		}
+		// the parts each view can see of the robots in its list
+		unsigned int* partMasks = NULL;
+		if (occlusionCulling)
+		{
+			partMasks = frameArena.AllocateArray<unsigned int>(numBoxes);
+			cullOccludedParts(view, scene, drawLists[v], drawCounts[v], partMasks);
+		}
+		drawView(view, drawLists[v], partMasks, drawCounts[v], scene);
+	}
+	glDisable(GL_SCISSOR_TEST);
+
+	if (telemetryPublisher.IsOpen())
+		publishTelemetry(scene.fleetFrame);
+
+	redrawScheduler.FrameDrawn(elapsedMilliseconds());
+	glutSwapBuffers();   // Double buffering, swap buffers
+}
+
+// Views drawn this frame for the multi-view mode, returns how many there are
+int getViews(View* views)
+{
+	switch (multiViewMode)
+	{
+	case MULTIVIEW_SPLIT:
+	{
+		// The camera at the top left, then fixed front, side and top inspection views
+		int w = windowWidth / 2, h = windowHeight / 2;
+		const MATRIX4X4& projection = camera.GetProjection();
+		views[0].Set(camera, 0, h, w, h);
+		views[1].Set(MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 6.0f, 22.0f), VECTOR3D(0.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 1.0f, 0.0f)),
+			projection, w, h, w, h);
+		views[2].Set(MATRIX4X4::GetLookAt(VECTOR3D(22.0f, 6.0f, 0.0f), VECTOR3D(0.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 1.0f, 0.0f)),
+			projection, 0, 0, w, h);
+		views[3].Set(MATRIX4X4::GetLookAt(VECTOR3D(0.0f, 25.0f, 0.0f), VECTOR3D(0.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f)),
+			projection, w, 0, w, h);
+		return 4;
+	}
+	case MULTIVIEW_CUBE:
+	{
+		// Six faces around the centre of the robot's body, which leaves the robot itself out
+		int faceSize = windowWidth / 3 < windowHeight / 2 ? windowWidth / 3 : windowHeight / 2;
+		VECTOR3D centre = robotPartMatrices[PART_BODY].GetColumn(3);
+		GetCubeFaceViews(centre, 0.2f, 40.0f, (windowWidth - 3 * faceSize) / 2, (windowHeight - 2 * faceSize) / 2,
+			faceSize, views);
+		return 6;
+	}
+	default:
+		views[0].Set(camera, 0, 0, windowWidth, windowHeight);
+		return 1;
+	}
+}
+
+// Rasterizes the body spheres of the robots in drawList and the flat ground into the
+// occlusion buffer for view, then sets partMasks to the parts of each robot that may show.
+// The robot itself is always drawn whole.
+void cullOccludedParts(const View& view, const FrameScene& scene, const int* drawList, int count, unsigned int* partMasks)
+{
+	int width = view.viewport[2] / 2, height = view.viewport[3] / 2;
+	if (occlusionBuffer.GetWidth() < width || occlusionBuffer.GetWidth() >= width + OCCLUSION_TILE_SIZE ||
+		occlusionBuffer.GetHeight() < height || occlusionBuffer.GetHeight() >= height + OCCLUSION_TILE_SIZE)
+		occlusionBuffer.Init(width, height);
+
+	occlusionBuffer.Begin(view.view, view.projection);
+
+	// The terrain is drawn finer than groundMesh, so only the flat ground is a safe occluder
+	if (!terrainGround && particleGround.size > 0)
+	{
+		float x1 = particleGround.x0 + particleGround.size * particleGround.dx;
+		float z1 = particleGround.z0 + particleGround.size * particleGround.dz;
+		float y = particleGround.heights[0];
+		VECTOR3D corners[4] = { VECTOR3D(particleGround.x0, y, particleGround.z0), VECTOR3D(x1, y, particleGround.z0),
+			VECTOR3D(x1, y, z1), VECTOR3D(particleGround.x0, y, z1) };
+		occlusionBuffer.DrawTriangle(corners[0], corners[1], corners[2]);
+		occlusionBuffer.DrawTriangle(corners[0], corners[2], corners[3]);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		if (drawList[i] != 0)
+			DrawRobotOccluders(occlusionBuffer, scene.fleetFrame->GetPartMatrices(drawList[i] - 1), scene.fleetOffset);
+		else if (multiViewMode != MULTIVIEW_CUBE)
+			DrawRobotOccluders(occlusionBuffer, robotPartMatrices, VECTOR3D(0.0f, 0.0f, 0.0f));
+	}
+	occlusionBuffer.End();
+
+	for (int i = 0; i < count; i++)
+	{
+		int robot = drawList[i] - 1;
+		partMasks[i] = robot < 0 ? ALL_ROBOT_PARTS : GetVisibleRobotParts(occlusionBuffer, scene.fleetFrame->bounds[robot],
+			scene.fleetFrame->GetPartMatrices(robot), scene.fleetOffset);
+	}
+}
+
+// Draws the robots in drawList, the ground and their shadows as seen from view. Only the
+// parts set in partMasks are drawn of the fleet robots, all of them when it is NULL.
+void drawView(const View& view, const int* drawList, const unsigned int* partMasks, int count, const FrameScene& scene)
+{
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(view.projection);
+	glMatrixMode(GL_MODELVIEW);
+	placeLights(view.view);
+	glLoadMatrixf(view.view);
+
+	if (perPixelLighting)
+		lightingShader.Begin();
+
+	// Draw Robot
+
+	// Apply modelling transformations M to move robot
+	// Current transformation matrix is set to IV, where I is identity matrix
+	// CTM = IV, so each part is drawn with CTM = IV * M_part
+	int first = 0;
+	if (count > 0 && drawList[0] == 0)
+	{
+		if (multiViewMode != MULTIVIEW_CUBE)
+			drawRobotParts(robotPartMatrices, legMode != LEGS_RIGID ? &skinnedLegs : NULL);
+		first = 1;
+	}
+
+	if (scene.fleetFrame && first < count)
+	{
+		glPushMatrix();
+		glTranslatef(scene.fleetOffset.x, scene.fleetOffset.y, scene.fleetOffset.z);
+		drawFleet(*scene.fleetFrame, drawList + first, partMasks ? partMasks + first : NULL, count - first);
+		glPopMatrix();
+	}
+
+	// Draw ground, marking its pixels in the stencil buffer for planar shadows or
+	// modulated by the shadow mask
+	if (scene.planarShadows)
+	{
+		glEnable(GL_STENCIL_TEST);
+		glStencilFunc(GL_ALWAYS, 1, 0xFF);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+	}
+	else if (scene.mappedShadows)
+	{
+		GLfloat sPlane[4], tPlane[4];
+		GetShadowMaskPlanes(*groundMesh, sPlane, tPlane);
+		glBindTexture(GL_TEXTURE_2D, shadowTexture);
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+		glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+		glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+		glTexGenfv(GL_S, GL_OBJECT_PLANE, sPlane);
+		glTexGenfv(GL_T, GL_OBJECT_PLANE, tPlane);
+		glEnable(GL_TEXTURE_GEN_S);
+		glEnable(GL_TEXTURE_GEN_T);
+		glEnable(GL_TEXTURE_2D);
+	}
+	if (perPixelLighting)
+	{
+		lightingShader.SetMaterial(groundMaterial);
+		lightingShader.SetShadowMask(scene.mappedShadows);
+	}
+
+	glPushMatrix();
+	const GLfloat T1[] = {	1.0, 0.0, 0.0, 0.0,
+							0.0, 1.0, 0.0, 0.0,
+							0.0, 0.0, 1.0, 0.0,
+							0.0, -10.0, 0.0, 1.0 };
+		glMultMatrixf(T1);
+		if (groundTerrainReady)
+			drawTerrain(view);
+		else if (primitiveMode == PRIMITIVES_GLU)
+			groundMesh->DrawMesh(meshSize);
+		else
+		{
+			groundMesh->ApplyMaterial();
+			(primitiveMode == PRIMITIVES_STRIPS ? groundStrips : groundLists).Draw();
+		}
+	glPopMatrix();
+
+	if (perPixelLighting)
+		lightingShader.End();
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_TEXTURE_GEN_S);
+	glDisable(GL_TEXTURE_GEN_T);
+
+	if (scene.planarShadows)
+		drawPlanarShadows(scene.casters, scene.numCasters);
+
+	if (showContacts)
+		drawContacts();
+
+	if (currentJoint >= 0 && count > 0 && drawList[0] == 0 && multiViewMode != MULTIVIEW_CUBE)
+		drawSelection();
+
+	if (showTrails)
+	{
+		int robot = 0;
+		if (count > 0 && drawList[0] == 0 && multiViewMode != MULTIVIEW_CUBE)
+			drawTrails(robotTrails, &robot, 1);
+		if (scene.fleetFrame && first < count)
+		{
+			// fleet robots are one behind their box indices
+			int* robots = frameArena.AllocateArray<int>(count - first);
+			for (int i = first; i < count; i++)
+				robots[i - first] = drawList[i] - 1;
+			glPushMatrix();
+			glTranslatef(scene.fleetOffset.x, scene.fleetOffset.y, scene.fleetOffset.z);
+			drawTrails(fleetTrails, robots, count - first);
+			glPopMatrix();
+		}
+	}
+
+	if (particles.GetNumParticles() > 0)
+		drawParticles(view);
+}
+
+// Picks the terrain nodes for the view and draws them
+void drawTerrain(const View& view)
+{
+	MATRIX4X4 model;
+	model.Translate(0.0f, -10.0f, 0.0f);
+
+	TerrainView terrainView;
+	terrainView.Set(view.view * model, view.projection, view.viewport[3], 1.0f);
+	groundTerrain.Select(terrainView);
+	groundTerrain.Draw();
+}
+
+// Draws the fleet robots in drawList, given as box indices, which are one past the robot's
+void drawFleet(const FleetFrame& fleetFrame, const int* drawList, const unsigned int* partMasks, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		int robot = drawList[i] - 1;
+		const RobotVariant* variant = fleet.HasVariants() ? &fleet.GetVariant(robot) : NULL;
+		if (!partMasks || partMasks[i] != 0)
+			drawRobotParts(fleetFrame.GetPartMatrices(robot), NULL, partMasks ? partMasks[i] : ALL_ROBOT_PARTS, variant);
+	}
+}
+
+// Light positions in the robot's frame for the shadows
+void getShadowLights(VECTOR3D lights[2])
+{
+	lights[0] = worldLights[0];
+	lights[1] = worldLights[1];
+}
+
+// Gives GL and the shader the lights' eye coordinates for view, unless they were last
+// placed for the same view
+void placeLights(const MATRIX4X4& view)
+{
+	if (lightsPlaced && memcmp(&lightsView, &view, sizeof(view)) == 0)
+		return;
+	lightsView = view;
+	lightsPlaced = true;
+
+	glLoadMatrixf(view);
+	const GLfloat position0[] = { worldLights[0].x, worldLights[0].y, worldLights[0].z, 1.0f };
+	const GLfloat position1[] = { worldLights[1].x, worldLights[1].y, worldLights[1].z, 1.0f };
+	glLightfv(GL_LIGHT0, GL_POSITION, position0);
+	glLightfv(GL_LIGHT1, GL_POSITION, position1);
+
+	if (lightingShader.IsReady())
+	{
+		VECTOR3D eye0 = view.TransformPoint(worldLights[0]);
+		VECTOR3D eye1 = view.TransformPoint(worldLights[1]);
+		const GLfloat eyePosition0[] = { eye0.x, eye0.y, eye0.z, 1.0f };
+		const GLfloat eyePosition1[] = { eye1.x, eye1.y, eye1.z, 1.0f };
+		lightingShader.SetLight(0, eyePosition0, light_ambient, light_diffuse, light_specular);
+		lightingShader.SetLight(1, eyePosition1, light_ambient, light_diffuse, light_specular);
+	}
+}
+
+// Renders the shadow maps again when the lights or casters moved, and then the mask texture
+void updateShadowMask(const ShadowCaster* casters, int numCasters)
+{
+	VECTOR3D lights[2];
+	getShadowLights(lights);
+
+	bool changed = shadowMaskDirty;
+	for (int i = 0; i < 2; i++)
+	{
+		if (shadowMaps[i].Update(lights[i], casters, numCasters))
+			changed = true;
+	}
+	if (!changed)
+		return;
+
+	const ShadowMap* maps[] = { &shadowMaps[0], &shadowMaps[1] };
+	BuildShadowMask(maps, 2, *groundMesh, VECTOR3D(0.0f, -10.0f, 0.0f), 1.0f - shadowDarkness,
+		shadowMaskSize, shadowMask, jobSystem);
+
+	if (!shadowTexture)
+	{
+		glGenTextures(1, &shadowTexture);
+		glBindTexture(GL_TEXTURE_2D, shadowTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, shadowMaskSize, shadowMaskSize, 0,
+			GL_LUMINANCE, GL_UNSIGNED_BYTE, shadowMask);
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_2D, shadowTexture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, shadowMaskSize, shadowMaskSize,
+			GL_LUMINANCE, GL_UNSIGNED_BYTE, shadowMask);
+	}
+	shadowMaskDirty = false;
+}
+
+// Darkens the ground where the casters, flattened onto it from each light, cover it.
+// The visible ground has stencil bit 1, so no depth test is needed, and each light sets
+// its own bit where it has darkened a pixel so overlapping parts only darken it once.
+void drawPlanarShadows(const ShadowCaster* casters, int numCasters)
+{
+	const float groundPlane[] = { 0.0f, 1.0f, 0.0f, 10.0f };
+	VECTOR3D lights[2];
+	getShadowLights(lights);
+
+	glDisable(GL_LIGHTING);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_STENCIL_TEST);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+	glColor4f(0.0f, 0.0f, 0.0f, shadowDarkness);
+
+	for (int l = 0; l < 2; l++)
+	{
+		GLuint lightBit = 2 << l;
+		glStencilFunc(GL_EQUAL, 1, 1 | lightBit);
+		glStencilMask(lightBit);
+
+		const float light[] = { lights[l].x, lights[l].y, lights[l].z, 1.0f };
+		MATRIX4X4 shadow = MATRIX4X4::GetPlanarShadow(groundPlane, light);
+		for (int i = 0; i < numCasters; i++)
+		{
+			glPushMatrix();
+				glMultMatrixf(shadow);
+				glTranslatef(casters[i].offset.x, casters[i].offset.y, casters[i].offset.z);
+				drawShadowParts(casters[i].partMatrices);
+			glPopMatrix();
+		}
+	}
+
+	glStencilMask(0xFF);
+	glDisable(GL_STENCIL_TEST);
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glEnable(GL_LIGHTING);
+}
+
+// Parts as the shadow maps' coarse shapes, without materials
+void drawShadowParts(const MATRIX4X4* partMatrices)
+{
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		glPushMatrix();
+			glMultMatrixf(partMatrices[i]);
+			shadowMaps[0].GetShape(robotParts[i].shape).Draw();
+		glPopMatrix();
+	}
+}
+
+// Finds ground and self contacts of the robot, once per animation tick
+void findContacts(const MATRIX4X4 partMatrices[NUM_ROBOT_PARTS])
+{
+	// in physics mode the robot walks on the drawn ground itself
+	VECTOR3D groundOffset(0.0f, -10.0f, 0.0f);
+	float height;
+	if (!physicsMode && particleGround.GetHeight(0.0f, 0.0f, height))
+		groundOffset.y += robotFootHeight + contactSkin - height;
+
+	collisionWorld.Clear();
+	collisionWorld.AddRobot(0, partMatrices);
+	collisionWorld.FindGroundContacts(*groundMesh, groundOffset, groundContacts);
+	collisionWorld.FindPartContacts(partContacts);
+}
+
+// Marks the contacts found by findContacts()
+void drawContacts()
+{
+	glDisable(GL_LIGHTING);
+	glPointSize(8.0);
+	glColor3f(1.0, 1.0, 0.0);
+	glBegin(GL_POINTS);
+	for (size_t i = 0; i < groundContacts.size(); i++)
+		glVertex3fv(groundContacts[i].point);
+	for (size_t i = 0; i < partContacts.size(); i++)
+		glVertex3fv(partContacts[i].point);
+	glEnd();
+	glEnable(GL_LIGHTING);
+}
+
+// Outlines the robot's parts moved by the selected joint
+void drawSelection()
+{
+	glDisable(GL_LIGHTING);
+	glColor3f(1.0, 1.0, 0.0);
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		if (partJoints[i] != currentJoint)
+			continue;
+
+		// box around the part's unit primitive
+		glPushMatrix();
+		glMultMatrixf(robotPartMatrices[i]);
+		if (robotParts[i].shape == SHAPE_SPHERE)
+			glScalef(2.0, 2.0, 2.0);
+		else if (robotParts[i].shape == SHAPE_CYLINDER)
+		{
+			glTranslatef(0.0, 0.0, 0.5);
+			glScalef(2.0, 2.0, 1.0);
+		}
+		glutWireCube(1.02);
+		glPopMatrix();
+	}
+	glEnable(GL_LIGHTING);
+}
+
+// Fleet robots stand on the ground behind the robot
+VECTOR3D getFleetOffset()
+{
+	return VECTOR3D(0.0f, -10.0f + 2.5f * robotDims.robotBodySize, -30.0f);
+}
+
+// Casts a ray from window position (x, y) through the view it falls in, selecting the
+// joint of the robot's part it hits first
+void pickJoint(int x, int y)
+{
+	View views[MAX_VIEWS];
+	int numViews = getViews(views);
+	float windowX = x + 0.5f, windowY = windowHeight - y - 0.5f;
+
+	for (int v = 0; v < numViews; v++)
+	{
+		const int* viewport = views[v].viewport;
+		if (windowX < viewport[0] || windowX >= viewport[0] + viewport[2] ||
+			windowY < viewport[1] || windowY >= viewport[1] + viewport[3])
+			continue;
+
+		pickScene.Clear();
+		if (multiViewMode != MULTIVIEW_CUBE)
+			pickScene.AddRobot(0, robotPartMatrices, VECTOR3D(0.0f, 0.0f, 0.0f));
+
+		const FleetFrame* fleetFrame = NULL;
+		if (showFleet)
+		{
+			fleetFrame = &fleet.GetFrame();
+			if (framePipeline.IsRunning())
+			{
+				const FrameSnapshot* snapshot = framePipeline.AcquireLatest();
+				fleetFrame = snapshot ? &snapshot->fleet : NULL;
+			}
+		}
+		for (int i = 0; fleetFrame && i < fleetFrame->numRobots; i++)
+			pickScene.AddRobot(1 + i, fleetFrame->GetPartMatrices(i), getFleetOffset());
+		pickScene.Build();
+
+		PickHit hit;
+		Ray ray = GetPickRay(views[v].view, views[v].projection, viewport, windowX, windowY);
+		bool found = pickScene.Intersect(ray, hit, &pickGround);
+		int joint = found && hit.robot == 0 ? partJoints[hit.part] : -1;
+
+		if (animationRecorder.IsRecording())
+			animationRecorder.RecordEvent(RECORD_SELECT_JOINT, joint + 1, jointChannels);
+		selectJoint(joint);
+		return;
+	}
+}
+
+// Joint the arrow keys turn, none for -1
+void selectJoint(int joint)
+{
+	currentJoint = joint;
+}
+
+// Adds the robot's current joint positions to its trails
+void pushRobotTrails(const MATRIX4X4* partMatrices)
+{
+	robotTrails.Push(partMatrices, (float)(elapsedMilliseconds() * 0.001));
+}
+
+// Fires sparks out of the muzzle ends of the cannon and arm guns that are animating
+void emitSparks(const MATRIX4X4* partMatrices)
+{
+	const VECTOR3D muzzle(0.0f, 0.0f, 1.0f);
+	if (robotAnimation.cannonRotating && !robotAnimation.stopCannon)
+	{
+		const MATRIX4X4& cannon = partMatrices[PART_CANNON];
+		particles.Emit(cannon.TransformPoint(muzzle), cannon.TransformDirection(muzzle), 0.35f, 8.0f, 1.5f, 12);
+	}
+	if (robotAnimation.armMoving)
+	{
+		const MATRIX4X4& left = partMatrices[PART_LEFT_ARM_GUN];
+		const MATRIX4X4& right = partMatrices[PART_RIGHT_ARM_GUN];
+		particles.Emit(left.TransformPoint(muzzle), left.TransformDirection(muzzle), 0.2f, 10.0f, 1.0f, 6);
+		particles.Emit(right.TransformPoint(muzzle), right.TransformDirection(muzzle), 0.2f, 10.0f, 1.0f, 6);
+	}
+}
+
+// Sparks as points, blended farthest first, cooling from yellow to red as they fade
+void drawParticles(const View& view)
+{
+	const std::vector<int>& order = particles.SortBackToFront(view.view, jobSystem);
+
+	glDisable(GL_LIGHTING);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+	glPointSize(4.0);
+	glBegin(GL_POINTS);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		float age = particles.GetAge(order[i]);
+		VECTOR3D position = particles.GetPosition(order[i]);
+		glColor4f(1.0f, 0.9f - 0.7f * age, 0.3f - 0.3f * age, 1.0f - age);
+		glVertex3fv(&position.x);
+	}
+	glEnd();
+	glPointSize(1.0);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glEnable(GL_LIGHTING);
+}
+
+// Line strips through the trails of the given robots, fading out towards their oldest points
+void drawTrails(const JointTrails& trails, const int* robots, int count)
+{
+	static const GLfloat colors[TRAIL_JOINTS][3] =
+	{
+		{ 1.0f, 0.6f, 0.1f },
+		{ 1.0f, 0.6f, 0.1f },
+		{ 0.2f, 0.7f, 1.0f },
+		{ 0.2f, 0.7f, 1.0f }
+	};
+
+	VECTOR3D* points = frameArena.AllocateArray<VECTOR3D>(trails.GetCapacity());
+	glDisable(GL_LIGHTING);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glLineWidth(2.0);
+	for (int i = 0; i < count; i++)
+	{
+		for (int j = 0; j < TRAIL_JOINTS; j++)
+		{
+			int numPoints = trails.GetTrail(robots[i], j, points);
+			glBegin(GL_LINE_STRIP);
+			for (int p = 0; p < numPoints; p++)
+			{
+				glColor4f(colors[j][0], colors[j][1], colors[j][2], (float)(p + 1) / numPoints);
+				glVertex3fv(&points[p].x);
+			}
+			glEnd();
+		}
+	}
+	glLineWidth(1.0);
+	glDisable(GL_BLEND);
+	glEnable(GL_LIGHTING);
+}
+
+// Draws every part as a unit primitive under its part matrix, or the skinned legs in
+// place of the leg parts when they are given
+void drawRobotParts(const MATRIX4X4* partMatrices, const IndexedMesh* legs, unsigned int parts, const RobotVariant* variant)
+{
+	const std::vector<IndexedMesh>& lists = perPixelLighting ? shadedLists : primitiveLists;
+	const std::vector<IndexedMesh>& strips = perPixelLighting ? shadedStrips : primitiveStrips;
+
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		const RobotPartInfo& part = robotParts[i];
+
+		// Set robot material properties per body part, only when it changes
+		if (i == 0 || part.bodyMaterial != robotParts[i - 1].bodyMaterial)
+			setPartMaterial(part.bodyMaterial, variant);
+		if ((legs && IsSkinnedPart(i)) || !(parts & (1u << i)))
+			continue;
+
+		glPushMatrix();
+			glMultMatrixf(partMatrices[i]);
+			if (primitiveMode == PRIMITIVES_LISTS)
+				lists[partPrimitive[i]].Draw();
+			else if (primitiveMode == PRIMITIVES_STRIPS)
+				strips[partPrimitive[i]].Draw();
+			else
+			{
+				switch (part.shape)
+				{
+				case SHAPE_SPHERE:
+					gluSphere(partQuadric, 1.0, part.slices, part.stacks);
+					break;
+				case SHAPE_CYLINDER:
+					gluCylinder(partQuadric, 1.0, 1.0, 1.0, part.slices, part.stacks);
+					break;
+				case SHAPE_CUBE:
+					glutSolidCube(1.0);
+					break;
+				}
+			}
+		glPopMatrix();
+	}
+
+	// the skin is already in the robot's world coordinates
+	if (legs)
+	{
+		setPartMaterial(false, variant);
+		legs->Draw();
+	}
+}
+
+// Body or leg material for the shader or fixed function lighting, the variant's own
+// from the palette when one is given
+void setPartMaterial(bool body, const RobotVariant* variant)
+{
+	if (variant)
+	{
+		int entry = body ? variant->bodyMaterial : variant->legMaterial;
+		const VariantMaterial& material = body ? variantPalette.body[entry] : variantPalette.legs[entry];
+		if (perPixelLighting)
+			lightingShader.SetMaterial(body ? variantBodyMaterials[entry] : variantLegMaterials[entry]);
+		else
+		{
+			glMaterialfv(GL_FRONT, GL_AMBIENT, material.ambient);
+			glMaterialfv(GL_FRONT, GL_SPECULAR, material.specular);
+			glMaterialfv(GL_FRONT, GL_DIFFUSE, material.diffuse);
+			glMaterialf(GL_FRONT, GL_SHININESS, material.shininess);
+		}
+	}
+	else if (perPixelLighting)
+		lightingShader.SetMaterial(body ? bodyMaterial : legMaterial);
+	else if (body)
+	{
+		glMaterialfv(GL_FRONT, GL_AMBIENT, robotBody_mat_ambient);
+		glMaterialfv(GL_FRONT, GL_SPECULAR, robotBody_mat_specular);
+		glMaterialfv(GL_FRONT, GL_DIFFUSE, robotBody_mat_diffuse);
+		glMaterialfv(GL_FRONT, GL_SHININESS, robotBody_mat_shininess);
+	}
+	else
+	{
+		glMaterialfv(GL_FRONT, GL_AMBIENT, robotLeg_mat_ambient);
+		glMaterialfv(GL_FRONT, GL_SPECULAR, robotLeg_mat_specular);
+		glMaterialfv(GL_FRONT, GL_DIFFUSE, robotLeg_mat_diffuse);
+		glMaterialfv(GL_FRONT, GL_SHININESS, robotLeg_mat_shininess);
+	}
+}
+
+
+// Callback, called at initialization and whenever user resizes the window.
+void reshape(int w, int h)
+{
+	// Set up viewport, projection, then change to modelview matrix mode - 
+	// display function will then set up camera and do modeling transforms.
+	glViewport(0, 0, (GLsizei)w, (GLsizei)h);
+
+	windowWidth = w;
+	windowHeight = h;
+	camera.SetViewport(w, h);
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(camera.GetProjection());
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixf(camera.GetView());
+}
+
+// single timer drives all animations so that ticks are ordered deterministically
+bool animationTimerRunning = false;
+
+// Callback, handles input from the keyboard, non-arrow keys
+void keyboard(unsigned char key, int /*x*/, int /*y*/)
+{
+	if (key == 'q' || key == 'Q')
+		exit(0);
+
+	handleKey(key);
+
+	if (animationRecorder.IsRecording())
+		animationRecorder.RecordEvent(RECORD_KEY, key, jointChannels);
+
+	if (robotAnimation.cannonRotating || robotAnimation.stepping || robotAnimation.armMoving || showFleet || physicsMode ||
+		showContacts)
+		startAnimationTimer();
+
+	requestRedraw();   // Redisplay if anything changed
+}
+
+// Applies a key press to the robot state, no GLUT calls so replay can run headless
+void handleKey(unsigned char key)
+{
+	//need to add function for ARROW KEYS, this just supposed to toggle the joint
+	switch (key)
+	{
+	case 'b':
+		currentJoint = JOINT_BODY;
+		break;
+	case 'h':
+		currentJoint = JOINT_RIGHT_HIP;
+		break;
+	case 'k':
+		currentJoint = JOINT_RIGHT_KNEE;
+		break;
+
+	case 'w':
+	{
+		RobotPose pose = getRobotPose();
+		StartStepAnimation(pose, robotAnimation);
+		setRobotPose(pose);
+		break;
+	}
+	case 'W':
+		robotJointState.SetAngle(0, JOINT_LEFT_HIP, 0.0f);
+		robotJointState.SetAngle(0, JOINT_LEFT_KNEE, 0.0f);
+		break;
+
+	case 'a':
+	{
+		RobotPose pose = getRobotPose();
+		StartArmAnimation(pose, robotAnimation);
+		setRobotPose(pose);
+		break;
+	}
+	case 'A':
+		robotJointState.SetAngle(0, JOINT_RIGHT_SHOULDER, 0.0f);
+		robotJointState.SetAngle(0, JOINT_RIGHT_ELBOW, 0.0f);
+		break;
+
+	case 'c':
+		StartCannonAnimation(robotAnimation);
+		break;
+	case 'C':
+		StopCannonAnimation(robotAnimation);
+		break;
+
+	case 'f':
+		// the pipeline only simulates the fleet while it is shown
+		showFleet = !showFleet;
+		if (!showFleet && framePipeline.IsRunning())
+			stopPipeline();
+		break;
+	case 'e':
+	{
+		// the fleet cannot change under its pipeline thread, which starts again after
+		bool pipelined = framePipeline.IsRunning();
+		if (pipelined)
+			stopPipeline();
+		fleetVariety = !fleetVariety;
+		fleet.SetVariants(fleetVariety ? &fleetVariants[0] : NULL);
+		if (pipelined)
+			startPipeline();
+		break;
+	}
+	case 'p':
+		// a replay simulates the fleet on its own ticks, and a hidden fleet not at all
+		if (framePipeline.IsRunning())
+			stopPipeline();
+		else if (showFleet && !replaying)
+			startPipeline();
+		break;
+	case 'x':
+		// the contacts are found by the animation timer, which every key press ticks
+		showContacts = !showContacts;
+		break;
+	case 't':
+		terrainGround = !terrainGround;
+		initGround();
+		break;
+	case 'o':
+		primitiveMode = (primitiveMode + 1) % 3;
+		break;
+	case 'l':
+		shadowMode = (shadowMode + 1) % 3;
+		break;
+	case 'g':
+		perPixelLighting = !perPixelLighting && lightingShader.IsReady();
+		break;
+	case 'm':
+		camera.SetMode(camera.GetParams().mode == CAMERA_ORBIT ? CAMERA_FOLLOW : CAMERA_ORBIT);
+		break;
+	case 'n':
+		multiViewMode = (multiViewMode + 1) % 3;
+		break;
+	case 'j':
+		legMode = (legMode + 1) % 3;
+		break;
+	case 'r':
+		showTrails = !showTrails;
+		break;
+	case 'u':
+		occlusionCulling = !occlusionCulling;
+		break;
+	case 'y':
+		physicsMode = !physicsMode;
+		if (physicsMode)
+			startPhysics();
+		break;
+
+	//Spins whole robot
+	case 's':
+		turnJoint(JOINT_ROBOT_SPIN, 2.0f);
+		break;
+	case 'S':
+		turnJoint(JOINT_ROBOT_SPIN, -2.0f);
+		break;
+	case 'v':
+		turnJoint(JOINT_VERTICAL_SPIN, 2.0f);
+		break;
+	case 'V':
+		turnJoint(JOINT_VERTICAL_SPIN, -2.0f);
+		break;
+		
+	}
+}
+
+void startAnimationTimer()
+{
+	if (!animationTimerRunning)
+	{
+		animationTimerRunning = true;
+		glutTimerFunc(10, animationTimer, 0);
+	}
+}
+
+void animationTimer(int)
+{
+	bool active = animationTick();
+
+	MATRIX4X4 partMatrices[NUM_ROBOT_PARTS];
+	computeRobotParts(partMatrices);
+	pushRobotTrails(partMatrices);
+	if (showContacts)
+		findContacts(partMatrices);
+
+	// Sparks keep the timer going until the last one has died
+	emitSparks(partMatrices);
+	if (particles.GetNumParticles() > 0)
+	{
+		particles.Update(0.01f, particleParams, &particleGround, jobSystem);
+		particleFrameNumber++;
+		active = true;
+	}
+
+	// The fleet keeps walking for as long as it is shown, the pipeline simulates it by itself
+	if (showFleet)
+	{
+		if (framePipeline.IsRunning())
+			fleetFrameNumber = framePipeline.GetNumFramesSimulated();
+		else
+		{
+			fleet.Update(jobSystem);
+			fleetTrails.Push(&fleet.GetFrame().partMatrices[0], (float)(elapsedMilliseconds() * 0.001), jobSystem);
+			fleetFrameNumber++;
+		}
+		active = true;
+	}
+
+	if (animationRecorder.IsRecording())
+		animationRecorder.RecordTick(jointChannels);
+
+	requestRedraw();
+
+	if (active)
+		glutTimerFunc(10, animationTimer, 0);
+	else
+		animationTimerRunning = false;
+}
+
+// Posts a redisplay when the scene changed, or a timer for it when the last frame was
+// less than a refresh ago. Requests made before it is drawn are folded into it.
+void requestRedraw()
+{
+	double delay = redrawScheduler.Request(elapsedMilliseconds());
+	if (delay == 0.0)
+		glutPostRedisplay();
+	else if (delay > 0.0)
+		glutTimerFunc((unsigned int)ceil(delay), redrawTimer, 0);
+}
+
+void redrawTimer(int)
+{
+	glutPostRedisplay();
+}
+
+double elapsedMilliseconds()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Advances the robot's animations by one tick, returns true while any is still running
+bool animationTick()
+{
+	RobotPose pose = getRobotPose();
+	bool active = AnimateRobot(pose, robotAnimation);
+	setRobotPose(pose);
+
+	// Physics steps with the ticks so replays simulate the same frames
+	if (physicsMode)
+	{
+		RobotPose targets = pose;
+		GetWalkTargets(physicsTicks * 0.01f * 2.0f * 3.14159265f, targets);
+		robotPhysics.SetTargets(0, targets);
+		robotPhysics.Step(0.01f);
+		physicsTicks++;
+		active = true;
+	}
+	return active;
+}
+
+// Drops the robot onto the ground below it, standing as it does at rest
+void startPhysics()
+{
+	// The standing height is known once the robot has been built
+	float heading = robotJointState.GetAngle(0, JOINT_ROBOT_SPIN);
+	VECTOR3D position(0.0f, 0.0f, 0.0f);
+	robotPhysics.Init(robotDims, 1, &position, &heading);
+
+	// Highest ground within reach of the feet
+	float reach = 2.0f * robotDims.robotBodySize;
+	float top = -10.0f, height;
+	for (int k = 0; k < 9; k++)
+	{
+		if (particleGround.GetHeight((k % 3 - 1) * reach, (k / 3 - 1) * reach, height) && height > top)
+			top = height;
+	}
+	position.Set(0.0f, top + robotPhysics.GetStandingHeight() + 0.05f, 0.0f);
+	robotPhysics.Init(robotDims, 1, &position, &heading);
+	robotPhysics.SetGround(&particleGround);
+	physicsTicks = 0;
+}
+
+// Moves the fleet's simulation to its own thread, the trails start again timed from now
+void startPipeline()
+{
+	fleetTrails.Init(fleetSize, trailLength);
+	framePipeline.Start(&fleet, 0, 10, &fleetTrails);
+}
+
+// Brings the fleet back to the animation timer. The pipeline's last snapshot is dropped
+// and the fleet's own frame, left where the pipeline started, is brought up to date.
+void stopPipeline()
+{
+	framePipeline.Stop();
+	fleetTrails.Init(fleetSize, trailLength);
+	fleet.Update(jobSystem);
+	requestRedraw();
+}
+
+// World matrices of the robot's parts, from the physics in physics mode
+void computeRobotParts(MATRIX4X4 partMatrices[NUM_ROBOT_PARTS])
+{
+	if (physicsMode)
+	{
+		robotPhysics.GetPartMatrices(0, partMatrices);
+		return;
+	}
+	MATRIX4X4 root;
+	ComputeRobotTransforms(robotDims, getRobotPose(), root, partMatrices);
+}
+
+// The robot's joint angles as a pose
+RobotPose getRobotPose()
+{
+	RobotPose pose;
+	robotJointState.GetPose(0, pose);
+	return pose;
+}
+
+// Sets every joint of the robot, limited by the registry
+void setRobotPose(const RobotPose& pose)
+{
+	robotJointState.SetPose(0, pose);
+}
+
+
+// Callback, handles input from the keyboard, function and arrow keys
+void functionKeys(int key, int /*x*/, int /*y*/)
+{
+	handleSpecialKey(key);
+
+	if (animationRecorder.IsRecording())
+		animationRecorder.RecordEvent(RECORD_SPECIAL_KEY, key, jointChannels);
+
+	// a turned joint moves the contacts
+	if (showContacts)
+		startAnimationTimer();
+
+	requestRedraw();   // Redisplay if anything changed
+}
+
+// Turns a joint of the robot, stopping at its limits
+void turnJoint(int joint, float degrees)
+{
+	robotJointState.SetAngle(0, joint, robotJointState.GetAngle(0, joint) + degrees);
+}
+
+void handleSpecialKey(int key)
+{
+	switch (key) 
+	{
+	case GLUT_KEY_LEFT:
+		if (currentJoint >= 0)
+			turnJoint(currentJoint, -2.0f);
+		break;
+
+	case GLUT_KEY_RIGHT:
+		if (currentJoint >= 0)
+			turnJoint(currentJoint, 2.0f);
+		break;
+	}
+	/*
+	// Help key
+	if (key == GLUT_KEY_F1)
+	{
+
+	}
+	// Do transformations with arrow keys
+	//else if (...)   // GLUT_KEY_DOWN, GLUT_KEY_UP, GLUT_KEY_RIGHT, GLUT_KEY_LEFT
+	//{
+	//}
+	*/
+}
+
+
+// Replays a recorded session without a window, as fast as possible, and verifies that
+// every joint angle comes out bit-identical to the recording
+int replayAnimation(const char* fileName)
+{
+	AnimationPlayer player;
+	if (!player.Open(fileName, NUM_JOINT_CHANNELS))
+	{
+		fprintf(stderr, "replay: could not read animation log %s\n", fileName);
+		return 1;
+	}
+
+	if (!player.Matches(jointChannels))
+	{
+		fprintf(stderr, "replay: initial joint state differs from recording\n");
+		return 1;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	replaying = true;
+
+	int type, key;
+	int numRecords = 0, numTicks = 0;
+	AnimationReadStatus status;
+	while ((status = player.NextRecord(type, key)) == RECORD_READ)
+	{
+		switch (type)
+		{
+		case RECORD_TICK:
+			animationTick();
+			numTicks++;
+			break;
+		case RECORD_KEY:
+			handleKey((unsigned char)key);
+			break;
+		case RECORD_SPECIAL_KEY:
+			handleSpecialKey(key);
+			break;
+		case RECORD_SELECT_JOINT:
+			selectJoint(key - 1);
+			break;
+		}
+		numRecords++;
+
+		if (!player.Matches(jointChannels))
+		{
+			fprintf(stderr, "replay: joint state diverged at record %d\n", numRecords);
+			return 1;
+		}
+	}
+
+	// a log cut short or damaged only replays the part before it
+	if (status == RECORD_CORRUPT)
+	{
+		fprintf(stderr, "replay: animation log %s is truncated or corrupt after record %d\n", fileName, numRecords);
+		return 1;
+	}
+
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("replay: %d records (%d ticks) bit-identical, %.3f ms\n", numRecords, numTicks, elapsed);
+	return 0;
+}
+
+void closeRecorder()
+{
+	if (animationRecorder.IsRecording())
+	{
+		if (!animationRecorder.Close())
+			fprintf(stderr, "record: the animation log is incomplete, it could not all be written\n");
+		printf("record: average %.3f us, max %.3f us per record\n",
+			animationRecorder.GetAverageRecordTime(), animationRecorder.GetMaxRecordTime());
+	}
+}
+
+// Publishes the robot's and the drawn fleet's joint state for the frame display() drew
+void publishTelemetry(const FleetFrame* fleetFrame)
+{
+	double now = elapsedMilliseconds();
+	int numRobots = 1 + (fleetFrame ? fleetFrame->numRobots : 0);
+	telemetryPublisher.BeginFrame(telemetryFrameNumber++, now * 0.001, (float)(now - lastTelemetryTime), numRobots);
+	RobotPose pose = getRobotPose();
+	telemetryPublisher.WriteRobots(0, 1, &pose, robotPartMatrices, VECTOR3D(0.0f, 0.0f, 0.0f));
+	// &poses[0] of an empty frame is out of range
+	if (fleetFrame && fleetFrame->numRobots > 0)
+		telemetryPublisher.WriteRobots(1, fleetFrame->numRobots, &fleetFrame->poses[0], &fleetFrame->partMatrices[0],
+			getFleetOffset(), jobSystem);
+	telemetryPublisher.EndFrame();
+	lastTelemetryTime = now;
+
+	double publishTime = elapsedMilliseconds() - now;
+	telemetryPublishTime += publishTime;
+	maxTelemetryPublishTime = publishTime > maxTelemetryPublishTime ? publishTime : maxTelemetryPublishTime;
+}
+
+void closePublisher()
+{
+	if (telemetryPublisher.GetNumPublished() > 0)
+		printf("publish: %lld frames, average %.3f us, max %.3f us per frame\n", telemetryPublisher.GetNumPublished(),
+			1000.0 * telemetryPublishTime / telemetryPublisher.GetNumPublished(), 1000.0 * maxTelemetryPublishTime);
+	telemetryPublisher.Close();
+}
+
+// Reader of the frames another instance publishes with -publish. Prints the latest frame
+// once a second: how many frames arrived since, how old the frame was once copied and the
+// robot's joint angles. Runs for the given seconds, or until interrupted for 0.
+int monitorTelemetry(double seconds)
+{
+	TelemetryReader reader;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	auto elapsedSeconds = [&start]()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	printf("monitor: waiting for a publisher on %s\n", telemetryName);
+	while (!reader.Open(telemetryName))
+	{
+		if (seconds > 0.0 && elapsedSeconds() >= seconds)
+		{
+			fprintf(stderr, "monitor: no publisher on %s\n", telemetryName);
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	}
+
+	TelemetrySnapshot snapshot;
+	long long lastFrame = -1;
+	int retries = 0;
+	while (seconds <= 0.0 || elapsedSeconds() < seconds)
+	{
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		if (!reader.ReadLatest(snapshot, 100, &retries) || snapshot.frameNumber == lastFrame)
+			continue;
+		long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+
+		printf("frame %lld at %.2f s, %lld new, %.2f ms frame, %d robots, %.3f ms old, %d retries\n",
+			snapshot.frameNumber, snapshot.time, lastFrame < 0 ? 1 : snapshot.frameNumber - lastFrame,
+			snapshot.frameTime, snapshot.numRobots, (now - snapshot.publishTime) * 1e-6, retries);
+		const TelemetryRobot& robot = snapshot.robots[0];
+		for (int j = 0; j < NUM_JOINTS; j++)
+			printf("  %s %.1f", robotJoints[j].name, robot.angles[j]);
+		printf("\n  body at (%.2f, %.2f, %.2f)\n", robot.transforms[PART_BODY][3], robot.transforms[PART_BODY][7],
+			robot.transforms[PART_BODY][11]);
+		lastFrame = snapshot.frameNumber;
+	}
+	return 0;
+}
+
+// Framebuffer with colour and depth stencil renderbuffers of the window's size, bound in
+// place of the window so the result does not depend on it being visible. ids gets the
+// framebuffer and the two renderbuffers.
+static bool createOffscreenTarget(GLuint ids[3])
+{
+	glGenFramebuffers(1, &ids[0]);
+	glBindFramebuffer(GL_FRAMEBUFFER, ids[0]);
+	glGenRenderbuffers(2, &ids[1]);
+	glBindRenderbuffer(GL_RENDERBUFFER, ids[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, vWidth, vHeight);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ids[1]);
+	glBindRenderbuffer(GL_RENDERBUFFER, ids[2]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, vWidth, vHeight);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, ids[2]);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		return false;
+	reshape(vWidth, vHeight);
+	return true;
+}
+
+static void deleteOffscreenTarget(GLuint ids[3])
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteRenderbuffers(2, &ids[1]);
+	glDeleteFramebuffers(1, &ids[0]);
+}
+
+// Draws the scene into the bound framebuffer and reads it back, returns the average time
+// of numFrames draws. Rows come back from the bottom, the image is kept from the top.
+static double renderScene(int numFrames, RGBImage& image)
+{
+	display();
+	glFinish();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numFrames; i++)
+		display();
+	glFinish();
+	double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<unsigned char> pixels((size_t)vWidth * vHeight * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, vWidth, vHeight, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	image.Resize(vWidth, vHeight);
+	size_t row = (size_t)vWidth * 3;
+	for (int y = 0; y < vHeight; y++)
+		memcpy(&image.pixels[y * row], &pixels[(vHeight - 1 - y) * row], row);
+	return elapsed / numFrames;
+}
+
+// Renders the robot offscreen with fixed function lighting on the full tessellation, and
+// with the lighting shader on the coarse and on the full tessellation, then compares the
+// images with CompareImages() and times each path. Fails when the coarse shader image
+// differs from the full one, or strays from the fixed function look. Any OpenGL 3.2
+// implementation will do, e.g. Mesa's llvmpipe under a virtual X server.
+int runShadingTest()
+{
+	const int numFrames = 20;
+	const float pixelThreshold = 0.1f;
+	const double maxTessellationFraction = 0.001;
+	const double maxShadingFraction = 0.01;
+
+	if (!lightingShader.IsReady())
+	{
+		fprintf(stderr, "shading test: the lighting shader is not available\n");
+		return 1;
+	}
+
+	// Offscreen target, so the result does not depend on the window being visible
+	GLuint target[3];
+	if (!createOffscreenTarget(target))
+	{
+		fprintf(stderr, "shading test: could not create the offscreen framebuffer\n");
+		return 1;
+	}
+
+	int numTriangles = 0, numShadedTriangles = 0;
+	for (int i = 0; i < NUM_ROBOT_PARTS; i++)
+	{
+		numTriangles += primitiveLists[partPrimitive[i]].GetNumTriangles();
+		numShadedTriangles += shadedLists[partPrimitive[i]].GetNumTriangles();
+	}
+	printf("shading test: %dx%d, robot of %d triangles, %d with per-pixel lighting\n",
+		vWidth, vHeight, numTriangles, numShadedTriangles);
+	printf("%-10s %12s %12s %12s %17s %17s\n", "pose", "fixed ms", "shader ms", "shader full", "tessellation", "vs fixed");
+
+	int result = 0;
+	RGBImage fixedImage, shadedImage, fullImage;
+	for (int pose = 0; pose < 2; pose++)
+	{
+		if (pose == 1)
+		{
+			RobotPose stepPose = getRobotPose();
+			StartStepAnimation(stepPose, robotAnimation);
+			setRobotPose(stepPose);
+			for (int i = 0; i < 25; i++)
+				animationTick();
+			robotJointState.SetAngle(0, JOINT_ROBOT_SPIN, 30.0f);
+			robotJointState.SetAngle(0, JOINT_VERTICAL_SPIN, 10.0f);
+		}
+
+		perPixelLighting = false;
+		double fixedTime = renderScene(numFrames, fixedImage);
+		perPixelLighting = true;
+		double shadedTime = renderScene(numFrames, shadedImage);
+
+		// the shader on the full tessellation is the reference for the coarse meshes
+		shadedLists.swap(primitiveLists);
+		shadedStrips.swap(primitiveStrips);
+		double fullTime = renderScene(numFrames, fullImage);
+		shadedLists.swap(primitiveLists);
+		shadedStrips.swap(primitiveStrips);
+
+		// mean perceptual difference and the share of pixels that differ
+		ImageDifference tessellation, shading;
+		CompareImages(fullImage, shadedImage, pixelThreshold, tessellation);
+		CompareImages(fixedImage, shadedImage, pixelThreshold, shading);
+		bool ok = tessellation.differentFraction <= maxTessellationFraction && shading.differentFraction <= maxShadingFraction;
+		printf("%-10s %12.3f %12.3f %12.3f %9.5f %6.2f%% %9.5f %6.2f%%  %s\n", pose == 0 ? "standing" : "stepping",
+			fixedTime, shadedTime, fullTime, tessellation.meanDelta, 100.0 * tessellation.differentFraction,
+			shading.meanDelta, 100.0 * shading.differentFraction, ok ? "ok" : "FAILED");
+		if (!ok)
+			result = 1;
+	}
+
+	deleteOffscreenTarget(target);
+	return result;
+}
+
+// Canonical poses of the reference image test, each set from the rest pose
+static const char* renderTestPoses[] = { "rest", "step", "arm", "cannon", "spin", "tilt" };
+const int NUM_RENDER_TEST_POSES = sizeof(renderTestPoses) / sizeof(renderTestPoses[0]);
+
+static void setRenderTestPose(int pose)
+{
+	RobotPose testPose;
+	ResetPose(testPose);
+	robotAnimation = RobotAnimation();
+	switch (pose)
+	{
+	case 1:
+		// the top of the step, hip at 40 degrees
+		StartStepAnimation(testPose, robotAnimation);
+		for (int i = 0; i < 40; i++)
+			AnimateRobot(testPose, robotAnimation);
+		break;
+	case 2:
+		// arm raised, shoulder at -45 and elbow at 90 degrees
+		StartArmAnimation(testPose, robotAnimation);
+		for (int i = 0; i < 60; i++)
+			AnimateRobot(testPose, robotAnimation);
+		break;
+	case 3:
+		testPose.angles[JOINT_CANNON] = 45.0f;
+		break;
+	case 4:
+		testPose.angles[JOINT_ROBOT_SPIN] = 135.0f;
+		break;
+	case 5:
+		testPose.angles[JOINT_ROBOT_SPIN] = -30.0f;
+		testPose.angles[JOINT_VERTICAL_SPIN] = 20.0f;
+		break;
+	}
+	setRobotPose(testPose);
+	robotAnimation = RobotAnimation();
+}
+
+// Ways of drawing the robot the test covers, each with its own references
+struct RenderTestPath
+{
+	const char* name;
+	int primitiveMode;
+	bool perPixelLighting;
+};
+
+static const RenderTestPath renderTestPaths[] =
+{
+	{ "lists", PRIMITIVES_LISTS, false },
+	{ "strips", PRIMITIVES_STRIPS, false },
+	{ "glu", PRIMITIVES_GLU, false },
+	{ "shader", PRIMITIVES_LISTS, true },
+};
+const int NUM_RENDER_TEST_PATHS = sizeof(renderTestPaths) / sizeof(renderTestPaths[0]);
+
+struct RenderTestImage
+{
+	char name[32];
+	char fileName[512];
+	RGBImage image;
+	double drawTime;
+	bool found, written, ok;
+	ImageDifference difference;
+};
+
+// Renders every canonical pose on every drawing path offscreen and compares the images
+// against the references in directory, named <pose>-<path>.ppm, or writes them as the new
+// references when record is set. A pixel differs when its perceptual difference is over
+// pixelThreshold and no neighbour matches, see CompareImages(); an image fails when more
+// than maxDifferentFraction of its pixels differ, and gets a <pose>-<path>-diff.ppm beside
+// the reference. Drawing needs the one GL context, the reading, comparing and writing of
+// the images runs in parallel across them on the job system.
+int runRenderTest(const char* directory, bool record)
+{
+	const float pixelThreshold = 0.1f;
+	const double maxDifferentFraction = 0.001;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	GLuint target[3];
+	if (!createOffscreenTarget(target))
+	{
+		fprintf(stderr, "render test: could not create the offscreen framebuffer\n");
+		return 1;
+	}
+
+	std::vector<RenderTestImage> images;
+	images.reserve(NUM_RENDER_TEST_POSES * NUM_RENDER_TEST_PATHS);
+	for (int path = 0; path < NUM_RENDER_TEST_PATHS; path++)
+	{
+		const RenderTestPath& info = renderTestPaths[path];
+		if (info.perPixelLighting && !lightingShader.IsReady())
+		{
+			printf("render test: the lighting shader is not available, skipping its images\n");
+			continue;
+		}
+		primitiveMode = info.primitiveMode;
+		perPixelLighting = info.perPixelLighting;
+
+		for (int pose = 0; pose < NUM_RENDER_TEST_POSES; pose++)
+		{
+			setRenderTestPose(pose);
+			images.push_back(RenderTestImage());
+			RenderTestImage& image = images.back();
+			snprintf(image.name, sizeof(image.name), "%s-%s", renderTestPoses[pose], info.name);
+			snprintf(image.fileName, sizeof(image.fileName), "%s/%s.ppm", directory, image.name);
+			image.drawTime = renderScene(1, image.image);
+		}
+	}
+	deleteOffscreenTarget(target);
+	double renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	std::chrono::steady_clock::time_point compareStart = std::chrono::steady_clock::now();
+	jobSystem->ParallelFor((int)images.size(), 1, [&images, directory, record, pixelThreshold, maxDifferentFraction](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			RenderTestImage& image = images[i];
+			if (record)
+			{
+				image.written = WritePPM(image.fileName, image.image);
+				continue;
+			}
+
+			RGBImage reference;
+			image.found = ReadPPM(image.fileName, reference) &&
+				reference.width == image.image.width && reference.height == image.image.height;
+			if (!image.found)
+				continue;
+
+			RGBImage diff;
+			CompareImages(reference, image.image, pixelThreshold, image.difference, &diff);
+			image.ok = image.difference.differentFraction <= maxDifferentFraction;
+			if (!image.ok)
+			{
+				char diffName[520];
+				snprintf(diffName, sizeof(diffName), "%s/%s-diff.ppm", directory, image.name);
+				WritePPM(diffName, diff);
+			}
+		}
+	});
+	double compareTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compareStart).count();
+
+	int result = 0;
+	printf("render test: %d images of %dx%d, %s %s\n", (int)images.size(), vWidth, vHeight,
+		record ? "recording references into" : "comparing against the references in", directory);
+	if (!record)
+		printf("%-16s %9s %10s %9s %10s %9s\n", "image", "draw ms", "mean", "max", "different", "shifted");
+	for (size_t i = 0; i < images.size(); i++)
+	{
+		const RenderTestImage& image = images[i];
+		if (record)
+		{
+			if (!image.written)
+			{
+				fprintf(stderr, "render test: could not write %s\n", image.fileName);
+				result = 1;
+			}
+			continue;
+		}
+		if (!image.found)
+		{
+			printf("%-16s %9.3f  no reference of this size, record one with -rendertest %s record\n",
+				image.name, image.drawTime, directory);
+			result = 1;
+			continue;
+		}
+		const ImageDifference& difference = image.difference;
+		printf("%-16s %9.3f %10.5f %9.3f %10d %9d  %s\n", image.name, image.drawTime, difference.meanDelta,
+			difference.maxDelta, difference.differentPixels, difference.shiftedPixels, image.ok ? "ok" : "FAILED");
+		if (!image.ok)
+			result = 1;
+	}
+
+	double totalTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("render test: %.1f ms in total, %.1f ms drawing, %.1f ms %s on %d threads  %s\n", totalTime, renderTime,
+		compareTime, record ? "writing" : "comparing", jobSystem->GetNumThreads(), result == 0 ? "ok" : "FAILED");
+	return result;
+}
+
+
+// Mouse button callback - use only if you want to 
+void mouse(int button, int state, int x, int y)
+{
+	currentButton = button;
+
+	switch (button)
+	{
+	case GLUT_LEFT_BUTTON:
+		if (state == GLUT_DOWN)
+		{
+			lastMouseX = clickX = x;
+			lastMouseY = clickY = y;
+		}
+		// a click rather than the end of a camera drag
+		else if (abs(x - clickX) + abs(y - clickY) <= 2)
+			pickJoint(x, y);
+		break;
+	case GLUT_RIGHT_BUTTON:
+		if (state == GLUT_DOWN)
+		{
+			lastMouseX = x;
+			lastMouseY = y;
+		}
+		break;
+	// Wheel, reported as buttons 3 and 4 by freeglut
+	case 3:
+		if (state == GLUT_DOWN)
+			camera.Zoom(0.9f);
+		break;
+	case 4:
+		if (state == GLUT_DOWN)
+			camera.Zoom(1.0f / 0.9f);
+		break;
+	default:
+		break;
+	}
+
+	requestRedraw();   // Redisplay if anything changed
+}
+
+
+// Mouse motion callback - use only if you want to 
+void mouseMotionHandler(int xMouse, int yMouse)
+{
+	int dx = xMouse - lastMouseX;
+	int dy = yMouse - lastMouseY;
+	lastMouseX = xMouse;
+	lastMouseY = yMouse;
+
+	// Half a degree per pixel, dragging up raises the camera
+	if (currentButton == GLUT_LEFT_BUTTON)
+		camera.Orbit(-0.5f * dx, 0.5f * dy);
+	// Dragging down moves away, 1% of the distance per pixel
+	else if (currentButton == GLUT_RIGHT_BUTTON)
+		camera.Zoom((float)pow(1.01, dy));
+
+	requestRedraw();   // Redisplay if anything changed
+}
+